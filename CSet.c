@@ -1,5 +1,12 @@
+#define _GNU_SOURCE
 #include "CSet.h"
+#include "CSetKernels.h"
+#include "CSetInternal.h"
+#include "CSetTrace.h"
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 // CSet provides an implementation of a set type for storing signed
 // 32-bit integer values (int32_t).
@@ -8,12 +15,38 @@
 //  - storage is array-based
 //  - duplicate elements are not allowed in a CSet
 //  - logically empty cells are set to INT32_MAX
-//  - sets can contain up to UINT32_MAX elements
+//  - sets can contain up to UINT32_MAX - 1 elements (one cell of the largest
+//    possible array holds the INT32_MAX sentinel); indices are unsigned
+//    32-bit, byte sizes are size_t, and growth saturates instead of
+//    overflowing
+//  - arrays of at least MAP_THRESHOLD_BYTES are mapped directly with mmap
+//    and grown with mremap, which moves page table entries instead of
+//    copying multi-GB arrays
 //  - unless noted to the contrary, the amortized cost of operations is O(N),
 //    where N is the number of elements in the CSet
 //  - amortized cost of search is O(log N)
 //  - amortized cost of union, intersection and difference is O(N)
+//  - bulk removals compact Data in a single pass, moving each surviving
+//    element at most once
 //  - cost of checking size, and full and empty tests are O(1)
+//  - filling, copying, comparing and searching Data run on the SIMD kernels
+//    in CSetKernels.c, chosen for the CPU once at startup
+//  - cost of maintaining the set's hash is O(1) per element inserted or removed
+//  - a set may optionally carry a summary (blocked Bloom filter plus per-block
+//    min/max fences over Data) which answers most failed searches with a
+//    single cache-line access; it is kept current by every mutating operation
+//  - observers attached to a set are notified of every element inserted or
+//    removed; set operations reinitialize their result, which detaches them
+//  - while a CSet_Trace is active, every operation that reads or changes
+//    elements is recorded for replay (CSetTrace.c); set operations build
+//    their result with the untraced Init and Insert, so only the call
+//    itself is recorded
+//  - AdoptSorted, Move, Swap and Release transfer a Data array between sets
+//    and callers without copying it; an array handed out by Release is
+//    freed with CSet_FreeArray or handed back with AdoptSorted
+//  - a set flagged CSET_FLAG_READONLY borrows its Data (for example a view
+//    into a CSet_Store); operations that would modify the elements in place
+//    fail, while Load, Copy and makeEmpty give it fresh storage of its own
 //  - there are no memory leaks during any of the supported operations
 //
 // Every initialized CSet object A satisfies the following contract:
@@ -32,23 +65,69 @@
    uint32_t Capacity;    // dimension of the set's array
    uint32_t Usage;       // number of elements in the set
    int32_t* Data;        // pointer to the set's array
+   uint64_t Hash;        // order-independent fingerprint of the elements
+   struct _CSet_Summary* Summary; // optional Bloom filter and block fences, or NULL
+   struct _CSet_Observer* Observers; // callbacks notified of changes, or NULL
+   uint32_t Flags;       // CSET_FLAG_* bits
 };
 
 typedef struct _CSet CSet;*/
 
+// The summary splits Data into blocks of SUMMARY_BLOCK elements (one cache
+// line) and records the first and last value of each. The Bloom filter is
+// made of 512-bit blocks, so each probe touches exactly one cache line.
+struct _CSet_Summary {
+
+   uint64_t* Bloom;      // BloomBlocks * SUMMARY_BLOOM_WORDS filter words
+   uint32_t BloomBlocks; // number of 512-bit filter blocks
+   uint32_t Sized;       // number of elements the filter was sized for
+   uint32_t Removed;     // removals since the filter was last rebuilt
+   uint32_t Fences;      // number of Data blocks, ceil(Usage / SUMMARY_BLOCK)
+   uint32_t FenceCap;    // dimension of the Min and Max arrays
+   int32_t* Min;         // first value of each Data block
+   int32_t* Max;         // last value of each Data block
+};
+
+typedef struct _CSet_Summary CSet_Summary;
+
 //Global Declaration
 #define DEFAULT_CAPACITY 10
 #define DUPLICATE_FLAG -1
+#define SUMMARY_BLOCK 16
+#define SUMMARY_BLOOM_WORDS 8
+#define SUMMARY_BITS_PER_ELEMENT 10
+#define CSET_FILE_MAGIC 0x54455343u   // "CSET" in little-endian byte order
+#define MAP_THRESHOLD_BYTES ((size_t) 64 << 20)
 
 //Internal Helper Declarations
-void CSet_Init_Empty(CSet* const pSet);
-void Copy_Elements(const int32_t* const source, uint32_t* target, uint32_t Sz);
+void Copy_Elements(const int32_t* const source, int32_t* target, uint32_t Sz);
 bool CSet_Insert_(CSet* pSet, int32_t val);
+bool Insert_Untraced(CSet* const pSet, int32_t Value);
+bool Init_Untraced(CSet* const pSet, uint32_t Sz);
 bool CSet_Init_(CSet* const pSet, uint32_t Sz);
-bool Make_Initialized_Array(int32_t** arr, uint32_t Sz);
-bool Extend_CSet_Data_Array(CSet* pSet, int32_t size);
-int Get_Insertion_Index_Of(CSet* pSet, int32_t val);
-int Find_Index_Helper(CSet* pSet, int32_t val);
+bool Make_Initialized_Array(int32_t** arr, uint32_t Sz, bool* pMapped);
+bool Extend_CSet_Data_Array(CSet* pSet, uint32_t size);
+bool Resize_Data(CSet* pSet, uint32_t size);
+void Free_Array(int32_t* arr, uint32_t Sz, bool mapped);
+size_t Mapped_Bytes(uint32_t Sz);
+uint32_t Grown_Capacity(uint32_t capacity);
+int64_t Get_Insertion_Index_Of(CSet* pSet, int32_t val);
+uint32_t Find_Index_Helper(const CSet* pSet, int32_t val);
+uint32_t Lower_Bound(const CSet* pSet, int32_t val);
+void Truncate_Usage(CSet* pSet, uint32_t newUsage);
+uint64_t Element_Hash(int32_t val);
+bool Summary_Build(CSet* pSet);
+bool Summary_Bloom_Rebuild(CSet* pSet);
+bool Summary_Fences_Rebuild(CSet* pSet, uint32_t first);
+void Summary_Bloom_Add(CSet_Summary* pSummary, int32_t val);
+bool Summary_Bloom_Test(const CSet_Summary* pSummary, int32_t val);
+void Notify_Inserted(const CSet* pSet, int32_t val);
+void Notify_Removed(const CSet* pSet, int32_t val);
+void Notify_Reset(const CSet* pSet);
+void Summary_After_Insert(CSet* pSet, int32_t val, uint32_t index);
+void Summary_After_Remove(CSet* pSet, uint32_t index);
+void Summary_After_Reload(CSet* pSet);
+bool Summary_Contains(const CSet* pSet, int32_t val);
 
 /**
  * Initializes an empty pSet object, with capacity Sz.
@@ -71,14 +150,11 @@ int Find_Index_Helper(CSet* pSet, int32_t val);
  *    true if successful, false otherwise
  */
 bool CSet_Init(CSet* const pSet, uint32_t Sz){
-	if(Sz == 0){
-		CSet_Init_Empty(pSet);
-		return true;
-	}
-	else{
-		return CSet_Init_(pSet, Sz);
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_INIT, pSet, NULL, NULL, Sz, 0, NULL, 0);
 	}
-}; 
+	return Init_Untraced(pSet, Sz);
+};
 
 /**
  * Loads specified values into a pSet object, replacing any previous contents.
@@ -102,19 +178,26 @@ bool CSet_Init(CSet* const pSet, uint32_t Sz){
  *    true if successful, false otherwise
  */
 bool CSet_Load(CSet* const pSet, uint32_t Sz, const int32_t* const Data, uint32_t DSz){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_LOAD, pSet, NULL, NULL, Sz, 0, Data, DSz);
+	}
 	int32_t* temp;
-	int i = 0;
-	bool success = Make_Initialized_Array(&temp, Sz);
+	bool mapped;
+	bool success = Make_Initialized_Array(&temp, Sz, &mapped);
 	if(!success){
 		return false;
 	}
-	if(pSet->Data != NULL){
-		free(pSet->Data);
-	}
+	Release_Data(pSet);
 	pSet->Capacity = Sz;
 	pSet->Usage    = DSz;
 	pSet->Data     = temp;
+	if(mapped){
+		pSet->Flags |= CSET_FLAG_MAPPED;
+	}
 	Copy_Elements(Data, pSet->Data, DSz);
+	pSet->Hash     = Elements_Hash(pSet->Data, DSz);
+	Summary_After_Reload(pSet);
+	Notify_Reset(pSet);
 	return true;
 };
 
@@ -135,23 +218,10 @@ bool CSet_Load(CSet* const pSet, uint32_t Sz, const int32_t* const Data, uint32_
  *    true if successful, false otherwise
  */
 bool CSet_Insert(CSet* const pSet, int32_t Value){
-	bool success;
-	if(!(pSet->Data)){
-		if((success = CSet_Init(pSet, DEFAULT_CAPACITY))){
-			return CSet_Insert_(pSet, Value);
-		}
-		else{
-			return false;
-		}
-	}
-	else if((pSet->Usage) == (pSet->Capacity - 1)){
-		success = Extend_CSet_Data_Array(pSet, (pSet->Capacity * 2));
-		if(success){
-			return CSet_Insert_(pSet, Value);
-		}
-		return false;
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_INSERT, pSet, NULL, NULL, (uint32_t) Value, 0, NULL, 0);
 	}
-	return CSet_Insert_(pSet, Value);
+	return Insert_Untraced(pSet, Value);
 };
 
 /**
@@ -175,8 +245,14 @@ bool CSet_Insert(CSet* const pSet, int32_t Value){
  *    true if successful, false otherwise
  */
 bool CSet_Copy(CSet* const pTarget, const CSet* const pSource){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_COPY, pTarget, pSource, NULL, 0, 0, NULL, 0);
+	}
+	if(pTarget->Flags & CSET_FLAG_READONLY){
+		Release_Data(pTarget);
+	}
 	if(pTarget->Data == NULL){
-		if(!CSet_Init(pTarget, pSource->Capacity)){
+		if(!CSet_Init_(pTarget, pSource->Capacity)){
 			return false;
 		}
 	}
@@ -187,15 +263,27 @@ bool CSet_Copy(CSet* const pTarget, const CSet* const pSource){
 		}
 	}
 	else if(pTarget->Capacity > pSource->Capacity){
-		free(pTarget->Data);
-		bool success = Make_Initialized_Array(&(pTarget->Data), pSource->Capacity);
-		if(!success){
+		int32_t* temp;
+		bool mapped;
+		if(!Make_Initialized_Array(&temp, pSource->Capacity, &mapped)){
 			return false;
 		}
+		Release_Data(pTarget);
+		pTarget->Data = temp;
+		pTarget->Usage = 0;
+		if(mapped){
+			pTarget->Flags |= CSET_FLAG_MAPPED;
+		}
 	}
 	Copy_Elements(pSource->Data, pTarget->Data, pSource->Usage);
+	if(pTarget->Usage > pSource->Usage){
+		CSet_Active_Kernels->Fill(pTarget->Data + pSource->Usage, INT32_MAX, pTarget->Usage - pSource->Usage);
+	}
 	pTarget->Usage = pSource->Usage;
 	pTarget->Capacity = pSource->Capacity;
+	pTarget->Hash = pSource->Hash;
+	Summary_After_Reload(pTarget);
+	Notify_Reset(pTarget);
 	return true;
 };
 
@@ -211,10 +299,16 @@ bool CSet_Copy(CSet* const pTarget, const CSet* const pSource){
  *    true if Value belongs to *pSet, false otherwise
  */
 bool CSet_Contains(const CSet* const pSet, int32_t Value){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_CONTAINS, pSet, NULL, NULL, (uint32_t) Value, 0, NULL, 0);
+	}
 	if(pSet->Data == NULL){
 		return false;
 	}
-	int index = Find_Index_Helper(pSet, Value);
+	if(pSet->Summary){
+		return Summary_Contains(pSet, Value);
+	}
+	uint32_t index = Find_Index_Helper(pSet, Value);
 	return (pSet->Data[index] == Value);
 };
 
@@ -236,24 +330,214 @@ bool CSet_Contains(const CSet* const pSet, int32_t Value){
  *    true if Value was removed, false otherwise
  */ 
 bool CSet_Remove(CSet* const pSet, int32_t Value){
-	if(pSet->Data == NULL){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_REMOVE, pSet, NULL, NULL, (uint32_t) Value, 0, NULL, 0);
+	}
+	if(pSet->Data == NULL || (pSet->Flags & CSET_FLAG_READONLY)){
 		return false;
 	}
-	int index = Find_Index_Helper(pSet, Value);
+	uint32_t index = Find_Index_Helper(pSet, Value);
 	if(pSet->Data[index] == Value){
-		while(index < (pSet->Usage -1)){
-			pSet->Data[index] = pSet->Data[index + 1];
-			index++;
-		}
+		memmove(pSet->Data + index, pSet->Data + index + 1, sizeof(int32_t) * (size_t)(pSet->Usage - 1 - index));
 		pSet->Data[pSet->Usage - 1] = INT32_MAX;
 		pSet->Usage--;
+		pSet->Hash -= Element_Hash(Value);
+		Summary_After_Remove(pSet, index);
+		Notify_Removed(pSet, Value);
 		return true;
 	}
 	return false;
 };
 
+/**
+ * Removes every element of Values[0:VSz-1] from a pSet object. Values may be
+ * unsorted and may contain duplicates or non-members. Data is compacted in a
+ * single pass, so the cost is O(N + VSz log VSz).
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ *    Values points to an array of dimension >= VSz, or is NULL if VSz == 0
+ * Post:  
+ *    No element of Values is a member of *pSet
+ *    pSet->Capacity is unchanged
+ *    *pSet satisfies the CSet contract
+ *    If memory for sorting Values cannot be allocated, *pSet is unchanged
+ * Returns:
+ *    the number of elements removed
+ */
+uint32_t CSet_RemoveMany(CSet* const pSet, const int32_t* const Values, uint32_t VSz){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_REMOVE_MANY, pSet, NULL, NULL, 0, 0, Values, VSz);
+	}
+	if(CSet_isEmpty(pSet) || (pSet->Flags & CSET_FLAG_READONLY) || VSz == 0){
+		return 0;
+	}
+	const int32_t* sorted = Values;
+	int32_t* temp = NULL;
+	uint32_t v = 1;
+	while(v < VSz && Values[v - 1] <= Values[v]){
+		v++;
+	}
+	if(v < VSz){
+		temp = (int32_t*) malloc(sizeof(int32_t) * VSz);
+		if(!temp){
+			return 0;
+		}
+		memcpy(temp, Values, sizeof(int32_t) * VSz);
+		qsort(temp, VSz, sizeof(int32_t), Compare_Int32);
+		sorted = temp;
+	}
+	uint32_t read = Lower_Bound(pSet, sorted[0]);
+	uint32_t write = read;
+	v = 0;
+	while(read < pSet->Usage){
+		int32_t val = pSet->Data[read];
+		while(v < VSz && sorted[v] < val){
+			v++;
+		}
+		if(v < VSz && sorted[v] == val){
+			pSet->Hash -= Element_Hash(val);
+			Notify_Removed(pSet, val);
+		}
+		else{
+			pSet->Data[write] = val;
+			write++;
+		}
+		read++;
+	}
+	free(temp);
+	uint32_t removed = pSet->Usage - write;
+	Truncate_Usage(pSet, write);
+	return removed;
+};
+
+/**
+ * Removes every value x with Lo <= x < Hi from a pSet object. The range is
+ * located with two binary searches and closed with one memmove.
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ * Post:  
+ *    No value in [Lo, Hi) is a member of *pSet
+ *    pSet->Capacity is unchanged
+ *    *pSet satisfies the CSet contract
+ * Returns:
+ *    the number of elements removed
+ */
+uint32_t CSet_RemoveRange(CSet* const pSet, int32_t Lo, int32_t Hi){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_REMOVE_RANGE, pSet, NULL, NULL, (uint32_t) Lo, (uint32_t) Hi, NULL, 0);
+	}
+	if(CSet_isEmpty(pSet) || (pSet->Flags & CSET_FLAG_READONLY) || Lo >= Hi){
+		return 0;
+	}
+	uint32_t first = Lower_Bound(pSet, Lo);
+	uint32_t last = Lower_Bound(pSet, Hi);
+	if(first == last){
+		return 0;
+	}
+	uint32_t i = first;
+	while(i < last){
+		pSet->Hash -= Element_Hash(pSet->Data[i]);
+		Notify_Removed(pSet, pSet->Data[i]);
+		i++;
+	}
+	memmove(pSet->Data + first, pSet->Data + last, sizeof(int32_t) * (pSet->Usage - last));
+	uint32_t removed = last - first;
+	Truncate_Usage(pSet, pSet->Usage - removed);
+	return removed;
+};
+
+/**
+ * Removes every element of a pSet object for which Pred returns true. Pred
+ * is called once per element, in increasing order, and Data is compacted in
+ * the same pass. An active trace records the call as a RemoveMany of the
+ * elements removed.
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ *    Pred is a function that does not modify *pSet
+ * Post:  
+ *    No element x with Pred(x, Ctx) == true is a member of *pSet
+ *    pSet->Capacity is unchanged
+ *    *pSet satisfies the CSet contract
+ * Returns:
+ *    the number of elements removed
+ */
+uint32_t CSet_RemoveIf(CSet* const pSet, bool (*Pred)(int32_t Value, void* Ctx), void* Ctx){
+	if(CSet_isEmpty(pSet) || (pSet->Flags & CSET_FLAG_READONLY)){
+		if(CSet_Active_Trace){
+			Trace_Record(CSet_Active_Trace, CSET_TRACE_REMOVE_MANY, pSet, NULL, NULL, 0, 0, NULL, 0);
+		}
+		return 0;
+	}
+	// A predicate cannot be replayed, so a trace records the dropped elements
+	int32_t* dropped = CSet_Active_Trace ? (int32_t*) malloc(sizeof(int32_t) * pSet->Usage) : NULL;
+	uint32_t read = 0, write = 0;
+	while(read < pSet->Usage){
+		int32_t val = pSet->Data[read];
+		if(Pred(val, Ctx)){
+			pSet->Hash -= Element_Hash(val);
+			Notify_Removed(pSet, val);
+			if(dropped){
+				dropped[read - write] = val;
+			}
+		}
+		else{
+			pSet->Data[write] = val;
+			write++;
+		}
+		read++;
+	}
+	uint32_t removed = pSet->Usage - write;
+	Truncate_Usage(pSet, write);
+	if(CSet_Active_Trace){
+		if(!dropped){
+			CSet_Active_Trace->Failed = true;
+		}
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_REMOVE_MANY, pSet, NULL, NULL, 0, 0, dropped, dropped ? removed : 0);
+		free(dropped);
+	}
+	return removed;
+};
+
+/**
+ * Reduces the capacity of a pSet object once its usage has dropped below
+ * Percent percent of its capacity. The new capacity is twice the usage, but
+ * never less than DEFAULT_CAPACITY.
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ *    Percent <= 100
+ * Post:  
+ *    The elements of *pSet are unchanged
+ *    If pSet->Usage * 100 < pSet->Capacity * Percent and the reallocation
+ *    succeeds, pSet->Capacity == max(2 * pSet->Usage, DEFAULT_CAPACITY)
+ *    *pSet satisfies the CSet contract
+ * Returns:
+ *    true if the capacity was reduced, false otherwise
+ */
+bool CSet_Shrink(CSet* const pSet, uint32_t Percent){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_SHRINK, pSet, NULL, NULL, Percent, 0, NULL, 0);
+	}
+	if(pSet->Data == NULL || (pSet->Flags & CSET_FLAG_READONLY) ||
+		(uint64_t)pSet->Usage * 100 >= (uint64_t)pSet->Capacity * Percent){
+		return false;
+	}
+	uint64_t size = (uint64_t) pSet->Usage * 2;
+	if(size < DEFAULT_CAPACITY){
+		size = DEFAULT_CAPACITY;
+	}
+	if(size >= pSet->Capacity){
+		return false;
+	}
+	return Resize_Data(pSet, (uint32_t) size);
+};
+
 /**
  * Determines if two CSet objects contain the same elements.
+ * Sets whose hashes differ are rejected in O(1) without scanning.
  *
  * Pre:
  *    *pA satisfies the CSet contract
@@ -265,24 +549,21 @@ bool CSet_Remove(CSet* const pSet, int32_t Value){
  *    true if sets contain same elements, false otherwise
  */
 bool CSet_Equals(const CSet* const pA, const CSet* const pB){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_EQUALS, pA, pB, NULL, 0, 0, NULL, 0);
+	}
 	if(!pA->Data && !pB->Data){
 		return true;
 	}
-	else if(!pA->Data || !pB->Data || (pA->Usage != pB->Usage)){
+	else if(!pA->Data || !pB->Data || (pA->Usage != pB->Usage) || (pA->Hash != pB->Hash)){
 		return false;
 	}
-	int i = 0;
-	while(i < pA->Usage){
-		if(pA->Data[i] != pB->Data[i]){
-			return false;
-		}
-		i++;
-	}
-	return true;
+	return CSet_Active_Kernels->Equal(pA->Data, pB->Data, pA->Usage);
 };
 
 /**
- * Determines if one CSet object is a subset of another.
+ * Determines if one CSet object is a subset of another. If *pB carries a
+ * summary, blocks of *pB that cannot hold elements of *pA are skipped.
  *
  * Pre:
  *    *pA satisfies the CSet contract
@@ -294,6 +575,9 @@ bool CSet_Equals(const CSet* const pA, const CSet* const pB){
  *    true if *pB contains every element of *pA, false otherwise
  */
 bool CSet_isSubsetOf(const CSet* const pA, const CSet* const pB){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_SUBSET, pA, pB, NULL, 0, 0, NULL, 0);
+	}
 	if(pA->Usage > pB->Usage){
 		return false;
 	}
@@ -306,7 +590,39 @@ bool CSet_isSubsetOf(const CSet* const pA, const CSet* const pB){
 	if(pA->Data == NULL){
 		return true;
 	}
-	int i = 0, smallInd = 0;
+	if(pB->Summary && pA->Usage > 0){
+		// Walk *pA against *pB's fences so whole blocks of *pB are skipped
+		// and most missing elements are rejected by the Bloom filter.
+		const CSet_Summary* pSum = pB->Summary;
+		uint32_t a = 0, blk = 0;
+		if(pB->Usage == 0 || pA->Data[0] < pSum->Min[0] ||
+			pA->Data[pA->Usage - 1] > pSum->Max[pSum->Fences - 1]){
+			return false;
+		}
+		while(a < pA->Usage){
+			int32_t val = pA->Data[a];
+			if(!Summary_Bloom_Test(pSum, val)){
+				return false;
+			}
+			while(pSum->Max[blk] < val){
+				blk++;
+			}
+			uint32_t i = blk * SUMMARY_BLOCK;
+			uint32_t end = (blk + 1) * SUMMARY_BLOCK;
+			if(end > pB->Usage){
+				end = pB->Usage;
+			}
+			while(i < end && pB->Data[i] < val){
+				i++;
+			}
+			if(i == end || pB->Data[i] != val){
+				return false;
+			}
+			a++;
+		}
+		return true;
+	}
+	uint32_t i = 0, smallInd = 0;
 	while(i < pB->Usage){
 		if(pB->Data[i] == pA->Data[smallInd]){
 			smallInd++;
@@ -316,6 +632,80 @@ bool CSet_isSubsetOf(const CSet* const pA, const CSet* const pB){
 	return (smallInd == pA->Usage);
 };
 
+/**
+ * Determines if two CSet objects have at least one element in common.
+ * If both sets carry a summary, pairs of blocks whose fences do not
+ * overlap are skipped without reading Data.
+ *
+ * Pre:
+ *    *pA satisfies the CSet contract
+ *    *pB satisfies the CSet contract
+ * Post:  
+ *    *pA is unchanged
+ *    *pB is unchanged
+ * Returns:
+ *    true if some element is contained in both *pA and *pB, false otherwise
+ */
+bool CSet_Intersects(const CSet* const pA, const CSet* const pB){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_INTERSECTS, pA, pB, NULL, 0, 0, NULL, 0);
+	}
+	if(CSet_isEmpty(pA) || CSet_isEmpty(pB)){
+		return false;
+	}
+	uint32_t a = 0, b = 0;
+	uint32_t aEnd = pA->Usage, bEnd = pB->Usage;
+	if(pA->Summary && pB->Summary){
+		const CSet_Summary* pSA = pA->Summary;
+		const CSet_Summary* pSB = pB->Summary;
+		uint32_t blkA = 0, blkB = 0;
+		while(blkA < pSA->Fences && blkB < pSB->Fences){
+			if(pSA->Max[blkA] < pSB->Min[blkB]){
+				blkA++;
+			}
+			else if(pSB->Max[blkB] < pSA->Min[blkA]){
+				blkB++;
+			}
+			else{
+				a = blkA * SUMMARY_BLOCK;
+				b = blkB * SUMMARY_BLOCK;
+				aEnd = (a + SUMMARY_BLOCK < pA->Usage) ? a + SUMMARY_BLOCK : pA->Usage;
+				bEnd = (b + SUMMARY_BLOCK < pB->Usage) ? b + SUMMARY_BLOCK : pB->Usage;
+				while(a < aEnd && b < bEnd){
+					if(pA->Data[a] < pB->Data[b]){
+						a++;
+					}
+					else if(pA->Data[a] > pB->Data[b]){
+						b++;
+					}
+					else{
+						return true;
+					}
+				}
+				if(pSA->Max[blkA] < pSB->Max[blkB]){
+					blkA++;
+				}
+				else{
+					blkB++;
+				}
+			}
+		}
+		return false;
+	}
+	while(a < aEnd && b < bEnd){
+		if(pA->Data[a] < pB->Data[b]){
+			a++;
+		}
+		else if(pA->Data[a] > pB->Data[b]){
+			b++;
+		}
+		else{
+			return true;
+		}
+	}
+	return false;
+};
+
 /**
  * Sets *pUnion to be the union of the sets *pA and *pB.
  *
@@ -337,38 +727,41 @@ bool CSet_isSubsetOf(const CSet* const pA, const CSet* const pB){
  *    true if the union is successfully created; false otherwise
  */
 bool CSet_Union(CSet* const pUnion, const CSet* const pA, const CSet* const pB){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_UNION, pUnion, pA, pB, 0, 0, NULL, 0);
+	}
 	if((pA->Data == NULL && pB->Data == NULL) || //shouldnt return false for these...should return the opposite 
-		!CSet_Init(pUnion, (pA->Capacity + pB->Capacity))){
+		!Init_Untraced(pUnion, (uint64_t) pA->Capacity + pB->Capacity > UINT32_MAX ?
+		UINT32_MAX : pA->Capacity + pB->Capacity)){
 		return false;
 	}
 	if(pA->Data == NULL){
-		int i = 0;
+		uint32_t i = 0;
 		while(i < pB->Usage){
-			CSet_Insert(pUnion, pB->Data[i]);
+			Insert_Untraced(pUnion, pB->Data[i]);
 			i++;
 		}
 		return true;
 	}
 	if(pB->Data == NULL){
-		int i = 0;
+		uint32_t i = 0;
 		while(i < pA->Usage){
-			CSet_Insert(pUnion, pA->Data[i]);
+			Insert_Untraced(pUnion, pA->Data[i]);
 			i++;
 		}
 		return true;
 	}
-	int i = 0, a = 0, b = 0;
-	int maxUse = pA->Usage > pB->Usage ? pA->Usage : pB->Usage;
+	uint32_t a = 0, b = 0;
 	bool success, done = false;
 	while(!done){
 		if((pA->Data[a] > pB->Data[b])){
 			if(b == (pB->Usage - 1)){
-				success = CSet_Insert(pUnion, pB->Data[b]);
+				success = Insert_Untraced(pUnion, pB->Data[b]);
 				if(!success){
 					return false;
 				}
 				while(a < pA->Usage){
-					success = CSet_Insert(pUnion, pA->Data[a]);
+					success = Insert_Untraced(pUnion, pA->Data[a]);
 					if(!success){
 						return false;
 					}
@@ -377,7 +770,7 @@ bool CSet_Union(CSet* const pUnion, const CSet* const pA, const CSet* const pB){
 				done = true;
 			}
 			else{
-				success = CSet_Insert(pUnion, pB->Data[b]);
+				success = Insert_Untraced(pUnion, pB->Data[b]);
 				if(!success){
 					return false;
 				}
@@ -386,12 +779,12 @@ bool CSet_Union(CSet* const pUnion, const CSet* const pA, const CSet* const pB){
 		}
 		else if((pA->Data[a] < pB->Data[b])){
 			if(a == (pA->Usage - 1)){
-				success = CSet_Insert(pUnion, pA->Data[a]);
+				success = Insert_Untraced(pUnion, pA->Data[a]);
 				if(!success){
 					return false;
 				}
 				while(b < pB->Usage){
-					success = CSet_Insert(pUnion, pB->Data[b]);
+					success = Insert_Untraced(pUnion, pB->Data[b]);
 					if(!success){
 					return false;
 				}
@@ -400,7 +793,7 @@ bool CSet_Union(CSet* const pUnion, const CSet* const pA, const CSet* const pB){
 				done = true;
 			}
 			else{
-				success = CSet_Insert(pUnion, pA->Data[a]);
+				success = Insert_Untraced(pUnion, pA->Data[a]);
 				if(!success){
 					return false;
 				}
@@ -408,7 +801,7 @@ bool CSet_Union(CSet* const pUnion, const CSet* const pA, const CSet* const pB){
 			}
 		}
 		else{
-			success = CSet_Insert(pUnion, pA->Data[a]);
+			success = Insert_Untraced(pUnion, pA->Data[a]);
 			if(!success){
 					return false;
 			}
@@ -444,12 +837,15 @@ bool CSet_Union(CSet* const pUnion, const CSet* const pA, const CSet* const pB){
  *    true if the intersection is successfully created; false otherwise
  */
 bool CSet_Intersection(CSet* const pIntersection, const CSet* const pA, const CSet* const pB){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_INTERSECTION, pIntersection, pA, pB, 0, 0, NULL, 0);
+	}
 	if (pA->Data == NULL || pB->Data == NULL || 
-		!CSet_Init(pIntersection, pA->Capacity > pB->Capacity ? pA->Capacity : pB->Capacity)){
+		!Init_Untraced(pIntersection, pA->Capacity > pB->Capacity ? pA->Capacity : pB->Capacity)){
 		return false;
 	}
 	bool done = false, success;
-	int a = 0, b = 0;
+	uint32_t a = 0, b = 0;
 	while(!done){
 		if((pA->Data[a] > pB->Data[b])){
 			if(b == (pB->Usage - 1)){
@@ -464,7 +860,7 @@ bool CSet_Intersection(CSet* const pIntersection, const CSet* const pA, const CS
 			a++;
 		}
 		else{
-			success = CSet_Insert(pIntersection, pA->Data[a]);
+			success = Insert_Untraced(pIntersection, pA->Data[a]);
 			if(!success){
 				return false;
 			}
@@ -495,19 +891,22 @@ bool CSet_Intersection(CSet* const pIntersection, const CSet* const pA, const CS
  *    true if the intersection is successfully created; false otherwise
  */
 bool CSet_Difference(CSet* const pDifference, const CSet* const pA, const CSet* const pB){
-	if (pA->Data == NULL || !CSet_Init(pDifference, pA->Capacity)){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_DIFFERENCE, pDifference, pA, pB, 0, 0, NULL, 0);
+	}
+	if (pA->Data == NULL || !Init_Untraced(pDifference, pA->Capacity)){
 		return false;
 	}
 	if(pB->Data == NULL){
-		int i = 0;
+		uint32_t i = 0;
 		while(i < pA->Usage){
-			CSet_Insert(pDifference, pA->Data[i]);
+			Insert_Untraced(pDifference, pA->Data[i]);
 			i++;
 		}
 		return true;
 	}
 	bool done = false, success;
-	int a = 0, b = 0;
+	uint32_t a = 0, b = 0;
 	while(!done){
 		if((pA->Data[a] > pB->Data[b])){
 			if(!(b == (pB->Usage - 1))){
@@ -515,7 +914,7 @@ bool CSet_Difference(CSet* const pDifference, const CSet* const pA, const CSet*
 			}
 			else{
 				while(a < pA->Usage){
-					success = CSet_Insert(pDifference, pA->Data[a]);
+					success = Insert_Untraced(pDifference, pA->Data[a]);
 					if(!success){
 						return false;
 					}
@@ -528,7 +927,7 @@ bool CSet_Difference(CSet* const pDifference, const CSet* const pA, const CSet*
 			if(a == (pA->Usage - 1)){
 				done = true;
 			}
-			success = CSet_Insert(pDifference, pA->Data[a]);
+			success = Insert_Untraced(pDifference, pA->Data[a]);
 			if(!success){
 				return false;
 			}
@@ -600,94 +999,562 @@ bool CSet_isFull(const CSet* const pSet){
  *     *pSet satisfies the CSet contract
  *  Post:
  *     *pSet contains no elements
+ *     *pSet has no summary
  *     *pSet satisfies the CSet contract
  */
 void CSet_makeEmpty(CSet* const pSet){
-	free(pSet->Data);
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_MAKE_EMPTY, pSet, NULL, NULL, 0, 0, NULL, 0);
+	}
+	Summary_Free(pSet);
+	Release_Data(pSet);
 	pSet->Usage = 0;
 	pSet->Capacity = 0;
 	pSet->Data = NULL;
+	pSet->Hash = 0;
+	Notify_Reset(pSet);
 }
 
+/**
+ *  Reports the order-independent hash of the elements in a CSet object.
+ *  Equal sets always have equal hashes, so the value can be used to key
+ *  hash tables of sets. It is maintained incrementally by every mutating
+ *  operation, so the cost is O(1).
+ *
+ *  Pre:
+ *     *pSet satisfies the CSet contract
+ *  Post:
+ *     *pSet is unchanged
+ *  Returns:
+ *     pSet->Hash, or 0 if *pSet is empty
+ */
+uint64_t CSet_Hash(const CSet* const pSet){
+	if(pSet->Data == NULL){
+		return 0;
+	}
+	return pSet->Hash;
+}
 
-//Internal(Private) helpers====================================================
+/**
+ *  Computes the hash that a CSet holding exactly Data[0:DSz-1] would have.
+ *
+ *  Pre:
+ *     Data points to an array of dimension >= DSz of distinct values
+ *  Returns:
+ *     the order-independent hash of Data[0:DSz-1]
+ */
+uint64_t CSet_HashElements(const int32_t* const Data, uint32_t DSz){
+	return Elements_Hash(Data, DSz);
+}
 
 /**
- * Initializes a CSet to be empty 
- * @param pSet the passed in CSet to be altered
+ *  Writes the elements of a CSet object to a stream: a magic number and
+ *  the element count as uint32_t, then the elements as int32_t, all in
+ *  host byte order. Other records (such as sketches) may follow in the
+ *  same stream.
+ *
+ *  Pre:
+ *     *pSet satisfies the CSet contract
+ *     Out is open for writing
+ *  Post:
+ *     *pSet is unchanged
+ *  Returns:
+ *     true if every byte was written, false otherwise
  */
-void CSet_Init_Empty(CSet* const pSet){
-	pSet->Capacity = 0;
-	pSet->Usage    = 0;
-	pSet->Data     = NULL;
-};
+bool CSet_Write(const CSet* const pSet, FILE* const Out){
+	uint32_t header[2] = {CSET_FILE_MAGIC, CSet_Size(pSet)};
+	if(fwrite(header, sizeof(uint32_t), 2, Out) != 2){
+		return false;
+	}
+	return header[1] == 0 || fwrite(pSet->Data, sizeof(int32_t), header[1], Out) == header[1];
+}
 
 /**
- * Initializes a CSet to have the given capacity of
- * numbers in its Data array
- * @param  pSet the passed in CSet
- * @param  Sz   the size of the capacity
- * @return bool whether or not the array allocation was successful
+ *  Replaces the contents of a CSet object with a set written by CSet_Write,
+ *  leaving the stream positioned after it.
+ *
+ *  Pre:
+ *     *pSet satisfies the CSet contract
+ *     In is open for reading
+ *  Post:
+ *     If successful:
+ *        *pSet holds the elements that were written
+ *        *pSet satisfies the CSet contract
+ *     else:
+ *        *pSet is unchanged
+ *  Returns:
+ *     true if a valid set was read, false otherwise
  */
-bool CSet_Init_(CSet* const pSet, uint32_t Sz){
-	bool success = Make_Initialized_Array(&(pSet->Data), Sz);
-	if(!success){
+bool CSet_Read(CSet* const pSet, FILE* const In){
+	uint32_t header[2];
+	if(fread(header, sizeof(uint32_t), 2, In) != 2 || header[0] != CSET_FILE_MAGIC ||
+		header[1] == UINT32_MAX){
 		return false;
 	}
-	pSet->Capacity = Sz;
-	pSet->Usage    = 0;
-	return true;
-};
+	uint32_t usage = header[1];
+	int32_t* temp = (int32_t*) malloc(sizeof(int32_t) * (usage > 0 ? usage : 1));
+	if(!temp){
+		return false;
+	}
+	bool success = usage == 0 || fread(temp, sizeof(int32_t), usage, In) == usage;
+	uint32_t i = 1;
+	while(success && i < usage){
+		success = temp[i - 1] < temp[i];
+		i++;
+	}
+	success = success && (usage == 0 || temp[usage - 1] != INT32_MAX);
+	if(success){
+		success = CSet_Load(pSet, usage < DEFAULT_CAPACITY ? DEFAULT_CAPACITY : usage + 1, temp, usage);
+	}
+	free(temp);
+	return success;
+}
+
 
 /**
- * Allocates and initializes an int32_t array of the given size and returns whether or not the
- * creation was successful
- * @param  arr the int32_t** of the array being passed in to be made
- * @param  Sz  the size of the array
- * @return bool if the allocation was succesful
+ *  Makes a CSet object take ownership of a caller's array of sorted,
+ *  distinct values instead of copying them, replacing any previous contents.
+ *  Cells Data[DSz:Sz-1] are set to INT32_MAX. If Validate is true the
+ *  values are checked in one O(DSz) pass first.
+ *
+ *  Pre:
+ *     *pSet satisfies the CSet contract
+ *     Data points to an array of dimension Sz, allocated with malloc (Flags
+ *        == 0) or returned by CSet_Release along with Flags
+ *     DSz < Sz
+ *     Data[0:DSz-1] are strictly increasing and below INT32_MAX, unless
+ *        Validate is true
+ *  Post:
+ *     If successful:
+ *        pSet->Data == Data, and *pSet owns it
+ *        pSet->Capacity == Sz, pSet->Usage == DSz
+ *        *pSet satisfies the CSet contract
+ *     else:
+ *        *pSet is unchanged and the caller still owns Data
+ *  Returns:
+ *     true if successful, false if Sz <= DSz or validation failed
  */
-bool Make_Initialized_Array(int32_t** arr, uint32_t Sz){
-	int32_t* temp;
-	temp = (int32_t*) malloc( sizeof(int32_t) * Sz);
-	if(temp){
-		int i = 0;
-		while( i < Sz ){
-			temp[i] = INT32_MAX;
-			i++;
+bool CSet_AdoptSorted(CSet* const pSet, int32_t* const Data, uint32_t DSz, uint32_t Sz, uint32_t Flags,
+                      bool Validate){
+	if(Data == NULL || Sz <= DSz){
+		return false;
+	}
+	uint32_t i = 1;
+	while(Validate && i < DSz){
+		if(Data[i - 1] >= Data[i]){
+			return false;
 		}
-		*arr = temp;
-		return true;
+		i++;
 	}
-	return false;
-};
-
-bool CSet_Insert_(CSet* pSet, int32_t val){
-	int insertInd = Get_Insertion_Index_Of(pSet, val);
-	if (insertInd == DUPLICATE_FLAG){
+	if(Validate && DSz > 0 && Data[DSz - 1] == INT32_MAX){
 		return false;
 	}
-	int32_t currVal = val;
-	int32_t temp;
-	while(insertInd < (pSet->Usage + 1)){
-		temp = pSet->Data[insertInd];
-		pSet->Data[insertInd] = currVal;
-		currVal = temp;
-		insertInd++;
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_LOAD, pSet, NULL, NULL, Sz, 0, Data, DSz);
 	}
-	(pSet->Usage)++;
+	CSet_Active_Kernels->Fill(Data + DSz, INT32_MAX, Sz - DSz);
+	if(pSet->Data != Data){
+		Release_Data(pSet);
+	}
+	pSet->Capacity = Sz;
+	pSet->Usage = DSz;
+	pSet->Data = Data;
+	pSet->Flags = (pSet->Flags & ~(CSET_FLAG_READONLY | CSET_FLAG_MAPPED)) | (Flags & CSET_FLAG_MAPPED);
+	pSet->Hash = Elements_Hash(Data, DSz);
+	Summary_After_Reload(pSet);
+	Notify_Reset(pSet);
 	return true;
-};
+}
 
 /**
- * Uses a Binary search to either find the offset of where the element should be or signify that
+ *  Moves the contents of one CSet object into another without copying:
+ *  the target's previous array is released, and the source is left empty.
+ *  The summary moves with the elements; observers stay attached to their
+ *  set and are told of the reset of both.
+ *
+ *  Pre:
+ *     *pTarget and *pSource satisfy the CSet contract
+ *  Post:
+ *     *pTarget holds the elements, array, summary and storage flags *pSource had
+ *     *pSource is empty and owns no array (unless pTarget == pSource)
+ */
+void CSet_Move(CSet* const pTarget, CSet* const pSource){
+	if(pTarget == pSource){
+		return;
+	}
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_MOVE, pTarget, pSource, NULL, 0, 0, NULL, 0);
+	}
+	Summary_Free(pTarget);
+	Release_Data(pTarget);
+	pTarget->Capacity = pSource->Capacity;
+	pTarget->Usage = pSource->Usage;
+	pTarget->Data = pSource->Data;
+	pTarget->Hash = pSource->Hash;
+	pTarget->Summary = pSource->Summary;
+	pTarget->Flags = pSource->Flags;
+	pSource->Capacity = 0;
+	pSource->Usage = 0;
+	pSource->Data = NULL;
+	pSource->Hash = 0;
+	pSource->Summary = NULL;
+	pSource->Flags &= ~(CSET_FLAG_READONLY | CSET_FLAG_MAPPED);
+	Notify_Reset(pTarget);
+	Notify_Reset(pSource);
+}
+
+/**
+ *  Exchanges the contents of two CSet objects in O(1). Summaries and
+ *  storage flags go with the elements; observers stay attached to their
+ *  set and are told of the reset of both.
+ *
+ *  Pre:
+ *     *pA and *pB satisfy the CSet contract
+ *  Post:
+ *     *pA holds what *pB held, and *pB what *pA held
+ */
+void CSet_Swap(CSet* const pA, CSet* const pB){
+	if(pA == pB){
+		return;
+	}
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_SWAP, pA, pB, NULL, 0, 0, NULL, 0);
+	}
+	CSet temp = *pA;
+	CSet_Observer* pObservers = pA->Observers;
+	*pA = *pB;
+	pA->Observers = pObservers;
+	pObservers = pB->Observers;
+	*pB = temp;
+	pB->Observers = pObservers;
+	Notify_Reset(pA);
+	Notify_Reset(pB);
+}
+
+/**
+ *  Hands the Data array of a CSet object over to the caller, leaving the
+ *  set empty. The array keeps the CSet layout (sorted elements followed by
+ *  INT32_MAX cells) and is freed with CSet_FreeArray, or given to a set
+ *  again with CSet_AdoptSorted, passing along *pFlags.
+ *
+ *  Pre:
+ *     *pSet satisfies the CSet contract
+ *  Post:
+ *     If *pSet owned an array:
+ *        *pUsage and *pCapacity describe it, *pFlags is 0 or CSET_FLAG_MAPPED
+ *        *pSet is empty, owns no array and has no summary
+ *     else (it has none, or borrows it):
+ *        *pUsage, *pCapacity and *pFlags are 0 and *pSet is unchanged
+ *  Returns:
+ *     the array, or NULL if *pSet did not own one
+ */
+int32_t* CSet_Release(CSet* const pSet, uint32_t* const pUsage, uint32_t* const pCapacity,
+                      uint32_t* const pFlags){
+	*pUsage = 0;
+	*pCapacity = 0;
+	*pFlags = 0;
+	if(pSet->Data == NULL || (pSet->Flags & CSET_FLAG_READONLY)){
+		return NULL;
+	}
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_RELEASE, pSet, NULL, NULL, 0, 0, NULL, 0);
+	}
+	int32_t* data = pSet->Data;
+	*pUsage = pSet->Usage;
+	*pCapacity = pSet->Capacity;
+	*pFlags = pSet->Flags & CSET_FLAG_MAPPED;
+	Summary_Free(pSet);
+	pSet->Capacity = 0;
+	pSet->Usage = 0;
+	pSet->Data = NULL;
+	pSet->Hash = 0;
+	pSet->Flags &= ~CSET_FLAG_MAPPED;
+	Notify_Reset(pSet);
+	return data;
+}
+
+/**
+ *  Frees an array returned by CSet_Release.
+ *
+ *  Pre:
+ *     Data, Capacity and Flags were returned by CSet_Release, or Data is NULL
+ *  Post:
+ *     the array is released
+ */
+void CSet_FreeArray(int32_t* const Data, uint32_t Capacity, uint32_t Flags){
+	if(Data != NULL){
+		Free_Array(Data, Capacity, Flags & CSET_FLAG_MAPPED);
+	}
+}
+
+/**
+ *  Attaches a summary to a CSet object: a cache-line-blocked Bloom filter
+ *  over its elements plus min/max fences for each SUMMARY_BLOCK elements of
+ *  Data. Contains, isSubsetOf and Intersects use it to answer misses and skip
+ *  blocks; every mutating operation keeps it current. Rebuilds the summary
+ *  if one is already attached.
+ *
+ *  Pre:
+ *     *pSet satisfies the CSet contract
+ *  Post:
+ *     If successful:
+ *        pSet->Summary describes the elements of *pSet
+ *     else:
+ *        pSet->Summary == NULL
+ *     The elements of *pSet are unchanged
+ *  Returns:
+ *     true if successful, false otherwise
+ */
+bool CSet_BuildSummary(CSet* const pSet){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_BUILD_SUMMARY, pSet, NULL, NULL, 0, 0, NULL, 0);
+	}
+	Summary_Free(pSet);
+	return Summary_Build(pSet);
+}
+
+/**
+ *  Detaches and frees the summary of a CSet object, if any.
+ *
+ *  Pre:
+ *     *pSet satisfies the CSet contract
+ *  Post:
+ *     pSet->Summary == NULL
+ *     The elements of *pSet are unchanged
+ */
+void CSet_DropSummary(CSet* const pSet){
+	if(CSet_Active_Trace){
+		Trace_Record(CSet_Active_Trace, CSET_TRACE_DROP_SUMMARY, pSet, NULL, NULL, 0, 0, NULL, 0);
+	}
+	Summary_Free(pSet);
+}
+
+/**
+ *  Attaches an observer to a CSet object. The observer is notified of
+ *  every later change until it is detached or the set is reinitialized.
+ *
+ *  Pre:
+ *     *pSet satisfies the CSet contract
+ *     *pObserver is not attached to any set
+ *     *pObserver stays valid while it is attached
+ *  Post:
+ *     *pObserver is attached to *pSet
+ *     The elements of *pSet are unchanged
+ */
+void CSet_Attach(CSet* const pSet, CSet_Observer* const pObserver){
+	pObserver->Next = pSet->Observers;
+	pSet->Observers = pObserver;
+}
+
+/**
+ *  Detaches an observer from a CSet object.
+ *
+ *  Pre:
+ *     *pSet satisfies the CSet contract
+ *  Post:
+ *     *pObserver is not attached to *pSet
+ *  Returns:
+ *     true if *pObserver was attached to *pSet, false otherwise
+ */
+bool CSet_Detach(CSet* const pSet, CSet_Observer* const pObserver){
+	CSet_Observer** ppLink = &pSet->Observers;
+	while(*ppLink){
+		if(*ppLink == pObserver){
+			*ppLink = pObserver->Next;
+			pObserver->Next = NULL;
+			return true;
+		}
+		ppLink = &(*ppLink)->Next;
+	}
+	return false;
+}
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Initializes an empty set of capacity Sz, as CSet_Init does, without
+ * recording the call in the active trace
+ * @param  pSet the set
+ * @param  Sz   the capacity
+ * @return bool whether the array could be allocated
+ */
+bool Init_Untraced(CSet* const pSet, uint32_t Sz){
+	if(Sz == 0){
+		CSet_Init_Empty(pSet);
+		return true;
+	}
+	else{
+		CSet_Init_Empty(pSet);
+		return CSet_Init_(pSet, Sz);
+	}
+};
+
+/**
+ * Adds a value to a set, growing it if necessary, as CSet_Insert does,
+ * without recording the call in the active trace
+ * @param  pSet  the set
+ * @param  Value the value to add
+ * @return bool whether the value was added
+ */
+bool Insert_Untraced(CSet* const pSet, int32_t Value){
+	bool success;
+	if(pSet->Flags & CSET_FLAG_READONLY){
+		return false;
+	}
+	if(!(pSet->Data)){
+		if((success = CSet_Init_(pSet, DEFAULT_CAPACITY))){
+			return CSet_Insert_(pSet, Value);
+		}
+		else{
+			return false;
+		}
+	}
+	else if((pSet->Usage) == (pSet->Capacity - 1)){
+		if(pSet->Capacity == UINT32_MAX){
+			return false;
+		}
+		success = Extend_CSet_Data_Array(pSet, Grown_Capacity(pSet->Capacity));
+		if(success){
+			return CSet_Insert_(pSet, Value);
+		}
+		return false;
+	}
+	return CSet_Insert_(pSet, Value);
+};
+
+
+/**
+ * Initializes a CSet to be empty 
+ * @param pSet the passed in CSet to be altered
+ */
+void CSet_Init_Empty(CSet* const pSet){
+	pSet->Capacity = 0;
+	pSet->Usage    = 0;
+	pSet->Data     = NULL;
+	pSet->Hash     = 0;
+	pSet->Summary  = NULL;
+	pSet->Observers = NULL;
+	pSet->Flags    = 0;
+};
+
+/**
+ * Initializes a CSet to have the given capacity of
+ * numbers in its Data array. Its summary and observers are left attached.
+ * @param  pSet the passed in CSet
+ * @param  Sz   the size of the capacity
+ * @return bool whether or not the array allocation was successful
+ */
+bool CSet_Init_(CSet* const pSet, uint32_t Sz){
+	bool mapped;
+	bool success = Make_Initialized_Array(&(pSet->Data), Sz, &mapped);
+	if(!success){
+		return false;
+	}
+	if(mapped){
+		pSet->Flags |= CSET_FLAG_MAPPED;
+	}
+	pSet->Capacity = Sz;
+	pSet->Usage    = 0;
+	pSet->Hash     = 0;
+	return true;
+};
+
+/**
+ * Allocates and initializes an int32_t array of the given size and returns whether or not the
+ * creation was successful. Arrays of at least MAP_THRESHOLD_BYTES are mapped with mmap.
+ * @param  arr     the int32_t** of the array being passed in to be made
+ * @param  Sz      the size of the array
+ * @param  pMapped receives whether the array was mapped rather than malloc'd
+ * @return bool if the allocation was succesful
+ */
+bool Make_Initialized_Array(int32_t** arr, uint32_t Sz, bool* pMapped){
+	int32_t* temp;
+	*pMapped = false;
+#if SIZE_MAX <= UINT32_MAX
+	if((uint64_t) Sz > SIZE_MAX / sizeof(int32_t)){
+		return false;
+	}
+#endif
+	if(sizeof(int32_t) * (size_t) Sz >= MAP_THRESHOLD_BYTES){
+		void* region = mmap(NULL, Mapped_Bytes(Sz), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		temp = (region == MAP_FAILED) ? NULL : (int32_t*) region;
+#ifdef MADV_HUGEPAGE
+		if(temp){
+			madvise(temp, Mapped_Bytes(Sz), MADV_HUGEPAGE);
+		}
+#endif
+		*pMapped = (temp != NULL);
+	}
+	else{
+		temp = (int32_t*) malloc(sizeof(int32_t) * (size_t) Sz);
+	}
+	if(temp){
+		CSet_Active_Kernels->Fill(temp, INT32_MAX, Sz);
+		*arr = temp;
+		return true;
+	}
+	return false;
+};
+
+/**
+ * Releases an array made by Make_Initialized_Array or Resize_Data
+ * @param arr    the array
+ * @param Sz     the dimension of the array
+ * @param mapped whether the array was mapped
+ */
+void Free_Array(int32_t* arr, uint32_t Sz, bool mapped){
+	if(mapped){
+		munmap(arr, Mapped_Bytes(Sz));
+	}
+	else{
+		free(arr);
+	}
+};
+
+/**
+ * Computes the length of the mapping that holds Sz elements, a whole
+ * number of pages
+ */
+size_t Mapped_Bytes(uint32_t Sz){
+	size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	size_t bytes = sizeof(int32_t) * (size_t) Sz;
+	return (bytes + page - 1) / page * page;
+};
+
+/**
+ * Computes the capacity to grow a full set to: double, saturating at
+ * UINT32_MAX
+ */
+uint32_t Grown_Capacity(uint32_t capacity){
+	uint64_t grown = (uint64_t) capacity * 2;
+	return grown > UINT32_MAX ? UINT32_MAX : (uint32_t) grown;
+};
+
+bool CSet_Insert_(CSet* pSet, int32_t val){
+	int64_t insertInd = Get_Insertion_Index_Of(pSet, val);
+	if (insertInd == DUPLICATE_FLAG){
+		return false;
+	}
+	memmove(pSet->Data + insertInd + 1, pSet->Data + insertInd,
+		sizeof(int32_t) * (size_t)(pSet->Usage - insertInd));
+	pSet->Data[insertInd] = val;
+	(pSet->Usage)++;
+	pSet->Hash += Element_Hash(val);
+	Summary_After_Insert(pSet, val, (uint32_t) insertInd);
+	Notify_Inserted(pSet, val);
+	return true;
+};
+
+/**
+ * Uses a Binary search to either find the offset of where the element should be or signify that
  * it should not be added because it is already in the set
  * @param  pSet the passed in set to add the element to
  * @param  val the passed in value to add 
- * @return int the index of where the value should be placed in the set or DUPLICATE_FLAG if 
+ * @return int64_t the index of where the value should be placed in the set or DUPLICATE_FLAG if 
  * it already exists.
  */
-int Get_Insertion_Index_Of(CSet* pSet, int32_t val){
-	int index = Find_Index_Helper(pSet, val);
+int64_t Get_Insertion_Index_Of(CSet* pSet, int32_t val){
+	uint32_t index = Find_Index_Helper(pSet, val);
 	if(pSet->Data[index] == val){
 		return DUPLICATE_FLAG;
 	}
@@ -700,47 +1567,449 @@ int Get_Insertion_Index_Of(CSet* pSet, int32_t val){
  * should go in that array.
  * @param  pSet a pointer to a CSet
  * @param  val  a int32_t value to search for
- * @return int the index of where the val is or should be
+ * @return uint32_t the index of where the val is or should be
  */
-int Find_Index_Helper(CSet* pSet, int32_t val){
-	int bottom = 0;
-	int top = pSet->Usage;
-	int currInd;
-	while(top >= bottom){
-		currInd = (bottom + ((top - bottom) / 2));
-		if(pSet->Data[currInd] == val){
-			return currInd;
+uint32_t Find_Index_Helper(const CSet* pSet, int32_t val){
+	return CSet_Active_Kernels->LowerBound(pSet->Data, pSet->Usage, val);
+};
+
+/**
+ * Grows the Data array of a set to size cells, filling the new cells with
+ * INT32_MAX
+ * @param  pSet the set to grow
+ * @param  size the new capacity, larger than pSet->Capacity
+ * @return bool whether or not the reallocation was successful
+ */
+bool Extend_CSet_Data_Array(CSet* pSet, uint32_t size){
+	uint32_t old = pSet->Capacity;
+	if(!Resize_Data(pSet, size)){
+		return false;
+	}
+	CSet_Active_Kernels->Fill(pSet->Data + old, INT32_MAX, size - old);
+	return true;
+};
+
+/**
+ * Changes the dimension of a set's Data array, keeping its first
+ * min(size, pSet->Capacity) cells. A mapped array is resized with mremap; a
+ * malloc'd array that grows past MAP_THRESHOLD_BYTES moves to a mapping.
+ * @param  pSet the set whose array is resized
+ * @param  size the new capacity
+ * @return bool whether or not the reallocation was successful; on failure
+ *              the set is unchanged
+ */
+bool Resize_Data(CSet* pSet, uint32_t size){
+#if SIZE_MAX <= UINT32_MAX
+	if((uint64_t) size > SIZE_MAX / sizeof(int32_t)){
+		return false;
+	}
+#endif
+	size_t bytes = sizeof(int32_t) * (size_t) size;
+	int32_t* newArr;
+	if(pSet->Flags & CSET_FLAG_MAPPED){
+		void* region = mremap(pSet->Data, Mapped_Bytes(pSet->Capacity), Mapped_Bytes(size), MREMAP_MAYMOVE);
+		if(region == MAP_FAILED){
+			return false;
 		}
-		else if(pSet->Data[currInd] > val){
-			top = currInd - 1;
+		newArr = (int32_t*) region;
+	}
+	else if(bytes >= MAP_THRESHOLD_BYTES){
+		bool mapped;
+		if(!Make_Initialized_Array(&newArr, size, &mapped)){
+			return false;
 		}
-		else{
-			bottom = currInd + 1;
+		Copy_Elements(pSet->Data, newArr, pSet->Capacity < size ? pSet->Capacity : size);
+		Free_Array(pSet->Data, pSet->Capacity, false);
+		if(mapped){
+			pSet->Flags |= CSET_FLAG_MAPPED;
 		}
 	}
-	return currInd;
+	else{
+		newArr = (int32_t*) realloc(pSet->Data, bytes);
+		if(!newArr){
+			return false;
+		}
+	}
+	pSet->Data = newArr;
+	pSet->Capacity = size;
+	return true;
+};
+
+void Copy_Elements(const int32_t* const source, int32_t* target, uint32_t Sz){
+	CSet_Active_Kernels->Copy(target, source, Sz);
+};
+
+/**
+ * Mixes a single element into a 64-bit hash (splitmix64 finalizer). The set
+ * hash is the wrapping sum of these, so it is independent of element order
+ * and an element can be taken back out by subtraction.
+ * @param  val the element to hash
+ * @return uint64_t the mixed hash of val
+ */
+uint64_t Element_Hash(int32_t val){
+	uint64_t h = (uint64_t)(uint32_t)val + 0x9E3779B97F4A7C15ULL;
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+	return h ^ (h >> 31);
+};
+
+/**
+ * Computes the set hash of the first Sz elements of an array
+ * @param  source the elements to hash
+ * @param  Sz     the number of elements
+ * @return uint64_t the sum of the element hashes
+ */
+uint64_t Elements_Hash(const int32_t* const source, uint32_t Sz){
+	uint64_t h = 0;
+	uint32_t i = 0;
+	while(i < Sz){
+		h += Element_Hash(source[i]);
+		i++;
+	}
+	return h;
+};
+
+/**
+ * Allocates and fills a summary for pSet. On failure nothing is attached.
+ * @param  pSet the set to summarize
+ * @return bool whether or not the allocations were successful
+ */
+bool Summary_Build(CSet* pSet){
+	CSet_Summary* pSum = (CSet_Summary*) calloc(1, sizeof(CSet_Summary));
+	if(!pSum){
+		return false;
+	}
+	pSet->Summary = pSum;
+	if(!Summary_Bloom_Rebuild(pSet) || !Summary_Fences_Rebuild(pSet, 0)){
+		Summary_Free(pSet);
+		return false;
+	}
+	return true;
 };
 
-bool Extend_CSet_Data_Array(CSet* pSet, int32_t size){
-	int32_t* newArr = realloc(pSet->Data, (sizeof(int32_t) * size));
-	if(!newArr){
+/**
+ * Frees the summary of pSet, if any, and clears the pointer
+ * @param pSet the set whose summary is released
+ */
+void Summary_Free(CSet* pSet){
+	CSet_Summary* pSum = pSet->Summary;
+	if(pSum){
+		free(pSum->Bloom);
+		free(pSum->Min);
+		free(pSum->Max);
+		free(pSum);
+	}
+	pSet->Summary = NULL;
+};
+
+/**
+ * Sizes the Bloom filter for the current usage (with room to double) and
+ * adds every element of pSet to it
+ * @param  pSet a set with a summary attached
+ * @return bool whether or not the allocation was successful
+ */
+bool Summary_Bloom_Rebuild(CSet* pSet){
+	CSet_Summary* pSum = pSet->Summary;
+	uint32_t usage = (pSet->Data == NULL) ? 0 : pSet->Usage;
+	uint32_t sized = usage < DEFAULT_CAPACITY ? DEFAULT_CAPACITY : usage;
+	uint64_t bits = (uint64_t)sized * 2 * SUMMARY_BITS_PER_ELEMENT;
+	uint32_t blocks = (uint32_t)((bits + 511) / 512);
+	// Blocks are 64 bytes; aligning them keeps every probe in one cache line
+	size_t bytes = (size_t)blocks * SUMMARY_BLOOM_WORDS * sizeof(uint64_t);
+	void* bloom = NULL;
+	if(posix_memalign(&bloom, 64, bytes) != 0){
 		return false;
 	}
-	int i = pSet->Usage;
-	while(i < size){
-		newArr[i] = INT32_MAX;
+	memset(bloom, 0, bytes);
+	free(pSum->Bloom);
+	pSum->Bloom = (uint64_t*) bloom;
+	pSum->BloomBlocks = blocks;
+	pSum->Sized = sized;
+	pSum->Removed = 0;
+	uint32_t i = 0;
+	while(i < usage){
+		Summary_Bloom_Add(pSum, pSet->Data[i]);
 		i++;
 	}
-	pSet->Data = newArr;
-	pSet->Capacity = (pSet->Capacity * 2);
 	return true;
 };
 
-void Copy_Elements(const int32_t* const source, uint32_t* target, uint32_t Sz){
-		int i = 0;
-		while(i < Sz){
-			target[i] = source[i];
-			i++;
+/**
+ * Recomputes the per-block fences from Data, growing the fence arrays if
+ * needed. Elements before index first did not move, so the fences of the
+ * blocks before its block are kept.
+ * @param  pSet  a set with a summary attached
+ * @param  first the index of the first element that changed, 0 for all
+ * @return bool whether or not the allocation was successful
+ */
+bool Summary_Fences_Rebuild(CSet* pSet, uint32_t first){
+	CSet_Summary* pSum = pSet->Summary;
+	uint32_t usage = (pSet->Data == NULL) ? 0 : pSet->Usage;
+	uint32_t fences = (usage + SUMMARY_BLOCK - 1) / SUMMARY_BLOCK;
+	if(fences > pSum->FenceCap){
+		uint32_t cap = fences * 2;
+		int32_t* newMin = (int32_t*) realloc(pSum->Min, sizeof(int32_t) * cap);
+		if(!newMin){
+			return false;
+		}
+		pSum->Min = newMin;
+		int32_t* newMax = (int32_t*) realloc(pSum->Max, sizeof(int32_t) * cap);
+		if(!newMax){
+			return false;
+		}
+		pSum->Max = newMax;
+		pSum->FenceCap = cap;
+	}
+	uint32_t blk = first / SUMMARY_BLOCK;
+	while(blk < fences){
+		uint32_t last = (blk + 1) * SUMMARY_BLOCK;
+		pSum->Min[blk] = pSet->Data[blk * SUMMARY_BLOCK];
+		pSum->Max[blk] = pSet->Data[(last < usage ? last : usage) - 1];
+		blk++;
+	}
+	pSum->Fences = fences;
+	return true;
+};
+
+/**
+ * Sets the four bits for val within a single 512-bit filter block. The high
+ * half of the element hash picks the block, the low bits pick the bits.
+ * @param pSummary the summary to update
+ * @param val      the value to add
+ */
+void Summary_Bloom_Add(CSet_Summary* pSummary, int32_t val){
+	uint64_t h = Element_Hash(val);
+	uint64_t* block = pSummary->Bloom +
+		((((h >> 32) * pSummary->BloomBlocks) >> 32) * SUMMARY_BLOOM_WORDS);
+	int k = 0;
+	while(k < 4){
+		uint32_t bit = (uint32_t)(h >> (9 * k)) & 511;
+		block[bit >> 6] |= (1ULL << (bit & 63));
+		k++;
+	}
+};
+
+/**
+ * Tests whether val may be present according to the Bloom filter
+ * @param  pSummary the summary to probe
+ * @param  val      the value to look for
+ * @return bool false if val is certainly absent, true if it may be present
+ */
+bool Summary_Bloom_Test(const CSet_Summary* pSummary, int32_t val){
+	uint64_t h = Element_Hash(val);
+	const uint64_t* block = pSummary->Bloom +
+		((((h >> 32) * pSummary->BloomBlocks) >> 32) * SUMMARY_BLOOM_WORDS);
+	int k = 0;
+	while(k < 4){
+		uint32_t bit = (uint32_t)(h >> (9 * k)) & 511;
+		if(!(block[bit >> 6] & (1ULL << (bit & 63)))){
+			return false;
 		}
+		k++;
 	}
+	return true;
+};
+
+/**
+ * Brings the summary up to date after val was inserted. The filter is
+ * resized once the set outgrows it, and only the fences from val's block
+ * onward, which shifted by one element, are recomputed. If memory runs out
+ * the summary is dropped, which only costs speed.
+ * @param pSet  the set that was modified
+ * @param val   the inserted value
+ * @param index the index val was inserted at
+ */
+void Summary_After_Insert(CSet* pSet, int32_t val, uint32_t index){
+	if(!pSet->Summary){
+		return;
+	}
+	if(pSet->Usage > 2 * pSet->Summary->Sized){
+		if(!Summary_Bloom_Rebuild(pSet)){
+			Summary_Free(pSet);
+			return;
+		}
+	}
+	else{
+		Summary_Bloom_Add(pSet->Summary, val);
+	}
+	if(!Summary_Fences_Rebuild(pSet, index)){
+		Summary_Free(pSet);
+	}
+};
+
+/**
+ * Brings the summary up to date after an element was removed. Bloom bits
+ * cannot be cleared, so the filter is rebuilt once stale bits accumulate.
+ * Only the fences from the removed element's block onward are recomputed.
+ * @param pSet  the set that was modified
+ * @param index the index the element was removed from
+ */
+void Summary_After_Remove(CSet* pSet, uint32_t index){
+	if(!pSet->Summary){
+		return;
+	}
+	pSet->Summary->Removed++;
+	if(pSet->Summary->Removed > pSet->Summary->Sized / 2){
+		if(!Summary_Bloom_Rebuild(pSet)){
+			Summary_Free(pSet);
+			return;
+		}
+	}
+	if(!Summary_Fences_Rebuild(pSet, index)){
+		Summary_Free(pSet);
+	}
+};
+
+/**
+ * Rebuilds the summary after the contents of pSet were replaced wholesale
+ * @param pSet the set that was modified
+ */
+void Summary_After_Reload(CSet* pSet){
+	if(!pSet->Summary){
+		return;
+	}
+	if(!Summary_Bloom_Rebuild(pSet) || !Summary_Fences_Rebuild(pSet, 0)){
+		Summary_Free(pSet);
+	}
+};
+
+/**
+ * Searches for val using the summary: the Bloom filter first, then a binary
+ * search over the block fences, then a scan of a single block of Data.
+ * @param  pSet a non-empty set with a summary attached
+ * @param  val  the value to search for
+ * @return bool whether or not val is in the set
+ */
+bool Summary_Contains(const CSet* pSet, int32_t val){
+	const CSet_Summary* pSum = pSet->Summary;
+	if(pSum->Fences == 0 || !Summary_Bloom_Test(pSum, val)){
+		return false;
+	}
+	if(val < pSum->Min[0] || val > pSum->Max[pSum->Fences - 1]){
+		return false;
+	}
+	uint32_t bottom = 0;
+	uint32_t top = pSum->Fences - 1;
+	while(bottom < top){
+		uint32_t mid = bottom + ((top - bottom + 1) / 2);
+		if(pSum->Min[mid] <= val){
+			bottom = mid;
+		}
+		else{
+			top = mid - 1;
+		}
+	}
+	if(val > pSum->Max[bottom]){
+		return false;
+	}
+	uint32_t i = bottom * SUMMARY_BLOCK;
+	while(pSet->Data[i] < val){
+		i++;
+	}
+	return pSet->Data[i] == val;
+};
+
+/**
+ * Finds the first index in pSet->Data[0 : pSet->Usage] holding a value >= val.
+ * pSet->Data[pSet->Usage] is never read, so the result is pSet->Usage when
+ * every element is smaller than val.
+ * @param  pSet a non-empty set
+ * @param  val  the value to search for
+ * @return uint32_t the lower bound of val
+ */
+uint32_t Lower_Bound(const CSet* pSet, int32_t val){
+	return CSet_Active_Kernels->LowerBound(pSet->Data, pSet->Usage, val);
+};
+
+/**
+ * Shrinks the usage of pSet after a compaction, resetting the vacated cells
+ * to INT32_MAX and refreshing the summary
+ * @param pSet     the set that was compacted
+ * @param newUsage the number of elements that remain
+ */
+void Truncate_Usage(CSet* pSet, uint32_t newUsage){
+	if(newUsage < pSet->Usage){
+		CSet_Active_Kernels->Fill(pSet->Data + newUsage, INT32_MAX, pSet->Usage - newUsage);
+	}
+	pSet->Usage = newUsage;
+	Summary_After_Reload(pSet);
+};
+
+/**
+ * qsort comparator for int32_t values
+ */
+int Compare_Int32(const void* a, const void* b){
+	int32_t x = *(const int32_t*)a;
+	int32_t y = *(const int32_t*)b;
+	return (x > y) - (x < y);
+};
+
+/**
+ * qsort comparator for uint32_t values
+ */
+int Compare_Uint32(const void* a, const void* b){
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+};
 
+/**
+ * qsort comparator for uint64_t values
+ */
+int Compare_Uint64(const void* a, const void* b){
+	uint64_t x = *(const uint64_t*)a;
+	uint64_t y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+};
+
+/**
+ * Tells every observer of pSet that val was inserted
+ */
+void Notify_Inserted(const CSet* pSet, int32_t val){
+	CSet_Observer* pObs = pSet->Observers;
+	while(pObs){
+		if(pObs->Inserted){
+			pObs->Inserted(pObs->Ctx, pSet, val);
+		}
+		pObs = pObs->Next;
+	}
+};
+
+/**
+ * Tells every observer of pSet that val was removed
+ */
+void Notify_Removed(const CSet* pSet, int32_t val){
+	CSet_Observer* pObs = pSet->Observers;
+	while(pObs){
+		if(pObs->Removed){
+			pObs->Removed(pObs->Ctx, pSet, val);
+		}
+		pObs = pObs->Next;
+	}
+};
+
+/**
+ * Tells every observer of pSet that its contents were replaced
+ */
+void Notify_Reset(const CSet* pSet){
+	CSet_Observer* pObs = pSet->Observers;
+	while(pObs){
+		if(pObs->Reset){
+			pObs->Reset(pObs->Ctx, pSet);
+		}
+		pObs = pObs->Next;
+	}
+};
+
+/**
+ * Frees the Data array of pSet unless it is borrowed, and marks the set as
+ * owning no storage
+ * @param pSet the set whose array is released
+ */
+void Release_Data(CSet* pSet){
+	if(pSet->Data != NULL && !(pSet->Flags & CSET_FLAG_READONLY)){
+		Free_Array(pSet->Data, pSet->Capacity, pSet->Flags & CSET_FLAG_MAPPED);
+	}
+	pSet->Data = NULL;
+	pSet->Flags &= ~(CSET_FLAG_READONLY | CSET_FLAG_MAPPED);
+};
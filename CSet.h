@@ -6,15 +6,42 @@
 #include <stdlib.h>
 #include <math.h>
 
+// Flags describing how a set's Data is held
+#define CSET_FLAG_READONLY 0x1   // Data is borrowed; it is never modified or freed
+#define CSET_FLAG_MAPPED   0x2   // Data is an mmap'd region, released with munmap
+
+struct _CSet_Summary;
+struct _CSet_Observer;
+
 struct _CSet {
 
    uint32_t Capacity;    // dimension of the set's array
    uint32_t Usage;       // number of elements in the set
    int32_t* Data;        // pointer to the set's array
+   uint64_t Hash;        // order-independent fingerprint of the elements
+   struct _CSet_Summary* Summary; // optional Bloom filter and block fences, or NULL
+   struct _CSet_Observer* Observers; // callbacks notified of changes, or NULL
+   uint32_t Flags;       // CSET_FLAG_* bits
 };
 
 typedef struct _CSet CSet;
 
+// An observer is told about every change to the set it is attached to.
+// Inserted and Removed run in the middle of the mutation, so they must not
+// read or modify the set that notifies them; Reset runs after the contents
+// were replaced wholesale (Load, Copy, makeEmpty) and may read it.
+// Any callback may be NULL. Observer storage belongs to the caller.
+struct _CSet_Observer {
+
+   void (*Inserted)(void* Ctx, const CSet* pSet, int32_t Value);
+   void (*Removed)(void* Ctx, const CSet* pSet, int32_t Value);
+   void (*Reset)(void* Ctx, const CSet* pSet);
+   void* Ctx;
+   struct _CSet_Observer* Next;
+};
+
+typedef struct _CSet_Observer CSet_Observer;
+
 bool CSet_Init(CSet* const pSet, uint32_t Sz);
 
 bool CSet_Load(CSet* const pSet, uint32_t Sz, const int32_t* const Data, uint32_t DSz);
@@ -27,10 +54,20 @@ bool CSet_Contains(const CSet* const pSet, int32_t Value);
 
 bool CSet_Remove(CSet* const pSet, int32_t Value);
 
+uint32_t CSet_RemoveMany(CSet* const pSet, const int32_t* const Values, uint32_t VSz);
+
+uint32_t CSet_RemoveRange(CSet* const pSet, int32_t Lo, int32_t Hi);
+
+uint32_t CSet_RemoveIf(CSet* const pSet, bool (*Pred)(int32_t Value, void* Ctx), void* Ctx);
+
+bool CSet_Shrink(CSet* const pSet, uint32_t Percent);
+
 bool CSet_Equals(const CSet* const pA, const CSet* const pB);
 
 bool CSet_isSubsetOf(const CSet* const pA, const CSet* const pB);
 
+bool CSet_Intersects(const CSet* const pA, const CSet* const pB);
+
 bool CSet_Union(CSet* const pUnion, const CSet* const pA, const CSet* const pB);
 
 bool CSet_Intersection(CSet* const pIntersection, const CSet* const pA, const CSet* const pB);
@@ -45,4 +82,32 @@ bool CSet_isFull(const CSet* const pSet);
 
 void CSet_makeEmpty(CSet* const pSet);
 
+uint64_t CSet_Hash(const CSet* const pSet);
+
+uint64_t CSet_HashElements(const int32_t* const Data, uint32_t DSz);
+
+bool CSet_Write(const CSet* const pSet, FILE* const Out);
+
+bool CSet_Read(CSet* const pSet, FILE* const In);
+
+bool CSet_AdoptSorted(CSet* const pSet, int32_t* const Data, uint32_t DSz, uint32_t Sz, uint32_t Flags,
+                      bool Validate);
+
+void CSet_Move(CSet* const pTarget, CSet* const pSource);
+
+void CSet_Swap(CSet* const pA, CSet* const pB);
+
+int32_t* CSet_Release(CSet* const pSet, uint32_t* const pUsage, uint32_t* const pCapacity,
+                      uint32_t* const pFlags);
+
+void CSet_FreeArray(int32_t* const Data, uint32_t Capacity, uint32_t Flags);
+
+bool CSet_BuildSummary(CSet* const pSet);
+
+void CSet_DropSummary(CSet* const pSet);
+
+void CSet_Attach(CSet* const pSet, CSet_Observer* const pObserver);
+
+bool CSet_Detach(CSet* const pSet, CSet_Observer* const pObserver);
+
 #endif
\ No newline at end of file
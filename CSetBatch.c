@@ -0,0 +1,635 @@
+#include "CSetBatch.h"
+#include "CSetInternal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// CSetBatch runs large batches of small, independent set operations
+// (union, intersection, difference of two sets) on a pool of threads.
+//
+// A batch is first cut into tasks: consecutive operations are grouped until
+// their combined cost (elements scanned plus a fixed per-operation charge)
+// reaches BATCH_GRAIN, so scheduling overhead is paid per task rather than
+// per operation. Each worker owns a contiguous range of task indices,
+// packed into one 64-bit word as [Low, High). The owner takes tasks from the
+// front of its range with a compare-and-swap on that word; a worker whose
+// range is empty picks victims in turn and steals the back half of a
+// victim's range with a single compare-and-swap, then continues with it as
+// its own. No lock is taken per operation or per task: the pool's mutex is
+// only used to start a batch and to wait for its completion barrier.
+//
+// Results are not allocated with malloc. Each worker owns an arena of large
+// blocks and bump-allocates every result it produces there, so the memory
+// of a result is written by one thread only and the allocator is never
+// contended. A result CSet borrows its storage (CSET_FLAG_READONLY): it can
+// be read, searched and combined like any set, Load, Copy and makeEmpty
+// give it storage of its own, and it stays valid until CSet_Pool_Reset or
+// CSet_Pool_Destroy recycles the arenas. Use CSet_Copy to keep one longer.
+//
+// The calling thread takes part in every batch as worker 0, so a pool of
+// one thread runs batches inline.
+
+//Global Declaration
+#define BATCH_MAX_THREADS 64
+#define BATCH_GRAIN 16384          // element steps grouped into one task
+#define BATCH_OP_COST 64           // fixed cost charged to every operation
+#define BATCH_BLOCK_BYTES ((size_t) 1 << 20)
+#define BATCH_ALIGN 16
+
+struct _Batch_Block {
+
+   struct _Batch_Block* Next; // next block of the arena
+   size_t Size;          // bytes available in Cells
+   size_t Used;          // bytes handed out from Cells
+   int32_t Cells[];      // result storage
+};
+
+typedef struct _Batch_Block Batch_Block;
+
+struct _Batch_Worker {
+
+   uint64_t Range;       // task indices [low 32 bits, high 32 bits) still to run
+   struct _CSet_Pool* pPool; // the pool the worker belongs to
+   uint32_t Index;       // position in pPool->Workers
+   uint32_t Victim;      // next worker to try stealing from
+   bool Failed;          // an operation of the current batch failed
+   Batch_Block* Blocks;  // first block of the arena
+   Batch_Block* Current; // block results are allocated from
+   Batch_Block* Last;    // last block of the arena
+   pthread_t Tid;        // helper thread, for workers other than 0
+} __attribute__((aligned(64)));
+
+typedef struct _Batch_Worker Batch_Worker;
+
+struct _CSet_Pool {
+
+   uint32_t Threads;     // number of workers, including the caller
+   Batch_Worker* Workers; // Threads workers
+   pthread_mutex_t Lock; // guards Generation, Active and Stopping
+   pthread_cond_t Start; // signaled when a batch starts or the pool stops
+   pthread_cond_t Done;  // signaled when the last helper finishes a batch
+   uint64_t Generation;  // number of batches started
+   uint32_t Active;      // helpers still working on the current batch
+   bool Stopping;        // helpers should exit
+   CSet_Batch_Op* Ops;   // operations of the current batch
+   uint32_t* Starts;     // first operation of each task, TaskCount + 1 entries
+   uint32_t TaskCount;   // number of tasks in the current batch
+   size_t StartCap;      // dimension of Starts
+};
+
+//Internal Helper Declarations
+void* Batch_Worker_Main(void* pArg);
+void Batch_Work(Batch_Worker* pWorker);
+bool Batch_Take(Batch_Worker* pWorker, uint32_t* pTask);
+bool Batch_Steal(Batch_Worker* pWorker);
+uint64_t Batch_Pack(uint32_t low, uint32_t high);
+bool Batch_Plan(CSet_Pool* pPool, const CSet_Batch_Op* ops, uint32_t count);
+uint64_t Batch_Cost(const CSet_Batch_Op* pOp);
+bool Batch_Run_Op(Batch_Worker* pWorker, CSet_Batch_Op* pOp);
+uint32_t Batch_Union(const int32_t* a, uint32_t na, const int32_t* b, uint32_t nb, int32_t* out);
+uint32_t Batch_Intersection(const int32_t* a, uint32_t na, const int32_t* b, uint32_t nb, int32_t* out);
+uint32_t Batch_Difference(const int32_t* a, uint32_t na, const int32_t* b, uint32_t nb, int32_t* out);
+int32_t* Batch_Alloc(Batch_Worker* pWorker, uint64_t cells);
+void Batch_Trim(Batch_Worker* pWorker, uint64_t cells);
+void Batch_Stop(CSet_Pool* pPool);
+
+/**
+ * Creates a pool of worker threads for running batches.
+ *
+ * Pre:
+ *    Threads is the number of workers, or 0 to use every online CPU;
+ *    the calling thread counts as one of them
+ * Post:
+ *    If successful, Threads - 1 helper threads are waiting for a batch
+ *    (fewer if the system refused to create more)
+ * Returns:
+ *    the pool, or NULL if it could not be created
+ */
+CSet_Pool* CSet_Pool_Create(uint32_t Threads){
+	if(Threads == 0){
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		Threads = cpus > 0 ? (uint32_t) cpus : 1;
+	}
+	if(Threads > BATCH_MAX_THREADS){
+		Threads = BATCH_MAX_THREADS;
+	}
+	CSet_Pool* pPool = (CSet_Pool*) calloc(1, sizeof(CSet_Pool));
+	if(!pPool){
+		return NULL;
+	}
+	void* workers = NULL;
+	if(posix_memalign(&workers, 64, sizeof(Batch_Worker) * Threads) != 0){
+		free(pPool);
+		return NULL;
+	}
+	memset(workers, 0, sizeof(Batch_Worker) * Threads);
+	pPool->Workers = (Batch_Worker*) workers;
+	pthread_mutex_init(&pPool->Lock, NULL);
+	pthread_cond_init(&pPool->Start, NULL);
+	pthread_cond_init(&pPool->Done, NULL);
+	uint32_t t = 0;
+	while(t < Threads){
+		pPool->Workers[t].pPool = pPool;
+		pPool->Workers[t].Index = t;
+		pPool->Workers[t].Victim = (t + 1) % Threads;
+		t++;
+	}
+	t = 1;
+	while(t < Threads && pthread_create(&pPool->Workers[t].Tid, NULL, Batch_Worker_Main, &pPool->Workers[t]) == 0){
+		t++;
+	}
+	pPool->Threads = t;
+	return pPool;
+};
+
+/**
+ * Reports the number of workers of a pool, including the calling thread.
+ *
+ * Pre:
+ *    pPool was returned by CSet_Pool_Create
+ * Returns:
+ *    the number of workers
+ */
+uint32_t CSet_Pool_Threads(const CSet_Pool* const pPool){
+	return pPool->Threads;
+};
+
+/**
+ * Runs Ops[0:Count-1] on the pool and returns once all of them are done.
+ *
+ * Pre:
+ *    pPool was returned by CSet_Pool_Create; no other batch is running on it
+ *    every Ops[i].pA and Ops[i].pB satisfies the CSet contract and is not
+ *       modified during the batch
+ *    every Ops[i].pResult satisfies the CSet contract and is distinct from
+ *       every operand and from the result of every other operation
+ * Post:
+ *    For every operation:
+ *       If Ops[i].Failed is false:
+ *          *Ops[i].pResult holds the union, intersection or difference of
+ *          *Ops[i].pA and *Ops[i].pB, in storage borrowed from the pool
+ *          (CSET_FLAG_READONLY) that stays valid until CSet_Pool_Reset or
+ *          CSet_Pool_Destroy; its previous storage was released and its
+ *          summary and observers detached, as with CSet_Union
+ *       else:
+ *          *Ops[i].pResult is unchanged (Op is unknown, or no memory)
+ *    If the task plan cannot be allocated no operation is run
+ * Returns:
+ *    true if every operation succeeded, false otherwise
+ */
+bool CSet_Pool_Run(CSet_Pool* const pPool, CSet_Batch_Op* const Ops, uint32_t Count){
+	if(Count == 0){
+		return true;
+	}
+	if(!Batch_Plan(pPool, Ops, Count)){
+		return false;
+	}
+	uint32_t t = 0;
+	while(t < pPool->Threads){
+		uint32_t low = (uint32_t)(((uint64_t) pPool->TaskCount * t) / pPool->Threads);
+		uint32_t high = (uint32_t)(((uint64_t) pPool->TaskCount * (t + 1)) / pPool->Threads);
+		pPool->Workers[t].Failed = false;
+		__atomic_store_n(&pPool->Workers[t].Range, Batch_Pack(low, high), __ATOMIC_RELAXED);
+		t++;
+	}
+	pthread_mutex_lock(&pPool->Lock);
+	pPool->Ops = Ops;
+	pPool->Active = pPool->Threads - 1;
+	pPool->Generation++;
+	pthread_cond_broadcast(&pPool->Start);
+	pthread_mutex_unlock(&pPool->Lock);
+
+	Batch_Work(&pPool->Workers[0]);
+
+	pthread_mutex_lock(&pPool->Lock);
+	while(pPool->Active > 0){
+		pthread_cond_wait(&pPool->Done, &pPool->Lock);
+	}
+	pPool->Ops = NULL;
+	pthread_mutex_unlock(&pPool->Lock);
+	bool success = true;
+	t = 0;
+	while(t < pPool->Threads){
+		success = success && !pPool->Workers[t].Failed;
+		t++;
+	}
+	return success;
+};
+
+/**
+ * Recycles the arenas holding the results of earlier batches. The blocks
+ * are kept for later batches.
+ *
+ * Pre:
+ *    pPool was returned by CSet_Pool_Create; no batch is running on it
+ * Post:
+ *    Results produced by earlier batches no longer own valid storage and
+ *    must not be read; they may still be reused as results or reinitialized
+ */
+void CSet_Pool_Reset(CSet_Pool* const pPool){
+	uint32_t t = 0;
+	while(t < pPool->Threads){
+		Batch_Block* pBlock = pPool->Workers[t].Blocks;
+		while(pBlock){
+			pBlock->Used = 0;
+			pBlock = pBlock->Next;
+		}
+		pPool->Workers[t].Current = pPool->Workers[t].Blocks;
+		t++;
+	}
+};
+
+/**
+ * Stops the helper threads of a pool and frees it, including its arenas.
+ *
+ * Pre:
+ *    pPool was returned by CSet_Pool_Create, or is NULL; no batch is running
+ * Post:
+ *    Results produced by the pool no longer own valid storage
+ */
+void CSet_Pool_Destroy(CSet_Pool* const pPool){
+	if(!pPool){
+		return;
+	}
+	Batch_Stop(pPool);
+	uint32_t t = 0;
+	while(t < pPool->Threads){
+		Batch_Block* pBlock = pPool->Workers[t].Blocks;
+		while(pBlock){
+			Batch_Block* pNext = pBlock->Next;
+			free(pBlock);
+			pBlock = pNext;
+		}
+		t++;
+	}
+	pthread_mutex_destroy(&pPool->Lock);
+	pthread_cond_destroy(&pPool->Start);
+	pthread_cond_destroy(&pPool->Done);
+	free(pPool->Workers);
+	free(pPool->Starts);
+	free(pPool);
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Body of a helper thread: waits for each batch, works on it, and reports
+ * completion until the pool stops
+ * @param  pArg the Batch_Worker of the thread
+ * @return void* NULL
+ */
+void* Batch_Worker_Main(void* pArg){
+	Batch_Worker* pWorker = (Batch_Worker*) pArg;
+	CSet_Pool* pPool = pWorker->pPool;
+	uint64_t seen = 0;
+	pthread_mutex_lock(&pPool->Lock);
+	while(true){
+		while(!pPool->Stopping && pPool->Generation == seen){
+			pthread_cond_wait(&pPool->Start, &pPool->Lock);
+		}
+		if(pPool->Stopping){
+			break;
+		}
+		seen = pPool->Generation;
+		pthread_mutex_unlock(&pPool->Lock);
+		Batch_Work(pWorker);
+		pthread_mutex_lock(&pPool->Lock);
+		pPool->Active--;
+		if(pPool->Active == 0){
+			pthread_cond_signal(&pPool->Done);
+		}
+	}
+	pthread_mutex_unlock(&pPool->Lock);
+	return NULL;
+};
+
+/**
+ * Runs tasks from the worker's own range, stealing more whenever it runs
+ * dry, until no worker has tasks left
+ * @param pWorker the worker
+ */
+void Batch_Work(Batch_Worker* pWorker){
+	CSet_Pool* pPool = pWorker->pPool;
+	uint32_t task;
+	do{
+		while(Batch_Take(pWorker, &task)){
+			uint32_t i = pPool->Starts[task];
+			while(i < pPool->Starts[task + 1]){
+				CSet_Batch_Op* pOp = &pPool->Ops[i];
+				pOp->Failed = !Batch_Run_Op(pWorker, pOp);
+				pWorker->Failed = pWorker->Failed || pOp->Failed;
+				i++;
+			}
+		}
+	}while(Batch_Steal(pWorker));
+};
+
+/**
+ * Takes the first task of the worker's own range
+ * @param  pWorker the worker
+ * @param  pTask   receives the task index
+ * @return bool whether a task was taken
+ */
+bool Batch_Take(Batch_Worker* pWorker, uint32_t* pTask){
+	uint64_t range = __atomic_load_n(&pWorker->Range, __ATOMIC_ACQUIRE);
+	while(true){
+		uint32_t low = (uint32_t) range;
+		uint32_t high = (uint32_t)(range >> 32);
+		if(low >= high){
+			return false;
+		}
+		if(__atomic_compare_exchange_n(&pWorker->Range, &range, Batch_Pack(low + 1, high),
+		                               true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+			*pTask = low;
+			return true;
+		}
+	}
+};
+
+/**
+ * Steals the back half of the range of some other worker and makes it the
+ * worker's own range. Victims are tried round-robin, starting after the
+ * last one tried, so thieves spread over different victims.
+ * @param  pWorker a worker whose own range is empty
+ * @return bool whether any tasks were stolen
+ */
+bool Batch_Steal(Batch_Worker* pWorker){
+	CSet_Pool* pPool = pWorker->pPool;
+	uint32_t tries = 0;
+	while(tries < pPool->Threads){
+		uint32_t v = pWorker->Victim;
+		pWorker->Victim = (v + 1) % pPool->Threads;
+		tries++;
+		if(v == pWorker->Index){
+			continue;
+		}
+		Batch_Worker* pVictim = &pPool->Workers[v];
+		uint64_t range = __atomic_load_n(&pVictim->Range, __ATOMIC_ACQUIRE);
+		while(true){
+			uint32_t low = (uint32_t) range;
+			uint32_t high = (uint32_t)(range >> 32);
+			if(low >= high){
+				break;
+			}
+			uint32_t mid = high - (high - low + 1) / 2;
+			if(__atomic_compare_exchange_n(&pVictim->Range, &range, Batch_Pack(low, mid),
+			                               true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+				__atomic_store_n(&pWorker->Range, Batch_Pack(mid, high), __ATOMIC_RELEASE);
+				return true;
+			}
+		}
+	}
+	return false;
+};
+
+/**
+ * Packs a task range into the word workers compete on
+ * @param  low  first task of the range
+ * @param  high one past the last task of the range
+ * @return uint64_t the packed range
+ */
+uint64_t Batch_Pack(uint32_t low, uint32_t high){
+	return ((uint64_t) high << 32) | low;
+};
+
+/**
+ * Groups the operations into tasks of about BATCH_GRAIN cost each
+ * @param  pPool the pool
+ * @param  ops   the operations of the batch
+ * @param  count the number of operations
+ * @return bool whether the allocation of the plan was successful
+ */
+bool Batch_Plan(CSet_Pool* pPool, const CSet_Batch_Op* ops, uint32_t count){
+	if(pPool->StartCap < (size_t) count + 1){
+		uint32_t* temp = (uint32_t*) realloc(pPool->Starts, sizeof(uint32_t) * ((size_t) count + 1));
+		if(!temp){
+			return false;
+		}
+		pPool->Starts = temp;
+		pPool->StartCap = (size_t) count + 1;
+	}
+	uint32_t tasks = 0;
+	uint64_t cost = 0;
+	pPool->Starts[0] = 0;
+	uint32_t i = 0;
+	while(i < count){
+		cost += Batch_Cost(&ops[i]);
+		i++;
+		if(cost >= BATCH_GRAIN){
+			pPool->Starts[++tasks] = i;
+			cost = 0;
+		}
+	}
+	if(pPool->Starts[tasks] != count){
+		pPool->Starts[++tasks] = count;
+	}
+	pPool->TaskCount = tasks;
+	return true;
+};
+
+/**
+ * Estimates the work of one operation
+ * @param  pOp the operation
+ * @return uint64_t elements scanned plus the fixed per-operation cost
+ */
+uint64_t Batch_Cost(const CSet_Batch_Op* pOp){
+	return (uint64_t) CSet_Size(pOp->pA) + CSet_Size(pOp->pB) + BATCH_OP_COST;
+};
+
+/**
+ * Computes one operation into the worker's arena and installs the result
+ * @param  pWorker the worker running the operation
+ * @param  pOp     the operation
+ * @return bool whether the result was produced
+ */
+bool Batch_Run_Op(Batch_Worker* pWorker, CSet_Batch_Op* pOp){
+	uint32_t na = CSet_Size(pOp->pA);
+	uint32_t nb = CSet_Size(pOp->pB);
+	uint64_t bound;
+	switch(pOp->Op){
+	case CSET_BATCH_UNION:
+		bound = (uint64_t) na + nb;
+		break;
+	case CSET_BATCH_INTERSECTION:
+		bound = na < nb ? na : nb;
+		break;
+	case CSET_BATCH_DIFFERENCE:
+		bound = na;
+		break;
+	default:
+		return false;
+	}
+	if(bound > UINT32_MAX - 1){
+		bound = UINT32_MAX - 1;
+	}
+	int32_t* out = Batch_Alloc(pWorker, bound + 1);
+	if(!out){
+		return false;
+	}
+	uint32_t n;
+	switch(pOp->Op){
+	case CSET_BATCH_UNION:
+		n = Batch_Union(pOp->pA->Data, na, pOp->pB->Data, nb, out);
+		break;
+	case CSET_BATCH_INTERSECTION:
+		n = Batch_Intersection(pOp->pA->Data, na, pOp->pB->Data, nb, out);
+		break;
+	default:
+		n = Batch_Difference(pOp->pA->Data, na, pOp->pB->Data, nb, out);
+		break;
+	}
+	out[n] = INT32_MAX;
+	Batch_Trim(pWorker, bound - n);
+	CSet* pResult = pOp->pResult;
+	Summary_Free(pResult);
+	Release_Data(pResult);
+	CSet_Init_Empty(pResult);
+	pResult->Data = out;
+	pResult->Capacity = n + 1;
+	pResult->Usage = n;
+	pResult->Hash = Elements_Hash(out, n);
+	pResult->Flags = CSET_FLAG_READONLY;
+	return true;
+};
+
+/**
+ * Merges two sorted arrays, dropping duplicates
+ * @param  a   the first array
+ * @param  na  number of elements in a
+ * @param  b   the second array
+ * @param  nb  number of elements in b
+ * @param  out array of dimension >= na + nb receiving the union
+ * @return uint32_t the number of elements written
+ */
+uint32_t Batch_Union(const int32_t* a, uint32_t na, const int32_t* b, uint32_t nb, int32_t* out){
+	uint32_t i = 0, j = 0, n = 0;
+	while(i < na && j < nb){
+		int32_t x = a[i];
+		int32_t y = b[j];
+		out[n++] = x < y ? x : y;
+		i += x <= y;
+		j += y <= x;
+	}
+	if(i < na){
+		memcpy(out + n, a + i, sizeof(int32_t) * (size_t)(na - i));
+		n += na - i;
+	}
+	if(j < nb){
+		memcpy(out + n, b + j, sizeof(int32_t) * (size_t)(nb - j));
+		n += nb - j;
+	}
+	return n;
+};
+
+/**
+ * Intersects two sorted arrays with a branch-free merge
+ * @param  a   the first array
+ * @param  na  number of elements in a
+ * @param  b   the second array
+ * @param  nb  number of elements in b
+ * @param  out array of dimension >= min(na, nb) + 1 receiving the intersection
+ * @return uint32_t the number of elements written
+ */
+uint32_t Batch_Intersection(const int32_t* a, uint32_t na, const int32_t* b, uint32_t nb, int32_t* out){
+	uint32_t i = 0, j = 0, n = 0;
+	while(i < na && j < nb){
+		int32_t x = a[i];
+		int32_t y = b[j];
+		out[n] = x;
+		n += x == y;
+		i += x <= y;
+		j += y <= x;
+	}
+	return n;
+};
+
+/**
+ * Subtracts one sorted array from another with a branch-free merge
+ * @param  a   the array to subtract from
+ * @param  na  number of elements in a
+ * @param  b   the array to subtract
+ * @param  nb  number of elements in b
+ * @param  out array of dimension >= na + 1 receiving the difference
+ * @return uint32_t the number of elements written
+ */
+uint32_t Batch_Difference(const int32_t* a, uint32_t na, const int32_t* b, uint32_t nb, int32_t* out){
+	uint32_t i = 0, j = 0, n = 0;
+	while(i < na && j < nb){
+		int32_t x = a[i];
+		int32_t y = b[j];
+		out[n] = x;
+		n += x < y;
+		i += x <= y;
+		j += y <= x;
+	}
+	if(i < na){
+		memcpy(out + n, a + i, sizeof(int32_t) * (size_t)(na - i));
+		n += na - i;
+	}
+	return n;
+};
+
+/**
+ * Bump-allocates cells from the worker's arena, moving on to a later block
+ * or adding one when the current block is full
+ * @param  pWorker the worker owning the arena
+ * @param  cells   the number of int32_t cells needed
+ * @return int32_t* the cells, or NULL if no memory is available
+ */
+int32_t* Batch_Alloc(Batch_Worker* pWorker, uint64_t cells){
+	size_t bytes = (size_t) cells * sizeof(int32_t);
+	Batch_Block* pBlock = pWorker->Current;
+	while(pBlock){
+		size_t start = (pBlock->Used + BATCH_ALIGN - 1) & ~((size_t) BATCH_ALIGN - 1);
+		if(start <= pBlock->Size && pBlock->Size - start >= bytes){
+			pBlock->Used = start + bytes;
+			pWorker->Current = pBlock;
+			return (int32_t*)((char*) pBlock->Cells + start);
+		}
+		pBlock = pBlock->Next;
+	}
+	size_t size = bytes > BATCH_BLOCK_BYTES ? bytes : BATCH_BLOCK_BYTES;
+	pBlock = (Batch_Block*) malloc(sizeof(Batch_Block) + size);
+	if(!pBlock){
+		return NULL;
+	}
+	pBlock->Next = NULL;
+	pBlock->Size = size;
+	pBlock->Used = bytes;
+	if(pWorker->Last){
+		pWorker->Last->Next = pBlock;
+	}
+	else{
+		pWorker->Blocks = pBlock;
+	}
+	pWorker->Last = pBlock;
+	pWorker->Current = pBlock;
+	return pBlock->Cells;
+};
+
+/**
+ * Gives back the unused tail of the most recent allocation
+ * @param pWorker the worker owning the arena
+ * @param cells   the number of cells at the end of that allocation not used
+ */
+void Batch_Trim(Batch_Worker* pWorker, uint64_t cells){
+	pWorker->Current->Used -= (size_t) cells * sizeof(int32_t);
+};
+
+/**
+ * Tells the helper threads to exit and joins them
+ * @param pPool the pool
+ */
+void Batch_Stop(CSet_Pool* pPool){
+	pthread_mutex_lock(&pPool->Lock);
+	pPool->Stopping = true;
+	pthread_cond_broadcast(&pPool->Start);
+	pthread_mutex_unlock(&pPool->Lock);
+	uint32_t t = 1;
+	while(t < pPool->Threads){
+		pthread_join(pPool->Workers[t].Tid, NULL);
+		t++;
+	}
+};
@@ -0,0 +1,36 @@
+#ifndef CSET_BATCH_H
+#define CSET_BATCH_H
+#include "CSet.h"
+
+// Operations a batch can run
+#define CSET_BATCH_UNION        1
+#define CSET_BATCH_INTERSECTION 2
+#define CSET_BATCH_DIFFERENCE   3
+
+// One independent operation of a batch: *pResult = *pA op *pB
+struct _CSet_Batch_Op {
+
+   uint32_t Op;          // CSET_BATCH_* operation
+   const CSet* pA;       // first operand
+   const CSet* pB;       // second operand
+   CSet* pResult;        // receives the result, stored in the pool's arenas
+   bool Failed;          // set if the result could not be produced
+};
+
+typedef struct _CSet_Batch_Op CSet_Batch_Op;
+
+struct _CSet_Pool;
+
+typedef struct _CSet_Pool CSet_Pool;
+
+CSet_Pool* CSet_Pool_Create(uint32_t Threads);
+
+uint32_t CSet_Pool_Threads(const CSet_Pool* const pPool);
+
+bool CSet_Pool_Run(CSet_Pool* const pPool, CSet_Batch_Op* const Ops, uint32_t Count);
+
+void CSet_Pool_Reset(CSet_Pool* const pPool);
+
+void CSet_Pool_Destroy(CSet_Pool* const pPool);
+
+#endif
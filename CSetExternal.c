@@ -0,0 +1,967 @@
+#define _GNU_SOURCE
+#include "CSetExternal.h"
+#include "CSetInternal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <aio.h>
+
+// CSetExternal runs set operations on sets kept on disk, for sets too large
+// to hold two inputs and an output in memory at once.
+//
+// A set on disk is a set file (see CSetExternal.h). CSet_External_Sort
+// builds one from a file of raw int32_t values in any order. It reads as
+// much of the input as the memory limit allows, radix sorts and
+// deduplicates it, and writes it out as a sorted run in TempDir. The runs
+// are then merged with a min-heap. If there are too many runs to give each
+// one a reasonable block of memory, they are merged in several passes.
+//
+// Union, intersection and difference stream both inputs once, in order.
+// Each input is read in large blocks with two buffers per stream: while the
+// merge consumes one block, the next one is already being read with POSIX
+// AIO. The output is written the same way, from two buffers that alternate
+// between being filled and being written. Reads are sequential and posted
+// ahead of use, so the merge loop rarely waits and throughput approaches
+// disk bandwidth. With Direct set, inputs are opened with O_DIRECT so they
+// bypass the page cache; file systems that refuse it (tmpfs, for example)
+// fall back to buffered reads with sequential readahead advice.
+//
+// Buffer memory is split evenly between the buffers an operation needs and
+// never exceeds MemoryLimit, apart from one block per buffer at the
+// smallest block size. A result collected into an in-memory CSet needs
+// room for the whole result.
+
+//Global Declaration
+#define EXTERNAL_DEFAULT_MEMORY (64u << 20)
+#define EXTERNAL_ALIGN 4096
+#define EXTERNAL_MIN_BLOCK (64u << 10)
+#define EXTERNAL_MAX_BLOCK (8u << 20)
+#define EXTERNAL_MIN_CAPACITY 10
+#define EXTERNAL_UNION 0
+#define EXTERNAL_INTERSECTION 1
+#define EXTERNAL_DIFFERENCE 2
+
+// A set file being read block by block
+struct _External_Stream {
+
+   int Fd;               // the file
+   int32_t* Buffers[2];  // the block being consumed and the block being read
+   size_t BlockBytes;    // size of each buffer
+   struct aiocb Cb;      // read in flight into Buffers[Which ^ 1], if Pending
+   bool Pending;         // a read is in flight
+   off_t Offset;         // file offset of the next read to post
+   uint32_t Which;       // index of the buffer being consumed
+   const int32_t* Cur;   // Buffers[Which]
+   uint32_t Pos;         // next element of Cur
+   uint32_t Len;         // number of elements in Cur
+   bool Failed;          // a read failed
+};
+
+typedef struct _External_Stream External_Stream;
+
+// Where the output of an operation goes: a file, or a growing array
+struct _External_Sink {
+
+   int Fd;               // the output file, or -1 when collecting in memory
+   const char* Path;     // path of the output file, removed on failure
+   int32_t* Buffers[2];  // the block being filled and the block being written
+   size_t BlockBytes;    // size of each file buffer
+   struct aiocb Cb;      // write in flight from Buffers[Which ^ 1], if Pending
+   bool Pending;         // a write is in flight
+   off_t Offset;         // file offset of the next write
+   uint32_t Which;       // index of the buffer being filled
+   int32_t* Cur;         // Buffers[Which]
+   uint32_t Pos;         // number of elements in Cur
+   uint32_t Cap;         // dimension of Cur
+   bool Failed;          // a write or an allocation failed
+};
+
+typedef struct _External_Sink External_Sink;
+
+//Internal Helper Declarations
+void External_Resolve(const CSet_External_Config* pConfig, CSet_External_Config* pResolved);
+size_t External_Block_Bytes(const CSet_External_Config* pConfig, uint32_t buffers);
+bool External_SetOp(uint8_t op, const char* pathA, const char* pathB, const char* outPath,
+                    CSet* pResult, const CSet_External_Config* pConfig);
+bool External_Merge_Pair(uint8_t op, External_Stream* a, External_Stream* b, External_Sink* out);
+bool External_Drain(External_Stream* s, External_Sink* out);
+bool External_Merge_Runs(char** paths, uint32_t k, const char* outPath, const CSet_External_Config* pConfig);
+bool External_Merge_Group(char** paths, uint32_t k, const char* outPath, const CSet_External_Config* pConfig);
+bool External_Write_Run(const CSet_External_Config* pConfig, const int32_t* Data, uint32_t Sz, char** pPath);
+bool External_Write_All(int fd, const void* data, size_t bytes);
+char* External_Temp_Path(const CSet_External_Config* pConfig, int* pFd);
+ssize_t Aio_Wait(struct aiocb* cb);
+bool Stream_Open(External_Stream* s, const char* path, size_t block, bool direct);
+void Stream_Issue(External_Stream* s);
+bool Stream_Ready(External_Stream* s);
+bool Stream_Refill(External_Stream* s);
+int32_t Stream_Head(const External_Stream* s);
+void Stream_Close(External_Stream* s);
+bool Sink_Open_File(External_Sink* s, const char* path, size_t block);
+bool Sink_Open_Memory(External_Sink* s, size_t block);
+bool Sink_Put(External_Sink* s, int32_t val);
+bool Sink_Append(External_Sink* s, const int32_t* vals, uint32_t n);
+bool Sink_Flush(External_Sink* s);
+bool Sink_Finish(External_Sink* s, CSet* pResult);
+void Sink_Abort(External_Sink* s);
+
+/**
+ * Builds a set file from a file of raw int32_t values in any order, with
+ * duplicates allowed.
+ *
+ * Pre:
+ *    InPath names a readable file whose size is a multiple of 4 bytes
+ *    OutPath differs from InPath
+ *    pConfig is NULL or points to the limits to respect
+ * Post:
+ *    If successful, OutPath is a set file of the distinct values of InPath
+ *    else, OutPath holds no partial output
+ *    No sort runs are left in TempDir
+ * Returns:
+ *    true if successful, false if a file could not be read or written, the
+ *    input holds INT32_MAX, or memory ran out
+ */
+bool CSet_External_Sort(const char* const InPath, const char* const OutPath,
+                        const CSet_External_Config* const pConfig){
+	CSet_External_Config config;
+	External_Resolve(pConfig, &config);
+	uint64_t chunk = config.MemoryLimit / (2 * sizeof(int32_t));
+	if(chunk < EXTERNAL_MIN_BLOCK / sizeof(int32_t)){
+		chunk = EXTERNAL_MIN_BLOCK / sizeof(int32_t);
+	}
+	if(chunk > UINT32_MAX - 1){
+		chunk = UINT32_MAX - 1;
+	}
+	int fd = open(InPath, O_RDONLY);
+	if(fd < 0){
+		return false;
+	}
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	int32_t* data = (int32_t*) malloc(sizeof(int32_t) * chunk);
+	char** runs = NULL;
+	uint32_t count = 0, capacity = 0;
+	bool success = (data != NULL);
+	while(success){
+		size_t want = sizeof(int32_t) * chunk;
+		size_t bytes = 0;
+		ssize_t got = 1;
+		while(bytes < want && got > 0){
+			got = read(fd, (char*) data + bytes, want - bytes);
+			bytes += (got > 0) ? (size_t) got : 0;
+		}
+		if(got < 0 || bytes % sizeof(int32_t) != 0){
+			success = false;
+			break;
+		}
+		if(bytes == 0){
+			break;
+		}
+		uint32_t n = bytes / sizeof(int32_t);
+		if(!Ingest_Radix_Sort(data, n)){
+			success = false;
+			break;
+		}
+		n = Ingest_Dedup(data, n);
+		if(data[n - 1] == INT32_MAX){
+			success = false;
+			break;
+		}
+		if(count == capacity){
+			capacity = capacity ? capacity * 2 : 16;
+			char** grown = (char**) realloc(runs, sizeof(char*) * capacity);
+			if(!grown){
+				success = false;
+				break;
+			}
+			runs = grown;
+		}
+		if(!External_Write_Run(&config, data, n, &runs[count])){
+			success = false;
+			break;
+		}
+		count++;
+		if(bytes < want){
+			break;
+		}
+	}
+	close(fd);
+	free(data);
+	if(success){
+		success = External_Merge_Runs(runs, count, OutPath, &config);
+	}
+	uint32_t r = 0;
+	while(r < count){
+		unlink(runs[r]);
+		free(runs[r]);
+		r++;
+	}
+	free(runs);
+	return success;
+};
+
+/**
+ * Writes the elements of a pSet object to a set file.
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ * Post:
+ *    If successful, Path is a set file holding exactly the elements of *pSet
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_External_Write(const CSet* const pSet, const char* const Path){
+	int fd = open(Path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0){
+		return false;
+	}
+	uint32_t usage = CSet_Size(pSet);
+	bool success = (usage == 0) || External_Write_All(fd, pSet->Data, sizeof(int32_t) * (size_t) usage);
+	success = (close(fd) == 0) && success;
+	if(!success){
+		unlink(Path);
+	}
+	return success;
+};
+
+/**
+ * Replaces the contents of a pSet object with the elements of a set file.
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ *    Path names a set file of fewer than UINT32_MAX elements
+ * Post:
+ *    If successful:
+ *       *pSet contains exactly the elements of the file
+ *       *pSet satisfies the CSet contract
+ *    else:
+ *       *pSet is unchanged
+ * Returns:
+ *    true if successful, false if the file cannot be read or is not a set file
+ */
+bool CSet_External_Load(CSet* const pSet, const char* const Path,
+                        const CSet_External_Config* const pConfig){
+	CSet_External_Config config;
+	External_Resolve(pConfig, &config);
+	size_t block = External_Block_Bytes(&config, 3);
+	External_Stream in;
+	External_Sink out;
+	if(!Stream_Open(&in, Path, block, config.Direct)){
+		return false;
+	}
+	bool success = Sink_Open_Memory(&out, block);
+	if(success){
+		success = External_Drain(&in, &out) && Is_Sorted_Set(out.Cur, out.Pos);
+		if(success){
+			success = Sink_Finish(&out, pSet);
+		}
+		else{
+			Sink_Abort(&out);
+		}
+	}
+	Stream_Close(&in);
+	return success;
+};
+
+/**
+ * Computes the union of two set files, streaming both from disk. The
+ * result goes to the set file OutPath, or into *pResult if OutPath is NULL.
+ *
+ * Pre:
+ *    PathA and PathB name set files
+ *    exactly one of OutPath and pResult is non-NULL
+ *    OutPath differs from PathA and PathB
+ *    *pResult, if used, satisfies the CSet contract
+ * Post:
+ *    If successful, the result holds every element of either input
+ *    else, OutPath holds no partial output and *pResult is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_External_Union(const char* const PathA, const char* const PathB, const char* const OutPath,
+                         CSet* const pResult, const CSet_External_Config* const pConfig){
+	return External_SetOp(EXTERNAL_UNION, PathA, PathB, OutPath, pResult, pConfig);
+};
+
+/**
+ * Computes the intersection of two set files, streaming both from disk.
+ * The result goes to the set file OutPath, or into *pResult if OutPath is
+ * NULL.
+ *
+ * Pre:
+ *    as for CSet_External_Union
+ * Post:
+ *    If successful, the result holds the elements common to both inputs
+ *    else, OutPath holds no partial output and *pResult is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_External_Intersection(const char* const PathA, const char* const PathB, const char* const OutPath,
+                                CSet* const pResult, const CSet_External_Config* const pConfig){
+	return External_SetOp(EXTERNAL_INTERSECTION, PathA, PathB, OutPath, pResult, pConfig);
+};
+
+/**
+ * Computes the elements of the set file PathA that are not in PathB,
+ * streaming both from disk. The result goes to the set file OutPath, or
+ * into *pResult if OutPath is NULL.
+ *
+ * Pre:
+ *    as for CSet_External_Union
+ * Post:
+ *    If successful, the result holds the elements of A that are not in B
+ *    else, OutPath holds no partial output and *pResult is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_External_Difference(const char* const PathA, const char* const PathB, const char* const OutPath,
+                              CSet* const pResult, const CSet_External_Config* const pConfig){
+	return External_SetOp(EXTERNAL_DIFFERENCE, PathA, PathB, OutPath, pResult, pConfig);
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Fills in the defaults of a configuration
+ * @param pConfig   the caller's configuration, or NULL
+ * @param pResolved receives the configuration to use
+ */
+void External_Resolve(const CSet_External_Config* pConfig, CSet_External_Config* pResolved){
+	if(pConfig){
+		*pResolved = *pConfig;
+	}
+	else{
+		memset(pResolved, 0, sizeof(CSet_External_Config));
+	}
+	if(pResolved->MemoryLimit == 0){
+		pResolved->MemoryLimit = EXTERNAL_DEFAULT_MEMORY;
+	}
+	if(pResolved->TempDir == NULL){
+		pResolved->TempDir = getenv("TMPDIR");
+		if(pResolved->TempDir == NULL || pResolved->TempDir[0] == '\0'){
+			pResolved->TempDir = "/tmp";
+		}
+	}
+};
+
+/**
+ * Splits the memory limit evenly between a number of I/O buffers
+ * @param  pConfig the resolved configuration
+ * @param  buffers the number of buffers the operation needs
+ * @return size_t the size of each buffer, a multiple of EXTERNAL_ALIGN
+ */
+size_t External_Block_Bytes(const CSet_External_Config* pConfig, uint32_t buffers){
+	uint64_t block = pConfig->MemoryLimit / buffers;
+	block -= block % EXTERNAL_ALIGN;
+	if(block < EXTERNAL_ALIGN){
+		block = EXTERNAL_ALIGN;
+	}
+	if(block > EXTERNAL_MAX_BLOCK){
+		block = EXTERNAL_MAX_BLOCK;
+	}
+	return (size_t) block;
+};
+
+/**
+ * Opens both inputs and the output of a binary set operation and runs it
+ * @return bool whether or not the operation was successful
+ */
+bool External_SetOp(uint8_t op, const char* pathA, const char* pathB, const char* outPath,
+                    CSet* pResult, const CSet_External_Config* pConfig){
+	if((outPath == NULL) == (pResult == NULL)){
+		return false;
+	}
+	CSet_External_Config config;
+	External_Resolve(pConfig, &config);
+	size_t block = External_Block_Bytes(&config, 6);
+	External_Stream a, b;
+	External_Sink out;
+	if(!Stream_Open(&a, pathA, block, config.Direct)){
+		return false;
+	}
+	if(!Stream_Open(&b, pathB, block, config.Direct)){
+		Stream_Close(&a);
+		return false;
+	}
+	bool success = outPath ? Sink_Open_File(&out, outPath, block) : Sink_Open_Memory(&out, block);
+	if(success){
+		if(External_Merge_Pair(op, &a, &b, &out)){
+			success = Sink_Finish(&out, pResult);
+		}
+		else{
+			Sink_Abort(&out);
+			success = false;
+		}
+	}
+	Stream_Close(&a);
+	Stream_Close(&b);
+	return success;
+};
+
+/**
+ * Merges two sorted streams into a sink, keeping the elements that belong
+ * to the result of op
+ * @param  op  EXTERNAL_UNION, EXTERNAL_INTERSECTION or EXTERNAL_DIFFERENCE
+ * @param  a   the first input
+ * @param  b   the second input
+ * @param  out the output
+ * @return bool whether or not every read and write was successful
+ */
+bool External_Merge_Pair(uint8_t op, External_Stream* a, External_Stream* b, External_Sink* out){
+	bool moreA = Stream_Ready(a);
+	bool moreB = Stream_Ready(b);
+	while(moreA && moreB){
+		int32_t x = Stream_Head(a);
+		int32_t y = Stream_Head(b);
+		if(x < y){
+			if(op != EXTERNAL_INTERSECTION && !Sink_Put(out, x)){
+				return false;
+			}
+			a->Pos++;
+			moreA = Stream_Ready(a);
+		}
+		else if(x > y){
+			if(op == EXTERNAL_UNION && !Sink_Put(out, y)){
+				return false;
+			}
+			b->Pos++;
+			moreB = Stream_Ready(b);
+		}
+		else{
+			if(op != EXTERNAL_DIFFERENCE && !Sink_Put(out, x)){
+				return false;
+			}
+			a->Pos++;
+			b->Pos++;
+			moreA = Stream_Ready(a);
+			moreB = Stream_Ready(b);
+		}
+	}
+	if(moreA && op != EXTERNAL_INTERSECTION && !External_Drain(a, out)){
+		return false;
+	}
+	if(moreB && op == EXTERNAL_UNION && !External_Drain(b, out)){
+		return false;
+	}
+	return !a->Failed && !b->Failed;
+};
+
+/**
+ * Copies the rest of a stream to a sink a block at a time
+ * @return bool whether or not every read and write was successful
+ */
+bool External_Drain(External_Stream* s, External_Sink* out){
+	while(Stream_Ready(s)){
+		if(!Sink_Append(out, s->Cur + s->Pos, s->Len - s->Pos)){
+			return false;
+		}
+		s->Pos = s->Len;
+	}
+	return !s->Failed;
+};
+
+/**
+ * Merges sorted runs into a set file. When there are more runs than the
+ * memory limit can give a block of EXTERNAL_MIN_BLOCK bytes each, groups of
+ * runs are first merged into larger temporary runs.
+ * @param  paths   the run files
+ * @param  k       the number of runs
+ * @param  outPath the set file to write
+ * @param  pConfig the resolved configuration
+ * @return bool whether or not the merge was successful
+ */
+bool External_Merge_Runs(char** paths, uint32_t k, const char* outPath, const CSet_External_Config* pConfig){
+	uint64_t fanIn = pConfig->MemoryLimit / (2 * EXTERNAL_MIN_BLOCK);
+	fanIn = (fanIn > 3) ? fanIn - 1 : 2;
+	if(k <= fanIn){
+		return External_Merge_Group(paths, k, outPath, pConfig);
+	}
+	uint32_t groups = (uint32_t)((k + fanIn - 1) / fanIn);
+	char** next = (char**) calloc(groups, sizeof(char*));
+	bool success = (next != NULL);
+	uint32_t g = 0;
+	while(success && g < groups){
+		int fd;
+		next[g] = External_Temp_Path(pConfig, &fd);
+		if(!next[g]){
+			success = false;
+			break;
+		}
+		close(fd);
+		uint32_t first = (uint32_t)(g * fanIn);
+		uint32_t n = (k - first < fanIn) ? k - first : (uint32_t) fanIn;
+		success = External_Merge_Group(paths + first, n, next[g], pConfig);
+		g++;
+	}
+	if(success){
+		success = External_Merge_Runs(next, groups, outPath, pConfig);
+	}
+	g = 0;
+	while(next && g < groups){
+		if(next[g]){
+			unlink(next[g]);
+			free(next[g]);
+		}
+		g++;
+	}
+	free(next);
+	return success;
+};
+
+/**
+ * Merges up to fan-in sorted runs into one set file with a binary min-heap
+ * of streams, dropping values that occur in more than one run
+ * @return bool whether or not the merge was successful
+ */
+bool External_Merge_Group(char** paths, uint32_t k, const char* outPath, const CSet_External_Config* pConfig){
+	size_t block = External_Block_Bytes(pConfig, 2 * k + 2);
+	External_Stream* streams = (External_Stream*) calloc(k ? k : 1, sizeof(External_Stream));
+	uint32_t* heap = (uint32_t*) malloc(sizeof(uint32_t) * (k ? k : 1));
+	External_Sink sink;
+	bool success = streams && heap && Sink_Open_File(&sink, outPath, block);
+	bool opened_sink = success;
+	uint32_t opened = 0, n = 0;
+	while(success && opened < k){
+		success = Stream_Open(&streams[opened], paths[opened], block, pConfig->Direct);
+		if(success){
+			opened++;
+		}
+	}
+	uint32_t r = 0;
+	while(success && r < opened){
+		if(Stream_Ready(&streams[r])){
+			int32_t key = Stream_Head(&streams[r]);
+			uint32_t child = n++;
+			while(child > 0 && key < Stream_Head(&streams[heap[(child - 1) / 2]])){
+				heap[child] = heap[(child - 1) / 2];
+				child = (child - 1) / 2;
+			}
+			heap[child] = r;
+		}
+		success = !streams[r].Failed;
+		r++;
+	}
+	bool any = false;
+	int32_t last = 0;
+	while(success && n > 0){
+		uint32_t top = heap[0];
+		int32_t val = Stream_Head(&streams[top]);
+		if(!any || val != last){
+			if(!Sink_Put(&sink, val)){
+				success = false;
+				break;
+			}
+			any = true;
+			last = val;
+		}
+		streams[top].Pos++;
+		if(!Stream_Ready(&streams[top])){
+			if(streams[top].Failed){
+				success = false;
+				break;
+			}
+			top = heap[--n];
+		}
+		if(n == 0){
+			break;
+		}
+		int32_t key = Stream_Head(&streams[top]);
+		uint32_t hole = 0;
+		while(true){
+			uint32_t child = 2 * hole + 1;
+			if(child >= n){
+				break;
+			}
+			if(child + 1 < n && Stream_Head(&streams[heap[child + 1]]) < Stream_Head(&streams[heap[child]])){
+				child++;
+			}
+			if(Stream_Head(&streams[heap[child]]) >= key){
+				break;
+			}
+			heap[hole] = heap[child];
+			hole = child;
+		}
+		heap[hole] = top;
+	}
+	if(opened_sink){
+		if(success){
+			success = Sink_Finish(&sink, NULL);
+		}
+		else{
+			Sink_Abort(&sink);
+		}
+	}
+	r = 0;
+	while(r < opened){
+		Stream_Close(&streams[r]);
+		r++;
+	}
+	free(streams);
+	free(heap);
+	return success;
+};
+
+/**
+ * Writes a sorted chunk to a new run file in TempDir
+ * @param  pConfig the resolved configuration
+ * @param  Data    the sorted, deduplicated values
+ * @param  Sz      the number of values
+ * @param  pPath   receives the malloc'd path of the run
+ * @return bool whether or not the run was written
+ */
+bool External_Write_Run(const CSet_External_Config* pConfig, const int32_t* Data, uint32_t Sz, char** pPath){
+	int fd;
+	char* path = External_Temp_Path(pConfig, &fd);
+	if(!path){
+		return false;
+	}
+	bool success = External_Write_All(fd, Data, sizeof(int32_t) * (size_t) Sz);
+	success = (close(fd) == 0) && success;
+	if(!success){
+		unlink(path);
+		free(path);
+		return false;
+	}
+	*pPath = path;
+	return true;
+};
+
+/**
+ * Writes a whole buffer to a file descriptor, retrying short writes
+ * @return bool whether or not every byte was written
+ */
+bool External_Write_All(int fd, const void* data, size_t bytes){
+	const char* p = (const char*) data;
+	while(bytes > 0){
+		ssize_t done = write(fd, p, bytes);
+		if(done < 0 && errno == EINTR){
+			continue;
+		}
+		if(done <= 0){
+			return false;
+		}
+		p += done;
+		bytes -= (size_t) done;
+	}
+	return true;
+};
+
+/**
+ * Creates a new, empty temporary file in TempDir
+ * @param  pConfig the resolved configuration
+ * @param  pFd     receives the open descriptor of the file
+ * @return char* the malloc'd path of the file, or NULL on failure
+ */
+char* External_Temp_Path(const CSet_External_Config* pConfig, int* pFd){
+	size_t len = strlen(pConfig->TempDir) + sizeof("/cset-run-XXXXXX");
+	char* path = (char*) malloc(len);
+	if(!path){
+		return NULL;
+	}
+	snprintf(path, len, "%s/cset-run-XXXXXX", pConfig->TempDir);
+	*pFd = mkstemp(path);
+	if(*pFd < 0){
+		free(path);
+		return NULL;
+	}
+	return path;
+};
+
+/**
+ * Waits for an asynchronous read or write to complete
+ * @return ssize_t the number of bytes transferred, or -1 on error
+ */
+ssize_t Aio_Wait(struct aiocb* cb){
+	const struct aiocb* list[1] = {cb};
+	int err;
+	while((err = aio_error(cb)) == EINPROGRESS){
+		aio_suspend(list, 1, NULL);
+	}
+	ssize_t n = aio_return(cb);
+	return (err == 0) ? n : -1;
+};
+
+/**
+ * Opens a set file for streaming and posts the read of its first block
+ * @param  s      the stream to open
+ * @param  path   the set file
+ * @param  block  the size of each buffer, a multiple of EXTERNAL_ALIGN
+ * @param  direct whether to try O_DIRECT first
+ * @return bool whether or not the stream was opened
+ */
+bool Stream_Open(External_Stream* s, const char* path, size_t block, bool direct){
+	memset(s, 0, sizeof(External_Stream));
+	s->Fd = -1;
+	if(direct){
+		s->Fd = open(path, O_RDONLY | O_DIRECT);
+	}
+	if(s->Fd < 0){
+		s->Fd = open(path, O_RDONLY);
+	}
+	if(s->Fd < 0){
+		return false;
+	}
+	posix_fadvise(s->Fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	void* first = NULL;
+	void* second = NULL;
+	if(posix_memalign(&first, EXTERNAL_ALIGN, block) != 0 ||
+		posix_memalign(&second, EXTERNAL_ALIGN, block) != 0){
+		free(first);
+		close(s->Fd);
+		return false;
+	}
+	s->Buffers[0] = (int32_t*) first;
+	s->Buffers[1] = (int32_t*) second;
+	s->BlockBytes = block;
+	s->Which = 1;
+	Stream_Issue(s);
+	if(s->Failed){
+		Stream_Close(s);
+		return false;
+	}
+	return true;
+};
+
+/**
+ * Posts an asynchronous read of the next block into the buffer that is not
+ * being consumed
+ */
+void Stream_Issue(External_Stream* s){
+	memset(&s->Cb, 0, sizeof(struct aiocb));
+	s->Cb.aio_fildes = s->Fd;
+	s->Cb.aio_buf = s->Buffers[s->Which ^ 1];
+	s->Cb.aio_nbytes = s->BlockBytes;
+	s->Cb.aio_offset = s->Offset;
+	if(aio_read(&s->Cb) != 0){
+		s->Failed = true;
+		return;
+	}
+	s->Offset += s->BlockBytes;
+	s->Pending = true;
+};
+
+/**
+ * Makes sure the stream has an unconsumed element, refilling if needed
+ * @return bool false at the end of the file or on a read error
+ */
+bool Stream_Ready(External_Stream* s){
+	return s->Pos < s->Len || Stream_Refill(s);
+};
+
+/**
+ * Switches to the block read in the background and posts the read of the
+ * one after it. A short block marks the end of the file.
+ * @return bool false at the end of the file or on a read error
+ */
+bool Stream_Refill(External_Stream* s){
+	if(!s->Pending){
+		return false;
+	}
+	ssize_t n = Aio_Wait(&s->Cb);
+	s->Pending = false;
+	if(n < 0 || n % sizeof(int32_t) != 0){
+		s->Failed = true;
+		return false;
+	}
+	if(n == 0){
+		return false;
+	}
+	s->Which ^= 1;
+	s->Cur = s->Buffers[s->Which];
+	s->Len = (uint32_t)(n / sizeof(int32_t));
+	s->Pos = 0;
+	if((size_t) n == s->BlockBytes){
+		Stream_Issue(s);
+	}
+	return true;
+};
+
+/**
+ * The next unconsumed element of a ready stream
+ */
+int32_t Stream_Head(const External_Stream* s){
+	return s->Cur[s->Pos];
+};
+
+/**
+ * Waits for any read in flight and releases a stream
+ */
+void Stream_Close(External_Stream* s){
+	if(s->Pending){
+		Aio_Wait(&s->Cb);
+		s->Pending = false;
+	}
+	close(s->Fd);
+	free(s->Buffers[0]);
+	free(s->Buffers[1]);
+	s->Buffers[0] = s->Buffers[1] = NULL;
+};
+
+/**
+ * Opens a sink that writes a set file, truncating it
+ * @return bool whether or not the file and buffers could be set up
+ */
+bool Sink_Open_File(External_Sink* s, const char* path, size_t block){
+	memset(s, 0, sizeof(External_Sink));
+	s->Fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(s->Fd < 0){
+		return false;
+	}
+	s->Path = path;
+	void* first = NULL;
+	void* second = NULL;
+	if(posix_memalign(&first, EXTERNAL_ALIGN, block) != 0 ||
+		posix_memalign(&second, EXTERNAL_ALIGN, block) != 0){
+		free(first);
+		close(s->Fd);
+		unlink(path);
+		return false;
+	}
+	s->Buffers[0] = (int32_t*) first;
+	s->Buffers[1] = (int32_t*) second;
+	s->BlockBytes = block;
+	s->Cur = s->Buffers[0];
+	s->Cap = (uint32_t)(block / sizeof(int32_t));
+	return true;
+};
+
+/**
+ * Opens a sink that collects the output in a growing array
+ * @return bool whether or not the first block could be allocated
+ */
+bool Sink_Open_Memory(External_Sink* s, size_t block){
+	memset(s, 0, sizeof(External_Sink));
+	s->Fd = -1;
+	s->Buffers[0] = (int32_t*) malloc(block);
+	if(!s->Buffers[0]){
+		return false;
+	}
+	s->Cur = s->Buffers[0];
+	s->Cap = (uint32_t)(block / sizeof(int32_t));
+	return true;
+};
+
+/**
+ * Appends one element to a sink
+ * @return bool whether or not the element could be stored
+ */
+bool Sink_Put(External_Sink* s, int32_t val){
+	if(s->Pos == s->Cap && !Sink_Flush(s)){
+		return false;
+	}
+	s->Cur[s->Pos++] = val;
+	return true;
+};
+
+/**
+ * Appends n elements to a sink
+ * @return bool whether or not the elements could be stored
+ */
+bool Sink_Append(External_Sink* s, const int32_t* vals, uint32_t n){
+	while(n > 0){
+		if(s->Pos == s->Cap && !Sink_Flush(s)){
+			return false;
+		}
+		uint32_t m = (n < s->Cap - s->Pos) ? n : s->Cap - s->Pos;
+		memcpy(s->Cur + s->Pos, vals, sizeof(int32_t) * m);
+		s->Pos += m;
+		vals += m;
+		n -= m;
+	}
+	return true;
+};
+
+/**
+ * Makes room in a sink: a file sink waits for the write in flight, posts
+ * the write of the current buffer and switches to the other one; a memory
+ * sink doubles its array
+ * @return bool whether or not there is room for more elements
+ */
+bool Sink_Flush(External_Sink* s){
+	if(s->Failed){
+		return false;
+	}
+	if(s->Fd < 0){
+		if(s->Cap >= UINT32_MAX - 1){
+			s->Failed = true;
+			return false;
+		}
+		uint64_t cap = (uint64_t) s->Cap * 2;
+		cap = (cap > UINT32_MAX - 1) ? UINT32_MAX - 1 : cap;
+		int32_t* grown = (int32_t*) realloc(s->Cur, sizeof(int32_t) * cap);
+		if(!grown){
+			s->Failed = true;
+			return false;
+		}
+		s->Buffers[0] = s->Cur = grown;
+		s->Cap = (uint32_t) cap;
+		return true;
+	}
+	if(s->Pending){
+		ssize_t n = Aio_Wait(&s->Cb);
+		s->Pending = false;
+		if(n != (ssize_t) s->Cb.aio_nbytes){
+			s->Failed = true;
+			return false;
+		}
+	}
+	if(s->Pos == 0){
+		return true;
+	}
+	memset(&s->Cb, 0, sizeof(struct aiocb));
+	s->Cb.aio_fildes = s->Fd;
+	s->Cb.aio_buf = s->Cur;
+	s->Cb.aio_nbytes = sizeof(int32_t) * (size_t) s->Pos;
+	s->Cb.aio_offset = s->Offset;
+	if(aio_write(&s->Cb) != 0){
+		s->Failed = true;
+		return false;
+	}
+	s->Pending = true;
+	s->Offset += s->Cb.aio_nbytes;
+	s->Which ^= 1;
+	s->Cur = s->Buffers[s->Which];
+	s->Pos = 0;
+	return true;
+};
+
+/**
+ * Completes a sink: a file sink writes what is left and closes the file;
+ * a memory sink loads its array into *pResult
+ * @param  s       the sink
+ * @param  pResult the set receiving a memory sink's elements
+ * @return bool whether or not the output is complete
+ */
+bool Sink_Finish(External_Sink* s, CSet* pResult){
+	bool success = !s->Failed;
+	if(s->Fd >= 0){
+		success = success && Sink_Flush(s);
+		if(s->Pending){
+			ssize_t n = Aio_Wait(&s->Cb);
+			s->Pending = false;
+			success = success && (n == (ssize_t) s->Cb.aio_nbytes);
+		}
+		success = (close(s->Fd) == 0) && success;
+		if(!success){
+			unlink(s->Path);
+		}
+	}
+	else if(success){
+		uint32_t capacity = s->Pos < EXTERNAL_MIN_CAPACITY ? EXTERNAL_MIN_CAPACITY : s->Pos + 1;
+		success = CSet_Load(pResult, capacity, s->Cur, s->Pos);
+	}
+	free(s->Buffers[0]);
+	free(s->Buffers[1]);
+	s->Buffers[0] = s->Buffers[1] = s->Cur = NULL;
+	return success;
+};
+
+/**
+ * Discards a sink's output
+ */
+void Sink_Abort(External_Sink* s){
+	s->Failed = true;
+	Sink_Finish(s, NULL);
+};
@@ -0,0 +1,35 @@
+#ifndef CSET_EXTERNAL_H
+#define CSET_EXTERNAL_H
+#include "CSet.h"
+
+// A set file holds the elements of one set as strictly increasing int32_t
+// values in host byte order, with nothing else in the file.
+
+// Limits and placement of the buffers used by an external operation
+struct _CSet_External_Config {
+
+   uint64_t MemoryLimit; // bytes of buffer memory an operation may use, 0 for the default
+   const char* TempDir;  // directory for sort runs, NULL for $TMPDIR or /tmp
+   bool Direct;          // read with O_DIRECT where the file system allows it
+};
+
+typedef struct _CSet_External_Config CSet_External_Config;
+
+bool CSet_External_Sort(const char* const InPath, const char* const OutPath,
+                        const CSet_External_Config* const pConfig);
+
+bool CSet_External_Write(const CSet* const pSet, const char* const Path);
+
+bool CSet_External_Load(CSet* const pSet, const char* const Path,
+                        const CSet_External_Config* const pConfig);
+
+bool CSet_External_Union(const char* const PathA, const char* const PathB, const char* const OutPath,
+                         CSet* const pResult, const CSet_External_Config* const pConfig);
+
+bool CSet_External_Intersection(const char* const PathA, const char* const PathB, const char* const OutPath,
+                                CSet* const pResult, const CSet_External_Config* const pConfig);
+
+bool CSet_External_Difference(const char* const PathA, const char* const PathB, const char* const OutPath,
+                              CSet* const pResult, const CSet_External_Config* const pConfig);
+
+#endif
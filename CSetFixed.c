@@ -0,0 +1,88 @@
+#include "CSetFixed.h"
+#include <string.h>
+
+// CSetFixed holds the conversions between fixed sets and CSet objects,
+// which do not depend on the universe and so are compiled once rather than
+// inlined into every CSET_FIXED_DEFINE type.
+//
+// A CSet is sorted, so checking that its first and last elements lie in the
+// universe checks all of them before any word is written. The bits are
+// decoded back to a CSet in ascending order straight into an array the set
+// adopts, with no insertion and no second copy. An empty fixed set becomes
+// a CSet with no array, like one emptied by CSet_makeEmpty.
+
+/**
+ * Replaces the contents of a fixed set with the elements of a CSet object.
+ *
+ * Pre:
+ *    Words points to an array of dimension WordCount
+ *    Universe <= 64 * WordCount
+ *    *pSet satisfies the CSet contract
+ * Post:
+ *    If successful:
+ *       bit v of Words is set iff CSet_Contains(pSet, v), for v < 64 * WordCount
+ *    else:
+ *       Words is unchanged
+ * Returns:
+ *    true if successful, false if *pSet has an element outside [0, Universe)
+ */
+bool CSet_Fixed_FromCSet(uint64_t* const Words, uint32_t WordCount, uint32_t Universe, const CSet* const pSet){
+	uint32_t size = CSet_Size(pSet);
+	if(size > 0 && (pSet->Data[0] < 0 || (uint32_t) pSet->Data[size - 1] >= Universe)){
+		return false;
+	}
+	memset(Words, 0, sizeof(uint64_t) * WordCount);
+	uint32_t i = 0;
+	while(i < size){
+		Words[CSET_FIXED_WORD(pSet->Data[i])] |= CSET_FIXED_MASK(pSet->Data[i]);
+		i++;
+	}
+	return true;
+};
+
+/**
+ * Replaces the contents of a CSet object with the members of a fixed set.
+ *
+ * Pre:
+ *    Words points to an array of dimension WordCount
+ *    *pSet satisfies the CSet contract
+ * Post:
+ *    If successful:
+ *       CSet_Contains(pSet, v) iff bit v of Words is set, for all v
+ *       pSet->Capacity == CSet_Size(pSet) + 1, or pSet->Data == NULL if
+ *          no bit is set
+ *    else:
+ *       *pSet is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_Fixed_ToCSet(const uint64_t* const Words, uint32_t WordCount, CSet* const pSet){
+	uint32_t size = 0, w = 0;
+	while(w < WordCount){
+		size += (uint32_t) __builtin_popcountll(Words[w]);
+		w++;
+	}
+	if(size == 0){
+		CSet_makeEmpty(pSet);
+		return true;
+	}
+	int32_t* data = (int32_t*) malloc(sizeof(int32_t) * ((size_t) size + 1));
+	if(data == NULL){
+		return false;
+	}
+	uint32_t filled = 0;
+	w = 0;
+	while(w < WordCount){
+		uint64_t bits = Words[w];
+		while(bits != 0){
+			data[filled++] = (int32_t)(w * 64 + (uint32_t) __builtin_ctzll(bits));
+			bits &= bits - 1;
+		}
+		w++;
+	}
+	if(!CSet_AdoptSorted(pSet, data, size, size + 1, 0, false)){
+		free(data);
+		return false;
+	}
+	return true;
+};
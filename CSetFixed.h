@@ -0,0 +1,166 @@
+#ifndef CSET_FIXED_H
+#define CSET_FIXED_H
+#include "CSet.h"
+
+// Fixed sets hold values drawn from a universe [0, Universe) known at
+// compile time, as one bit per value in an array of words. They need no
+// allocation and can live on the stack or in static storage.
+//
+// CSET_FIXED_DEFINE(Name, Universe) defines the type Name and its
+// operations, Name_Insert, Name_Union and so on, as static inline
+// functions. Every loop runs over the constant CSET_FIXED_WORDS(Universe)
+// words, so the compiler unrolls and vectorizes it for the universe.
+// A fixed set is initialized with CSET_FIXED_EMPTY, or with constant
+// words built from CSET_FIXED_WORD and CSET_FIXED_MASK:
+//
+//    CSET_FIXED_DEFINE(Feature_Set, 4096)
+//    static const Feature_Set Reserved = { .Words = {
+//       [CSET_FIXED_WORD(1)] = CSET_FIXED_MASK(1) | CSET_FIXED_MASK(2),
+//       [CSET_FIXED_WORD(4095)] = CSET_FIXED_MASK(4095) } };
+
+#define CSET_FIXED_WORDS(Universe) (((uint32_t)(Universe) + 63) / 64)
+#define CSET_FIXED_WORD(Value) ((uint32_t)(Value) / 64)
+#define CSET_FIXED_MASK(Value) (1ULL << ((uint32_t)(Value) % 64))
+#define CSET_FIXED_EMPTY { { 0 } }
+
+bool CSet_Fixed_FromCSet(uint64_t* const Words, uint32_t WordCount, uint32_t Universe, const CSet* const pSet);
+
+bool CSet_Fixed_ToCSet(const uint64_t* const Words, uint32_t WordCount, CSet* const pSet);
+
+/**
+ * Defines the fixed set type Name over [0, Universe) and its operations.
+ * Values outside the universe are never members: Insert rejects them and
+ * Contains and Remove answer false. Union, Intersection and Difference
+ * write to a result that may be one of their operands.
+ *
+ *    bool Name_Insert(Name* pSet, int32_t Value)      true if Value was added
+ *    bool Name_Contains(const Name* pSet, int32_t Value)
+ *    bool Name_Remove(Name* pSet, int32_t Value)      true if Value was removed
+ *    uint32_t Name_Size(const Name* pSet)
+ *    bool Name_isEmpty(const Name* pSet)
+ *    void Name_makeEmpty(Name* pSet)
+ *    bool Name_Equals(const Name* pA, const Name* pB)
+ *    bool Name_isSubsetOf(const Name* pA, const Name* pB)
+ *    bool Name_Intersects(const Name* pA, const Name* pB)
+ *    void Name_Union(Name* pUnion, const Name* pA, const Name* pB)
+ *    void Name_Intersection(Name* pIntersection, const Name* pA, const Name* pB)
+ *    void Name_Difference(Name* pDifference, const Name* pA, const Name* pB)
+ *    bool Name_FromCSet(Name* pSet, const CSet* pSource)
+ *       false, leaving *pSet unchanged, if *pSource has a value outside
+ *       the universe
+ *    bool Name_ToCSet(const Name* pSet, CSet* pTarget)
+ *       replaces the contents of *pTarget, which satisfies the CSet
+ *       contract; false if memory ran out
+ *
+ * Pre:
+ *    Universe is a constant expression, 0 < Universe <= INT32_MAX
+ */
+#define CSET_FIXED_DEFINE(Name, Universe)                                                         \
+typedef char Name##_Universe_Check[(Universe) > 0 && (Universe) <= INT32_MAX ? 1 : -1];         \
+struct _##Name {                                                                                  \
+   uint64_t Words[CSET_FIXED_WORDS(Universe)];                                                   \
+};                                                                                                \
+typedef struct _##Name Name;                                                                      \
+static inline bool Name##_Insert(Name* const pSet, int32_t Value){                               \
+	if((uint32_t) Value >= (uint32_t)(Universe)){                                                   \
+		return false;                                                                                \
+	}                                                                                               \
+	uint64_t* pWord = &pSet->Words[CSET_FIXED_WORD(Value)];                                         \
+	bool added = !(*pWord & CSET_FIXED_MASK(Value));                                                \
+	*pWord |= CSET_FIXED_MASK(Value);                                                               \
+	return added;                                                                                   \
+};                                                                                                \
+static inline bool Name##_Contains(const Name* const pSet, int32_t Value){                       \
+	return (uint32_t) Value < (uint32_t)(Universe)                                                  \
+		&& (pSet->Words[CSET_FIXED_WORD(Value)] & CSET_FIXED_MASK(Value)) != 0;                       \
+};                                                                                                \
+static inline bool Name##_Remove(Name* const pSet, int32_t Value){                               \
+	if(!Name##_Contains(pSet, Value)){                                                              \
+		return false;                                                                                \
+	}                                                                                               \
+	pSet->Words[CSET_FIXED_WORD(Value)] &= ~CSET_FIXED_MASK(Value);                                 \
+	return true;                                                                                    \
+};                                                                                                \
+static inline uint32_t Name##_Size(const Name* const pSet){                                      \
+	uint32_t size = 0, i = 0;                                                                       \
+	while(i < CSET_FIXED_WORDS(Universe)){                                                          \
+		size += (uint32_t) __builtin_popcountll(pSet->Words[i]);                                     \
+		i++;                                                                                         \
+	}                                                                                               \
+	return size;                                                                                    \
+};                                                                                                \
+static inline bool Name##_isEmpty(const Name* const pSet){                                       \
+	uint64_t any = 0;                                                                               \
+	uint32_t i = 0;                                                                                 \
+	while(i < CSET_FIXED_WORDS(Universe)){                                                          \
+		any |= pSet->Words[i];                                                                       \
+		i++;                                                                                         \
+	}                                                                                               \
+	return any == 0;                                                                                \
+};                                                                                                \
+static inline void Name##_makeEmpty(Name* const pSet){                                           \
+	uint32_t i = 0;                                                                                 \
+	while(i < CSET_FIXED_WORDS(Universe)){                                                          \
+		pSet->Words[i] = 0;                                                                          \
+		i++;                                                                                         \
+	}                                                                                               \
+};                                                                                                \
+static inline bool Name##_Equals(const Name* const pA, const Name* const pB){                    \
+	uint64_t diff = 0;                                                                              \
+	uint32_t i = 0;                                                                                 \
+	while(i < CSET_FIXED_WORDS(Universe)){                                                          \
+		diff |= pA->Words[i] ^ pB->Words[i];                                                         \
+		i++;                                                                                         \
+	}                                                                                               \
+	return diff == 0;                                                                               \
+};                                                                                                \
+static inline bool Name##_isSubsetOf(const Name* const pA, const Name* const pB){                \
+	uint64_t extra = 0;                                                                             \
+	uint32_t i = 0;                                                                                 \
+	while(i < CSET_FIXED_WORDS(Universe)){                                                          \
+		extra |= pA->Words[i] & ~pB->Words[i];                                                       \
+		i++;                                                                                         \
+	}                                                                                               \
+	return extra == 0;                                                                              \
+};                                                                                                \
+static inline bool Name##_Intersects(const Name* const pA, const Name* const pB){                \
+	uint64_t common = 0;                                                                            \
+	uint32_t i = 0;                                                                                 \
+	while(i < CSET_FIXED_WORDS(Universe)){                                                          \
+		common |= pA->Words[i] & pB->Words[i];                                                       \
+		i++;                                                                                         \
+	}                                                                                               \
+	return common != 0;                                                                             \
+};                                                                                                \
+static inline void Name##_Union(Name* const pUnion, const Name* const pA, const Name* const pB){  \
+	uint32_t i = 0;                                                                                 \
+	while(i < CSET_FIXED_WORDS(Universe)){                                                          \
+		pUnion->Words[i] = pA->Words[i] | pB->Words[i];                                              \
+		i++;                                                                                         \
+	}                                                                                               \
+};                                                                                                \
+static inline void Name##_Intersection(Name* const pIntersection, const Name* const pA,          \
+                                       const Name* const pB){                                     \
+	uint32_t i = 0;                                                                                 \
+	while(i < CSET_FIXED_WORDS(Universe)){                                                          \
+		pIntersection->Words[i] = pA->Words[i] & pB->Words[i];                                       \
+		i++;                                                                                         \
+	}                                                                                               \
+};                                                                                                \
+static inline void Name##_Difference(Name* const pDifference, const Name* const pA,              \
+                                     const Name* const pB){                                       \
+	uint32_t i = 0;                                                                                 \
+	while(i < CSET_FIXED_WORDS(Universe)){                                                          \
+		pDifference->Words[i] = pA->Words[i] & ~pB->Words[i];                                        \
+		i++;                                                                                         \
+	}                                                                                               \
+};                                                                                                \
+static inline bool Name##_FromCSet(Name* const pSet, const CSet* const pSource){                 \
+	return CSet_Fixed_FromCSet(pSet->Words, CSET_FIXED_WORDS(Universe), (uint32_t)(Universe),      \
+	                           pSource);                                                           \
+};                                                                                                \
+static inline bool Name##_ToCSet(const Name* const pSet, CSet* const pTarget){                   \
+	return CSet_Fixed_ToCSet(pSet->Words, CSET_FIXED_WORDS(Universe), pTarget);                    \
+}
+
+#endif
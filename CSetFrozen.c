@@ -0,0 +1,516 @@
+#include "CSetFrozen.h"
+#include "CSetKernels.h"
+#include "CSetInternal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// CSetFrozen builds a minimal perfect hash index (in the style of BBHash)
+// over a set that will not change again, so membership is answered without
+// a binary search.
+//
+// Level 0 is a bit array of about FROZEN_GAMMA bits per element. Every
+// element is hashed to one bit; bits hit by exactly one element are kept,
+// and the elements that collided move on to level 1, which is sized for
+// them with a different hash, and so on. Each element ends up owning the
+// one bit at the first level where it did not collide, and the rank of that
+// bit among all kept bits (0 to Count - 1) is its slot. Elements still
+// colliding after CSET_FROZEN_MAX_LEVELS levels go to a small sorted spill
+// list. With two bits per element 61% of the elements are placed at
+// level 0 and the expected number of levels probed is about 1.6.
+//
+// The bit arrays are stored in 64-byte blocks of 448 bits plus the rank of
+// the block's first bit, so finding an element's slot reads a single cache
+// line per level. The index keeps the elements in slot order (Keys), and
+// membership is confirmed by comparing Keys[slot] with the value, a second
+// access. A value that is not a member either finds no set bit, or finds
+// one owned by another element and fails that comparison. The hash index
+// takes about 3.6 bits per element, in addition to the 32-bit Keys.
+//
+// Building hashes the elements of each level on several threads. Bits are
+// marked with atomic ORs into a "seen" and a "collided" array, then each
+// thread collects its own collided elements for the next level. Keys is
+// filled in parallel as well, since every element has a distinct slot.
+//
+// An index is written after its set with CSet_Frozen_Write and read back
+// with CSet_Frozen_Read, which checks it against the set read before it.
+
+//Global Declaration
+#define FROZEN_BLOCK_BITS 448
+#define FROZEN_BLOCK_WORDS 8
+#define FROZEN_RANK_WORD 7
+#define FROZEN_GAMMA 2
+#define FROZEN_MAX_THREADS 64
+#define FROZEN_MIN_SHARE (1 << 16)
+#define FROZEN_SEED 0x243F6A8885A308D3ULL
+#define FROZEN_FILE_MAGIC 0x315A5246u   // "FRZ1" in little-endian byte order
+
+struct _Frozen_Job {
+
+   CSet_Frozen* pFrozen; // index being built
+   const int32_t* Keys;  // elements handled by the job
+   uint32_t Begin;       // first element of the job
+   uint32_t End;         // one past the last element of the job
+   uint32_t Level;       // level being built
+   uint64_t* Seen;       // bits of the level hit by at least one element
+   uint64_t* Collided;   // bits of the level hit by more than one element
+   int32_t* Left;        // receives the unplaced elements from Left[Begin]
+   uint32_t LeftCount;   // number of unplaced elements
+};
+
+typedef struct _Frozen_Job Frozen_Job;
+
+//Internal Helper Declarations
+uint64_t Frozen_Position(const CSet_Frozen* pFrozen, uint32_t level, int32_t val);
+bool Frozen_Locate(const CSet_Frozen* pFrozen, int32_t val, uint32_t* pSlot);
+uint32_t Frozen_Threads(uint32_t threads, uint32_t n);
+void Frozen_Run(Frozen_Job* jobs, uint32_t threads, void* (*fn)(void*));
+void* Frozen_Mark_Main(void* pArg);
+void* Frozen_Split_Main(void* pArg);
+void* Frozen_Place_Main(void* pArg);
+bool Frozen_Check_Ranks(const CSet_Frozen* pFrozen);
+
+/**
+ * Builds the index of a set's elements, replacing any previous index.
+ *
+ * Pre:
+ *    *pFrozen was zeroed or returned by an earlier Build or Read
+ *    *pSet satisfies the CSet contract and is no longer modified
+ *    Threads is the number of build threads, or 0 to use every online CPU
+ * Post:
+ *    If successful:
+ *       CSet_Frozen_Contains(pFrozen, x) == CSet_Contains(pSet, x) for all x
+ *       pFrozen->SetHash == CSet_Hash(pSet)
+ *    else:
+ *       *pFrozen is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_Frozen_Build(CSet_Frozen* const pFrozen, const CSet* const pSet, uint32_t Threads){
+	CSet_Frozen built;
+	memset(&built, 0, sizeof(CSet_Frozen));
+	uint32_t n = CSet_Size(pSet);
+	built.Count = n;
+	built.Seed = FROZEN_SEED;
+	built.SetHash = CSet_Hash(pSet);
+	Frozen_Job jobs[FROZEN_MAX_THREADS];
+	uint64_t levelWords = (((uint64_t) n * FROZEN_GAMMA + FROZEN_BLOCK_BITS - 1) / FROZEN_BLOCK_BITS) * FROZEN_RANK_WORD;
+	int32_t* keys = (int32_t*) malloc(sizeof(int32_t) * ((size_t) n + 1));
+	int32_t* left = (int32_t*) malloc(sizeof(int32_t) * ((size_t) n + 1));
+	uint64_t* seen = (uint64_t*) malloc(sizeof(uint64_t) * (size_t)(levelWords + 1));
+	uint64_t* collided = (uint64_t*) malloc(sizeof(uint64_t) * (size_t)(levelWords + 1));
+	bool success = keys && left && seen && collided;
+	if(success && n > 0){
+		memcpy(keys, pSet->Data, sizeof(int32_t) * (size_t) n);
+	}
+	uint32_t remaining = n;
+	while(success && remaining > 0 && built.Levels < CSET_FROZEN_MAX_LEVELS){
+		uint32_t level = built.Levels;
+		uint32_t blocks = (uint32_t)(((uint64_t) remaining * FROZEN_GAMMA + FROZEN_BLOCK_BITS - 1) / FROZEN_BLOCK_BITS);
+		size_t words = (size_t) blocks * FROZEN_RANK_WORD;
+		uint64_t* temp = (uint64_t*) realloc(built.Blocks, sizeof(uint64_t) * FROZEN_BLOCK_WORDS *
+		                                     ((size_t) built.BlockCount + blocks));
+		if(!temp){
+			success = false;
+			break;
+		}
+		built.Blocks = temp;
+		built.LevelStart[level] = built.BlockCount;
+		built.LevelBlocks[level] = blocks;
+		built.BlockCount += blocks;
+		built.Levels++;
+		memset(seen, 0, sizeof(uint64_t) * words);
+		memset(collided, 0, sizeof(uint64_t) * words);
+
+		uint32_t threads = Frozen_Threads(Threads, remaining);
+		uint32_t t = 0;
+		while(t < threads){
+			jobs[t].pFrozen = &built;
+			jobs[t].Keys = keys;
+			jobs[t].Begin = (uint32_t)(((uint64_t) remaining * t) / threads);
+			jobs[t].End = (uint32_t)(((uint64_t) remaining * (t + 1)) / threads);
+			jobs[t].Level = level;
+			jobs[t].Seen = seen;
+			jobs[t].Collided = collided;
+			jobs[t].Left = left;
+			jobs[t].LeftCount = 0;
+			t++;
+		}
+		Frozen_Run(jobs, threads, Frozen_Mark_Main);
+		uint64_t* pBlock = built.Blocks + (size_t) built.LevelStart[level] * FROZEN_BLOCK_WORDS;
+		size_t w = 0;
+		while(w < words){
+			seen[w] &= ~collided[w];
+			pBlock[(w / FROZEN_RANK_WORD) * FROZEN_BLOCK_WORDS + w % FROZEN_RANK_WORD] = seen[w];
+			w++;
+		}
+		Frozen_Run(jobs, threads, Frozen_Split_Main);
+		remaining = 0;
+		t = 0;
+		while(t < threads){
+			memmove(left + remaining, left + jobs[t].Begin, sizeof(int32_t) * jobs[t].LeftCount);
+			remaining += jobs[t].LeftCount;
+			t++;
+		}
+		int32_t* swap = keys;
+		keys = left;
+		left = swap;
+	}
+	if(success && remaining > 0){
+		built.Spill = (int32_t*) malloc(sizeof(int32_t) * remaining);
+		success = built.Spill != NULL;
+		if(success){
+			memcpy(built.Spill, keys, sizeof(int32_t) * remaining);
+			built.SpillCount = remaining;
+		}
+	}
+	if(success){
+		uint64_t rank = 0;
+		uint32_t b = 0;
+		while(b < built.BlockCount){
+			uint64_t* pBlock = built.Blocks + (size_t) b * FROZEN_BLOCK_WORDS;
+			pBlock[FROZEN_RANK_WORD] = rank;
+			uint32_t j = 0;
+			while(j < FROZEN_RANK_WORD){
+				rank += __builtin_popcountll(pBlock[j++]);
+			}
+			b++;
+		}
+		built.Keys = (int32_t*) malloc(sizeof(int32_t) * ((size_t) rank + 1));
+		success = built.Keys != NULL;
+	}
+	if(success && n > 0){
+		uint32_t threads = Frozen_Threads(Threads, n);
+		uint32_t t = 0;
+		while(t < threads){
+			jobs[t].pFrozen = &built;
+			jobs[t].Keys = pSet->Data;
+			jobs[t].Begin = (uint32_t)(((uint64_t) n * t) / threads);
+			jobs[t].End = (uint32_t)(((uint64_t) n * (t + 1)) / threads);
+			t++;
+		}
+		Frozen_Run(jobs, threads, Frozen_Place_Main);
+	}
+	free(keys);
+	free(left);
+	free(seen);
+	free(collided);
+	if(!success){
+		CSet_Frozen_Free(&built);
+		return false;
+	}
+	CSet_Frozen_Free(pFrozen);
+	*pFrozen = built;
+	return true;
+};
+
+/**
+ * Determines if Value belongs to the set an index was built from, in O(1):
+ * one cache line per level probed, plus one comparison with Keys.
+ *
+ * Pre:
+ *    *pFrozen was built by CSet_Frozen_Build or read by CSet_Frozen_Read
+ * Post:
+ *    *pFrozen is unchanged
+ * Returns:
+ *    true if Value belongs to the set, false otherwise
+ */
+bool CSet_Frozen_Contains(const CSet_Frozen* const pFrozen, int32_t Value){
+	uint32_t slot;
+	if(Frozen_Locate(pFrozen, Value, &slot)){
+		return pFrozen->Keys[slot] == Value;
+	}
+	if(pFrozen->SpillCount == 0){
+		return false;
+	}
+	uint32_t index = CSet_Active_Kernels->LowerBound(pFrozen->Spill, pFrozen->SpillCount, Value);
+	return index < pFrozen->SpillCount && pFrozen->Spill[index] == Value;
+};
+
+/**
+ * Writes an index to a stream, normally right after its set was written
+ * with CSet_Write.
+ *
+ * Pre:
+ *    *pFrozen was built by CSet_Frozen_Build or read by CSet_Frozen_Read
+ *    Out is open for writing
+ * Post:
+ *    *pFrozen is unchanged
+ * Returns:
+ *    true if every write succeeded, false otherwise
+ */
+bool CSet_Frozen_Write(const CSet_Frozen* const pFrozen, FILE* const Out){
+	uint32_t header[6] = {FROZEN_FILE_MAGIC, pFrozen->Count, pFrozen->Levels,
+	                      pFrozen->BlockCount, pFrozen->SpillCount, 0};
+	uint64_t seeds[2] = {pFrozen->Seed, pFrozen->SetHash};
+	size_t blockWords = (size_t) pFrozen->BlockCount * FROZEN_BLOCK_WORDS;
+	size_t placed = (size_t) pFrozen->Count - pFrozen->SpillCount;
+	return fwrite(header, sizeof(uint32_t), 6, Out) == 6 &&
+	       fwrite(seeds, sizeof(uint64_t), 2, Out) == 2 &&
+	       (pFrozen->Levels == 0 ||
+	        (fwrite(pFrozen->LevelStart, sizeof(uint32_t), pFrozen->Levels, Out) == pFrozen->Levels &&
+	         fwrite(pFrozen->LevelBlocks, sizeof(uint32_t), pFrozen->Levels, Out) == pFrozen->Levels)) &&
+	       (blockWords == 0 || fwrite(pFrozen->Blocks, sizeof(uint64_t), blockWords, Out) == blockWords) &&
+	       (placed == 0 || fwrite(pFrozen->Keys, sizeof(int32_t), placed, Out) == placed) &&
+	       (pFrozen->SpillCount == 0 ||
+	        fwrite(pFrozen->Spill, sizeof(int32_t), pFrozen->SpillCount, Out) == pFrozen->SpillCount);
+};
+
+/**
+ * Replaces an index with one written by CSet_Frozen_Write, leaving the
+ * stream positioned after it.
+ *
+ * Pre:
+ *    *pFrozen was zeroed or returned by an earlier Build or Read
+ *    In is open for reading
+ *    pSet is the set the index belongs to, or NULL to skip the check
+ * Post:
+ *    If successful:
+ *       *pFrozen holds the index that was written
+ *    else:
+ *       *pFrozen is unchanged
+ * Returns:
+ *    true if a well-formed index was read (built from a set with the size
+ *    and hash of *pSet, if given), false otherwise
+ */
+bool CSet_Frozen_Read(CSet_Frozen* const pFrozen, FILE* const In, const CSet* const pSet){
+	uint32_t header[6];
+	uint64_t seeds[2];
+	if(fread(header, sizeof(uint32_t), 6, In) != 6 || fread(seeds, sizeof(uint64_t), 2, In) != 2 ||
+		header[0] != FROZEN_FILE_MAGIC || header[2] > CSET_FROZEN_MAX_LEVELS || header[4] > header[1]){
+		return false;
+	}
+	if(pSet && (header[1] != CSet_Size(pSet) || seeds[1] != CSet_Hash(pSet))){
+		return false;
+	}
+	CSet_Frozen read;
+	memset(&read, 0, sizeof(CSet_Frozen));
+	read.Count = header[1];
+	read.Levels = header[2];
+	read.BlockCount = header[3];
+	read.SpillCount = header[4];
+	read.Seed = seeds[0];
+	read.SetHash = seeds[1];
+	size_t blockWords = (size_t) read.BlockCount * FROZEN_BLOCK_WORDS;
+	size_t placed = (size_t) read.Count - read.SpillCount;
+	read.Blocks = (uint64_t*) malloc(sizeof(uint64_t) * (blockWords + 1));
+	read.Keys = (int32_t*) malloc(sizeof(int32_t) * (placed + 1));
+	read.Spill = (int32_t*) malloc(sizeof(int32_t) * ((size_t) read.SpillCount + 1));
+	bool success = read.Blocks && read.Keys && read.Spill &&
+	               (read.Levels == 0 ||
+	                (fread(read.LevelStart, sizeof(uint32_t), read.Levels, In) == read.Levels &&
+	                 fread(read.LevelBlocks, sizeof(uint32_t), read.Levels, In) == read.Levels)) &&
+	               (blockWords == 0 || fread(read.Blocks, sizeof(uint64_t), blockWords, In) == blockWords) &&
+	               (placed == 0 || fread(read.Keys, sizeof(int32_t), placed, In) == placed) &&
+	               (read.SpillCount == 0 || fread(read.Spill, sizeof(int32_t), read.SpillCount, In) == read.SpillCount);
+	uint64_t total = 0;
+	uint32_t level = 0;
+	while(success && level < read.Levels){
+		success = read.LevelStart[level] == total && read.LevelBlocks[level] > 0;
+		total += read.LevelBlocks[level];
+		level++;
+	}
+	success = success && total == read.BlockCount && Frozen_Check_Ranks(&read);
+	uint32_t i = 1;
+	while(success && i < read.SpillCount){
+		success = read.Spill[i - 1] < read.Spill[i];
+		i++;
+	}
+	if(!success){
+		CSet_Frozen_Free(&read);
+		return false;
+	}
+	CSet_Frozen_Free(pFrozen);
+	*pFrozen = read;
+	return true;
+};
+
+/**
+ * Releases the memory of an index.
+ *
+ * Pre:
+ *    *pFrozen was zeroed or returned by Build or Read
+ * Post:
+ *    *pFrozen is zeroed and indexes the empty set
+ */
+void CSet_Frozen_Free(CSet_Frozen* const pFrozen){
+	free(pFrozen->Blocks);
+	free(pFrozen->Keys);
+	free(pFrozen->Spill);
+	memset(pFrozen, 0, sizeof(CSet_Frozen));
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Hashes val to a bit of the given level
+ * @param  pFrozen the index
+ * @param  level   the level
+ * @param  val     the value to hash
+ * @return uint64_t the bit index within the level
+ */
+uint64_t Frozen_Position(const CSet_Frozen* pFrozen, uint32_t level, int32_t val){
+	uint64_t h = Sketch_Mix((uint32_t) val ^ (pFrozen->Seed + level * 0x9E3779B97F4A7C15ULL));
+	uint64_t bits = (uint64_t) pFrozen->LevelBlocks[level] * FROZEN_BLOCK_BITS;
+	return (uint64_t)(((unsigned __int128) h * bits) >> 64);
+};
+
+/**
+ * Finds the slot val would own: the rank of the first kept bit it hashes to
+ * @param  pFrozen the index, with ranks filled in
+ * @param  val     the value to look up
+ * @param  pSlot   receives the slot
+ * @return bool whether some level has a kept bit for val
+ */
+bool Frozen_Locate(const CSet_Frozen* pFrozen, int32_t val, uint32_t* pSlot){
+	uint32_t level = 0;
+	while(level < pFrozen->Levels){
+		uint64_t bit = Frozen_Position(pFrozen, level, val);
+		const uint64_t* pBlock = pFrozen->Blocks +
+			((size_t) pFrozen->LevelStart[level] + bit / FROZEN_BLOCK_BITS) * FROZEN_BLOCK_WORDS;
+		uint32_t offset = (uint32_t)(bit % FROZEN_BLOCK_BITS);
+		uint32_t word = offset >> 6;
+		uint64_t mask = 1ULL << (offset & 63);
+		if(pBlock[word] & mask){
+			uint64_t rank = pBlock[FROZEN_RANK_WORD] + __builtin_popcountll(pBlock[word] & (mask - 1));
+			uint32_t j = 0;
+			while(j < word){
+				rank += __builtin_popcountll(pBlock[j++]);
+			}
+			*pSlot = (uint32_t) rank;
+			return true;
+		}
+		level++;
+	}
+	return false;
+};
+
+/**
+ * Chooses how many threads to build with, giving each at least
+ * FROZEN_MIN_SHARE elements
+ * @param  threads the requested number, 0 for one per online CPU
+ * @param  n       the number of elements to process
+ * @return uint32_t the number of threads, at least 1
+ */
+uint32_t Frozen_Threads(uint32_t threads, uint32_t n){
+	if(threads == 0){
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cpus > 0 ? (uint32_t) cpus : 1;
+	}
+	if(threads > FROZEN_MAX_THREADS){
+		threads = FROZEN_MAX_THREADS;
+	}
+	if(threads > n / FROZEN_MIN_SHARE + 1){
+		threads = n / FROZEN_MIN_SHARE + 1;
+	}
+	return threads;
+};
+
+/**
+ * Runs fn on every job, jobs[1:] on their own threads and jobs[0] on the
+ * calling thread; a job whose thread cannot be started runs inline
+ * @param jobs    the jobs
+ * @param threads the number of jobs
+ * @param fn      the job body
+ */
+void Frozen_Run(Frozen_Job* jobs, uint32_t threads, void* (*fn)(void*)){
+	pthread_t tids[FROZEN_MAX_THREADS];
+	bool started[FROZEN_MAX_THREADS];
+	uint32_t t = 1;
+	while(t < threads){
+		started[t] = pthread_create(&tids[t], NULL, fn, &jobs[t]) == 0;
+		t++;
+	}
+	fn(&jobs[0]);
+	t = 1;
+	while(t < threads){
+		if(started[t]){
+			pthread_join(tids[t], NULL);
+		}
+		else{
+			fn(&jobs[t]);
+		}
+		t++;
+	}
+};
+
+/**
+ * Job body: marks the bit of each element in Seen, and in Collided if it
+ * was already marked
+ * @param  pArg the Frozen_Job
+ * @return void* NULL
+ */
+void* Frozen_Mark_Main(void* pArg){
+	Frozen_Job* pJob = (Frozen_Job*) pArg;
+	uint32_t i = pJob->Begin;
+	while(i < pJob->End){
+		uint64_t bit = Frozen_Position(pJob->pFrozen, pJob->Level, pJob->Keys[i]);
+		uint64_t mask = 1ULL << (bit & 63);
+		if(__atomic_fetch_or(&pJob->Seen[bit >> 6], mask, __ATOMIC_RELAXED) & mask){
+			__atomic_fetch_or(&pJob->Collided[bit >> 6], mask, __ATOMIC_RELAXED);
+		}
+		i++;
+	}
+	return NULL;
+};
+
+/**
+ * Job body: collects the elements whose bit was not kept into Left
+ * @param  pArg the Frozen_Job
+ * @return void* NULL
+ */
+void* Frozen_Split_Main(void* pArg){
+	Frozen_Job* pJob = (Frozen_Job*) pArg;
+	uint32_t i = pJob->Begin;
+	while(i < pJob->End){
+		uint64_t bit = Frozen_Position(pJob->pFrozen, pJob->Level, pJob->Keys[i]);
+		if(!(pJob->Seen[bit >> 6] & (1ULL << (bit & 63)))){
+			pJob->Left[pJob->Begin + pJob->LeftCount++] = pJob->Keys[i];
+		}
+		i++;
+	}
+	return NULL;
+};
+
+/**
+ * Job body: stores each placed element in Keys at its slot
+ * @param  pArg the Frozen_Job
+ * @return void* NULL
+ */
+void* Frozen_Place_Main(void* pArg){
+	Frozen_Job* pJob = (Frozen_Job*) pArg;
+	uint32_t i = pJob->Begin;
+	uint32_t slot;
+	while(i < pJob->End){
+		if(Frozen_Locate(pJob->pFrozen, pJob->Keys[i], &slot)){
+			pJob->pFrozen->Keys[slot] = pJob->Keys[i];
+		}
+		i++;
+	}
+	return NULL;
+};
+
+/**
+ * Checks that the rank words of an index that was read are consistent with
+ * its bits and that the kept bits number exactly the placed elements
+ * @param  pFrozen the index
+ * @return bool whether the ranks are consistent
+ */
+bool Frozen_Check_Ranks(const CSet_Frozen* pFrozen){
+	uint64_t rank = 0;
+	uint32_t b = 0;
+	while(b < pFrozen->BlockCount){
+		const uint64_t* pBlock = pFrozen->Blocks + (size_t) b * FROZEN_BLOCK_WORDS;
+		if(pBlock[FROZEN_RANK_WORD] != rank){
+			return false;
+		}
+		uint32_t j = 0;
+		while(j < FROZEN_RANK_WORD){
+			rank += __builtin_popcountll(pBlock[j++]);
+		}
+		b++;
+	}
+	return rank == (uint64_t) pFrozen->Count - pFrozen->SpillCount;
+};
@@ -0,0 +1,37 @@
+#ifndef CSET_FROZEN_H
+#define CSET_FROZEN_H
+#include "CSet.h"
+
+#define CSET_FROZEN_MAX_LEVELS 32
+
+// A minimal perfect hash index over the elements of a set that no longer
+// changes. Each level is a bit array stored in 64-byte blocks: seven words
+// of bits followed by the number of set bits in all earlier blocks.
+struct _CSet_Frozen {
+
+   uint32_t Count;       // number of elements indexed
+   uint32_t Levels;      // number of levels in use
+   uint32_t LevelStart[CSET_FROZEN_MAX_LEVELS];  // first block of each level
+   uint32_t LevelBlocks[CSET_FROZEN_MAX_LEVELS]; // number of blocks of each level
+   uint64_t* Blocks;     // BlockCount blocks of 8 words
+   uint32_t BlockCount;  // number of blocks of all levels
+   int32_t* Keys;        // placed elements, each at the rank of its bit
+   int32_t* Spill;       // sorted elements no level could place
+   uint32_t SpillCount;  // number of elements in Spill
+   uint64_t Seed;        // seed of the level hash functions
+   uint64_t SetHash;     // CSet_Hash of the set the index was built from
+};
+
+typedef struct _CSet_Frozen CSet_Frozen;
+
+bool CSet_Frozen_Build(CSet_Frozen* const pFrozen, const CSet* const pSet, uint32_t Threads);
+
+bool CSet_Frozen_Contains(const CSet_Frozen* const pFrozen, int32_t Value);
+
+bool CSet_Frozen_Write(const CSet_Frozen* const pFrozen, FILE* const Out);
+
+bool CSet_Frozen_Read(CSet_Frozen* const pFrozen, FILE* const In, const CSet* const pSet);
+
+void CSet_Frozen_Free(CSet_Frozen* const pFrozen);
+
+#endif
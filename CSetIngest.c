@@ -0,0 +1,513 @@
+#include "CSetIngest.h"
+#include "CSetInternal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// CSetIngest builds a CSet from a file of integers in one parallel pass.
+//
+// The file is mapped into memory and split into one chunk per thread.
+// Each thread parses its chunk into a private array, radix sorts it and
+// removes duplicates. The sorted runs are then k-way merged (dropping
+// duplicates across runs) into the final set, which is loaded with a
+// single CSet_Load.
+//
+// Two formats are accepted:
+//  - text: signed decimal integers separated by whitespace (one per line
+//    in the usual case)
+//  - binary: consecutive little-endian int32_t values
+//
+// INT32_MAX marks empty cells in a CSet and cannot be stored, so a file
+// containing it (or a text value outside the int32_t range, or any other
+// character) is rejected and the target set is left unchanged.
+
+//Global Declaration
+#define INGEST_MAX_THREADS 64
+#define INGEST_MIN_CHUNK (1 << 16)
+#define DEFAULT_INGEST_CAPACITY 10
+
+struct _Ingest_Run {
+
+   const unsigned char* Begin;   // first byte of the chunk
+   const unsigned char* End;     // one past the last byte of the chunk
+   bool Binary;                  // chunk holds little-endian int32_t values
+   int32_t* Data;                // parsed, sorted, deduplicated values
+   uint32_t Usage;               // number of values in Data
+   uint32_t Capacity;            // dimension of Data
+   bool Failed;                  // parse or allocation error
+};
+
+typedef struct _Ingest_Run Ingest_Run;
+
+//Internal Helper Declarations
+bool Ingest_File(CSet* const pSet, const char* const Path, uint32_t Threads, bool Binary);
+void* Ingest_Run_Main(void* pArg);
+bool Ingest_Parse_Text(Ingest_Run* pRun);
+bool Ingest_Parse_Binary(Ingest_Run* pRun);
+bool Ingest_Append(Ingest_Run* pRun, int32_t val);
+uint32_t Ingest_Merge(Ingest_Run* runs, uint32_t k, int32_t* out);
+uint32_t Parse_Eight_Digits(const unsigned char* p);
+bool Is_Eight_Digits(const unsigned char* p);
+
+/**
+ * Replaces the contents of a pSet object with the integers in a text file.
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ *    Path names a readable file of whitespace-separated decimal integers
+ *    Threads is the number of parser threads, or 0 to use every online CPU
+ * Post:
+ *    If successful:
+ *       *pSet contains exactly the distinct values in the file
+ *       *pSet satisfies the CSet contract
+ *    else:
+ *       *pSet is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_IngestText(CSet* const pSet, const char* const Path, uint32_t Threads){
+	return Ingest_File(pSet, Path, Threads, false);
+};
+
+/**
+ * Replaces the contents of a pSet object with the values in a file of raw
+ * little-endian int32_t values.
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ *    Path names a readable file whose size is a multiple of 4 bytes
+ *    Threads is the number of sorter threads, or 0 to use every online CPU
+ * Post:
+ *    If successful:
+ *       *pSet contains exactly the distinct values in the file
+ *       (a thread's chunk of the file must hold fewer than UINT32_MAX values)
+ *       *pSet satisfies the CSet contract
+ *    else:
+ *       *pSet is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_IngestBinary(CSet* const pSet, const char* const Path, uint32_t Threads){
+	return Ingest_File(pSet, Path, Threads, true);
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Maps the file, runs one Ingest_Run per chunk on its own thread, merges the
+ * runs and loads the result into pSet
+ * @param  pSet    the set to replace
+ * @param  Path    the file to read
+ * @param  Threads the requested number of threads, 0 for one per CPU
+ * @param  Binary  whether the file holds raw int32_t values
+ * @return bool whether or not the ingest was successful
+ */
+bool Ingest_File(CSet* const pSet, const char* const Path, uint32_t Threads, bool Binary){
+	int fd = open(Path, O_RDONLY);
+	if(fd < 0){
+		return false;
+	}
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (Binary && (st.st_size % sizeof(int32_t)) != 0)){
+		close(fd);
+		return false;
+	}
+	size_t len = (size_t) st.st_size;
+	const unsigned char* base = NULL;
+	if(len > 0){
+		void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(map == MAP_FAILED){
+			close(fd);
+			return false;
+		}
+		madvise(map, len, MADV_SEQUENTIAL);
+		madvise(map, len, MADV_WILLNEED);
+		base = (const unsigned char*) map;
+	}
+	close(fd);
+
+	if(Threads == 0){
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		Threads = cpus > 0 ? (uint32_t) cpus : 1;
+	}
+	if(Threads > INGEST_MAX_THREADS){
+		Threads = INGEST_MAX_THREADS;
+	}
+	if((size_t) Threads * INGEST_MIN_CHUNK > len){
+		Threads = (uint32_t)(len / INGEST_MIN_CHUNK) + 1;
+	}
+
+	Ingest_Run runs[INGEST_MAX_THREADS];
+	pthread_t tids[INGEST_MAX_THREADS];
+	bool started[INGEST_MAX_THREADS];
+	memset(runs, 0, sizeof(runs));
+	size_t unit = Binary ? sizeof(int32_t) : 1;
+	size_t units = len / unit;
+	const unsigned char* prev = base;
+	uint32_t t = 0;
+	while(t < Threads){
+		const unsigned char* end = base + ((units * (t + 1)) / Threads) * unit;
+		if(!Binary){
+			// Text chunks end just after a separator so no value is split.
+			while(end < base + len && end[0] != '\n'){
+				end++;
+			}
+			if(end < base + len){
+				end++;
+			}
+		}
+		if(end < prev){
+			end = prev;
+		}
+		runs[t].Begin = prev;
+		runs[t].End = end;
+		runs[t].Binary = Binary;
+		prev = end;
+		t++;
+	}
+
+	bool success = true;
+	t = 0;
+	while(t < Threads){
+		started[t] = (t > 0) && pthread_create(&tids[t], NULL, Ingest_Run_Main, &runs[t]) == 0;
+		t++;
+	}
+	Ingest_Run_Main(&runs[0]);
+	t = 0;
+	while(t < Threads){
+		if(t > 0){
+			if(started[t]){
+				pthread_join(tids[t], NULL);
+			}
+			else{
+				Ingest_Run_Main(&runs[t]);
+			}
+		}
+		success = success && !runs[t].Failed;
+		t++;
+	}
+	if(base){
+		munmap((void*) base, len);
+	}
+
+	uint64_t total = 0;
+	t = 0;
+	while(t < Threads){
+		total += runs[t].Usage;
+		t++;
+	}
+	int32_t* merged = NULL;
+	if(success && total >= UINT32_MAX){
+		success = false;
+	}
+	if(success){
+		merged = (int32_t*) malloc(sizeof(int32_t) * (total > 0 ? total : 1));
+		success = (merged != NULL);
+	}
+	if(success){
+		uint32_t usage = Ingest_Merge(runs, Threads, merged);
+		uint32_t capacity = usage < DEFAULT_INGEST_CAPACITY ? DEFAULT_INGEST_CAPACITY : usage + 1;
+		success = CSet_Load(pSet, capacity, merged, usage);
+	}
+	free(merged);
+	t = 0;
+	while(t < Threads){
+		free(runs[t].Data);
+		t++;
+	}
+	return success;
+};
+
+/**
+ * Thread body: parses a chunk, then sorts and deduplicates its values
+ * @param  pArg the Ingest_Run to process
+ * @return void* always NULL; errors are reported through Failed
+ */
+void* Ingest_Run_Main(void* pArg){
+	Ingest_Run* pRun = (Ingest_Run*) pArg;
+	bool parsed = pRun->Binary ? Ingest_Parse_Binary(pRun) : Ingest_Parse_Text(pRun);
+	if(!parsed || !Ingest_Radix_Sort(pRun->Data, pRun->Usage)){
+		pRun->Failed = true;
+		return NULL;
+	}
+	pRun->Usage = Ingest_Dedup(pRun->Data, pRun->Usage);
+	return NULL;
+};
+
+/**
+ * Parses whitespace-separated decimal integers. Runs of eight digits are
+ * converted at once with a SWAR (SIMD within a register) multiply sequence.
+ * @param  pRun the chunk to parse
+ * @return bool false on a malformed or out-of-range value
+ */
+bool Ingest_Parse_Text(Ingest_Run* pRun){
+	const unsigned char* p = pRun->Begin;
+	const unsigned char* end = pRun->End;
+	while(p < end){
+		unsigned char ch = *p;
+		if(ch == '\n' || ch == ' ' || ch == '\t' || ch == '\r'){
+			p++;
+			continue;
+		}
+		bool negative = false;
+		if(ch == '-'){
+			negative = true;
+			p++;
+		}
+		const unsigned char* digits = p;
+		int64_t acc = 0;
+		if(end - p >= 8 && Is_Eight_Digits(p)){
+			acc = Parse_Eight_Digits(p);
+			p += 8;
+		}
+		while(p < end && *p >= '0' && *p <= '9'){
+			acc = acc * 10 + (*p - '0');
+			if(acc > (int64_t) INT32_MAX + 1){
+				return false;
+			}
+			p++;
+		}
+		if(p == digits || (p < end && !(*p == '\n' || *p == ' ' || *p == '\t' || *p == '\r'))){
+			return false;
+		}
+		if(negative){
+			acc = -acc;
+		}
+		if(acc >= INT32_MAX || !Ingest_Append(pRun, (int32_t) acc)){
+			return false;
+		}
+	}
+	return true;
+};
+
+/**
+ * Decodes little-endian int32_t values
+ * @param  pRun the chunk to decode
+ * @return bool false on INT32_MAX, a chunk of UINT32_MAX or more values
+ *              (which a run cannot count), or allocation failure
+ */
+bool Ingest_Parse_Binary(Ingest_Run* pRun){
+	size_t count = (size_t)(pRun->End - pRun->Begin) / sizeof(int32_t);
+	if(count >= UINT32_MAX){
+		return false;
+	}
+	pRun->Data = (int32_t*) malloc(sizeof(int32_t) * (count > 0 ? count : 1));
+	if(!pRun->Data){
+		return false;
+	}
+	pRun->Capacity = (uint32_t) count;
+	const unsigned char* p = pRun->Begin;
+	size_t i = 0;
+	while(i < count){
+		uint32_t u = (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+			((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+		if(u == (uint32_t) INT32_MAX){
+			return false;
+		}
+		pRun->Data[i] = (int32_t) u;
+		p += sizeof(int32_t);
+		i++;
+	}
+	pRun->Usage = (uint32_t) count;
+	return true;
+};
+
+/**
+ * Appends a value to a run, growing its array geometrically
+ * @param  pRun the run to extend
+ * @param  val  the value to append
+ * @return bool whether or not the allocation was successful
+ */
+bool Ingest_Append(Ingest_Run* pRun, int32_t val){
+	if(pRun->Usage == pRun->Capacity){
+		uint64_t cap = pRun->Capacity ? (uint64_t) pRun->Capacity * 2 :
+			(uint64_t)(pRun->End - pRun->Begin) / 8 + DEFAULT_INGEST_CAPACITY;
+		if(cap >= UINT32_MAX){
+			cap = UINT32_MAX - 1;
+		}
+		if(cap <= pRun->Usage){
+			return false;
+		}
+		int32_t* newArr = (int32_t*) realloc(pRun->Data, sizeof(int32_t) * cap);
+		if(!newArr){
+			return false;
+		}
+		pRun->Data = newArr;
+		pRun->Capacity = (uint32_t) cap;
+	}
+	pRun->Data[pRun->Usage] = val;
+	pRun->Usage++;
+	return true;
+};
+
+/**
+ * Sorts signed values with a four-pass LSD radix sort on the sign-flipped
+ * bit pattern. Passes whose byte is constant across the input are skipped.
+ * @param  Data the values to sort
+ * @param  Sz   the number of values
+ * @return bool whether or not the scratch allocation was successful
+ */
+bool Ingest_Radix_Sort(int32_t* Data, uint32_t Sz){
+	if(Sz < 2){
+		return true;
+	}
+	uint32_t* src = (uint32_t*) Data;
+	uint32_t* dst = (uint32_t*) malloc(sizeof(uint32_t) * Sz);
+	if(!dst){
+		return false;
+	}
+	uint32_t* scratch = dst;
+	uint32_t counts[4][256];
+	memset(counts, 0, sizeof(counts));
+	uint32_t i = 0;
+	while(i < Sz){
+		uint32_t u = src[i] ^ 0x80000000u;
+		counts[0][u & 0xFF]++;
+		counts[1][(u >> 8) & 0xFF]++;
+		counts[2][(u >> 16) & 0xFF]++;
+		counts[3][u >> 24]++;
+		i++;
+	}
+	int pass = 0;
+	while(pass < 4){
+		uint32_t shift = pass * 8;
+		if(counts[pass][((src[0] ^ 0x80000000u) >> shift) & 0xFF] != Sz){
+			uint32_t offsets[256];
+			uint32_t sum = 0;
+			int b = 0;
+			while(b < 256){
+				offsets[b] = sum;
+				sum += counts[pass][b];
+				b++;
+			}
+			i = 0;
+			while(i < Sz){
+				uint32_t u = src[i];
+				dst[offsets[((u ^ 0x80000000u) >> shift) & 0xFF]++] = u;
+				i++;
+			}
+			uint32_t* swap = src;
+			src = dst;
+			dst = swap;
+		}
+		pass++;
+	}
+	if(src != (uint32_t*) Data){
+		memcpy(Data, src, sizeof(uint32_t) * Sz);
+	}
+	free(scratch);
+	return true;
+};
+
+/**
+ * Removes adjacent duplicates from a sorted array in place
+ * @param  Data the sorted values
+ * @param  Sz   the number of values
+ * @return uint32_t the number of distinct values kept
+ */
+uint32_t Ingest_Dedup(int32_t* Data, uint32_t Sz){
+	if(Sz == 0){
+		return 0;
+	}
+	uint32_t write = 1, read = 1;
+	while(read < Sz){
+		if(Data[read] != Data[write - 1]){
+			Data[write] = Data[read];
+			write++;
+		}
+		read++;
+	}
+	return write;
+};
+
+/**
+ * Merges k sorted, deduplicated runs into out with a binary min-heap of run
+ * cursors, dropping values that occur in more than one run
+ * @param  runs the runs to merge
+ * @param  k    the number of runs
+ * @param  out  an array large enough for every value of every run
+ * @return uint32_t the number of values written to out
+ */
+uint32_t Ingest_Merge(Ingest_Run* runs, uint32_t k, int32_t* out){
+	uint32_t heap[INGEST_MAX_THREADS];
+	uint32_t cursor[INGEST_MAX_THREADS];
+	uint32_t n = 0, usage = 0, r = 0;
+	while(r < k){
+		cursor[r] = 0;
+		if(runs[r].Usage > 0){
+			uint32_t child = n++;
+			while(child > 0 && runs[r].Data[0] < runs[heap[(child - 1) / 2]].Data[0]){
+				heap[child] = heap[(child - 1) / 2];
+				child = (child - 1) / 2;
+			}
+			heap[child] = r;
+		}
+		r++;
+	}
+	while(n > 0){
+		uint32_t top = heap[0];
+		int32_t val = runs[top].Data[cursor[top]];
+		if(usage == 0 || out[usage - 1] != val){
+			out[usage] = val;
+			usage++;
+		}
+		cursor[top]++;
+		if(cursor[top] == runs[top].Usage){
+			top = heap[--n];
+		}
+		int32_t key = (n > 0) ? runs[top].Data[cursor[top]] : 0;
+		uint32_t hole = 0;
+		while(n > 0){
+			uint32_t child = 2 * hole + 1;
+			if(child >= n){
+				break;
+			}
+			if(child + 1 < n &&
+				runs[heap[child + 1]].Data[cursor[heap[child + 1]]] < runs[heap[child]].Data[cursor[heap[child]]]){
+				child++;
+			}
+			if(runs[heap[child]].Data[cursor[heap[child]]] >= key){
+				break;
+			}
+			heap[hole] = heap[child];
+			hole = child;
+		}
+		if(n > 0){
+			heap[hole] = top;
+		}
+	}
+	return usage;
+};
+
+/**
+ * Checks that the eight bytes at p are all ASCII digits
+ * @param  p the bytes to test; at least eight must be readable
+ * @return bool whether or not all eight are digits
+ */
+bool Is_Eight_Digits(const unsigned char* p){
+	uint64_t val;
+	memcpy(&val, p, sizeof(val));
+	return (((val & 0xF0F0F0F0F0F0F0F0ULL) |
+		(((val + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+		0x3333333333333333ULL);
+};
+
+/**
+ * Converts eight ASCII digits to their value with three multiplies
+ * (SWAR), independent of host byte order
+ * @param  p the digits, most significant first
+ * @return uint32_t the value of the eight digits
+ */
+uint32_t Parse_Eight_Digits(const unsigned char* p){
+	uint64_t val = (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) |
+		((uint64_t)p[3] << 24) | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+		((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+	val = (val & 0x0F0F0F0F0F0F0F0FULL) * 2561 >> 8;
+	val = (val & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;
+	return (uint32_t)((val & 0x0000FFFF0000FFFFULL) * 42949672960001ULL >> 32);
+};
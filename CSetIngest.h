@@ -0,0 +1,9 @@
+#ifndef CSET_INGEST_H
+#define CSET_INGEST_H
+#include "CSet.h"
+
+bool CSet_IngestText(CSet* const pSet, const char* const Path, uint32_t Threads);
+
+bool CSet_IngestBinary(CSet* const pSet, const char* const Path, uint32_t Threads);
+
+#endif
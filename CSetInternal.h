@@ -0,0 +1,41 @@
+#ifndef CSET_INTERNAL_H
+#define CSET_INTERNAL_H
+#include "CSet.h"
+#include "CSetTrace.h"
+
+// Helpers defined in one module and used by others. They are not part of
+// the public API; declaring them here lets the compiler check every caller
+// against the definition.
+
+// Defined in CSetIngest.c, used by CSetExternal.c
+bool Ingest_Radix_Sort(int32_t* Data, uint32_t Sz);
+
+uint32_t Ingest_Dedup(int32_t* Data, uint32_t Sz);
+
+// Defined in CSetStore.c, used by CSetExternal.c
+bool Is_Sorted_Set(const int32_t* Data, uint32_t DSz);
+
+// Defined in CSet.c, used by CSetBatch.c
+void CSet_Init_Empty(CSet* const pSet);
+
+void Release_Data(CSet* pSet);
+
+void Summary_Free(CSet* pSet);
+
+uint64_t Elements_Hash(const int32_t* const source, uint32_t Sz);
+
+// Defined in CSet.c, used by CSetView.c, CSetJoin.c and CSetReplay.c
+int Compare_Int32(const void* a, const void* b);
+
+int Compare_Uint32(const void* a, const void* b);
+
+int Compare_Uint64(const void* a, const void* b);
+
+// Defined in CSetSketch.c, used by CSetFrozen.c and CSetTrace.c
+uint64_t Sketch_Mix(uint64_t x);
+
+// Defined in CSetTrace.c, used by CSet.c
+void Trace_Record(CSet_Trace* pTrace, uint32_t op, const CSet* pSet, const CSet* pOther, const CSet* pThird,
+                  uint32_t arg0, uint32_t arg1, const int32_t* values, uint32_t count);
+
+#endif
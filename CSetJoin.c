@@ -0,0 +1,795 @@
+#include "CSetJoin.h"
+#include "CSetInternal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// CSetJoin computes the overlaps between every pair of sets of a collection,
+// without intersecting the Count * (Count - 1) / 2 pairs one by one.
+//
+// Both joins start from an inverted index: the elements of all the sets are
+// radix sorted by value (stably, so each value's list of sets is in
+// ascending set order), which turns the collection into one posting list
+// per distinct value, stored back to back. Every set-major entry remembers
+// its position in the posting lists, so a set can walk the lists of its own
+// elements from just past itself.
+//
+// CSet_Join_Counts fills a dense Count x Count matrix. Row a is accumulated
+// by walking, for every element of set a, the sets b > a sharing it, and
+// incrementing a counter per b. The counters cover one block of
+// JOIN_BLOCK columns at a time, so they stay in the L1 cache however many
+// sets there are; each element keeps a cursor into its posting list between
+// blocks. Rows are handed out to the threads one at a time, since they
+// differ widely in cost, and once the upper triangle is complete the
+// threads mirror it into the lower one tile by tile. The work is the sum of
+// the squared posting list lengths rather than the sum of the pairwise set
+// sizes, which is far less when most pairs share few elements.
+//
+// CSet_Join_Similar only reports the pairs with a Jaccard similarity of at
+// least Threshold, using prefix filtering. Elements are ranked from the
+// rarest to the most frequent, and each set is rewritten as its sorted
+// ranks. Two sets x and y with J(x, y) >= t share at least t * |x|
+// elements, so they must share one among the first |x| - ceil(t * |x|) + 1
+// ranks of x (its prefix), and likewise for y. Only the prefixes are
+// indexed; the sets are processed by increasing size and each probes the
+// prefix lists for smaller sets, skipping those too small to reach the
+// threshold (|y| >= t * |x|). Because prefixes hold rare elements, the
+// lists probed are short, and each candidate is verified with an exact
+// merge of the two sets. Empty sets are never reported.
+
+//Global Declaration
+#define JOIN_BLOCK 8192
+#define JOIN_TILE 64
+#define JOIN_MAX_THREADS 64
+#define JOIN_MIN_ROWS 16
+#define JOIN_RADIX_BITS 16
+#define JOIN_EPSILON 1e-9
+
+// The posting lists of all the elements of a collection.
+struct _Join_Index {
+
+   uint32_t Count;       // number of sets
+   uint32_t Entries;     // number of elements of all the sets
+   uint32_t* Offsets;    // Count + 1 offsets of each set's elements in set-major order
+   uint32_t* Ids;        // set of each entry in value order: the posting lists back to back
+   uint32_t* Source;     // set-major entry at each value-order position
+   uint32_t* Position;   // value-order position of each set-major entry
+   uint32_t* ListEnd;    // end of the posting list holding each value-order position
+};
+
+typedef struct _Join_Index Join_Index;
+
+// State shared by the threads of one join.
+struct _Join_Context {
+
+   const CSet* const* Sets; // the joined sets
+   uint32_t Count;       // number of sets
+   const Join_Index* pIndex; // posting lists of all the elements
+   uint32_t* Matrix;     // Count x Count overlaps (counts join)
+   double Threshold;     // minimum Jaccard similarity (similarity join)
+   uint32_t* Order;      // sets by increasing size (similarity join)
+   uint32_t* Tokens;     // ranks of each set's elements, set-major and sorted per set
+   uint32_t* PrefixLength; // number of indexed ranks of each set
+   uint32_t* PrefixOffsets; // offsets of each rank's prefix list
+   uint32_t* PrefixIds;  // positions in Order of the sets whose prefix holds each rank
+   uint32_t Next;        // next row or tile to hand out
+};
+
+typedef struct _Join_Context Join_Context;
+
+// The work and scratch space of one thread.
+struct _Join_Job {
+
+   Join_Context* pContext; // join being computed
+   uint32_t* Counters;   // overlap counter of each column of a block, or of each candidate
+   uint32_t* Cursors;    // position and end of the posting list of each element of a row
+   uint32_t* Touched;    // candidates with a nonzero counter
+   CSet_Join_Pair* Pairs; // pairs found by the job
+   uint64_t PairCount;   // number of pairs in Pairs
+   uint64_t PairCapacity; // dimension of Pairs
+   bool Failed;          // a pair could not be stored
+};
+
+typedef struct _Join_Job Join_Job;
+
+//Internal Helper Declarations
+bool Join_Index_Build(Join_Index* pIndex, const CSet* const* sets, uint32_t count);
+void Join_Index_Free(Join_Index* pIndex);
+uint32_t Join_Threads(uint32_t threads, uint32_t count);
+bool Join_Jobs_Init(Join_Job* jobs, uint32_t threads, Join_Context* pContext, uint32_t counters, uint32_t cursors);
+void Join_Jobs_Free(Join_Job* jobs, uint32_t threads);
+void Join_Run(Join_Job* jobs, uint32_t threads, void* (*fn)(void*));
+void* Join_Count_Main(void* pArg);
+void* Join_Mirror_Main(void* pArg);
+void* Join_Probe_Main(void* pArg);
+bool Join_Rank(Join_Context* pContext);
+bool Join_Prefixes(Join_Context* pContext, uint32_t ranks);
+uint32_t Join_Required(double threshold, uint32_t size);
+uint32_t Join_Overlap(const CSet* pA, const CSet* pB);
+bool Join_Push(Join_Job* pJob, uint32_t a, uint32_t b, uint32_t overlap, double jaccard);
+int Compare_Join_Pairs(const void* a, const void* b);
+
+/**
+ * Computes the size of the intersection of every pair of sets of a
+ * collection.
+ *
+ * Pre:
+ *    Sets[0:Count] satisfy the CSet contract and are not modified during the call
+ *    Matrix has Count * Count elements
+ *    Threads is the number of threads, or 0 to use every online CPU
+ * Post:
+ *    If successful:
+ *       Matrix[i * Count + j] == |Sets[i] n Sets[j]| for all i, j < Count
+ *       (so Matrix[i * Count + i] == CSet_Size(Sets[i]))
+ *    else:
+ *       the content of Matrix is unspecified
+ * Returns:
+ *    true if successful, false if memory ran out or the sets hold UINT32_MAX
+ *    or more elements in total
+ */
+bool CSet_Join_Counts(const CSet* const* const Sets, uint32_t Count, uint32_t* const Matrix, uint32_t Threads){
+	Join_Index index;
+	if(!Join_Index_Build(&index, Sets, Count)){
+		return false;
+	}
+	uint32_t largest = 0, i = 0;
+	while(i < Count){
+		if(index.Offsets[i + 1] - index.Offsets[i] > largest){
+			largest = index.Offsets[i + 1] - index.Offsets[i];
+		}
+		i++;
+	}
+	Join_Context context;
+	memset(&context, 0, sizeof(Join_Context));
+	context.Sets = Sets;
+	context.Count = Count;
+	context.pIndex = &index;
+	context.Matrix = Matrix;
+	Join_Job jobs[JOIN_MAX_THREADS];
+	uint32_t threads = Join_Threads(Threads, Count);
+	bool success = Join_Jobs_Init(jobs, threads, &context, JOIN_BLOCK, 2 * largest);
+	if(success){
+		Join_Run(jobs, threads, Join_Count_Main);
+		context.Next = 0;
+		Join_Run(jobs, threads, Join_Mirror_Main);
+	}
+	Join_Jobs_Free(jobs, threads);
+	Join_Index_Free(&index);
+	return success;
+};
+
+/**
+ * Finds every pair of sets of a collection whose Jaccard similarity is at
+ * least Threshold.
+ *
+ * Pre:
+ *    Sets[0:Count] satisfy the CSet contract and are not modified during the call
+ *    0 < Threshold <= 1
+ *    Threads is the number of threads, or 0 to use every online CPU
+ * Post:
+ *    If successful:
+ *       (*pPairs)[0:*pPairCount] are the pairs A < B of nonempty sets with
+ *       CSet_Jaccard(Sets[A], Sets[B]) >= Threshold, sorted by A then B
+ *       *pPairs is allocated with malloc (NULL if there are none) and is
+ *       freed by the caller
+ *    else:
+ *       *pPairs and *pPairCount are unchanged
+ * Returns:
+ *    true if successful, false if Threshold is out of range, memory ran out
+ *    or the sets hold UINT32_MAX or more elements in total
+ */
+bool CSet_Join_Similar(const CSet* const* const Sets, uint32_t Count, double Threshold, uint32_t Threads, CSet_Join_Pair** const pPairs, uint64_t* const pPairCount){
+	if(!(Threshold > 0.0 && Threshold <= 1.0)){
+		return false;
+	}
+	Join_Index index;
+	if(!Join_Index_Build(&index, Sets, Count)){
+		return false;
+	}
+	Join_Context context;
+	memset(&context, 0, sizeof(Join_Context));
+	context.Sets = Sets;
+	context.Count = Count;
+	context.pIndex = &index;
+	context.Threshold = Threshold;
+	bool success = Join_Rank(&context);
+	Join_Job jobs[JOIN_MAX_THREADS];
+	uint32_t threads = Join_Threads(Threads, Count);
+	success = success && Join_Jobs_Init(jobs, threads, &context, Count, 0);
+	if(success){
+		Join_Run(jobs, threads, Join_Probe_Main);
+		uint64_t total = 0;
+		uint32_t t = 0;
+		while(t < threads){
+			success = success && !jobs[t].Failed;
+			total += jobs[t].PairCount;
+			t++;
+		}
+		CSet_Join_Pair* pairs = NULL;
+		if(success && total > 0){
+			pairs = (CSet_Join_Pair*) malloc(sizeof(CSet_Join_Pair) * (size_t) total);
+			success = pairs != NULL;
+		}
+		if(success){
+			uint64_t filled = 0;
+			t = 0;
+			while(t < threads){
+				if(jobs[t].PairCount > 0){
+					memcpy(pairs + filled, jobs[t].Pairs, sizeof(CSet_Join_Pair) * (size_t) jobs[t].PairCount);
+				}
+				filled += jobs[t].PairCount;
+				t++;
+			}
+			if(total > 1){
+				qsort(pairs, (size_t) total, sizeof(CSet_Join_Pair), Compare_Join_Pairs);
+			}
+			*pPairs = pairs;
+			*pPairCount = total;
+		}
+		Join_Jobs_Free(jobs, threads);
+	}
+	free(context.Order);
+	free(context.Tokens);
+	free(context.PrefixLength);
+	free(context.PrefixOffsets);
+	free(context.PrefixIds);
+	Join_Index_Free(&index);
+	return success;
+};
+
+
+//Internal(Private) helpers=====================================================
+
+/**
+ * Builds the posting lists of the elements of a collection by radix sorting
+ * its set-major entries by value, two 16-bit digits per pass
+ * @param  pIndex receives the index
+ * @param  sets   the sets
+ * @param  count  the number of sets
+ * @return bool true if successful, false if memory ran out or there are too many entries
+ */
+bool Join_Index_Build(Join_Index* pIndex, const CSet* const* sets, uint32_t count){
+	memset(pIndex, 0, sizeof(Join_Index));
+	pIndex->Count = count;
+	pIndex->Offsets = (uint32_t*) malloc(sizeof(uint32_t) * ((size_t) count + 1));
+	if(pIndex->Offsets == NULL){
+		return false;
+	}
+	uint64_t total = 0;
+	uint32_t i = 0;
+	while(i < count){
+		pIndex->Offsets[i] = (uint32_t) total;
+		total += CSet_Size(sets[i]);
+		if(total >= UINT32_MAX){
+			free(pIndex->Offsets);
+			pIndex->Offsets = NULL;
+			return false;
+		}
+		i++;
+	}
+	pIndex->Offsets[count] = (uint32_t) total;
+	uint32_t m = (uint32_t) total;
+	size_t bytes = sizeof(uint32_t) * ((size_t) m + 1);
+	pIndex->Entries = m;
+	pIndex->Ids = (uint32_t*) malloc(bytes);
+	pIndex->Source = (uint32_t*) malloc(bytes);
+	pIndex->Position = (uint32_t*) malloc(bytes);
+	pIndex->ListEnd = (uint32_t*) malloc(bytes);
+	uint32_t* keys = (uint32_t*) malloc(bytes);
+	uint32_t* sorted = (uint32_t*) malloc(bytes);
+	uint32_t* buckets = (uint32_t*) malloc(sizeof(uint32_t) << JOIN_RADIX_BITS);
+	if(!pIndex->Ids || !pIndex->Source || !pIndex->Position || !pIndex->ListEnd || !keys || !sorted || !buckets){
+		free(keys);
+		free(sorted);
+		free(buckets);
+		Join_Index_Free(pIndex);
+		return false;
+	}
+
+	// Flipping the sign bit makes the unsigned order of the keys the value order
+	i = 0;
+	while(i < count){
+		uint32_t begin = pIndex->Offsets[i], size = pIndex->Offsets[i + 1] - begin, j = 0;
+		while(j < size){
+			keys[begin + j] = (uint32_t) sets[i]->Data[j] ^ 0x80000000u;
+			pIndex->Ids[begin + j] = i;
+			j++;
+		}
+		i++;
+	}
+
+	// Low digit: set-major entries into Source, high digit: Source into Position
+	uint32_t shift = 0;
+	while(shift < 32){
+		memset(buckets, 0, sizeof(uint32_t) << JOIN_RADIX_BITS);
+		uint32_t* from = shift == 0 ? NULL : pIndex->Source;
+		uint32_t* to = shift == 0 ? pIndex->Source : pIndex->Position;
+		uint32_t e = 0;
+		while(e < m){
+			buckets[(keys[e] >> shift) & 0xFFFF]++;
+			e++;
+		}
+		uint32_t b = 0, sum = 0;
+		while(b < (1u << JOIN_RADIX_BITS)){
+			uint32_t n = buckets[b];
+			buckets[b] = sum;
+			sum += n;
+			b++;
+		}
+		e = 0;
+		while(e < m){
+			uint32_t entry = from ? from[e] : e;
+			to[buckets[(keys[entry] >> shift) & 0xFFFF]++] = entry;
+			e++;
+		}
+		shift += JOIN_RADIX_BITS;
+	}
+	memcpy(pIndex->Source, pIndex->Position, sizeof(uint32_t) * (size_t) m);
+
+	// Position, Ids and the end of each run of equal values
+	uint32_t p = 0;
+	while(p < m){
+		uint32_t entry = pIndex->Source[p];
+		pIndex->Position[entry] = p;
+		sorted[p] = pIndex->Ids[entry];
+		p++;
+	}
+	memcpy(pIndex->Ids, sorted, sizeof(uint32_t) * (size_t) m);
+	uint32_t end = m;
+	p = m;
+	while(p > 0){
+		p--;
+		if(p + 1 < m && keys[pIndex->Source[p]] != keys[pIndex->Source[p + 1]]){
+			end = p + 1;
+		}
+		pIndex->ListEnd[p] = end;
+	}
+	free(keys);
+	free(sorted);
+	free(buckets);
+	return true;
+};
+
+/**
+ * Frees the arrays of an index
+ * @param pIndex the index
+ */
+void Join_Index_Free(Join_Index* pIndex){
+	free(pIndex->Offsets);
+	free(pIndex->Ids);
+	free(pIndex->Source);
+	free(pIndex->Position);
+	free(pIndex->ListEnd);
+	memset(pIndex, 0, sizeof(Join_Index));
+};
+
+/**
+ * Chooses how many threads to join with, giving each at least
+ * JOIN_MIN_ROWS sets
+ * @param  threads the requested number, 0 for one per online CPU
+ * @param  count   the number of sets
+ * @return uint32_t the number of threads, at least 1
+ */
+uint32_t Join_Threads(uint32_t threads, uint32_t count){
+	if(threads == 0){
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cpus > 0 ? (uint32_t) cpus : 1;
+	}
+	if(threads > JOIN_MAX_THREADS){
+		threads = JOIN_MAX_THREADS;
+	}
+	if(threads > count / JOIN_MIN_ROWS + 1){
+		threads = count / JOIN_MIN_ROWS + 1;
+	}
+	return threads;
+};
+
+/**
+ * Allocates the scratch space of every job
+ * @param  jobs     the jobs
+ * @param  threads  the number of jobs
+ * @param  pContext the join the jobs compute
+ * @param  counters the number of counters of each job
+ * @param  cursors  the number of cursors of each job
+ * @return bool true if successful, false if memory ran out (the jobs are then freed)
+ */
+bool Join_Jobs_Init(Join_Job* jobs, uint32_t threads, Join_Context* pContext, uint32_t counters, uint32_t cursors){
+	bool success = true;
+	uint32_t t = 0;
+	while(t < threads){
+		memset(&jobs[t], 0, sizeof(Join_Job));
+		jobs[t].pContext = pContext;
+		jobs[t].Counters = (uint32_t*) calloc((size_t) counters + 1, sizeof(uint32_t));
+		jobs[t].Cursors = (uint32_t*) malloc(sizeof(uint32_t) * ((size_t) cursors + 1));
+		jobs[t].Touched = (uint32_t*) malloc(sizeof(uint32_t) * ((size_t) counters + 1));
+		success = success && jobs[t].Counters && jobs[t].Cursors && jobs[t].Touched;
+		t++;
+	}
+	if(!success){
+		Join_Jobs_Free(jobs, threads);
+	}
+	return success;
+};
+
+/**
+ * Frees the scratch space and the pairs of every job
+ * @param jobs    the jobs
+ * @param threads the number of jobs
+ */
+void Join_Jobs_Free(Join_Job* jobs, uint32_t threads){
+	uint32_t t = 0;
+	while(t < threads){
+		free(jobs[t].Counters);
+		free(jobs[t].Cursors);
+		free(jobs[t].Touched);
+		free(jobs[t].Pairs);
+		memset(&jobs[t], 0, sizeof(Join_Job));
+		t++;
+	}
+};
+
+/**
+ * Runs fn on every job, jobs[1:] on their own threads and jobs[0] on the
+ * calling thread; a job whose thread cannot be started runs inline
+ * @param jobs    the jobs
+ * @param threads the number of jobs
+ * @param fn      the job body
+ */
+void Join_Run(Join_Job* jobs, uint32_t threads, void* (*fn)(void*)){
+	pthread_t tids[JOIN_MAX_THREADS];
+	bool started[JOIN_MAX_THREADS];
+	uint32_t t = 1;
+	while(t < threads){
+		started[t] = pthread_create(&tids[t], NULL, fn, &jobs[t]) == 0;
+		t++;
+	}
+	fn(&jobs[0]);
+	t = 1;
+	while(t < threads){
+		if(started[t]){
+			pthread_join(tids[t], NULL);
+		}
+		else{
+			fn(&jobs[t]);
+		}
+		t++;
+	}
+};
+
+/**
+ * Job body: takes rows a one at a time and fills Matrix[a][a:] with the
+ * overlaps of set a, JOIN_BLOCK columns at a time
+ * @param  pArg the Join_Job
+ * @return void* NULL
+ */
+void* Join_Count_Main(void* pArg){
+	Join_Job* pJob = (Join_Job*) pArg;
+	Join_Context* pContext = pJob->pContext;
+	const Join_Index* pIndex = pContext->pIndex;
+	uint32_t count = pContext->Count;
+	uint32_t* counters = pJob->Counters;
+	uint32_t* cursors = pJob->Cursors;
+	uint32_t a = __atomic_fetch_add(&pContext->Next, 1, __ATOMIC_RELAXED);
+	while(a < count){
+		uint32_t begin = pIndex->Offsets[a], size = pIndex->Offsets[a + 1] - begin;
+		uint32_t* row = pContext->Matrix + (size_t) a * count;
+		row[a] = size;
+		uint32_t i = 0;
+		while(i < size){
+			uint32_t p = pIndex->Position[begin + i];
+			cursors[2 * i] = p + 1;
+			cursors[2 * i + 1] = pIndex->ListEnd[p];
+			i++;
+		}
+		uint32_t c0 = a + 1;
+		while(c0 < count){
+			uint32_t c1 = count - c0 > JOIN_BLOCK ? c0 + JOIN_BLOCK : count;
+			i = 0;
+			while(i < size){
+				uint32_t q = cursors[2 * i], end = cursors[2 * i + 1];
+				while(q < end && pIndex->Ids[q] < c1){
+					counters[pIndex->Ids[q] - c0]++;
+					q++;
+				}
+				cursors[2 * i] = q;
+				i++;
+			}
+			memcpy(row + c0, counters, sizeof(uint32_t) * (c1 - c0));
+			memset(counters, 0, sizeof(uint32_t) * (c1 - c0));
+			c0 = c1;
+		}
+		a = __atomic_fetch_add(&pContext->Next, 1, __ATOMIC_RELAXED);
+	}
+	return NULL;
+};
+
+/**
+ * Job body: takes JOIN_TILE rows at a time and copies the upper triangle of
+ * Matrix into their part of the lower triangle, one square tile at a time
+ * @param  pArg the Join_Job
+ * @return void* NULL
+ */
+void* Join_Mirror_Main(void* pArg){
+	Join_Job* pJob = (Join_Job*) pArg;
+	Join_Context* pContext = pJob->pContext;
+	uint32_t count = pContext->Count;
+	uint32_t* matrix = pContext->Matrix;
+	uint32_t r0 = __atomic_fetch_add(&pContext->Next, JOIN_TILE, __ATOMIC_RELAXED);
+	while(r0 < count){
+		uint32_t r1 = count - r0 > JOIN_TILE ? r0 + JOIN_TILE : count;
+		uint32_t c0 = 0;
+		while(c0 < r1){
+			uint32_t c1 = c0 + JOIN_TILE;
+			uint32_t r = r0;
+			while(r < r1){
+				uint32_t c = c0;
+				while(c < c1 && c < r){
+					matrix[(size_t) r * count + c] = matrix[(size_t) c * count + r];
+					c++;
+				}
+				r++;
+			}
+			c0 = c1;
+		}
+		r0 = __atomic_fetch_add(&pContext->Next, JOIN_TILE, __ATOMIC_RELAXED);
+	}
+	return NULL;
+};
+
+/**
+ * Job body: takes the sets x in Order one at a time, counts the prefix
+ * ranks x shares with each smaller set large enough to reach the threshold,
+ * and verifies those candidates by merging
+ * @param  pArg the Join_Job
+ * @return void* NULL
+ */
+void* Join_Probe_Main(void* pArg){
+	Join_Job* pJob = (Join_Job*) pArg;
+	Join_Context* pContext = pJob->pContext;
+	const Join_Index* pIndex = pContext->pIndex;
+	const CSet* const* sets = pContext->Sets;
+	double threshold = pContext->Threshold;
+	uint32_t o = __atomic_fetch_add(&pContext->Next, 1, __ATOMIC_RELAXED);
+	while(o < pContext->Count){
+		uint32_t x = pContext->Order[o];
+		uint32_t sizeX = CSet_Size(sets[x]);
+		uint32_t minSize = Join_Required(threshold, sizeX);
+		uint32_t touched = 0;
+		const uint32_t* tokens = pContext->Tokens + pIndex->Offsets[x];
+		uint32_t i = 0;
+		while(i < pContext->PrefixLength[x]){
+			uint32_t lo = pContext->PrefixOffsets[tokens[i]], hi = pContext->PrefixOffsets[tokens[i] + 1];
+
+			// The list is in Order, hence by size: skip the sets smaller than minSize
+			uint32_t end = hi;
+			while(lo < end){
+				uint32_t mid = lo + (end - lo) / 2;
+				if(CSet_Size(sets[pContext->Order[pContext->PrefixIds[mid]]]) < minSize){
+					lo = mid + 1;
+				}
+				else{
+					end = mid;
+				}
+			}
+			while(lo < hi && pContext->PrefixIds[lo] < o){
+				uint32_t y = pContext->PrefixIds[lo];
+				if(pJob->Counters[y] == 0){
+					pJob->Touched[touched++] = y;
+				}
+				pJob->Counters[y]++;
+				lo++;
+			}
+			i++;
+		}
+		i = 0;
+		while(i < touched){
+			uint32_t y = pContext->Order[pJob->Touched[i]];
+			pJob->Counters[pJob->Touched[i]] = 0;
+			uint32_t overlap = Join_Overlap(sets[x], sets[y]);
+			double jaccard = (double) overlap / ((double) sizeX + CSet_Size(sets[y]) - overlap);
+			if(jaccard >= threshold && !Join_Push(pJob, x < y ? x : y, x < y ? y : x, overlap, jaccard)){
+				pJob->Failed = true;
+			}
+			i++;
+		}
+		o = __atomic_fetch_add(&pContext->Next, 1, __ATOMIC_RELAXED);
+	}
+	return NULL;
+};
+
+/**
+ * Ranks the distinct elements from the rarest to the most frequent (ties by
+ * value), rewrites every set as its sorted ranks, orders the sets by size
+ * and builds the prefix lists
+ * @param  pContext the similarity join
+ * @return bool true if successful, false if memory ran out
+ */
+bool Join_Rank(Join_Context* pContext){
+	const Join_Index* pIndex = pContext->pIndex;
+	uint32_t m = pIndex->Entries, count = pContext->Count;
+	uint32_t lists = 0, p = 0;
+	while(p < m){
+		p = pIndex->ListEnd[p];
+		lists++;
+	}
+	uint64_t* keys = (uint64_t*) malloc(sizeof(uint64_t) * ((size_t) (lists > count ? lists : count) + 1));
+	uint32_t* ranks = (uint32_t*) malloc(sizeof(uint32_t) * ((size_t) lists + 1));
+	pContext->Tokens = (uint32_t*) malloc(sizeof(uint32_t) * ((size_t) m + 1));
+	pContext->Order = (uint32_t*) malloc(sizeof(uint32_t) * ((size_t) count + 1));
+	bool success = keys && ranks && pContext->Tokens && pContext->Order;
+	if(success){
+		uint32_t list = 0;
+		p = 0;
+		while(p < m){
+			keys[list] = ((uint64_t)(pIndex->ListEnd[p] - p) << 32) | list;
+			p = pIndex->ListEnd[p];
+			list++;
+		}
+		qsort(keys, lists, sizeof(uint64_t), Compare_Uint64);
+		list = 0;
+		while(list < lists){
+			ranks[(uint32_t) keys[list]] = list;
+			list++;
+		}
+		list = 0;
+		p = 0;
+		while(p < m){
+			if(p > 0 && pIndex->ListEnd[p - 1] == p){
+				list++;
+			}
+			pContext->Tokens[pIndex->Source[p]] = ranks[list];
+			p++;
+		}
+		uint32_t i = 0;
+		while(i < count){
+			uint32_t begin = pIndex->Offsets[i], size = pIndex->Offsets[i + 1] - begin;
+			qsort(pContext->Tokens + begin, size, sizeof(uint32_t), Compare_Uint32);
+			keys[i] = ((uint64_t) size << 32) | i;
+			i++;
+		}
+		qsort(keys, count, sizeof(uint64_t), Compare_Uint64);
+		i = 0;
+		while(i < count){
+			pContext->Order[i] = (uint32_t) keys[i];
+			i++;
+		}
+		success = Join_Prefixes(pContext, lists);
+	}
+	free(keys);
+	free(ranks);
+	return success;
+};
+
+/**
+ * Builds, for every rank, the list of the positions in Order of the sets
+ * whose prefix holds it, in increasing order
+ * @param  pContext the similarity join, with Tokens and Order built
+ * @param  ranks    the number of distinct ranks
+ * @return bool true if successful, false if memory ran out
+ */
+bool Join_Prefixes(Join_Context* pContext, uint32_t ranks){
+	const Join_Index* pIndex = pContext->pIndex;
+	uint32_t count = pContext->Count;
+	pContext->PrefixLength = (uint32_t*) malloc(sizeof(uint32_t) * ((size_t) count + 1));
+	pContext->PrefixOffsets = (uint32_t*) calloc((size_t) ranks + 2, sizeof(uint32_t));
+	if(!pContext->PrefixLength || !pContext->PrefixOffsets){
+		return false;
+	}
+	uint32_t total = 0, i = 0;
+	while(i < count){
+		uint32_t begin = pIndex->Offsets[i], size = pIndex->Offsets[i + 1] - begin;
+		uint32_t length = size - Join_Required(pContext->Threshold, size) + 1;
+		pContext->PrefixLength[i] = length < size ? length : size;
+		uint32_t j = 0;
+		while(j < pContext->PrefixLength[i]){
+			pContext->PrefixOffsets[pContext->Tokens[begin + j] + 2]++;
+			j++;
+		}
+		total += pContext->PrefixLength[i];
+		i++;
+	}
+	i = 2;
+	while(i < ranks + 2){
+		pContext->PrefixOffsets[i] += pContext->PrefixOffsets[i - 1];
+		i++;
+	}
+	pContext->PrefixIds = (uint32_t*) malloc(sizeof(uint32_t) * ((size_t) total + 1));
+	if(pContext->PrefixIds == NULL){
+		return false;
+	}
+
+	// Filling through PrefixOffsets[rank + 1] leaves it at the start of rank + 1
+	uint32_t o = 0;
+	while(o < count){
+		uint32_t x = pContext->Order[o];
+		const uint32_t* tokens = pContext->Tokens + pIndex->Offsets[x];
+		uint32_t j = 0;
+		while(j < pContext->PrefixLength[x]){
+			pContext->PrefixIds[pContext->PrefixOffsets[tokens[j] + 1]++] = o;
+			j++;
+		}
+		o++;
+	}
+	return true;
+};
+
+/**
+ * Computes ceil(threshold * size), rounding down results within
+ * JOIN_EPSILON of an integer so the filters never reject a qualifying pair
+ * @param  threshold the Jaccard threshold
+ * @param  size      a set size
+ * @return uint32_t the minimum overlap, or partner size, of a qualifying pair
+ */
+uint32_t Join_Required(double threshold, uint32_t size){
+	double required = ceil(threshold * size - JOIN_EPSILON);
+	return required > 0.0 ? (uint32_t) required : 0;
+};
+
+/**
+ * Counts the common elements of two sets with one merge pass
+ * @param  pA the first set
+ * @param  pB the second set
+ * @return uint32_t |A n B|
+ */
+uint32_t Join_Overlap(const CSet* pA, const CSet* pB){
+	const int32_t* a = pA->Data;
+	const int32_t* b = pB->Data;
+	const int32_t* endA = a + CSet_Size(pA);
+	const int32_t* endB = b + CSet_Size(pB);
+	uint32_t common = 0;
+	while(a < endA && b < endB){
+		if(*a < *b){
+			a++;
+		}
+		else if(*a > *b){
+			b++;
+		}
+		else{
+			common++;
+			a++;
+			b++;
+		}
+	}
+	return common;
+};
+
+/**
+ * Appends a pair to the pairs of a job, doubling its capacity as needed
+ * @param  pJob     the job
+ * @param  a        the index of the first set
+ * @param  b        the index of the second set
+ * @param  overlap  the size of their intersection
+ * @param  jaccard  their Jaccard similarity
+ * @return bool true if successful, false if memory ran out
+ */
+bool Join_Push(Join_Job* pJob, uint32_t a, uint32_t b, uint32_t overlap, double jaccard){
+	if(pJob->PairCount == pJob->PairCapacity){
+		uint64_t capacity = pJob->PairCapacity ? 2 * pJob->PairCapacity : 64;
+		CSet_Join_Pair* pairs = (CSet_Join_Pair*) realloc(pJob->Pairs, sizeof(CSet_Join_Pair) * (size_t) capacity);
+		if(pairs == NULL){
+			return false;
+		}
+		pJob->Pairs = pairs;
+		pJob->PairCapacity = capacity;
+	}
+	CSet_Join_Pair* pPair = &pJob->Pairs[pJob->PairCount++];
+	pPair->A = a;
+	pPair->B = b;
+	pPair->Overlap = overlap;
+	pPair->Jaccard = jaccard;
+	return true;
+};
+
+/**
+ * qsort comparator ordering join pairs by A, then B
+ */
+int Compare_Join_Pairs(const void* a, const void* b){
+	const CSet_Join_Pair* x = (const CSet_Join_Pair*) a;
+	const CSet_Join_Pair* y = (const CSet_Join_Pair*) b;
+	if(x->A != y->A){
+		return (x->A > y->A) - (x->A < y->A);
+	}
+	return (x->B > y->B) - (x->B < y->B);
+};
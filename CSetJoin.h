@@ -0,0 +1,21 @@
+#ifndef CSET_JOIN_H
+#define CSET_JOIN_H
+#include "CSet.h"
+
+// A pair of sets found by a similarity join, identified by their indexes in
+// the joined collection.
+struct _CSet_Join_Pair {
+
+   uint32_t A;           // index of the first set
+   uint32_t B;           // index of the second set, A < B
+   uint32_t Overlap;     // |Sets[A] n Sets[B]|
+   double Jaccard;       // Overlap / |Sets[A] u Sets[B]|
+};
+
+typedef struct _CSet_Join_Pair CSet_Join_Pair;
+
+bool CSet_Join_Counts(const CSet* const* const Sets, uint32_t Count, uint32_t* const Matrix, uint32_t Threads);
+
+bool CSet_Join_Similar(const CSet* const* const Sets, uint32_t Count, double Threshold, uint32_t Threads, CSet_Join_Pair** const pPairs, uint64_t* const pPairCount);
+
+#endif
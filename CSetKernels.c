@@ -0,0 +1,409 @@
+#include "CSetKernels.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNELS_X86 1
+#endif
+
+// CSetKernels holds the fill, copy, compare and search loops that CSet.c
+// runs over Data, in one scalar and up to three x86 SIMD versions.
+//
+// Each SIMD version is compiled with a target attribute, so the rest of the
+// program stays at the baseline instruction set. A constructor queries the
+// CPU (cpuid, through __builtin_cpu_supports) before main runs and points
+// CSet_Active_Kernels at the widest table the CPU supports. The environment
+// variable CSET_KERNELS ("scalar", "sse4.2", "avx2" or "avx512") may name a
+// narrower table, which is useful for comparing them.
+//
+// Copies of at least KERNEL_STREAM_THRESHOLD elements use non-temporal
+// stores: such a copy would evict the whole cache, and the destination is
+// rarely read back before other work replaces it anyway.
+//
+// The lower bound narrows the range with a branch-free binary search until
+// a few vectors' worth of elements remain, then counts the elements smaller
+// than the key with vector compares. The data is sorted, so that count is
+// the offset of the lower bound within the range.
+
+//Global Declaration
+#define KERNEL_STREAM_THRESHOLD (1u << 20)
+#define KERNEL_SCALAR_RANGE 8
+#define KERNEL_SSE_RANGE 16
+#define KERNEL_AVX2_RANGE 32
+#define KERNEL_AVX512_RANGE 64
+
+//Internal Helper Declarations
+uint32_t Kernel_Narrow(const int32_t* Data, uint32_t Sz, int32_t Value, uint32_t range, uint32_t* pBottom);
+void Kernel_Fill_Scalar(int32_t* Dst, int32_t Value, uint32_t Sz);
+void Kernel_Copy_Scalar(int32_t* Dst, const int32_t* Src, uint32_t Sz);
+bool Kernel_Equal_Scalar(const int32_t* A, const int32_t* B, uint32_t Sz);
+uint32_t Kernel_Lower_Bound_Scalar(const int32_t* Data, uint32_t Sz, int32_t Value);
+#ifdef KERNELS_X86
+void Kernel_Fill_SSE(int32_t* Dst, int32_t Value, uint32_t Sz);
+void Kernel_Copy_SSE(int32_t* Dst, const int32_t* Src, uint32_t Sz);
+bool Kernel_Equal_SSE(const int32_t* A, const int32_t* B, uint32_t Sz);
+uint32_t Kernel_Lower_Bound_SSE(const int32_t* Data, uint32_t Sz, int32_t Value);
+void Kernel_Fill_AVX2(int32_t* Dst, int32_t Value, uint32_t Sz);
+void Kernel_Copy_AVX2(int32_t* Dst, const int32_t* Src, uint32_t Sz);
+bool Kernel_Equal_AVX2(const int32_t* A, const int32_t* B, uint32_t Sz);
+uint32_t Kernel_Lower_Bound_AVX2(const int32_t* Data, uint32_t Sz, int32_t Value);
+void Kernel_Fill_AVX512(int32_t* Dst, int32_t Value, uint32_t Sz);
+void Kernel_Copy_AVX512(int32_t* Dst, const int32_t* Src, uint32_t Sz);
+bool Kernel_Equal_AVX512(const int32_t* A, const int32_t* B, uint32_t Sz);
+uint32_t Kernel_Lower_Bound_AVX512(const int32_t* Data, uint32_t Sz, int32_t Value);
+#endif
+bool Kernel_Supported(const CSet_Kernels* pKernels);
+void Kernels_Startup(void) __attribute__((constructor));
+
+static const CSet_Kernels Scalar_Kernels = {
+	"scalar", Kernel_Fill_Scalar, Kernel_Copy_Scalar, Kernel_Equal_Scalar, Kernel_Lower_Bound_Scalar
+};
+#ifdef KERNELS_X86
+static const CSet_Kernels SSE_Kernels = {
+	"sse4.2", Kernel_Fill_SSE, Kernel_Copy_SSE, Kernel_Equal_SSE, Kernel_Lower_Bound_SSE
+};
+static const CSet_Kernels AVX2_Kernels = {
+	"avx2", Kernel_Fill_AVX2, Kernel_Copy_AVX2, Kernel_Equal_AVX2, Kernel_Lower_Bound_AVX2
+};
+static const CSet_Kernels AVX512_Kernels = {
+	"avx512", Kernel_Fill_AVX512, Kernel_Copy_AVX512, Kernel_Equal_AVX512, Kernel_Lower_Bound_AVX512
+};
+// Widest first
+static const CSet_Kernels* const All_Kernels[] = {
+	&AVX512_Kernels, &AVX2_Kernels, &SSE_Kernels, &Scalar_Kernels
+};
+#else
+static const CSet_Kernels* const All_Kernels[] = { &Scalar_Kernels };
+#endif
+
+// Valid before the startup selection runs, so static constructors elsewhere
+// may already use CSets
+const CSet_Kernels* CSet_Active_Kernels = &Scalar_Kernels;
+
+/**
+ * Reports the kernel table in use.
+ *
+ * Returns:
+ *    the table every CSet operation currently runs on
+ */
+const CSet_Kernels* CSet_Kernels_Get(void){
+	return CSet_Active_Kernels;
+};
+
+/**
+ * Switches every CSet operation to the kernel table called Name, or to the
+ * widest table the CPU supports if Name is NULL. Switching while another
+ * thread runs a CSet operation is not supported.
+ *
+ * Post:
+ *    If successful, CSet_Active_Kernels->Name matches Name
+ *    else, the active table is unchanged
+ * Returns:
+ *    true if the table exists and the CPU supports it, false otherwise
+ */
+bool CSet_Kernels_Select(const char* const Name){
+	uint32_t i = 0;
+	while(i < sizeof(All_Kernels) / sizeof(All_Kernels[0])){
+		const CSet_Kernels* pKernels = All_Kernels[i];
+		if((Name == NULL || strcmp(Name, pKernels->Name) == 0) && Kernel_Supported(pKernels)){
+			CSet_Active_Kernels = pKernels;
+			return true;
+		}
+		i++;
+	}
+	return false;
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Runs once before main: selects the kernel table named by CSET_KERNELS,
+ * or else the widest one the CPU supports
+ */
+void Kernels_Startup(void){
+#ifdef KERNELS_X86
+	__builtin_cpu_init();
+#endif
+	const char* name = getenv("CSET_KERNELS");
+	if(name == NULL || !CSet_Kernels_Select(name)){
+		CSet_Kernels_Select(NULL);
+	}
+};
+
+/**
+ * Checks whether the CPU can run a kernel table
+ */
+bool Kernel_Supported(const CSet_Kernels* pKernels){
+#ifdef KERNELS_X86
+	if(pKernels == &AVX512_Kernels){
+		return __builtin_cpu_supports("avx512f");
+	}
+	if(pKernels == &AVX2_Kernels){
+		return __builtin_cpu_supports("avx2");
+	}
+	if(pKernels == &SSE_Kernels){
+		return __builtin_cpu_supports("sse4.2");
+	}
+#endif
+	return true;
+};
+
+/**
+ * Branch-free binary search that narrows [0, Sz) to at most range elements
+ * which contain the lower bound of Value or are followed by it
+ * @param  Data    a sorted array
+ * @param  Sz      the number of elements in Data
+ * @param  Value   the value to search for
+ * @param  range   the size at which to stop narrowing
+ * @param  pBottom receives the first index of the remaining range
+ * @return uint32_t the number of elements in the remaining range
+ */
+uint32_t Kernel_Narrow(const int32_t* Data, uint32_t Sz, int32_t Value, uint32_t range, uint32_t* pBottom){
+	uint32_t bottom = 0;
+	uint32_t n = Sz;
+	while(n > range){
+		uint32_t half = n / 2;
+		bottom = (Data[bottom + half] < Value) ? bottom + half : bottom;
+		n -= half;
+	}
+	*pBottom = bottom;
+	return n;
+};
+
+// Scalar kernels: the baseline table, and the tails of the SIMD kernels
+
+void Kernel_Fill_Scalar(int32_t* Dst, int32_t Value, uint32_t Sz){
+	uint32_t i = 0;
+	while(i < Sz){
+		Dst[i] = Value;
+		i++;
+	}
+};
+
+void Kernel_Copy_Scalar(int32_t* Dst, const int32_t* Src, uint32_t Sz){
+	if(Sz > 0){
+		memmove(Dst, Src, sizeof(int32_t) * Sz);
+	}
+};
+
+bool Kernel_Equal_Scalar(const int32_t* A, const int32_t* B, uint32_t Sz){
+	return Sz == 0 || memcmp(A, B, sizeof(int32_t) * Sz) == 0;
+};
+
+uint32_t Kernel_Lower_Bound_Scalar(const int32_t* Data, uint32_t Sz, int32_t Value){
+	uint32_t bottom;
+	uint32_t n = Kernel_Narrow(Data, Sz, Value, KERNEL_SCALAR_RANGE, &bottom);
+	const int32_t* p = Data + bottom;
+	uint32_t i = 0;
+	while(i < n){
+		bottom += (p[i] < Value);
+		i++;
+	}
+	return bottom;
+};
+
+#ifdef KERNELS_X86
+
+// SSE4.2 kernels: 4 elements per vector
+
+__attribute__((target("sse4.2")))
+void Kernel_Fill_SSE(int32_t* Dst, int32_t Value, uint32_t Sz){
+	__m128i v = _mm_set1_epi32(Value);
+	uint32_t i = 0;
+	while(i + 4 <= Sz){
+		_mm_storeu_si128((__m128i*)(Dst + i), v);
+		i += 4;
+	}
+	Kernel_Fill_Scalar(Dst + i, Value, Sz - i);
+};
+
+__attribute__((target("sse4.2")))
+void Kernel_Copy_SSE(int32_t* Dst, const int32_t* Src, uint32_t Sz){
+	if(Sz < KERNEL_STREAM_THRESHOLD || (Dst < Src + Sz && Src < Dst + Sz)){
+		Kernel_Copy_Scalar(Dst, Src, Sz);
+		return;
+	}
+	uint32_t i = 0;
+	while(i < Sz && ((uintptr_t)(Dst + i) & 15) != 0){
+		Dst[i] = Src[i];
+		i++;
+	}
+	while(i + 4 <= Sz){
+		_mm_stream_si128((__m128i*)(Dst + i), _mm_loadu_si128((const __m128i*)(Src + i)));
+		i += 4;
+	}
+	_mm_sfence();
+	Kernel_Copy_Scalar(Dst + i, Src + i, Sz - i);
+};
+
+__attribute__((target("sse4.2")))
+bool Kernel_Equal_SSE(const int32_t* A, const int32_t* B, uint32_t Sz){
+	uint32_t i = 0;
+	while(i + 4 <= Sz){
+		__m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(A + i)),
+			_mm_loadu_si128((const __m128i*)(B + i)));
+		if(_mm_movemask_epi8(eq) != 0xFFFF){
+			return false;
+		}
+		i += 4;
+	}
+	return Kernel_Equal_Scalar(A + i, B + i, Sz - i);
+};
+
+__attribute__((target("sse4.2,popcnt")))
+uint32_t Kernel_Lower_Bound_SSE(const int32_t* Data, uint32_t Sz, int32_t Value){
+	uint32_t bottom;
+	uint32_t n = Kernel_Narrow(Data, Sz, Value, KERNEL_SSE_RANGE, &bottom);
+	const int32_t* p = Data + bottom;
+	__m128i v = _mm_set1_epi32(Value);
+	uint32_t i = 0;
+	while(i + 4 <= n){
+		__m128i lt = _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(p + i)), v);
+		bottom += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(lt)));
+		i += 4;
+	}
+	while(i < n){
+		bottom += (p[i] < Value);
+		i++;
+	}
+	return bottom;
+};
+
+// AVX2 kernels: 8 elements per vector
+
+__attribute__((target("avx2")))
+void Kernel_Fill_AVX2(int32_t* Dst, int32_t Value, uint32_t Sz){
+	__m256i v = _mm256_set1_epi32(Value);
+	uint32_t i = 0;
+	while(i + 8 <= Sz){
+		_mm256_storeu_si256((__m256i*)(Dst + i), v);
+		i += 8;
+	}
+	Kernel_Fill_Scalar(Dst + i, Value, Sz - i);
+};
+
+__attribute__((target("avx2")))
+void Kernel_Copy_AVX2(int32_t* Dst, const int32_t* Src, uint32_t Sz){
+	if(Sz < KERNEL_STREAM_THRESHOLD || (Dst < Src + Sz && Src < Dst + Sz)){
+		Kernel_Copy_Scalar(Dst, Src, Sz);
+		return;
+	}
+	uint32_t i = 0;
+	while(i < Sz && ((uintptr_t)(Dst + i) & 31) != 0){
+		Dst[i] = Src[i];
+		i++;
+	}
+	while(i + 8 <= Sz){
+		_mm256_stream_si256((__m256i*)(Dst + i), _mm256_loadu_si256((const __m256i*)(Src + i)));
+		i += 8;
+	}
+	_mm_sfence();
+	Kernel_Copy_Scalar(Dst + i, Src + i, Sz - i);
+};
+
+__attribute__((target("avx2")))
+bool Kernel_Equal_AVX2(const int32_t* A, const int32_t* B, uint32_t Sz){
+	uint32_t i = 0;
+	while(i + 8 <= Sz){
+		__m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(A + i)),
+			_mm256_loadu_si256((const __m256i*)(B + i)));
+		if(_mm256_movemask_epi8(eq) != -1){
+			return false;
+		}
+		i += 8;
+	}
+	return Kernel_Equal_Scalar(A + i, B + i, Sz - i);
+};
+
+__attribute__((target("avx2,popcnt")))
+uint32_t Kernel_Lower_Bound_AVX2(const int32_t* Data, uint32_t Sz, int32_t Value){
+	uint32_t bottom;
+	uint32_t n = Kernel_Narrow(Data, Sz, Value, KERNEL_AVX2_RANGE, &bottom);
+	const int32_t* p = Data + bottom;
+	__m256i v = _mm256_set1_epi32(Value);
+	uint32_t i = 0;
+	while(i + 8 <= n){
+		__m256i lt = _mm256_cmpgt_epi32(v, _mm256_loadu_si256((const __m256i*)(p + i)));
+		bottom += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(lt)));
+		i += 8;
+	}
+	while(i < n){
+		bottom += (p[i] < Value);
+		i++;
+	}
+	return bottom;
+};
+
+// AVX-512 kernels: 16 elements per vector, with masked loads and stores for
+// the tails
+
+__attribute__((target("avx512f")))
+void Kernel_Fill_AVX512(int32_t* Dst, int32_t Value, uint32_t Sz){
+	__m512i v = _mm512_set1_epi32(Value);
+	uint32_t i = 0;
+	while(i + 16 <= Sz){
+		_mm512_storeu_si512((void*)(Dst + i), v);
+		i += 16;
+	}
+	if(i < Sz){
+		_mm512_mask_storeu_epi32(Dst + i, (__mmask16)((1u << (Sz - i)) - 1), v);
+	}
+};
+
+__attribute__((target("avx512f")))
+void Kernel_Copy_AVX512(int32_t* Dst, const int32_t* Src, uint32_t Sz){
+	if(Sz < KERNEL_STREAM_THRESHOLD || (Dst < Src + Sz && Src < Dst + Sz)){
+		Kernel_Copy_Scalar(Dst, Src, Sz);
+		return;
+	}
+	uint32_t i = 0;
+	while(i < Sz && ((uintptr_t)(Dst + i) & 63) != 0){
+		Dst[i] = Src[i];
+		i++;
+	}
+	while(i + 16 <= Sz){
+		_mm512_stream_si512((void*)(Dst + i), _mm512_loadu_si512((const void*)(Src + i)));
+		i += 16;
+	}
+	_mm_sfence();
+	Kernel_Copy_Scalar(Dst + i, Src + i, Sz - i);
+};
+
+__attribute__((target("avx512f")))
+bool Kernel_Equal_AVX512(const int32_t* A, const int32_t* B, uint32_t Sz){
+	uint32_t i = 0;
+	while(i + 16 <= Sz){
+		if(_mm512_cmpneq_epi32_mask(_mm512_loadu_si512((const void*)(A + i)),
+			_mm512_loadu_si512((const void*)(B + i))) != 0){
+			return false;
+		}
+		i += 16;
+	}
+	if(i < Sz){
+		__mmask16 tail = (__mmask16)((1u << (Sz - i)) - 1);
+		return _mm512_mask_cmpneq_epi32_mask(tail, _mm512_maskz_loadu_epi32(tail, A + i),
+			_mm512_maskz_loadu_epi32(tail, B + i)) == 0;
+	}
+	return true;
+};
+
+__attribute__((target("avx512f,popcnt")))
+uint32_t Kernel_Lower_Bound_AVX512(const int32_t* Data, uint32_t Sz, int32_t Value){
+	uint32_t bottom;
+	uint32_t n = Kernel_Narrow(Data, Sz, Value, KERNEL_AVX512_RANGE, &bottom);
+	const int32_t* p = Data + bottom;
+	__m512i v = _mm512_set1_epi32(Value);
+	uint32_t i = 0;
+	while(i + 16 <= n){
+		bottom += __builtin_popcount(_mm512_cmplt_epi32_mask(_mm512_loadu_si512((const void*)(p + i)), v));
+		i += 16;
+	}
+	if(i < n){
+		__mmask16 tail = (__mmask16)((1u << (n - i)) - 1);
+		bottom += __builtin_popcount(_mm512_mask_cmplt_epi32_mask(tail, _mm512_maskz_loadu_epi32(tail, p + i), v));
+	}
+	return bottom;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef CSET_KERNELS_H
+#define CSET_KERNELS_H
+#include <stdint.h>
+#include <stdbool.h>
+
+// The primitive loops over int32_t arrays that CSet operations are built
+// from. One table exists per instruction set; the best one the CPU supports
+// is selected once at program startup.
+struct _CSet_Kernels {
+
+   const char* Name;     // "scalar", "sse4.2", "avx2" or "avx512"
+   void (*Fill)(int32_t* Dst, int32_t Value, uint32_t Sz);
+   void (*Copy)(int32_t* Dst, const int32_t* Src, uint32_t Sz);
+   bool (*Equal)(const int32_t* A, const int32_t* B, uint32_t Sz);
+   uint32_t (*LowerBound)(const int32_t* Data, uint32_t Sz, int32_t Value);
+};
+
+typedef struct _CSet_Kernels CSet_Kernels;
+
+extern const CSet_Kernels* CSet_Active_Kernels;
+
+const CSet_Kernels* CSet_Kernels_Get(void);
+
+bool CSet_Kernels_Select(const char* const Name);
+
+#endif
@@ -0,0 +1,502 @@
+#include "CSetPMA.h"
+#include "CSetKernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+// CSetPMA provides a mutable, gapped representation of a set for workloads
+// dominated by random inserts and removes. A dense CSet moves half of Data
+// on an average insert; a packed memory array leaves gaps between elements
+// so that an update only moves elements within a small window.
+//
+// The cells are split into segments of Segment cells (a power of two of at
+// least 2 log2(Capacity)). Each segment keeps its elements sorted at its
+// start, so a lookup is a binary search over the first elements of the
+// segments followed by a search of one segment. The segments are the leaves
+// of an implicit binary tree whose level l node covers 2^l aligned
+// segments. Every level has density thresholds, interpolated between the
+// leaves and the root of a tree of height h:
+//  - upper: 1 at the leaves down to 3/4 at the root
+//  - lower: 1/8 at the leaves up to 1/4 at the root
+// An insert into a full segment, or a remove that leaves a segment below
+// 1/8 full, walks up to the smallest enclosing window that is within its
+// thresholds and spreads that window's elements evenly over it. If even the
+// root is out of bounds the array is reallocated at a capacity where it is
+// between 1/4 and 1/2 full. The amortized cost of an update is O(log^2 N)
+// element moves, and each rebalance touches one contiguous window.
+//
+// Spreading evenly within the thresholds keeps every segment non-empty
+// whenever there is more than one, which the segment search relies on.
+//
+// Elements are visited in sorted order with CSet_PMA_Next, which skips the
+// gaps a segment at a time, so set operations can scan a PMA sequentially.
+// CSet_PMA_Compact writes the elements back out in the plain dense CSet
+// layout, and CSet_PMA_Build goes the other way.
+
+//Global Declaration
+#define PMA_MIN_SEGMENT 32
+#define PMA_MAX_CAPACITY ((uint32_t) 1 << 31)
+
+//Internal Helper Declarations
+uint32_t PMA_Segment_For(uint32_t capacity);
+uint32_t PMA_Target_Capacity(uint64_t n);
+uint32_t PMA_Height(const CSet_PMA* pPMA);
+uint32_t PMA_Find_Segment(const CSet_PMA* pPMA, int32_t val);
+uint32_t PMA_Gather(const CSet_PMA* pPMA, uint32_t first, uint32_t w, int32_t* out);
+void PMA_Spread(CSet_PMA* pPMA, uint32_t first, uint32_t w, const int32_t* src, uint32_t m);
+uint32_t PMA_Add_Sorted(int32_t* arr, uint32_t m, int32_t val);
+void PMA_Rebalance(CSet_PMA* pPMA, uint32_t first, uint32_t w, bool add, int32_t val);
+bool PMA_Resize(CSet_PMA* pPMA, uint32_t capacity, bool keep, const int32_t* src, uint32_t m, bool add, int32_t val);
+
+/**
+ * Initializes an empty packed memory array.
+ *
+ * Pre:
+ *    none
+ * Post:
+ *    If successful:
+ *       pPMA->Usage == 0
+ *       pPMA->Capacity == pPMA->Segment (a single segment)
+ *    else:
+ *       *pPMA holds no memory
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_PMA_Init(CSet_PMA* const pPMA){
+	memset(pPMA, 0, sizeof(CSet_PMA));
+	return PMA_Resize(pPMA, PMA_Target_Capacity(0), false, NULL, 0, false, 0);
+};
+
+/**
+ * Replaces the contents of a packed memory array with the elements of a set.
+ *
+ * Pre:
+ *    *pPMA was initialized by CSet_PMA_Init
+ *    *pSet satisfies the CSet contract
+ * Post:
+ *    If successful:
+ *       *pPMA holds exactly the elements of *pSet, spread evenly at a
+ *       density between 1/4 and 1/2
+ *    else:
+ *       *pPMA is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_PMA_Build(CSet_PMA* const pPMA, const CSet* const pSet){
+	uint32_t n = CSet_Size(pSet);
+	uint32_t capacity = PMA_Target_Capacity(n);
+	if(capacity == 0){
+		return false;
+	}
+	return PMA_Resize(pPMA, capacity, false, pSet->Data, n, false, 0);
+};
+
+/**
+ * Adds Value to a packed memory array. Only the segment holding Value is
+ * changed, unless it is full and a window around it is rebalanced.
+ *
+ * Pre:
+ *    *pPMA was initialized by CSet_PMA_Init
+ *    Value != INT32_MAX
+ * Post:
+ *    If successful:
+ *       Value is a member of *pPMA
+ *    else:
+ *       *pPMA is unchanged
+ * Returns:
+ *    true if Value was added, false if it was already a member or memory
+ *    could not be allocated
+ */
+bool CSet_PMA_Insert(CSet_PMA* const pPMA, int32_t Value){
+	if(Value == INT32_MAX){
+		return false;
+	}
+	uint32_t seg = PMA_Find_Segment(pPMA, Value);
+	int32_t* cells = pPMA->Cells + (size_t) seg * pPMA->Segment;
+	uint32_t count = pPMA->Counts[seg];
+	uint32_t off = CSet_Active_Kernels->LowerBound(cells, count, Value);
+	if(off < count && cells[off] == Value){
+		return false;
+	}
+	if(count < pPMA->Segment){
+		memmove(cells + off + 1, cells + off, sizeof(int32_t) * (size_t)(count - off));
+		cells[off] = Value;
+		pPMA->Counts[seg]++;
+		pPMA->Usage++;
+		return true;
+	}
+	uint32_t h = PMA_Height(pPMA);
+	uint32_t level = 1;
+	while(level <= h){
+		uint32_t w = (uint32_t) 1 << level;
+		uint32_t first = seg & ~(w - 1);
+		uint64_t room = (uint64_t) w * pPMA->Segment;
+		uint64_t n = 0;
+		uint32_t s = first;
+		while(s < first + w){
+			n += pPMA->Counts[s++];
+		}
+		if((n + 1) * 4 * h <= room * (4 * h - level)){
+			PMA_Rebalance(pPMA, first, w, true, Value);
+			pPMA->Usage++;
+			return true;
+		}
+		level++;
+	}
+	uint32_t capacity = PMA_Target_Capacity((uint64_t) pPMA->Usage + 1);
+	if(capacity != 0 && PMA_Resize(pPMA, capacity, true, NULL, 0, true, Value)){
+		return true;
+	}
+	if(pPMA->Usage + 1 < pPMA->Capacity){
+		PMA_Rebalance(pPMA, 0, pPMA->Capacity / pPMA->Segment, true, Value);
+		pPMA->Usage++;
+		return true;
+	}
+	return false;
+};
+
+/**
+ * Removes Value from a packed memory array. Only the segment holding Value
+ * is changed, unless it becomes too sparse and a window around it is
+ * rebalanced.
+ *
+ * Pre:
+ *    *pPMA was initialized by CSet_PMA_Init
+ * Post:
+ *    Value is not a member of *pPMA
+ * Returns:
+ *    true if Value was removed, false if it was not a member
+ */
+bool CSet_PMA_Remove(CSet_PMA* const pPMA, int32_t Value){
+	uint32_t seg = PMA_Find_Segment(pPMA, Value);
+	int32_t* cells = pPMA->Cells + (size_t) seg * pPMA->Segment;
+	uint32_t count = pPMA->Counts[seg];
+	uint32_t off = CSet_Active_Kernels->LowerBound(cells, count, Value);
+	if(off >= count || cells[off] != Value){
+		return false;
+	}
+	memmove(cells + off, cells + off + 1, sizeof(int32_t) * (size_t)(count - 1 - off));
+	cells[count - 1] = INT32_MAX;
+	pPMA->Counts[seg]--;
+	pPMA->Usage--;
+	uint32_t h = PMA_Height(pPMA);
+	if(h == 0 || (uint64_t) pPMA->Counts[seg] * 8 >= pPMA->Segment){
+		return true;
+	}
+	uint32_t level = 1;
+	while(level <= h){
+		uint32_t w = (uint32_t) 1 << level;
+		uint32_t first = seg & ~(w - 1);
+		uint64_t room = (uint64_t) w * pPMA->Segment;
+		uint64_t n = 0;
+		uint32_t s = first;
+		while(s < first + w){
+			n += pPMA->Counts[s++];
+		}
+		if(n * 8 * h >= room * (h + level)){
+			PMA_Rebalance(pPMA, first, w, false, 0);
+			return true;
+		}
+		level++;
+	}
+	if(!PMA_Resize(pPMA, PMA_Target_Capacity(pPMA->Usage), true, NULL, 0, false, 0)){
+		PMA_Rebalance(pPMA, 0, pPMA->Capacity / pPMA->Segment, false, 0);
+	}
+	return true;
+};
+
+/**
+ * Determines if Value belongs to a packed memory array.
+ *
+ * Pre:
+ *    *pPMA was initialized by CSet_PMA_Init
+ * Post:
+ *    *pPMA is unchanged
+ * Returns:
+ *    true if Value belongs to *pPMA, false otherwise
+ */
+bool CSet_PMA_Contains(const CSet_PMA* const pPMA, int32_t Value){
+	uint32_t seg = PMA_Find_Segment(pPMA, Value);
+	const int32_t* cells = pPMA->Cells + (size_t) seg * pPMA->Segment;
+	uint32_t count = pPMA->Counts[seg];
+	uint32_t off = CSet_Active_Kernels->LowerBound(cells, count, Value);
+	return off < count && cells[off] == Value;
+};
+
+/**
+ * Reports the number of elements in a packed memory array.
+ *
+ * Pre:
+ *    *pPMA was initialized by CSet_PMA_Init
+ * Returns:
+ *    pPMA->Usage
+ */
+uint32_t CSet_PMA_Size(const CSet_PMA* const pPMA){
+	return pPMA->Usage;
+};
+
+/**
+ * Steps a cursor to the next element of a packed memory array, in
+ * increasing order. A scan starts with *pCursor == 0.
+ *
+ * Pre:
+ *    *pPMA was initialized by CSet_PMA_Init and is not modified during the scan
+ *    *pCursor is 0 or was set by an earlier call on *pPMA
+ * Post:
+ *    If an element remains:
+ *       *pValue is the next element and *pCursor is advanced past it
+ *    else:
+ *       *pCursor == pPMA->Capacity
+ * Returns:
+ *    true if an element was returned, false at the end of the scan
+ */
+bool CSet_PMA_Next(const CSet_PMA* const pPMA, uint32_t* const pCursor, int32_t* const pValue){
+	uint32_t c = *pCursor;
+	while(c < pPMA->Capacity){
+		uint32_t seg = c / pPMA->Segment;
+		if(c - seg * pPMA->Segment < pPMA->Counts[seg]){
+			*pValue = pPMA->Cells[c];
+			*pCursor = c + 1;
+			return true;
+		}
+		c = (seg + 1) * pPMA->Segment;
+	}
+	*pCursor = pPMA->Capacity;
+	return false;
+};
+
+/**
+ * Writes the elements of a packed memory array into a CSet in the plain
+ * dense layout, replacing its contents.
+ *
+ * Pre:
+ *    *pPMA was initialized by CSet_PMA_Init
+ *    *pSet satisfies the CSet contract
+ * Post:
+ *    *pPMA is unchanged
+ *    If successful:
+ *       *pSet holds exactly the elements of *pPMA
+ *       pSet->Capacity == pPMA->Usage + 1
+ *    else:
+ *       *pSet is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_PMA_Compact(const CSet_PMA* const pPMA, CSet* const pSet){
+	int32_t* temp = (int32_t*) malloc(sizeof(int32_t) * ((size_t) pPMA->Usage + 1));
+	if(!temp){
+		return false;
+	}
+	uint32_t n = PMA_Gather(pPMA, 0, pPMA->Capacity / pPMA->Segment, temp);
+	bool success = CSet_Load(pSet, n + 1, temp, n);
+	free(temp);
+	return success;
+};
+
+/**
+ * Releases the memory of a packed memory array.
+ *
+ * Pre:
+ *    *pPMA was initialized by CSet_PMA_Init, or zeroed
+ * Post:
+ *    *pPMA holds no memory
+ */
+void CSet_PMA_Free(CSet_PMA* const pPMA){
+	free(pPMA->Cells);
+	free(pPMA->Counts);
+	free(pPMA->Scratch);
+	memset(pPMA, 0, sizeof(CSet_PMA));
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Chooses the segment size for an array of the given capacity: the smallest
+ * power of two that is at least 2 log2(capacity) and PMA_MIN_SEGMENT
+ * @param  capacity a power of two
+ * @return uint32_t cells per segment
+ */
+uint32_t PMA_Segment_For(uint32_t capacity){
+	uint32_t logCap = 0;
+	while(((uint32_t) 1 << logCap) < capacity){
+		logCap++;
+	}
+	uint32_t segment = PMA_MIN_SEGMENT;
+	while(segment < 2 * logCap){
+		segment *= 2;
+	}
+	return segment;
+};
+
+/**
+ * Chooses the capacity at which n elements fill an array between 1/4 and
+ * 1/2, or a single segment if n fits in half of one
+ * @param  n the number of elements
+ * @return uint32_t the capacity, or 0 if n is too large
+ */
+uint32_t PMA_Target_Capacity(uint64_t n){
+	uint64_t capacity = PMA_MIN_SEGMENT;
+	while(n * 2 > capacity){
+		capacity *= 2;
+	}
+	return capacity > PMA_MAX_CAPACITY ? 0 : (uint32_t) capacity;
+};
+
+/**
+ * Computes the height of the implicit tree over the segments
+ * @param  pPMA the packed memory array
+ * @return uint32_t log2 of the number of segments
+ */
+uint32_t PMA_Height(const CSet_PMA* pPMA){
+	uint32_t h = 0;
+	while((pPMA->Segment << h) < pPMA->Capacity){
+		h++;
+	}
+	return h;
+};
+
+/**
+ * Finds the segment that holds val, or should: the last one whose first
+ * element is <= val, or segment 0
+ * @param  pPMA the packed memory array
+ * @param  val  the value to search for
+ * @return uint32_t the segment index
+ */
+uint32_t PMA_Find_Segment(const CSet_PMA* pPMA, int32_t val){
+	uint32_t bottom = 0;
+	uint32_t top = pPMA->Capacity / pPMA->Segment - 1;
+	while(bottom < top){
+		uint32_t mid = bottom + (top - bottom + 1) / 2;
+		if(pPMA->Cells[(size_t) mid * pPMA->Segment] <= val){
+			bottom = mid;
+		}
+		else{
+			top = mid - 1;
+		}
+	}
+	return bottom;
+};
+
+/**
+ * Copies the elements of segments [first, first + w) into out, in order
+ * @param  pPMA  the packed memory array
+ * @param  first the first segment of the window
+ * @param  w     the number of segments in the window
+ * @param  out   array large enough for the elements of the window
+ * @return uint32_t the number of elements copied
+ */
+uint32_t PMA_Gather(const CSet_PMA* pPMA, uint32_t first, uint32_t w, int32_t* out){
+	uint32_t m = 0;
+	uint32_t s = first;
+	while(s < first + w){
+		memcpy(out + m, pPMA->Cells + (size_t) s * pPMA->Segment, sizeof(int32_t) * pPMA->Counts[s]);
+		m += pPMA->Counts[s];
+		s++;
+	}
+	return m;
+};
+
+/**
+ * Spreads the sorted values src[0:m-1] evenly over segments [first, first + w),
+ * each segment receiving its share at its start followed by INT32_MAX gaps
+ * @param pPMA  the packed memory array
+ * @param first the first segment of the window
+ * @param w     the number of segments in the window
+ * @param src   the values, not overlapping the window
+ * @param m     the number of values, at most w * Segment
+ */
+void PMA_Spread(CSet_PMA* pPMA, uint32_t first, uint32_t w, const int32_t* src, uint32_t m){
+	uint32_t share = m / w;
+	uint32_t extra = m % w;
+	uint32_t s = 0;
+	while(s < w){
+		uint32_t count = share + (s < extra);
+		int32_t* cells = pPMA->Cells + (size_t)(first + s) * pPMA->Segment;
+		if(count > 0){
+			memcpy(cells, src, sizeof(int32_t) * count);
+		}
+		CSet_Active_Kernels->Fill(cells + count, INT32_MAX, pPMA->Segment - count);
+		pPMA->Counts[first + s] = count;
+		src += count;
+		s++;
+	}
+};
+
+/**
+ * Inserts val into the sorted array arr[0:m-1], which has room for one more
+ * @param  arr the array
+ * @param  m   the number of values in arr
+ * @param  val a value not in arr
+ * @return uint32_t m + 1
+ */
+uint32_t PMA_Add_Sorted(int32_t* arr, uint32_t m, int32_t val){
+	uint32_t pos = CSet_Active_Kernels->LowerBound(arr, m, val);
+	memmove(arr + pos + 1, arr + pos, sizeof(int32_t) * (size_t)(m - pos));
+	arr[pos] = val;
+	return m + 1;
+};
+
+/**
+ * Spreads the elements of a window evenly over it, adding val first if asked.
+ * Usage is not changed.
+ * @param pPMA  the packed memory array
+ * @param first the first segment of the window
+ * @param w     the number of segments in the window
+ * @param add   whether val is added to the window
+ * @param val   the value to add, not already present
+ */
+void PMA_Rebalance(CSet_PMA* pPMA, uint32_t first, uint32_t w, bool add, int32_t val){
+	uint32_t m = PMA_Gather(pPMA, first, w, pPMA->Scratch);
+	if(add){
+		m = PMA_Add_Sorted(pPMA->Scratch, m, val);
+	}
+	PMA_Spread(pPMA, first, w, pPMA->Scratch, m);
+};
+
+/**
+ * Reallocates the array at a new capacity and spreads the elements evenly.
+ * The elements are those of the array itself if keep is true, or else
+ * src[0:m-1], plus val if add is true.
+ * @param  pPMA     the packed memory array
+ * @param  capacity the new capacity, from PMA_Target_Capacity
+ * @param  keep     whether the current elements are kept
+ * @param  src      sorted values replacing the contents unless keep is true
+ * @param  m        the number of values in src
+ * @param  add      whether val is added
+ * @param  val      the value to add, not already present
+ * @return bool whether the allocation was successful; if not, *pPMA is unchanged
+ */
+bool PMA_Resize(CSet_PMA* pPMA, uint32_t capacity, bool keep, const int32_t* src, uint32_t m, bool add, int32_t val){
+	uint32_t segment = PMA_Segment_For(capacity);
+	int32_t* cells = (int32_t*) malloc(sizeof(int32_t) * (size_t) capacity);
+	uint32_t* counts = (uint32_t*) malloc(sizeof(uint32_t) * (size_t)(capacity / segment));
+	int32_t* scratch = (int32_t*) malloc(sizeof(int32_t) * (size_t) capacity);
+	if(!cells || !counts || !scratch){
+		free(cells);
+		free(counts);
+		free(scratch);
+		return false;
+	}
+	if(keep){
+		m = PMA_Gather(pPMA, 0, pPMA->Capacity / pPMA->Segment, scratch);
+		src = scratch;
+	}
+	if(add){
+		if(src != scratch && m > 0){
+			memcpy(scratch, src, sizeof(int32_t) * (size_t) m);
+		}
+		src = scratch;
+		m = PMA_Add_Sorted(scratch, m, val);
+	}
+	free(pPMA->Cells);
+	free(pPMA->Counts);
+	free(pPMA->Scratch);
+	pPMA->Cells = cells;
+	pPMA->Counts = counts;
+	pPMA->Scratch = scratch;
+	pPMA->Capacity = capacity;
+	pPMA->Segment = segment;
+	pPMA->Usage = m;
+	PMA_Spread(pPMA, 0, capacity / segment, src, m);
+	return true;
+};
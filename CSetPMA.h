@@ -0,0 +1,38 @@
+#ifndef CSET_PMA_H
+#define CSET_PMA_H
+#include "CSet.h"
+
+// A packed memory array: the elements of a set in sorted order, spread over
+// Capacity cells split into segments of Segment cells. Each segment holds
+// its elements at its start, followed by INT32_MAX gaps.
+struct _CSet_PMA {
+
+   uint32_t Capacity;    // number of cells, a power of two
+   uint32_t Segment;     // cells per segment, a power of two dividing Capacity
+   uint32_t Usage;       // number of elements
+   int32_t* Cells;       // the Capacity cells
+   uint32_t* Counts;     // number of elements in each segment
+   int32_t* Scratch;     // Capacity cells used while rebalancing
+};
+
+typedef struct _CSet_PMA CSet_PMA;
+
+bool CSet_PMA_Init(CSet_PMA* const pPMA);
+
+bool CSet_PMA_Build(CSet_PMA* const pPMA, const CSet* const pSet);
+
+bool CSet_PMA_Insert(CSet_PMA* const pPMA, int32_t Value);
+
+bool CSet_PMA_Remove(CSet_PMA* const pPMA, int32_t Value);
+
+bool CSet_PMA_Contains(const CSet_PMA* const pPMA, int32_t Value);
+
+uint32_t CSet_PMA_Size(const CSet_PMA* const pPMA);
+
+bool CSet_PMA_Next(const CSet_PMA* const pPMA, uint32_t* const pCursor, int32_t* const pValue);
+
+bool CSet_PMA_Compact(const CSet_PMA* const pPMA, CSet* const pSet);
+
+void CSet_PMA_Free(CSet_PMA* const pPMA);
+
+#endif
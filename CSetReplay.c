@@ -0,0 +1,486 @@
+#include "CSetReplay.h"
+#include "CSetInternal.h"
+#include "CSetPMA.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// CSetReplay re-executes a trace written by CSetTrace against a set
+// representation and reports the latency of every operation.
+//
+// A backend (CSet_Replay_Backend) is a table of functions over opaque set
+// storage: CSet_Replay_Dense runs every record on plain CSets, and
+// CSet_Replay_Packed runs the element updates and lookups on packed memory
+// arrays (CSetPMA.c) and skips what a PMA does not offer (set operations,
+// range removals, summaries). Other representations are compared on the
+// same workload by supplying another table.
+//
+// Records are replayed in order on a single thread. Each call is timed on
+// its own with CLOCK_MONOTONIC, so the figures include a few tens of
+// nanoseconds of clock overhead; they are meant for comparing backends and
+// engine versions on the same trace rather than as absolute costs.
+// Latencies are kept per operation and sorted once at the end for the
+// percentiles.
+//
+// A replay starts every set empty. Init, Load and the set operations
+// release a set's previous array before reinitializing it, so unlike the
+// traced program (which may have released it separately) the replay never
+// leaks; the release is part of the measured call.
+
+//Global Declaration
+#define REPLAY_MIN_CAPACITY 256
+
+struct _Replay_Latencies {
+
+   uint32_t* Ns;         // latency of each call, saturated at UINT32_MAX
+   uint64_t Count;       // number of latencies held
+   uint64_t Capacity;    // dimension of Ns
+};
+
+typedef struct _Replay_Latencies Replay_Latencies;
+
+//Internal Helper Declarations
+void* Replay_Set(void*** pSets, uint32_t* pCapacity, uint32_t id, const CSet_Replay_Backend* pBackend, bool* pFailed);
+uint32_t Replay_Sets_Needed(uint32_t op);
+bool Replay_Add(Replay_Latencies* pLatencies, uint64_t ns);
+bool Replay_Dense_Create(void* pSet);
+bool Replay_Dense_Run(void* const* Sets, const CSet_Trace_Record* pRecord, const int32_t* Values);
+uint64_t Replay_Dense_Hash(const void* pSet);
+void Replay_Dense_Free(void* pSet);
+bool Replay_Packed_Create(void* pSet);
+bool Replay_Packed_Run(void* const* Sets, const CSet_Trace_Record* pRecord, const int32_t* Values);
+uint64_t Replay_Packed_Hash(const void* pSet);
+void Replay_Packed_Free(void* pSet);
+
+const CSet_Replay_Backend CSet_Replay_Dense = {"dense", sizeof(CSet), Replay_Dense_Create,
+	Replay_Dense_Run, Replay_Dense_Hash, Replay_Dense_Free};
+
+const CSet_Replay_Backend CSet_Replay_Packed = {"packed", sizeof(CSet_PMA), Replay_Packed_Create,
+	Replay_Packed_Run, Replay_Packed_Hash, Replay_Packed_Free};
+
+/**
+ * Replays a trace file against a backend, measuring every call.
+ *
+ * Pre:
+ *    In is open for reading, positioned at a trace file
+ *    no trace is active (the replay itself would be recorded)
+ * Post:
+ *    *pReport holds the number of records and sets, the latency percentiles
+ *    of each operation, and the sum of the hashes of the sets at the end.
+ *    A trailing partial record (a trace cut short) ends the replay.
+ *    Every set the replay created has been freed.
+ * Returns:
+ *    true if the file was a trace and every record could be replayed (or
+ *    skipped), false if it was malformed or memory ran out
+ */
+bool CSet_Replay_Run(FILE* const In, const CSet_Replay_Backend* const pBackend, CSet_Replay_Report* const pReport){
+	memset(pReport, 0, sizeof(CSet_Replay_Report));
+	pReport->Backend = pBackend->Name;
+	uint32_t header[2];
+	if(fread(header, sizeof(uint32_t), 2, In) != 2 || header[0] != CSET_TRACE_FILE_MAGIC ||
+		header[1] != sizeof(CSet_Trace_Record)){
+		return false;
+	}
+	Replay_Latencies latencies[CSET_TRACE_OPS];
+	memset(latencies, 0, sizeof(latencies));
+	void** sets = NULL;
+	uint32_t setCap = 0;
+	int32_t* values = NULL;
+	uint32_t valueCap = 0;
+	bool failed = false;
+	CSet_Trace_Record record;
+	while(!failed && fread(&record, sizeof(CSet_Trace_Record), 1, In) == 1){
+		if(record.Op == 0 || record.Op >= CSET_TRACE_OPS){
+			failed = true;
+			break;
+		}
+		if(record.Count > valueCap){
+			int32_t* temp = (int32_t*) realloc(values, sizeof(int32_t) * (size_t) record.Count);
+			if(!temp){
+				failed = true;
+				break;
+			}
+			values = temp;
+			valueCap = record.Count;
+		}
+		if(record.Count > 0 && fread(values, sizeof(int32_t), record.Count, In) != record.Count){
+			break;
+		}
+		pReport->Records++;
+		void* handles[3];
+		handles[0] = Replay_Set(&sets, &setCap, record.Set, pBackend, &failed);
+		handles[1] = Replay_Set(&sets, &setCap, record.Other, pBackend, &failed);
+		handles[2] = Replay_Set(&sets, &setCap, record.Third, pBackend, &failed);
+		uint32_t needed = Replay_Sets_Needed(record.Op);
+		if(failed || handles[0] == NULL || (needed > 1 && handles[1] == NULL) || (needed > 2 && handles[2] == NULL)){
+			pReport->Ops[record.Op].Skipped++;
+			continue;
+		}
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		bool ran = pBackend->Run(handles, &record, values);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		if(!ran){
+			pReport->Ops[record.Op].Skipped++;
+			continue;
+		}
+		int64_t ns = (int64_t)(end.tv_sec - start.tv_sec) * 1000000000 + (end.tv_nsec - start.tv_nsec);
+		if(!Replay_Add(&latencies[record.Op], ns > 0 ? (uint64_t) ns : 0)){
+			failed = true;
+		}
+	}
+	uint32_t op = 1;
+	while(op < CSET_TRACE_OPS){
+		static const uint32_t perMille[CSET_REPLAY_PERCENTILES] = {500, 900, 990, 999, 1000};
+		Replay_Latencies* pLatencies = &latencies[op];
+		CSet_Replay_Stats* pStats = &pReport->Ops[op];
+		pStats->Count = pLatencies->Count;
+		if(pLatencies->Count > 0){
+			qsort(pLatencies->Ns, pLatencies->Count, sizeof(uint32_t), Compare_Uint32);
+			uint64_t i = 0;
+			while(i < pLatencies->Count){
+				pStats->TotalNs += pLatencies->Ns[i];
+				i++;
+			}
+			uint32_t p = 0;
+			while(p < CSET_REPLAY_PERCENTILES){
+				pStats->Ns[p] = pLatencies->Ns[(pLatencies->Count - 1) * perMille[p] / 1000];
+				p++;
+			}
+		}
+		free(pLatencies->Ns);
+		op++;
+	}
+	uint32_t id = 0;
+	while(id < setCap){
+		if(sets[id]){
+			pReport->Sets++;
+			pReport->StateHash += pBackend->Hash(sets[id]);
+			pBackend->Free(sets[id]);
+			free(sets[id]);
+		}
+		id++;
+	}
+	free(sets);
+	free(values);
+	return !failed;
+};
+
+/**
+ * Prints a replay report as a table of per-operation latencies, in
+ * nanoseconds. Operations that were never called are left out.
+ *
+ * Pre:
+ *    *pReport was filled in by CSet_Replay_Run
+ *    Out is open for writing
+ */
+void CSet_Replay_Print(const CSet_Replay_Report* const pReport, FILE* const Out){
+	fprintf(Out, "replay on %s: %llu records, %u sets\n", pReport->Backend,
+	        (unsigned long long) pReport->Records, pReport->Sets);
+	fprintf(Out, "%-13s %10s %8s %8s %8s %8s %8s %8s %10s\n", "operation", "calls", "skipped",
+	        "mean", "p50", "p90", "p99", "p99.9", "max");
+	uint32_t op = 1;
+	while(op < CSET_TRACE_OPS){
+		const CSet_Replay_Stats* pStats = &pReport->Ops[op];
+		if(pStats->Count > 0 || pStats->Skipped > 0){
+			fprintf(Out, "%-13s %10llu %8llu %8llu %8llu %8llu %8llu %8llu %10llu\n", CSet_Trace_OpName(op),
+			        (unsigned long long) pStats->Count, (unsigned long long) pStats->Skipped,
+			        (unsigned long long)(pStats->Count > 0 ? pStats->TotalNs / pStats->Count : 0),
+			        (unsigned long long) pStats->Ns[0], (unsigned long long) pStats->Ns[1],
+			        (unsigned long long) pStats->Ns[2], (unsigned long long) pStats->Ns[3],
+			        (unsigned long long) pStats->Ns[4]);
+		}
+		op++;
+	}
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Finds the storage of a trace set, creating it the first time its id
+ * appears
+ * @param  pSets     the storage of each id, indexed by id - 1
+ * @param  pCapacity the dimension of *pSets
+ * @param  id        the id, or 0 for no set
+ * @param  pBackend  the backend
+ * @param  pFailed   set to true if memory runs out
+ * @return void* the set, or NULL for id 0 or on failure
+ */
+void* Replay_Set(void*** pSets, uint32_t* pCapacity, uint32_t id, const CSet_Replay_Backend* pBackend, bool* pFailed){
+	if(id == 0){
+		return NULL;
+	}
+	if(id > *pCapacity){
+		uint64_t capacity = *pCapacity < REPLAY_MIN_CAPACITY ? REPLAY_MIN_CAPACITY : (uint64_t) *pCapacity * 2;
+		if(capacity < id){
+			capacity = id;
+		}
+		void** temp = (void**) realloc(*pSets, sizeof(void*) * capacity);
+		if(!temp){
+			*pFailed = true;
+			return NULL;
+		}
+		memset(temp + *pCapacity, 0, sizeof(void*) * (capacity - *pCapacity));
+		*pSets = temp;
+		*pCapacity = (uint32_t) capacity;
+	}
+	void** pSlot = &(*pSets)[id - 1];
+	if(*pSlot == NULL){
+		void* pSet = calloc(1, pBackend->Size);
+		if(!pSet || !pBackend->Create(pSet)){
+			free(pSet);
+			*pFailed = true;
+			return NULL;
+		}
+		*pSlot = pSet;
+	}
+	return *pSlot;
+};
+
+/**
+ * Reports how many set arguments an operation takes
+ * @param  op the CSET_TRACE_* operation
+ * @return uint32_t 3 for set operations, 2 for comparisons, Copy, Move and Swap, else 1
+ */
+uint32_t Replay_Sets_Needed(uint32_t op){
+	if(op == CSET_TRACE_UNION || op == CSET_TRACE_INTERSECTION || op == CSET_TRACE_DIFFERENCE){
+		return 3;
+	}
+	if(op == CSET_TRACE_COPY || op == CSET_TRACE_EQUALS || op == CSET_TRACE_SUBSET || op == CSET_TRACE_INTERSECTS ||
+		op == CSET_TRACE_MOVE || op == CSET_TRACE_SWAP){
+		return 2;
+	}
+	return 1;
+};
+
+/**
+ * Appends a latency, growing the array as needed
+ * @param  pLatencies the latencies of one operation
+ * @param  ns         the latency in nanoseconds
+ * @return bool whether there was room
+ */
+bool Replay_Add(Replay_Latencies* pLatencies, uint64_t ns){
+	if(pLatencies->Count == pLatencies->Capacity){
+		uint64_t capacity = pLatencies->Capacity < REPLAY_MIN_CAPACITY ? REPLAY_MIN_CAPACITY : pLatencies->Capacity * 2;
+		uint32_t* temp = (uint32_t*) realloc(pLatencies->Ns, sizeof(uint32_t) * capacity);
+		if(!temp){
+			return false;
+		}
+		pLatencies->Ns = temp;
+		pLatencies->Capacity = capacity;
+	}
+	pLatencies->Ns[pLatencies->Count++] = ns > UINT32_MAX ? UINT32_MAX : (uint32_t) ns;
+	return true;
+};
+
+/**
+ * Prepares a zeroed CSet for replay
+ * @param  pSet the storage
+ * @return bool true
+ */
+bool Replay_Dense_Create(void* pSet){
+	return CSet_Init((CSet*) pSet, 0);
+};
+
+/**
+ * Runs one record on plain CSets
+ * @param  Sets    the sets named by the record
+ * @param  pRecord the record
+ * @param  Values  the values of the record
+ * @return bool true, or false for an operation this replayer does not know
+ */
+bool Replay_Dense_Run(void* const* Sets, const CSet_Trace_Record* pRecord, const int32_t* Values){
+	CSet* pSet = (CSet*) Sets[0];
+	CSet* pOther = (CSet*) Sets[1];
+	CSet* pThird = (CSet*) Sets[2];
+	int32_t value = (int32_t) pRecord->Args[0];
+	int32_t* data;
+	uint32_t usage, capacity, flags;
+	switch(pRecord->Op){
+	case CSET_TRACE_INIT:
+		CSet_makeEmpty(pSet);
+		CSet_Init(pSet, pRecord->Args[0]);
+		break;
+	case CSET_TRACE_LOAD:
+		CSet_Load(pSet, pRecord->Args[0], Values, pRecord->Count);
+		break;
+	case CSET_TRACE_INSERT:
+		CSet_Insert(pSet, value);
+		break;
+	case CSET_TRACE_COPY:
+		CSet_Copy(pSet, pOther);
+		break;
+	case CSET_TRACE_CONTAINS:
+		CSet_Contains(pSet, value);
+		break;
+	case CSET_TRACE_REMOVE:
+		CSet_Remove(pSet, value);
+		break;
+	case CSET_TRACE_REMOVE_MANY:
+		CSet_RemoveMany(pSet, Values, pRecord->Count);
+		break;
+	case CSET_TRACE_REMOVE_RANGE:
+		CSet_RemoveRange(pSet, value, (int32_t) pRecord->Args[1]);
+		break;
+	case CSET_TRACE_SHRINK:
+		CSet_Shrink(pSet, pRecord->Args[0]);
+		break;
+	case CSET_TRACE_EQUALS:
+		CSet_Equals(pSet, pOther);
+		break;
+	case CSET_TRACE_SUBSET:
+		CSet_isSubsetOf(pSet, pOther);
+		break;
+	case CSET_TRACE_INTERSECTS:
+		CSet_Intersects(pSet, pOther);
+		break;
+	case CSET_TRACE_UNION:
+		CSet_makeEmpty(pSet);
+		CSet_Union(pSet, pOther, pThird);
+		break;
+	case CSET_TRACE_INTERSECTION:
+		CSet_makeEmpty(pSet);
+		CSet_Intersection(pSet, pOther, pThird);
+		break;
+	case CSET_TRACE_DIFFERENCE:
+		CSet_makeEmpty(pSet);
+		CSet_Difference(pSet, pOther, pThird);
+		break;
+	case CSET_TRACE_MAKE_EMPTY:
+		CSet_makeEmpty(pSet);
+		break;
+	case CSET_TRACE_BUILD_SUMMARY:
+		CSet_BuildSummary(pSet);
+		break;
+	case CSET_TRACE_MOVE:
+		CSet_Move(pSet, pOther);
+		break;
+	case CSET_TRACE_SWAP:
+		CSet_Swap(pSet, pOther);
+		break;
+	case CSET_TRACE_RELEASE:
+		data = CSet_Release(pSet, &usage, &capacity, &flags);
+		CSet_FreeArray(data, capacity, flags);
+		break;
+	case CSET_TRACE_DROP_SUMMARY:
+		CSet_DropSummary(pSet);
+		break;
+	default:
+		return false;
+	}
+	return true;
+};
+
+/**
+ * Reports the hash of a replayed CSet
+ * @param  pSet the set
+ * @return uint64_t CSet_Hash of the set
+ */
+uint64_t Replay_Dense_Hash(const void* pSet){
+	return CSet_Hash((const CSet*) pSet);
+};
+
+/**
+ * Releases a replayed CSet
+ * @param pSet the set
+ */
+void Replay_Dense_Free(void* pSet){
+	CSet_makeEmpty((CSet*) pSet);
+};
+
+/**
+ * Prepares a zeroed packed memory array for replay
+ * @param  pSet the storage
+ * @return bool whether the array could be allocated
+ */
+bool Replay_Packed_Create(void* pSet){
+	return CSet_PMA_Init((CSet_PMA*) pSet);
+};
+
+/**
+ * Runs one record on packed memory arrays. Load and Copy go through a
+ * temporary dense set, as a PMA is only built from one
+ * @param  Sets    the sets named by the record
+ * @param  pRecord the record
+ * @param  Values  the values of the record
+ * @return bool false for the operations a PMA does not support
+ */
+bool Replay_Packed_Run(void* const* Sets, const CSet_Trace_Record* pRecord, const int32_t* Values){
+	CSet_PMA* pPMA = (CSet_PMA*) Sets[0];
+	CSet_PMA other;
+	int32_t value = (int32_t) pRecord->Args[0];
+	CSet temp;
+	uint32_t i = 0;
+	switch(pRecord->Op){
+	case CSET_TRACE_INIT:
+	case CSET_TRACE_MAKE_EMPTY:
+	case CSET_TRACE_RELEASE:
+		CSet_PMA_Free(pPMA);
+		CSet_PMA_Init(pPMA);
+		break;
+	case CSET_TRACE_MOVE:
+		CSet_PMA_Free(pPMA);
+		*pPMA = *(CSet_PMA*) Sets[1];
+		CSet_PMA_Init((CSet_PMA*) Sets[1]);
+		break;
+	case CSET_TRACE_SWAP:
+		other = *pPMA;
+		*pPMA = *(CSet_PMA*) Sets[1];
+		*(CSet_PMA*) Sets[1] = other;
+		break;
+	case CSET_TRACE_LOAD:
+		CSet_Init(&temp, 0);
+		if(CSet_Load(&temp, pRecord->Args[0], Values, pRecord->Count)){
+			CSet_PMA_Build(pPMA, &temp);
+		}
+		CSet_makeEmpty(&temp);
+		break;
+	case CSET_TRACE_COPY:
+		CSet_Init(&temp, 0);
+		if(CSet_PMA_Compact((const CSet_PMA*) Sets[1], &temp)){
+			CSet_PMA_Build(pPMA, &temp);
+		}
+		CSet_makeEmpty(&temp);
+		break;
+	case CSET_TRACE_INSERT:
+		CSet_PMA_Insert(pPMA, value);
+		break;
+	case CSET_TRACE_CONTAINS:
+		CSet_PMA_Contains(pPMA, value);
+		break;
+	case CSET_TRACE_REMOVE:
+		CSet_PMA_Remove(pPMA, value);
+		break;
+	case CSET_TRACE_REMOVE_MANY:
+		while(i < pRecord->Count){
+			CSet_PMA_Remove(pPMA, Values[i]);
+			i++;
+		}
+		break;
+	default:
+		return false;
+	}
+	return true;
+};
+
+/**
+ * Reports the hash of a replayed packed memory array
+ * @param  pSet the array
+ * @return uint64_t CSet_Hash of its elements, or 0 if they cannot be copied out
+ */
+uint64_t Replay_Packed_Hash(const void* pSet){
+	CSet temp;
+	CSet_Init(&temp, 0);
+	uint64_t hash = CSet_PMA_Compact((const CSet_PMA*) pSet, &temp) ? CSet_Hash(&temp) : 0;
+	CSet_makeEmpty(&temp);
+	return hash;
+};
+
+/**
+ * Releases a replayed packed memory array
+ * @param pSet the array
+ */
+void Replay_Packed_Free(void* pSet){
+	CSet_PMA_Free((CSet_PMA*) pSet);
+};
@@ -0,0 +1,53 @@
+#ifndef CSET_REPLAY_H
+#define CSET_REPLAY_H
+#include "CSetTrace.h"
+
+#define CSET_REPLAY_PERCENTILES 5   // p50, p90, p99, p99.9 and the maximum
+
+// A set representation a trace can be replayed against. Every set of the
+// trace gets Size zeroed bytes, prepared by Create when its id first
+// appears. Run executes one record on the sets it names (NULL for id 0) and
+// returns false if the representation does not support the operation.
+struct _CSet_Replay_Backend {
+
+   const char* Name;
+   size_t Size;
+   bool (*Create)(void* pSet);
+   bool (*Run)(void* const* Sets, const CSet_Trace_Record* pRecord, const int32_t* Values);
+   uint64_t (*Hash)(const void* pSet);
+   void (*Free)(void* pSet);
+};
+
+typedef struct _CSet_Replay_Backend CSet_Replay_Backend;
+
+// Latencies of one operation, in nanoseconds
+struct _CSet_Replay_Stats {
+
+   uint64_t Count;       // number of calls replayed
+   uint64_t Skipped;     // number of calls the backend does not support
+   uint64_t TotalNs;     // sum of the latencies
+   uint64_t Ns[CSET_REPLAY_PERCENTILES]; // p50, p90, p99, p99.9 and max
+};
+
+typedef struct _CSet_Replay_Stats CSet_Replay_Stats;
+
+struct _CSet_Replay_Report {
+
+   const char* Backend;  // name of the backend replayed against
+   uint64_t Records;     // number of records read
+   uint32_t Sets;        // number of distinct sets in the trace
+   uint64_t StateHash;   // sum of the hashes of every set after the replay
+   CSet_Replay_Stats Ops[CSET_TRACE_OPS]; // indexed by CSET_TRACE_* operation
+};
+
+typedef struct _CSet_Replay_Report CSet_Replay_Report;
+
+extern const CSet_Replay_Backend CSet_Replay_Dense;
+
+extern const CSet_Replay_Backend CSet_Replay_Packed;
+
+bool CSet_Replay_Run(FILE* const In, const CSet_Replay_Backend* const pBackend, CSet_Replay_Report* const pReport);
+
+void CSet_Replay_Print(const CSet_Replay_Report* const pReport, FILE* const Out);
+
+#endif
@@ -0,0 +1,1133 @@
+#define _GNU_SOURCE
+#include "CSetServer.h"
+#include "CSetIngest.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// CSetServer serves queries against named CSets over a Unix domain socket,
+// so that every process on a host can share one in-memory copy of each set.
+//
+// Every message is a 12-byte header followed by a payload. Integers are in
+// host byte order, since both ends always run on the same machine.
+//
+//    request: uint32_t Length    bytes following the header
+//             uint32_t Id        echoed in the reply
+//             uint8_t  Op        one of CSET_OP_*
+//             uint8_t  NameALen  length of the first set name
+//             uint8_t  NameBLen  length of the second set name, or 0
+//             uint8_t  Reserved
+//             char     NameA[NameALen], NameB[NameBLen], then the op payload
+//
+//    reply:   uint32_t Length    bytes following the header
+//             uint32_t Id        Id of the request
+//             uint8_t  Status    one of CSET_STATUS_*
+//             uint8_t  Reserved[3]
+//             the op reply (present only if Status == CSET_STATUS_OK)
+//
+// Replies on a connection are sent in request order.
+//
+// The server runs a single-threaded epoll loop. Each wakeup first reads and
+// parses every ready connection. Contains and ContainsMany probes from all
+// of those requests are not answered one at a time. They are gathered,
+// sorted by set and value, and answered by one merge pass over each set's
+// Data, so concurrent clients share the cost of walking the array.
+//
+// CSET_OP_LOAD reads a file with the server's privileges, and on the event
+// loop thread, so it is refused until the owner names a directory with
+// CSet_Server_AllowLoads. Paths must then be relative, have no ".."
+// component, and still resolve inside that directory once symbolic links
+// are followed.
+
+//Global Declaration
+#define SERVER_HEADER_SIZE 12
+#define SERVER_MAX_REQUEST (64u << 20)
+#define SERVER_MAX_EVENTS 64
+#define SERVER_READ_CHUNK 65536
+#define SERVER_MERGE_RATIO 8
+#define DEFAULT_SERVER_CAPACITY 10
+
+struct _Server_Conn {
+
+   int Fd;               // connected socket
+   uint8_t* In;          // received bytes not yet parsed
+   size_t InLen;         // number of bytes in In
+   size_t InCap;         // dimension of In
+   uint8_t* Out;         // replies not yet sent
+   size_t OutLen;        // number of bytes in Out
+   size_t OutSent;       // number of bytes of Out already sent
+   size_t OutCap;        // dimension of Out
+   bool Watching;        // EPOLLOUT is registered
+   bool Touched;         // Out changed during this wakeup
+   bool Dead;            // close after this wakeup
+   struct _Server_Conn* Prev; // previous open connection, or NULL
+   struct _Server_Conn* Next; // next open connection, or NULL
+};
+
+typedef struct _Server_Conn Server_Conn;
+
+struct _Named_Set {
+
+   char Name[CSET_SERVER_NAME_MAX + 1];
+   CSet Set;
+};
+
+typedef struct _Named_Set Named_Set;
+
+struct _Server_Probe {
+
+   int32_t Value;        // value to look up
+   uint32_t SetIndex;    // index into Sets
+   Server_Conn* pConn;   // connection that receives the answer
+   size_t Offset;        // position of the answer byte in pConn->Out
+};
+
+typedef struct _Server_Probe Server_Probe;
+
+struct _CSet_Server {
+
+   int ListenFd;
+   int EpollFd;
+   int WakeFds[2];       // self-pipe used by CSet_Server_Stop
+   char Path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+   Named_Set* Sets;
+   uint32_t SetCount;
+   uint32_t SetCap;
+   Server_Probe* Probes;
+   size_t ProbeCount;
+   size_t ProbeCap;
+   Server_Conn** Touched;
+   size_t TouchedCount;
+   size_t TouchedCap;
+   char* LoadRoot;       // resolved directory loads are confined to, or NULL to refuse loads
+   Server_Conn* Conns;   // every open connection
+   size_t ConnCount;     // number of open connections
+};
+
+//Internal Helper Declarations
+int Find_Named_Set(const CSet_Server* pServer, const char* name, size_t len);
+bool Accept_Connections(CSet_Server* pServer);
+void Read_Connection(CSet_Server* pServer, Server_Conn* pConn);
+bool Handle_Request(CSet_Server* pServer, Server_Conn* pConn, const uint8_t* frame);
+bool Handle_Set_Op(Server_Conn* pConn, uint32_t id, uint8_t op, const CSet* pA, const CSet* pB);
+bool Handle_Load(CSet_Server* pServer, Server_Conn* pConn, uint32_t id,
+                 const char* name, size_t nameLen, const char* path, size_t pathLen);
+char* Resolve_Load_Path(const CSet_Server* pServer, const char* path, size_t pathLen);
+bool Reserve_Reply(Server_Conn* pConn, uint32_t id, uint8_t status, uint32_t len, size_t* pOffset);
+bool Queue_Probe(CSet_Server* pServer, Server_Conn* pConn, uint32_t setIndex, int32_t val, size_t offset);
+void Run_Probes(CSet_Server* pServer);
+int Compare_Probes(const void* a, const void* b);
+void Touch_Connection(CSet_Server* pServer, Server_Conn* pConn);
+void Flush_Connection(CSet_Server* pServer, Server_Conn* pConn);
+void Close_Connection(CSet_Server* pServer, Server_Conn* pConn);
+void Close_All_Connections(CSet_Server* pServer);
+bool Server_Grow_Buffer(uint8_t** buf, size_t* cap, size_t need);
+bool Server_Write_All(int fd, const void* buf, size_t len);
+bool Server_Read_All(int fd, void* buf, size_t len);
+void Server_Put_U32(uint8_t* p, uint32_t val);
+uint32_t Server_Get_U32(const uint8_t* p);
+
+/**
+ * Creates a server listening on a Unix domain socket at Path. Any stale
+ * socket file at Path is removed first.
+ *
+ * Pre:
+ *    Path is shorter than the platform limit for socket paths
+ * Returns:
+ *    a new server with no sets, or NULL on failure
+ */
+CSet_Server* CSet_Server_Create(const char* const Path){
+	CSet_Server* pServer = (CSet_Server*) calloc(1, sizeof(CSet_Server));
+	if(!pServer){
+		return NULL;
+	}
+	pServer->ListenFd = -1;
+	pServer->EpollFd = -1;
+	pServer->WakeFds[0] = pServer->WakeFds[1] = -1;
+	if(strlen(Path) >= sizeof(pServer->Path)){
+		free(pServer);
+		return NULL;
+	}
+	strcpy(pServer->Path, Path);
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, Path);
+	unlink(Path);
+	pServer->ListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	pServer->EpollFd = epoll_create1(EPOLL_CLOEXEC);
+	if(pServer->ListenFd < 0 || pServer->EpollFd < 0 ||
+		pipe2(pServer->WakeFds, O_NONBLOCK | O_CLOEXEC) != 0 ||
+		bind(pServer->ListenFd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ||
+		listen(pServer->ListenFd, SOMAXCONN) != 0){
+		CSet_Server_Destroy(pServer);
+		return NULL;
+	}
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = &pServer->ListenFd;
+	if(epoll_ctl(pServer->EpollFd, EPOLL_CTL_ADD, pServer->ListenFd, &ev) != 0){
+		CSet_Server_Destroy(pServer);
+		return NULL;
+	}
+	ev.data.ptr = &pServer->WakeFds[0];
+	if(epoll_ctl(pServer->EpollFd, EPOLL_CTL_ADD, pServer->WakeFds[0], &ev) != 0){
+		CSet_Server_Destroy(pServer);
+		return NULL;
+	}
+	return pServer;
+};
+
+/**
+ * Publishes *pSet under Name, replacing any set already published under
+ * that name. The server takes over the elements of *pSet with CSet_Move
+ * and attaches a summary to them so that missing probes are cheap. Any
+ * observers stay attached to *pSet.
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ *    Name is at most CSET_SERVER_NAME_MAX characters
+ *    CSet_Server_Run is not executing on another thread
+ * Post:
+ *    If successful:
+ *       the elements of *pSet are served under Name
+ *       *pSet is empty
+ *    else:
+ *       *pSet is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_Server_Publish(CSet_Server* const pServer, const char* const Name, CSet* const pSet){
+	size_t len = strlen(Name);
+	if(len == 0 || len > CSET_SERVER_NAME_MAX){
+		return false;
+	}
+	int index = Find_Named_Set(pServer, Name, len);
+	if(index < 0){
+		if(pServer->SetCount == pServer->SetCap){
+			uint32_t cap = pServer->SetCap ? pServer->SetCap * 2 : DEFAULT_SERVER_CAPACITY;
+			Named_Set* newSets = (Named_Set*) realloc(pServer->Sets, sizeof(Named_Set) * cap);
+			if(!newSets){
+				return false;
+			}
+			pServer->Sets = newSets;
+			pServer->SetCap = cap;
+		}
+		index = (int) pServer->SetCount++;
+		memcpy(pServer->Sets[index].Name, Name, len + 1);
+		CSet_Init(&pServer->Sets[index].Set, 0);
+	}
+
+	// Observers stay attached to the caller's set, which is told of its reset
+	CSet_Move(&pServer->Sets[index].Set, pSet);
+	if(!CSet_isEmpty(&pServer->Sets[index].Set)){
+		CSet_BuildSummary(&pServer->Sets[index].Set);
+	}
+	return true;
+};
+
+/**
+ * Lets clients load text files with CSET_OP_LOAD, confined to the
+ * directory Root. Loads are refused (CSET_STATUS_DENIED) until this is
+ * called. A load reads the whole file on the event loop thread, stalling
+ * every other client meanwhile.
+ *
+ * Pre:
+ *    Root names a directory, or is NULL to refuse loads again
+ *    CSet_Server_Run is not executing on another thread
+ * Post:
+ *    If successful, CSET_OP_LOAD accepts relative paths without ".."
+ *    components that resolve inside Root; otherwise loads are refused
+ * Returns:
+ *    true if successful, false if Root is not a directory or memory ran out
+ */
+bool CSet_Server_AllowLoads(CSet_Server* const pServer, const char* const Root){
+	free(pServer->LoadRoot);
+	pServer->LoadRoot = NULL;
+	if(Root == NULL){
+		return true;
+	}
+	char* resolved = realpath(Root, NULL);
+	struct stat st;
+	if(!resolved || stat(resolved, &st) != 0 || !S_ISDIR(st.st_mode)){
+		free(resolved);
+		return false;
+	}
+	pServer->LoadRoot = resolved;
+	return true;
+};
+
+/**
+ * Serves requests until CSet_Server_Stop is called.
+ *
+ * Pre:
+ *    pServer was returned by CSet_Server_Create
+ * Post:
+ *    every client connection has been closed
+ * Returns:
+ *    true if stopped by CSet_Server_Stop, false on an unrecoverable error
+ */
+bool CSet_Server_Run(CSet_Server* const pServer){
+	struct epoll_event events[SERVER_MAX_EVENTS];
+	bool running = true, success = true;
+	while(running){
+		int n = epoll_wait(pServer->EpollFd, events, SERVER_MAX_EVENTS, -1);
+		if(n < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			success = false;
+			break;
+		}
+		int e = 0;
+		while(e < n){
+			void* ptr = events[e].data.ptr;
+			if(ptr == &pServer->ListenFd){
+				Accept_Connections(pServer);
+			}
+			else if(ptr == &pServer->WakeFds[0]){
+				char drain[16];
+				while(read(pServer->WakeFds[0], drain, sizeof(drain)) > 0){
+				}
+				running = false;
+			}
+			else{
+				Server_Conn* pConn = (Server_Conn*) ptr;
+				if(events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)){
+					Read_Connection(pServer, pConn);
+				}
+				if(events[e].events & EPOLLOUT){
+					Touch_Connection(pServer, pConn);
+				}
+			}
+			e++;
+		}
+		Run_Probes(pServer);
+		size_t t = 0;
+		while(t < pServer->TouchedCount){
+			Server_Conn* pConn = pServer->Touched[t];
+			pConn->Touched = false;
+			if(!pConn->Dead){
+				Flush_Connection(pServer, pConn);
+			}
+			if(pConn->Dead){
+				Close_Connection(pServer, pConn);
+			}
+			t++;
+		}
+		pServer->TouchedCount = 0;
+	}
+	Close_All_Connections(pServer);
+	return success;
+};
+
+/**
+ * Asks a running server to return from CSet_Server_Run. Safe to call from
+ * another thread or from a signal handler.
+ */
+void CSet_Server_Stop(CSet_Server* const pServer){
+	char byte = 0;
+	ssize_t ignored = write(pServer->WakeFds[1], &byte, 1);
+	(void) ignored;
+};
+
+/**
+ * Closes the socket and any connection still open, removes the socket
+ * file and frees every published set.
+ *
+ * Pre:
+ *    CSet_Server_Run is not executing
+ */
+void CSet_Server_Destroy(CSet_Server* const pServer){
+	if(!pServer){
+		return;
+	}
+	if(pServer->ListenFd >= 0){
+		close(pServer->ListenFd);
+		unlink(pServer->Path);
+	}
+	if(pServer->EpollFd >= 0){
+		close(pServer->EpollFd);
+	}
+	Close_All_Connections(pServer);
+	if(pServer->WakeFds[0] >= 0){
+		close(pServer->WakeFds[0]);
+		close(pServer->WakeFds[1]);
+	}
+	uint32_t i = 0;
+	while(i < pServer->SetCount){
+		CSet_makeEmpty(&pServer->Sets[i].Set);
+		i++;
+	}
+	free(pServer->Sets);
+	free(pServer->Probes);
+	free(pServer->Touched);
+	free(pServer->LoadRoot);
+	free(pServer);
+};
+
+/**
+ * Connects to a server.
+ *
+ * Returns:
+ *    a blocking socket descriptor, or -1 on failure
+ */
+int CSet_Client_Connect(const char* const Path){
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(strlen(Path) >= sizeof(addr.sun_path)){
+		return -1;
+	}
+	strcpy(addr.sun_path, Path);
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(fd < 0){
+		return -1;
+	}
+	if(connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0){
+		close(fd);
+		return -1;
+	}
+	return fd;
+};
+
+/**
+ * Sends one request and waits for its reply.
+ *
+ * Pre:
+ *    Fd was returned by CSet_Client_Connect
+ *    NameB is NULL for single-set operations
+ * Post:
+ *    If the reply status is CSET_STATUS_OK, *pReply points to a malloc'd
+ *    copy of the reply payload (NULL if empty) of *pRSz bytes, which the
+ *    caller must free
+ * Returns:
+ *    the reply status, or -1 on an I/O error
+ */
+int CSet_Client_Request(int Fd, uint8_t Op, const char* const NameA, const char* const NameB,
+                        const void* const Payload, uint32_t PSz, void** pReply, uint32_t* pRSz){
+	size_t lenA = strlen(NameA);
+	size_t lenB = NameB ? strlen(NameB) : 0;
+	if(lenA > CSET_SERVER_NAME_MAX || lenB > CSET_SERVER_NAME_MAX){
+		return CSET_STATUS_BAD_REQUEST;
+	}
+	uint8_t header[SERVER_HEADER_SIZE];
+	Server_Put_U32(header, (uint32_t)(lenA + lenB + PSz));
+	Server_Put_U32(header + 4, 0);
+	header[8] = Op;
+	header[9] = (uint8_t) lenA;
+	header[10] = (uint8_t) lenB;
+	header[11] = 0;
+	if(!Server_Write_All(Fd, header, sizeof(header)) || !Server_Write_All(Fd, NameA, lenA) ||
+		!Server_Write_All(Fd, NameB, lenB) || !Server_Write_All(Fd, Payload, PSz)){
+		return -1;
+	}
+	if(!Server_Read_All(Fd, header, sizeof(header))){
+		return -1;
+	}
+	uint32_t len = Server_Get_U32(header);
+	void* reply = NULL;
+	if(len > 0){
+		reply = malloc(len);
+		if(!reply || !Server_Read_All(Fd, reply, len)){
+			free(reply);
+			return -1;
+		}
+	}
+	if(header[8] != CSET_STATUS_OK){
+		free(reply);
+		return header[8];
+	}
+	*pReply = reply;
+	*pRSz = len;
+	return CSET_STATUS_OK;
+};
+
+/**
+ * Asks the server whether Value belongs to the set published as Name.
+ *
+ * Returns:
+ *    the reply status, or -1 on an I/O error; *pResult is set on success
+ */
+int CSet_Client_Contains(int Fd, const char* const Name, int32_t Value, bool* pResult){
+	void* reply = NULL;
+	uint32_t len = 0;
+	int status = CSet_Client_Request(Fd, CSET_OP_CONTAINS, Name, NULL, &Value, sizeof(Value), &reply, &len);
+	if(status == CSET_STATUS_OK){
+		*pResult = (len == 1 && ((uint8_t*) reply)[0] != 0);
+	}
+	free(reply);
+	return status;
+};
+
+/**
+ * Asks the server which of Values[0:VSz-1] belong to the set published as
+ * Name. Results[i] receives the answer for Values[i].
+ *
+ * Returns:
+ *    the reply status, or -1 on an I/O error
+ */
+int CSet_Client_ContainsMany(int Fd, const char* const Name, const int32_t* const Values,
+                             uint32_t VSz, bool* const Results){
+	void* reply = NULL;
+	uint32_t len = 0;
+	int status = CSet_Client_Request(Fd, CSET_OP_CONTAINS_MANY, Name, NULL, Values,
+	                                 VSz * sizeof(int32_t), &reply, &len);
+	if(status == CSET_STATUS_OK){
+		if(len != VSz){
+			free(reply);
+			return CSET_STATUS_FAILED;
+		}
+		uint32_t i = 0;
+		while(i < VSz){
+			Results[i] = ((uint8_t*) reply)[i] != 0;
+			i++;
+		}
+	}
+	free(reply);
+	return status;
+};
+
+/**
+ * Asks the server for the number of elements of the set published as Name.
+ *
+ * Returns:
+ *    the reply status, or -1 on an I/O error; *pSize is set on success
+ */
+int CSet_Client_Size(int Fd, const char* const Name, uint32_t* pSize){
+	void* reply = NULL;
+	uint32_t len = 0;
+	int status = CSet_Client_Request(Fd, CSET_OP_SIZE, Name, NULL, NULL, 0, &reply, &len);
+	if(status == CSET_STATUS_OK){
+		if(len != sizeof(uint32_t)){
+			free(reply);
+			return CSET_STATUS_FAILED;
+		}
+		*pSize = Server_Get_U32((uint8_t*) reply);
+	}
+	free(reply);
+	return status;
+};
+
+/**
+ * Asks the server for the union, intersection or difference of two
+ * published sets and loads the elements into *pResult.
+ *
+ * Pre:
+ *    Op is CSET_OP_UNION, CSET_OP_INTERSECTION or CSET_OP_DIFFERENCE
+ *    *pResult satisfies the CSet contract
+ * Returns:
+ *    the reply status, or -1 on an I/O error
+ */
+int CSet_Client_SetOp(int Fd, uint8_t Op, const char* const NameA, const char* const NameB,
+                      CSet* const pResult){
+	void* reply = NULL;
+	uint32_t len = 0;
+	int status = CSet_Client_Request(Fd, Op, NameA, NameB, NULL, 0, &reply, &len);
+	if(status == CSET_STATUS_OK){
+		uint32_t count = (len >= sizeof(uint32_t)) ? Server_Get_U32((uint8_t*) reply) : 0;
+		if(len < sizeof(uint32_t) || len != sizeof(uint32_t) + count * sizeof(int32_t)){
+			status = CSET_STATUS_FAILED;
+		}
+		else{
+			int32_t* values = (int32_t*) malloc(sizeof(int32_t) * (count > 0 ? count : 1));
+			if(!values){
+				status = CSET_STATUS_FAILED;
+			}
+			else{
+				memcpy(values, (uint8_t*) reply + sizeof(uint32_t), sizeof(int32_t) * count);
+				uint32_t capacity = count < DEFAULT_SERVER_CAPACITY ? DEFAULT_SERVER_CAPACITY : count + 1;
+				if(!CSet_Load(pResult, capacity, values, count)){
+					status = CSET_STATUS_FAILED;
+				}
+				free(values);
+			}
+		}
+	}
+	free(reply);
+	return status;
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Looks up a published set by name
+ * @param  pServer the server
+ * @param  name    the name, not necessarily terminated
+ * @param  len     the length of name
+ * @return int the index of the set in pServer->Sets, or -1
+ */
+int Find_Named_Set(const CSet_Server* pServer, const char* name, size_t len){
+	uint32_t i = 0;
+	while(i < pServer->SetCount){
+		if(strncmp(pServer->Sets[i].Name, name, len) == 0 && pServer->Sets[i].Name[len] == '\0'){
+			return (int) i;
+		}
+		i++;
+	}
+	return -1;
+};
+
+/**
+ * Accepts every pending connection, registers it with epoll and links it
+ * into Conns. Touched is grown to hold every open connection, so marking
+ * one for flushing can never fail.
+ * @param  pServer the server
+ * @return bool false if a connection could not be set up
+ */
+bool Accept_Connections(CSet_Server* pServer){
+	while(true){
+		int fd = accept4(pServer->ListenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if(fd < 0){
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		if(pServer->ConnCount == pServer->TouchedCap){
+			size_t cap = pServer->TouchedCap ? pServer->TouchedCap * 2 : SERVER_MAX_EVENTS;
+			Server_Conn** newTouched = (Server_Conn**) realloc(pServer->Touched, sizeof(Server_Conn*) * cap);
+			if(!newTouched){
+				close(fd);
+				return false;
+			}
+			pServer->Touched = newTouched;
+			pServer->TouchedCap = cap;
+		}
+		Server_Conn* pConn = (Server_Conn*) calloc(1, sizeof(Server_Conn));
+		if(!pConn){
+			close(fd);
+			return false;
+		}
+		pConn->Fd = fd;
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = pConn;
+		if(epoll_ctl(pServer->EpollFd, EPOLL_CTL_ADD, fd, &ev) != 0){
+			close(fd);
+			free(pConn);
+			return false;
+		}
+		pConn->Next = pServer->Conns;
+		if(pServer->Conns){
+			pServer->Conns->Prev = pConn;
+		}
+		pServer->Conns = pConn;
+		pServer->ConnCount++;
+	}
+};
+
+/**
+ * Reads everything available on a connection and handles each complete
+ * request in it. Leftover bytes of a partial request are kept for later.
+ * @param pServer the server
+ * @param pConn   the readable connection
+ */
+void Read_Connection(CSet_Server* pServer, Server_Conn* pConn){
+	while(!pConn->Dead){
+		if(!Server_Grow_Buffer(&pConn->In, &pConn->InCap, pConn->InLen + SERVER_READ_CHUNK)){
+			pConn->Dead = true;
+			break;
+		}
+		ssize_t got = read(pConn->Fd, pConn->In + pConn->InLen, SERVER_READ_CHUNK);
+		if(got > 0){
+			pConn->InLen += (size_t) got;
+		}
+		else if(got < 0 && errno == EINTR){
+			continue;
+		}
+		else{
+			if(got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)){
+				pConn->Dead = true;
+			}
+			break;
+		}
+	}
+	size_t pos = 0;
+	while(!pConn->Dead && pConn->InLen - pos >= SERVER_HEADER_SIZE){
+		uint32_t len = Server_Get_U32(pConn->In + pos);
+		if(len > SERVER_MAX_REQUEST){
+			pConn->Dead = true;
+			break;
+		}
+		if(pConn->InLen - pos - SERVER_HEADER_SIZE < len){
+			break;
+		}
+		if(!Handle_Request(pServer, pConn, pConn->In + pos)){
+			pConn->Dead = true;
+		}
+		pos += SERVER_HEADER_SIZE + len;
+	}
+	memmove(pConn->In, pConn->In + pos, pConn->InLen - pos);
+	pConn->InLen -= pos;
+	Touch_Connection(pServer, pConn);
+};
+
+/**
+ * Decodes one complete request and appends its reply to pConn->Out.
+ * Membership probes only reserve their reply bytes; Run_Probes fills them.
+ * @param  pServer the server
+ * @param  pConn   the connection the request arrived on
+ * @param  frame   the request header, followed by its payload
+ * @return bool false if the connection should be dropped
+ */
+bool Handle_Request(CSet_Server* pServer, Server_Conn* pConn, const uint8_t* frame){
+	uint32_t len = Server_Get_U32(frame);
+	uint32_t id = Server_Get_U32(frame + 4);
+	uint8_t op = frame[8];
+	size_t lenA = frame[9], lenB = frame[10];
+	const char* nameA = (const char*)(frame + SERVER_HEADER_SIZE);
+	const char* nameB = nameA + lenA;
+	const uint8_t* payload = (const uint8_t*)(nameB + lenB);
+	if(lenA + lenB > len){
+		return Reserve_Reply(pConn, id, CSET_STATUS_BAD_REQUEST, 0, NULL);
+	}
+	uint32_t psz = len - (uint32_t)(lenA + lenB);
+	if(op == CSET_OP_LOAD){
+		return Handle_Load(pServer, pConn, id, nameA, lenA, (const char*) payload, psz);
+	}
+	int a = Find_Named_Set(pServer, nameA, lenA);
+	int b = (lenB > 0) ? Find_Named_Set(pServer, nameB, lenB) : -1;
+	if(a < 0 || (lenB > 0 && b < 0)){
+		return Reserve_Reply(pConn, id, CSET_STATUS_NO_SUCH_SET, 0, NULL);
+	}
+	const CSet* pA = &pServer->Sets[a].Set;
+	size_t offset;
+	switch(op){
+		case CSET_OP_CONTAINS:
+		case CSET_OP_CONTAINS_MANY:{
+			uint32_t count = psz / sizeof(int32_t);
+			if(psz % sizeof(int32_t) != 0 || (op == CSET_OP_CONTAINS && count != 1)){
+				return Reserve_Reply(pConn, id, CSET_STATUS_BAD_REQUEST, 0, NULL);
+			}
+			if(!Reserve_Reply(pConn, id, CSET_STATUS_OK, count, &offset)){
+				return false;
+			}
+			uint32_t i = 0;
+			while(i < count){
+				int32_t val;
+				memcpy(&val, payload + i * sizeof(int32_t), sizeof(int32_t));
+				if(!Queue_Probe(pServer, pConn, (uint32_t) a, val, offset + i)){
+					return false;
+				}
+				i++;
+			}
+			return true;
+		}
+		case CSET_OP_SIZE:
+			if(!Reserve_Reply(pConn, id, CSET_STATUS_OK, sizeof(uint32_t), &offset)){
+				return false;
+			}
+			Server_Put_U32(pConn->Out + offset, CSet_Size(pA));
+			return true;
+		case CSET_OP_UNION:
+		case CSET_OP_INTERSECTION:
+		case CSET_OP_DIFFERENCE:
+		case CSET_OP_INTERSECTS:
+			if(b < 0){
+				return Reserve_Reply(pConn, id, CSET_STATUS_BAD_REQUEST, 0, NULL);
+			}
+			return Handle_Set_Op(pConn, id, op, pA, &pServer->Sets[b].Set);
+		default:
+			return Reserve_Reply(pConn, id, CSET_STATUS_BAD_REQUEST, 0, NULL);
+	}
+};
+
+/**
+ * Computes a binary set operation and appends its elements as the reply
+ * @param  pConn   the requesting connection
+ * @param  id      the request id
+ * @param  op      the set operation
+ * @param  pA      the first operand
+ * @param  pB      the second operand
+ * @return bool false if the reply could not be buffered
+ */
+bool Handle_Set_Op(Server_Conn* pConn, uint32_t id, uint8_t op, const CSet* pA, const CSet* pB){
+	size_t offset;
+	if(op == CSET_OP_INTERSECTS){
+		if(!Reserve_Reply(pConn, id, CSET_STATUS_OK, 1, &offset)){
+			return false;
+		}
+		pConn->Out[offset] = CSet_Intersects(pA, pB) ? 1 : 0;
+		return true;
+	}
+	// The set operations reject empty operands, whose results are trivial.
+	CSet result;
+	CSet_Init(&result, 0);
+	const CSet* pReply = &result;
+	bool success = true;
+	if(op == CSET_OP_UNION){
+		if(CSet_isEmpty(pA)){
+			pReply = pB;
+		}
+		else if(CSet_isEmpty(pB)){
+			pReply = pA;
+		}
+		else{
+			success = CSet_Union(&result, pA, pB);
+		}
+	}
+	else if(op == CSET_OP_INTERSECTION){
+		if(!CSet_isEmpty(pA) && !CSet_isEmpty(pB)){
+			success = CSet_Intersection(&result, pA, pB);
+		}
+	}
+	else if(!CSet_isEmpty(pA)){
+		success = CSet_isEmpty(pB) ? CSet_Copy(&result, pA) : CSet_Difference(&result, pA, pB);
+	}
+	uint32_t count = CSet_Size(pReply);
+	if(!success){
+		CSet_makeEmpty(&result);
+		return Reserve_Reply(pConn, id, CSET_STATUS_FAILED, 0, NULL);
+	}
+	if(!Reserve_Reply(pConn, id, CSET_STATUS_OK, sizeof(uint32_t) + count * sizeof(int32_t), &offset)){
+		CSet_makeEmpty(&result);
+		return false;
+	}
+	Server_Put_U32(pConn->Out + offset, count);
+	if(count > 0){
+		memcpy(pConn->Out + offset + sizeof(uint32_t), pReply->Data, count * sizeof(int32_t));
+	}
+	CSet_makeEmpty(&result);
+	return true;
+};
+
+/**
+ * Loads a text file of integers with CSet_IngestText and publishes it under
+ * the given name. The path must resolve inside the load root. The event
+ * loop is blocked while the file is read.
+ * @return bool false if the reply could not be buffered
+ */
+bool Handle_Load(CSet_Server* pServer, Server_Conn* pConn, uint32_t id,
+                 const char* name, size_t nameLen, const char* path, size_t pathLen){
+	if(nameLen == 0){
+		return Reserve_Reply(pConn, id, CSET_STATUS_BAD_REQUEST, 0, NULL);
+	}
+	char* resolved = Resolve_Load_Path(pServer, path, pathLen);
+	if(!resolved){
+		return Reserve_Reply(pConn, id, CSET_STATUS_DENIED, 0, NULL);
+	}
+	char nameZ[CSET_SERVER_NAME_MAX + 1];
+	memcpy(nameZ, name, nameLen);
+	nameZ[nameLen] = '\0';
+	CSet loaded;
+	CSet_Init(&loaded, 0);
+	bool success = CSet_IngestText(&loaded, resolved, 0);
+	free(resolved);
+	uint32_t size = CSet_Size(&loaded);
+	if(!success || !CSet_Server_Publish(pServer, nameZ, &loaded)){
+		CSet_makeEmpty(&loaded);
+		return Reserve_Reply(pConn, id, CSET_STATUS_FAILED, 0, NULL);
+	}
+	size_t offset;
+	if(!Reserve_Reply(pConn, id, CSET_STATUS_OK, sizeof(uint32_t), &offset)){
+		return false;
+	}
+	Server_Put_U32(pConn->Out + offset, size);
+	return true;
+};
+
+/**
+ * Resolves a load path against the load root. The path must be nonempty,
+ * relative, free of NUL bytes and ".." components, name an existing file,
+ * and resolve inside the root once symbolic links are followed.
+ * @param  pServer the server
+ * @param  path    the requested path, not NUL-terminated
+ * @param  pathLen the length of path
+ * @return char* the malloc'd resolved path, or NULL if loads are refused,
+ *               the path is not allowed or memory ran out
+ */
+char* Resolve_Load_Path(const CSet_Server* pServer, const char* path, size_t pathLen){
+	if(!pServer->LoadRoot || pathLen == 0 || path[0] == '/' || memchr(path, '\0', pathLen)){
+		return NULL;
+	}
+	size_t i = 0;
+	while(i < pathLen){
+		size_t end = i;
+		while(end < pathLen && path[end] != '/'){
+			end++;
+		}
+		if(end - i == 2 && path[i] == '.' && path[i + 1] == '.'){
+			return NULL;
+		}
+		i = end + 1;
+	}
+	size_t rootLen = strlen(pServer->LoadRoot);
+	char* joined = (char*) malloc(rootLen + pathLen + 2);
+	if(!joined){
+		return NULL;
+	}
+	memcpy(joined, pServer->LoadRoot, rootLen);
+	joined[rootLen] = '/';
+	memcpy(joined + rootLen + 1, path, pathLen);
+	joined[rootLen + pathLen + 1] = '\0';
+	char* resolved = realpath(joined, NULL);
+	free(joined);
+	bool inside = resolved && strncmp(resolved, pServer->LoadRoot, rootLen) == 0 &&
+		(resolved[rootLen] == '/' || (rootLen == 1 && resolved[1] != '\0'));
+	if(!inside){
+		free(resolved);
+		return NULL;
+	}
+	return resolved;
+};
+
+/**
+ * Appends a reply header and len zeroed payload bytes to pConn->Out
+ * @param  pConn   the connection to reply on
+ * @param  id      the request id
+ * @param  status  the reply status
+ * @param  len     the payload length
+ * @param  pOffset receives the offset of the payload in pConn->Out, may be NULL
+ * @return bool whether or not the allocation was successful
+ */
+bool Reserve_Reply(Server_Conn* pConn, uint32_t id, uint8_t status, uint32_t len, size_t* pOffset){
+	if(!Server_Grow_Buffer(&pConn->Out, &pConn->OutCap, pConn->OutLen + SERVER_HEADER_SIZE + len)){
+		return false;
+	}
+	uint8_t* p = pConn->Out + pConn->OutLen;
+	memset(p, 0, SERVER_HEADER_SIZE + len);
+	Server_Put_U32(p, len);
+	Server_Put_U32(p + 4, id);
+	p[8] = status;
+	if(pOffset){
+		*pOffset = pConn->OutLen + SERVER_HEADER_SIZE;
+	}
+	pConn->OutLen += SERVER_HEADER_SIZE + len;
+	return true;
+};
+
+/**
+ * Adds a membership probe to the current batch
+ * @return bool whether or not the allocation was successful
+ */
+bool Queue_Probe(CSet_Server* pServer, Server_Conn* pConn, uint32_t setIndex, int32_t val, size_t offset){
+	if(pServer->ProbeCount == pServer->ProbeCap){
+		size_t cap = pServer->ProbeCap ? pServer->ProbeCap * 2 : SERVER_MAX_EVENTS;
+		Server_Probe* newProbes = (Server_Probe*) realloc(pServer->Probes, sizeof(Server_Probe) * cap);
+		if(!newProbes){
+			return false;
+		}
+		pServer->Probes = newProbes;
+		pServer->ProbeCap = cap;
+	}
+	Server_Probe* pProbe = &pServer->Probes[pServer->ProbeCount++];
+	pProbe->Value = val;
+	pProbe->SetIndex = setIndex;
+	pProbe->pConn = pConn;
+	pProbe->Offset = offset;
+	return true;
+};
+
+/**
+ * Answers every queued probe. Probes are sorted by set and value; a set
+ * that receives many probes is walked once from front to back, and a set
+ * that receives few is searched per probe.
+ * @param pServer the server
+ */
+void Run_Probes(CSet_Server* pServer){
+	if(pServer->ProbeCount == 0){
+		return;
+	}
+	qsort(pServer->Probes, pServer->ProbeCount, sizeof(Server_Probe), Compare_Probes);
+	size_t first = 0;
+	while(first < pServer->ProbeCount){
+		uint32_t setIndex = pServer->Probes[first].SetIndex;
+		const CSet* pSet = &pServer->Sets[setIndex].Set;
+		size_t last = first;
+		while(last < pServer->ProbeCount && pServer->Probes[last].SetIndex == setIndex){
+			last++;
+		}
+		bool merge = !CSet_isEmpty(pSet) &&
+			(uint64_t)(last - first) * SERVER_MERGE_RATIO >= pSet->Usage;
+		uint32_t cursor = 0;
+		size_t p = first;
+		while(p < last){
+			Server_Probe* pProbe = &pServer->Probes[p];
+			bool found;
+			if(merge){
+				while(cursor < pSet->Usage && pSet->Data[cursor] < pProbe->Value){
+					cursor++;
+				}
+				found = cursor < pSet->Usage && pSet->Data[cursor] == pProbe->Value;
+			}
+			else{
+				found = CSet_Contains(pSet, pProbe->Value);
+			}
+			if(!pProbe->pConn->Dead){
+				pProbe->pConn->Out[pProbe->Offset] = found ? 1 : 0;
+			}
+			p++;
+		}
+		first = last;
+	}
+	pServer->ProbeCount = 0;
+};
+
+/**
+ * qsort comparator ordering probes by set, then by value
+ */
+int Compare_Probes(const void* a, const void* b){
+	const Server_Probe* x = (const Server_Probe*) a;
+	const Server_Probe* y = (const Server_Probe*) b;
+	if(x->SetIndex != y->SetIndex){
+		return x->SetIndex < y->SetIndex ? -1 : 1;
+	}
+	return (x->Value > y->Value) - (x->Value < y->Value);
+};
+
+/**
+ * Records that a connection needs flushing at the end of this wakeup.
+ * Accept_Connections reserved a Touched cell for every open connection.
+ */
+void Touch_Connection(CSet_Server* pServer, Server_Conn* pConn){
+	if(pConn->Touched){
+		return;
+	}
+	pServer->Touched[pServer->TouchedCount++] = pConn;
+	pConn->Touched = true;
+};
+
+/**
+ * Sends as much of pConn->Out as the socket accepts, and watches for
+ * writability only while unsent replies remain
+ */
+void Flush_Connection(CSet_Server* pServer, Server_Conn* pConn){
+	while(pConn->OutSent < pConn->OutLen){
+		ssize_t sent = send(pConn->Fd, pConn->Out + pConn->OutSent,
+		                    pConn->OutLen - pConn->OutSent, MSG_NOSIGNAL);
+		if(sent > 0){
+			pConn->OutSent += (size_t) sent;
+		}
+		else if(sent < 0 && errno == EINTR){
+			continue;
+		}
+		else{
+			if(sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK){
+				pConn->Dead = true;
+				return;
+			}
+			break;
+		}
+	}
+	if(pConn->OutSent == pConn->OutLen){
+		pConn->OutSent = pConn->OutLen = 0;
+	}
+	bool pending = pConn->OutLen > 0;
+	if(pending != pConn->Watching){
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = pending ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+		ev.data.ptr = pConn;
+		epoll_ctl(pServer->EpollFd, EPOLL_CTL_MOD, pConn->Fd, &ev);
+		pConn->Watching = pending;
+	}
+};
+
+/**
+ * Unregisters, closes, unlinks and frees a connection
+ */
+void Close_Connection(CSet_Server* pServer, Server_Conn* pConn){
+	if(pConn->Prev){
+		pConn->Prev->Next = pConn->Next;
+	}
+	else{
+		pServer->Conns = pConn->Next;
+	}
+	if(pConn->Next){
+		pConn->Next->Prev = pConn->Prev;
+	}
+	pServer->ConnCount--;
+	epoll_ctl(pServer->EpollFd, EPOLL_CTL_DEL, pConn->Fd, NULL);
+	close(pConn->Fd);
+	free(pConn->In);
+	free(pConn->Out);
+	free(pConn);
+};
+
+/**
+ * Closes every open connection, with any replies still unsent
+ * @param pServer the server
+ */
+void Close_All_Connections(CSet_Server* pServer){
+	while(pServer->Conns){
+		Close_Connection(pServer, pServer->Conns);
+	}
+	pServer->TouchedCount = 0;
+};
+
+/**
+ * Grows a byte buffer geometrically until it holds at least need bytes
+ * @return bool whether or not the allocation was successful
+ */
+bool Server_Grow_Buffer(uint8_t** buf, size_t* cap, size_t need){
+	if(need <= *cap){
+		return true;
+	}
+	size_t newCap = *cap ? *cap : SERVER_READ_CHUNK;
+	while(newCap < need){
+		newCap *= 2;
+	}
+	uint8_t* newBuf = (uint8_t*) realloc(*buf, newCap);
+	if(!newBuf){
+		return false;
+	}
+	*buf = newBuf;
+	*cap = newCap;
+	return true;
+};
+
+/**
+ * Writes len bytes to a blocking descriptor
+ */
+bool Server_Write_All(int fd, const void* buf, size_t len){
+	const uint8_t* p = (const uint8_t*) buf;
+	while(len > 0){
+		ssize_t sent = send(fd, p, len, MSG_NOSIGNAL);
+		if(sent < 0 && errno == EINTR){
+			continue;
+		}
+		if(sent <= 0){
+			return false;
+		}
+		p += sent;
+		len -= (size_t) sent;
+	}
+	return true;
+};
+
+/**
+ * Reads exactly len bytes from a blocking descriptor
+ */
+bool Server_Read_All(int fd, void* buf, size_t len){
+	uint8_t* p = (uint8_t*) buf;
+	while(len > 0){
+		ssize_t got = read(fd, p, len);
+		if(got < 0 && errno == EINTR){
+			continue;
+		}
+		if(got <= 0){
+			return false;
+		}
+		p += got;
+		len -= (size_t) got;
+	}
+	return true;
+};
+
+void Server_Put_U32(uint8_t* p, uint32_t val){
+	memcpy(p, &val, sizeof(val));
+};
+
+uint32_t Server_Get_U32(const uint8_t* p){
+	uint32_t val;
+	memcpy(&val, p, sizeof(val));
+	return val;
+};
@@ -0,0 +1,56 @@
+#ifndef CSET_SERVER_H
+#define CSET_SERVER_H
+#include "CSet.h"
+
+// Operation codes of the CSetServer protocol
+#define CSET_OP_CONTAINS       1   // payload: int32_t value        reply: uint8_t
+#define CSET_OP_CONTAINS_MANY  2   // payload: int32_t values[n]    reply: uint8_t[n]
+#define CSET_OP_SIZE           3   // payload: none                 reply: uint32_t
+#define CSET_OP_UNION          4   // payload: none (two names)     reply: uint32_t n, int32_t[n]
+#define CSET_OP_INTERSECTION   5   // payload: none (two names)     reply: uint32_t n, int32_t[n]
+#define CSET_OP_DIFFERENCE     6   // payload: none (two names)     reply: uint32_t n, int32_t[n]
+#define CSET_OP_INTERSECTS     7   // payload: none (two names)     reply: uint8_t
+#define CSET_OP_LOAD           8   // payload: path of a text file  reply: uint32_t size
+                                   // (relative to the root set by CSet_Server_AllowLoads)
+
+// Reply status codes
+#define CSET_STATUS_OK          0
+#define CSET_STATUS_NO_SUCH_SET 1
+#define CSET_STATUS_BAD_REQUEST 2
+#define CSET_STATUS_FAILED      3
+#define CSET_STATUS_DENIED      4
+
+#define CSET_SERVER_NAME_MAX 255
+
+struct _CSet_Server;
+
+typedef struct _CSet_Server CSet_Server;
+
+CSet_Server* CSet_Server_Create(const char* const Path);
+
+bool CSet_Server_Publish(CSet_Server* const pServer, const char* const Name, CSet* const pSet);
+
+bool CSet_Server_AllowLoads(CSet_Server* const pServer, const char* const Root);
+
+bool CSet_Server_Run(CSet_Server* const pServer);
+
+void CSet_Server_Stop(CSet_Server* const pServer);
+
+void CSet_Server_Destroy(CSet_Server* const pServer);
+
+int CSet_Client_Connect(const char* const Path);
+
+int CSet_Client_Request(int Fd, uint8_t Op, const char* const NameA, const char* const NameB,
+                        const void* const Payload, uint32_t PSz, void** pReply, uint32_t* pRSz);
+
+int CSet_Client_Contains(int Fd, const char* const Name, int32_t Value, bool* pResult);
+
+int CSet_Client_ContainsMany(int Fd, const char* const Name, const int32_t* const Values,
+                             uint32_t VSz, bool* const Results);
+
+int CSet_Client_Size(int Fd, const char* const Name, uint32_t* pSize);
+
+int CSet_Client_SetOp(int Fd, uint8_t Op, const char* const NameA, const char* const NameB,
+                      CSet* const pResult);
+
+#endif
@@ -0,0 +1,518 @@
+#define _GNU_SOURCE
+#include "CSetShared.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// CSetShared lets separate processes use one copy of a collection of sets
+// that lives in a POSIX shared-memory segment (shm_open by name, or an
+// anonymous memfd whose descriptor is inherited or passed along).
+//
+// The segment begins with a header, followed by an area holding published
+// versions. A version is a directory of Count entries (offset, length and
+// hash of each set) followed by the sorted elements of every set, each set
+// followed by one INT32_MAX cell, so the elements plus that cell form a
+// valid CSet Data array, as in a CSet_Store. Everything in the segment is
+// addressed by its offset from the start of the segment, never by pointer,
+// so each process may map it at a different address.
+//
+// A single writer creates the segment and publishes versions with
+// CSet_Shared_Publish: it copies the sets into free space, then makes the
+// new version current with one atomic store of its offset in the header.
+// Readers attach with CSet_Shared_Attach, which maps the segment read-only
+// (plus the header writable, for the reader's slot), and pin a version with
+// CSet_Shared_Pin. CSet_Shared_View then yields a CSET_FLAG_READONLY CSet
+// whose Data points straight into the mapping, usable with every const
+// operation in CSet.h. The views stay valid until the reader unpins, even
+// while newer versions are published.
+//
+// Versions are kept in the area as a ring, oldest first. Each process that
+// maps the segment owns a slot in the header holding its pid and the
+// generation it has pinned. Before publishing, the writer drops the oldest
+// versions that are not current and not pinned by any slot; a version that
+// is still pinned holds back every newer one, and Publish fails if there is
+// not enough space left. A reader pins by storing the generation of the
+// current version in its slot and then checking that it is still current,
+// while the writer stores the new current offset before it scans the
+// slots. With both sides sequentially consistent, a version the writer
+// finds unpinned can no longer be pinned by a reader. Slots whose process
+// has exited are reclaimed, so a crashed reader does not pin a version
+// forever.
+
+//Global Declaration
+#define SHARED_MAGIC 0x4D485343u        // "CSHM" in little-endian byte order
+#define SHARED_DATA_START ((uint64_t) 1 << 16) // header area, a multiple of any page size
+#define SHARED_ALIGN 64
+
+struct _Shared_Slot {
+
+   uint32_t Pid;         // process owning the slot, 0 if free
+   uint32_t Unused;
+   uint64_t Generation;  // generation pinned by the owner, 0 if none
+};
+
+typedef struct _Shared_Slot Shared_Slot;
+
+struct _Shared_Header {
+
+   uint32_t Magic;       // SHARED_MAGIC once the segment is initialized
+   uint32_t Versions;    // number of versions kept in the ring
+   uint64_t Size;        // bytes of the segment
+   uint64_t Current;     // offset of the current version, 0 before the first publish
+   uint64_t NextGeneration; // generation of the next version published
+   uint64_t Head;        // offset just past the newest version
+   uint64_t Tail;        // offset of the oldest version kept
+   uint64_t Newest;      // offset of the newest version
+   Shared_Slot Slots[CSET_SHARED_MAX_READERS];
+};
+
+typedef struct _Shared_Header Shared_Header;
+
+struct _Shared_Version {
+
+   uint64_t Generation;  // generation of the version
+   uint64_t Next;        // offset of the next newer version, 0 if none yet
+   uint64_t Bytes;       // bytes taken by the version
+   uint32_t Count;       // number of sets
+   uint32_t Unused;
+};
+
+typedef struct _Shared_Version Shared_Version;
+
+struct _Shared_Entry {
+
+   uint64_t Offset;      // offset of the set's first element in the segment
+   uint32_t Length;      // number of elements in the set
+   uint32_t Unused;
+   uint64_t Hash;        // CSet_Hash of the set
+};
+
+typedef struct _Shared_Entry Shared_Entry;
+
+//Internal Helper Declarations
+bool Shared_Claim_Slot(CSet_Shared* pShared);
+bool Shared_Is_Dead(uint32_t pid);
+bool Shared_Is_Pinned(Shared_Header* pHeader, uint64_t generation);
+void Shared_Reclaim(CSet_Shared* pShared);
+uint64_t Shared_Allocate(Shared_Header* pHeader, uint64_t bytes);
+
+/**
+ * Creates a shared-memory segment of Bytes bytes and maps it as its writer.
+ *
+ * Pre:
+ *    Name is a shm_open name ("/name") that does not exist yet, or NULL for
+ *    an anonymous memfd segment (readers then attach through pShared->Fd)
+ * Post:
+ *    If successful:
+ *       the segment exists and holds no version
+ *       pShared is its writer
+ *    else:
+ *       no segment was left behind
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_Shared_Create(CSet_Shared* const pShared, const char* const Name, uint64_t Bytes){
+	memset(pShared, 0, sizeof(CSet_Shared));
+	uint64_t size = (Bytes + SHARED_ALIGN - 1) / SHARED_ALIGN * SHARED_ALIGN;
+	if(size < SHARED_DATA_START * 2){
+		size = SHARED_DATA_START * 2;
+	}
+	int fd = Name ? shm_open(Name, O_CREAT | O_EXCL | O_RDWR, 0644) : memfd_create("cset", 0);
+	if(fd < 0){
+		return false;
+	}
+	void* base = MAP_FAILED;
+	if(ftruncate(fd, (off_t) size) == 0){
+		base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	if(base == MAP_FAILED){
+		close(fd);
+		if(Name){
+			shm_unlink(Name);
+		}
+		return false;
+	}
+	Shared_Header* pHeader = (Shared_Header*) base;
+	pHeader->Size = size;
+	pHeader->NextGeneration = 1;
+	pHeader->Head = SHARED_DATA_START;
+	pHeader->Tail = SHARED_DATA_START;
+	__atomic_store_n(&pHeader->Magic, SHARED_MAGIC, __ATOMIC_RELEASE);
+	pShared->Header = pHeader;
+	pShared->Base = (const uint8_t*) base;
+	pShared->Size = size;
+	pShared->Fd = fd;
+	pShared->Writer = true;
+	Shared_Claim_Slot(pShared);
+	return true;
+};
+
+/**
+ * Publishes a new version holding copies of Sets[0:Count-1], which become
+ * sets 0 to Count-1 of the version, and makes it current.
+ *
+ * Pre:
+ *    pShared is the writer of its segment
+ *    every *Sets[i] satisfies the CSet contract
+ * Post:
+ *    If successful:
+ *       the new version is current; readers see it once they pin again
+ *       versions that were neither current nor pinned may have been dropped
+ *    else:
+ *       the current version is unchanged
+ * Returns:
+ *    true if successful, false if the segment has no room for the version
+ *    (for example while an old version is still pinned)
+ */
+bool CSet_Shared_Publish(CSet_Shared* const pShared, const CSet* const* const Sets, uint32_t Count){
+	if(!pShared->Writer){
+		return false;
+	}
+	Shared_Header* pHeader = pShared->Header;
+	uint64_t bytes = sizeof(Shared_Version) + sizeof(Shared_Entry) * (uint64_t) Count;
+	uint32_t i = 0;
+	while(i < Count){
+		bytes += sizeof(int32_t) * ((uint64_t) CSet_Size(Sets[i]) + 1);
+		i++;
+	}
+	bytes = (bytes + SHARED_ALIGN - 1) / SHARED_ALIGN * SHARED_ALIGN;
+	Shared_Reclaim(pShared);
+	uint64_t offset = Shared_Allocate(pHeader, bytes);
+	if(offset == 0){
+		return false;
+	}
+	uint8_t* base = (uint8_t*) pShared->Base;
+	Shared_Version* pVersion = (Shared_Version*)(base + offset);
+	Shared_Entry* pEntries = (Shared_Entry*)(pVersion + 1);
+	pVersion->Generation = pHeader->NextGeneration++;
+	pVersion->Next = 0;
+	pVersion->Bytes = bytes;
+	pVersion->Count = Count;
+	pVersion->Unused = 0;
+	uint64_t cell = offset + sizeof(Shared_Version) + sizeof(Shared_Entry) * (uint64_t) Count;
+	i = 0;
+	while(i < Count){
+		uint32_t usage = CSet_Size(Sets[i]);
+		int32_t* pData = (int32_t*)(base + cell);
+		if(usage > 0){
+			memcpy(pData, Sets[i]->Data, sizeof(int32_t) * (size_t) usage);
+		}
+		pData[usage] = INT32_MAX;
+		pEntries[i].Offset = cell;
+		pEntries[i].Length = usage;
+		pEntries[i].Unused = 0;
+		pEntries[i].Hash = CSet_Hash(Sets[i]);
+		cell += sizeof(int32_t) * ((uint64_t) usage + 1);
+		i++;
+	}
+	if(pHeader->Versions > 0){
+		((Shared_Version*)(base + pHeader->Newest))->Next = offset;
+	}
+	else{
+		pHeader->Tail = offset;
+	}
+	pHeader->Newest = offset;
+	pHeader->Head = offset + bytes;
+	pHeader->Versions++;
+	__atomic_store_n(&pHeader->Current, offset, __ATOMIC_SEQ_CST);
+	return true;
+};
+
+/**
+ * Maps an existing segment as a reader: the sets are mapped read-only and
+ * only the header (holding the reader's slot) is writable.
+ *
+ * Pre:
+ *    Name names a segment created by CSet_Shared_Create, or is NULL and Fd
+ *    is a descriptor of one (the writer's pShared->Fd, inherited or passed)
+ * Post:
+ *    If successful, pShared is a reader with nothing pinned
+ * Returns:
+ *    true if successful, false if the segment cannot be mapped, is not
+ *    initialized, or has no free reader slot
+ */
+bool CSet_Shared_Attach(CSet_Shared* const pShared, const char* const Name, int Fd){
+	memset(pShared, 0, sizeof(CSet_Shared));
+	int fd = Name ? shm_open(Name, O_RDWR, 0) : dup(Fd);
+	struct stat info;
+	if(fd < 0){
+		return false;
+	}
+	if(fstat(fd, &info) != 0 || (uint64_t) info.st_size < SHARED_DATA_START * 2){
+		close(fd);
+		return false;
+	}
+	uint64_t size = (uint64_t) info.st_size;
+	void* header = mmap(NULL, SHARED_DATA_START, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	void* base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	pShared->Header = (Shared_Header*) header;
+	pShared->Base = (const uint8_t*) base;
+	pShared->Size = size;
+	pShared->Fd = fd;
+	if(header == MAP_FAILED || base == MAP_FAILED ||
+		__atomic_load_n(&pShared->Header->Magic, __ATOMIC_ACQUIRE) != SHARED_MAGIC ||
+		pShared->Header->Size != size || !Shared_Claim_Slot(pShared)){
+		if(header != MAP_FAILED){
+			munmap(header, SHARED_DATA_START);
+		}
+		if(base != MAP_FAILED){
+			munmap(base, size);
+		}
+		close(fd);
+		memset(pShared, 0, sizeof(CSet_Shared));
+		return false;
+	}
+	return true;
+};
+
+/**
+ * Pins the current version, releasing any version pinned before. Views of
+ * the pinned version stay valid until the next Pin, Unpin or Close.
+ *
+ * Pre:
+ *    pShared was returned by Create or Attach
+ * Post:
+ *    The current version (if any) is pinned and cannot be dropped
+ * Returns:
+ *    the generation pinned (1 for the first version published), or 0 if
+ *    nothing has been published yet
+ */
+uint64_t CSet_Shared_Pin(CSet_Shared* const pShared){
+	Shared_Header* pHeader = pShared->Header;
+	Shared_Slot* pSlot = &pHeader->Slots[pShared->Slot];
+	while(true){
+		uint64_t offset = __atomic_load_n(&pHeader->Current, __ATOMIC_SEQ_CST);
+		if(offset == 0){
+			CSet_Shared_Unpin(pShared);
+			return 0;
+		}
+		const Shared_Version* pVersion = (const Shared_Version*)(pShared->Base + offset);
+		uint64_t generation = __atomic_load_n(&pVersion->Generation, __ATOMIC_RELAXED);
+		__atomic_store_n(&pSlot->Generation, generation, __ATOMIC_SEQ_CST);
+		if(__atomic_load_n(&pHeader->Current, __ATOMIC_SEQ_CST) == offset &&
+			__atomic_load_n(&pVersion->Generation, __ATOMIC_RELAXED) == generation){
+			pShared->Pinned = offset;
+			pShared->Generation = generation;
+			return generation;
+		}
+	}
+};
+
+/**
+ * Reports the generation of the current version, so a reader can tell
+ * whether pinning again would give it a newer one.
+ *
+ * Pre:
+ *    pShared was returned by Create or Attach
+ * Returns:
+ *    the generation of the current version, or 0 if none was published
+ */
+uint64_t CSet_Shared_Latest(const CSet_Shared* const pShared){
+	uint64_t offset = __atomic_load_n(&pShared->Header->Current, __ATOMIC_SEQ_CST);
+	if(offset == 0){
+		return 0;
+	}
+	return __atomic_load_n(&((const Shared_Version*)(pShared->Base + offset))->Generation, __ATOMIC_RELAXED);
+};
+
+/**
+ * Reports the number of sets in the pinned version.
+ *
+ * Returns:
+ *    the number of sets, or 0 if nothing is pinned
+ */
+uint32_t CSet_Shared_Count(const CSet_Shared* const pShared){
+	if(pShared->Pinned == 0){
+		return 0;
+	}
+	return ((const Shared_Version*)(pShared->Base + pShared->Pinned))->Count;
+};
+
+/**
+ * Fills *pView with a read-only CSet over set Id of the pinned version,
+ * without copying it.
+ *
+ * Pre:
+ *    *pView is not attached to any storage of its own
+ * Post:
+ *    If successful:
+ *       pView->Data points into the segment and pView->Flags has
+ *       CSET_FLAG_READONLY set
+ *       pView->Usage is the size of the set, pView->Capacity == pView->Usage + 1
+ *       *pView satisfies the CSet contract until the version is unpinned
+ * Returns:
+ *    true if a version is pinned and Id names one of its sets, false otherwise
+ */
+bool CSet_Shared_View(const CSet_Shared* const pShared, uint32_t Id, CSet* const pView){
+	if(Id >= CSet_Shared_Count(pShared)){
+		return false;
+	}
+	const Shared_Entry* pEntry = (const Shared_Entry*)((const Shared_Version*)(pShared->Base + pShared->Pinned) + 1) + Id;
+	pView->Capacity = pEntry->Length + 1;
+	pView->Usage = pEntry->Length;
+	pView->Data = (int32_t*)(pShared->Base + pEntry->Offset);
+	pView->Hash = pEntry->Hash;
+	pView->Summary = NULL;
+	pView->Observers = NULL;
+	pView->Flags = CSET_FLAG_READONLY;
+	return true;
+};
+
+/**
+ * Releases the pinned version, letting the writer drop it once it is no
+ * longer current.
+ *
+ * Post:
+ *    Nothing is pinned; views of the version are invalid
+ */
+void CSet_Shared_Unpin(CSet_Shared* const pShared){
+	__atomic_store_n(&pShared->Header->Slots[pShared->Slot].Generation, 0, __ATOMIC_SEQ_CST);
+	pShared->Pinned = 0;
+	pShared->Generation = 0;
+};
+
+/**
+ * Unmaps a segment and frees the mapping's slot. The segment itself stays
+ * until CSet_Shared_Remove (or, for a memfd, the last descriptor closes).
+ *
+ * Post:
+ *    *pShared is zeroed; views of its versions are invalid
+ */
+void CSet_Shared_Close(CSet_Shared* const pShared){
+	if(pShared->Header == NULL){
+		return;
+	}
+	Shared_Slot* pSlot = &pShared->Header->Slots[pShared->Slot];
+	__atomic_store_n(&pSlot->Generation, 0, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&pSlot->Pid, 0, __ATOMIC_SEQ_CST);
+	if(!pShared->Writer){
+		munmap(pShared->Header, SHARED_DATA_START);
+	}
+	munmap((void*) pShared->Base, pShared->Size);
+	close(pShared->Fd);
+	memset(pShared, 0, sizeof(CSet_Shared));
+};
+
+/**
+ * Removes the name of a segment created with a name. Processes that still
+ * map it keep using it; the memory is released when the last one closes.
+ *
+ * Returns:
+ *    true if the name was removed, false otherwise
+ */
+bool CSet_Shared_Remove(const char* const Name){
+	return shm_unlink(Name) == 0;
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Claims a free slot of the header for the calling process, reclaiming the
+ * slots of exited processes if none is free
+ * @param  pShared the mapping
+ * @return bool whether a slot was claimed
+ */
+bool Shared_Claim_Slot(CSet_Shared* pShared){
+	Shared_Slot* pSlots = pShared->Header->Slots;
+	uint32_t pid = (uint32_t) getpid();
+	uint32_t pass = 0;
+	while(pass < 2){
+		uint32_t i = 0;
+		while(i < CSET_SHARED_MAX_READERS){
+			uint32_t expected = 0;
+			if(__atomic_compare_exchange_n(&pSlots[i].Pid, &expected, pid, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)){
+				__atomic_store_n(&pSlots[i].Generation, 0, __ATOMIC_SEQ_CST);
+				pShared->Slot = i;
+				return true;
+			}
+			i++;
+		}
+		i = 0;
+		while(i < CSET_SHARED_MAX_READERS){
+			uint32_t owner = __atomic_load_n(&pSlots[i].Pid, __ATOMIC_SEQ_CST);
+			if(owner != 0 && Shared_Is_Dead(owner)){
+				__atomic_store_n(&pSlots[i].Generation, 0, __ATOMIC_SEQ_CST);
+				__atomic_compare_exchange_n(&pSlots[i].Pid, &owner, 0, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+			}
+			i++;
+		}
+		pass++;
+	}
+	return false;
+};
+
+/**
+ * Determines whether a process has exited
+ * @param  pid the process id
+ * @return bool true if no such process exists
+ */
+bool Shared_Is_Dead(uint32_t pid){
+	return kill((pid_t) pid, 0) != 0 && errno == ESRCH;
+};
+
+/**
+ * Determines whether a live process has a generation pinned, freeing the
+ * slots of exited processes on the way
+ * @param  pHeader    the segment header
+ * @param  generation the generation
+ * @return bool whether some slot pins it
+ */
+bool Shared_Is_Pinned(Shared_Header* pHeader, uint64_t generation){
+	uint32_t i = 0;
+	while(i < CSET_SHARED_MAX_READERS){
+		uint32_t owner = __atomic_load_n(&pHeader->Slots[i].Pid, __ATOMIC_SEQ_CST);
+		if(owner != 0 && __atomic_load_n(&pHeader->Slots[i].Generation, __ATOMIC_SEQ_CST) == generation){
+			if(!Shared_Is_Dead(owner)){
+				return true;
+			}
+			__atomic_store_n(&pHeader->Slots[i].Generation, 0, __ATOMIC_SEQ_CST);
+			__atomic_compare_exchange_n(&pHeader->Slots[i].Pid, &owner, 0, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+		}
+		i++;
+	}
+	return false;
+};
+
+/**
+ * Drops the oldest versions that are neither current nor pinned
+ * @param pShared the writer's mapping
+ */
+void Shared_Reclaim(CSet_Shared* pShared){
+	Shared_Header* pHeader = pShared->Header;
+	while(pHeader->Versions > 0 && pHeader->Tail != pHeader->Current){
+		const Shared_Version* pOldest = (const Shared_Version*)(pShared->Base + pHeader->Tail);
+		if(Shared_Is_Pinned(pHeader, pOldest->Generation)){
+			return;
+		}
+		pHeader->Tail = pOldest->Next;
+		pHeader->Versions--;
+	}
+};
+
+/**
+ * Finds room for a version of the given size after the newest one,
+ * wrapping around to the start of the area if the end is too short
+ * @param  pHeader the segment header
+ * @param  bytes   the size of the version
+ * @return uint64_t the offset of the room, or 0 if there is none
+ */
+uint64_t Shared_Allocate(Shared_Header* pHeader, uint64_t bytes){
+	if(pHeader->Versions == 0){
+		pHeader->Head = SHARED_DATA_START;
+		pHeader->Tail = SHARED_DATA_START;
+		return bytes <= pHeader->Size - SHARED_DATA_START ? SHARED_DATA_START : 0;
+	}
+	if(pHeader->Head > pHeader->Tail){
+		if(pHeader->Size - pHeader->Head >= bytes){
+			return pHeader->Head;
+		}
+		return pHeader->Tail - SHARED_DATA_START >= bytes ? SHARED_DATA_START : 0;
+	}
+	return pHeader->Tail - pHeader->Head >= bytes ? pHeader->Head : 0;
+};
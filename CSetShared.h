@@ -0,0 +1,46 @@
+#ifndef CSET_SHARED_H
+#define CSET_SHARED_H
+#include "CSet.h"
+
+#define CSET_SHARED_MAX_READERS 64
+
+struct _Shared_Header;
+
+// A mapping of a shared-memory segment holding published versions of a
+// collection of sets. The segment only stores offsets, so every process
+// may map it at a different address.
+struct _CSet_Shared {
+
+   struct _Shared_Header* Header; // writable mapping of the segment header
+   const uint8_t* Base;  // mapping of the whole segment (writable for the writer)
+   uint64_t Size;        // bytes of the segment
+   int Fd;               // descriptor of the segment
+   bool Writer;          // whether this mapping publishes versions
+   uint32_t Slot;        // reader slot claimed in the header
+   uint64_t Pinned;      // offset of the pinned version, or 0
+   uint64_t Generation;  // generation of the pinned version, or 0
+};
+
+typedef struct _CSet_Shared CSet_Shared;
+
+bool CSet_Shared_Create(CSet_Shared* const pShared, const char* const Name, uint64_t Bytes);
+
+bool CSet_Shared_Publish(CSet_Shared* const pShared, const CSet* const* const Sets, uint32_t Count);
+
+bool CSet_Shared_Attach(CSet_Shared* const pShared, const char* const Name, int Fd);
+
+uint64_t CSet_Shared_Pin(CSet_Shared* const pShared);
+
+uint64_t CSet_Shared_Latest(const CSet_Shared* const pShared);
+
+uint32_t CSet_Shared_Count(const CSet_Shared* const pShared);
+
+bool CSet_Shared_View(const CSet_Shared* const pShared, uint32_t Id, CSet* const pView);
+
+void CSet_Shared_Unpin(CSet_Shared* const pShared);
+
+void CSet_Shared_Close(CSet_Shared* const pShared);
+
+bool CSet_Shared_Remove(const char* const Name);
+
+#endif
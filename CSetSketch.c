@@ -0,0 +1,870 @@
+#include "CSetSketch.h"
+#include "CSetInternal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// CSetSketch provides compact summaries of CSets for similarity search.
+//
+// A MinHash signature holds, for each of K hash functions, the minimum hash
+// of any element of the set. The fraction of positions at which two
+// signatures agree estimates the Jaccard similarity of the two sets. Each
+// hash function is multiply-shift, h_i(x) = (A_i * x + B_i) >> 32, so
+// computing a signature is one pass over Data with a branch-free inner loop
+// over the K functions that the compiler can vectorize.
+//
+// A tracked signature is attached to its set as an observer. Inserts update
+// it in O(K). A removal cannot be undone exactly, so it marks the signature
+// Stale, and CSet_MinHash_Compute refreshes it later.
+//
+// The LSH index splits each signature into Bands bands of Rows values and
+// hashes each band into a table. Sets that agree on every value of any one
+// band become candidates, so a query touches Bands chains instead of every
+// set. Exact similarity of the candidates can then be checked with
+// CSet_Jaccard.
+//
+// A HyperLogLog sketch estimates the number of distinct elements it has
+// seen in 2^P small registers, independent of the number of elements.
+// Register j holds the largest rank (position of the first set bit) among
+// the hashes routed to it. Sketches with the same P merge by taking the
+// register-wise maximum, which gives the sketch of the union. Small
+// sketches keep only their non-zero registers in a sorted sparse list and
+// switch to the dense array once that list would be larger. A tracked
+// sketch follows inserts into its set. Removals cannot be taken back out of
+// a HyperLogLog, so after them the sketch over-estimates until rebuilt. If
+// memory runs out while an insert is added, the sketch marks itself Stale
+// and the next CSet_HLL_Estimate rebuilds it from the tracked set.
+
+//Global Declaration
+#define LSH_INITIAL_BUCKETS 64
+#define HLL_MIN_P 4
+#define HLL_MAX_P 18
+#define HLL_FILE_MAGIC 0x314C4C48u   // "HLL1" in little-endian byte order
+
+struct _LSH_Entry {
+
+   uint64_t Key;         // hash of one band of a signature
+   uint32_t Id;          // caller's identifier of the set
+   uint32_t Next;        // next entry in the chain (index + 1, 0 = end)
+};
+
+typedef struct _LSH_Entry LSH_Entry;
+
+//Internal Helper Declarations
+void MinHash_On_Insert(void* Ctx, const CSet* pSet, int32_t Value);
+void MinHash_On_Remove(void* Ctx, const CSet* pSet, int32_t Value);
+void MinHash_On_Reset(void* Ctx, const CSet* pSet);
+uint64_t LSH_Band_Key(const CSet_MinHash* pSig, uint32_t band, uint32_t rows);
+bool LSH_Rehash(CSet_LSH* pIndex, uint32_t buckets);
+int Compare_Ids(const void* a, const void* b);
+void HLL_Position(const CSet_HLL* pHLL, int32_t val, uint32_t* pIndex, uint8_t* pRank);
+bool HLL_Set_Register(CSet_HLL* pHLL, uint32_t index, uint8_t rank);
+bool HLL_Densify(CSet_HLL* pHLL);
+bool HLL_Check_Sparse(const uint32_t* sparse, uint32_t count, uint32_t P);
+void HLL_On_Insert(void* Ctx, const CSet* pSet, int32_t Value);
+void HLL_On_Reset(void* Ctx, const CSet* pSet);
+bool HLL_Rebuild(CSet_HLL* pHLL, const CSet* pSet);
+
+/**
+ * Initializes an empty MinHash signature with K hash functions derived
+ * from Seed. Signatures are comparable only if they share K and Seed.
+ *
+ * Pre:
+ *    K > 0
+ * Post:
+ *    If successful:
+ *       pSig->Mins[0:K-1] == UINT32_MAX, the signature of the empty set
+ *       *pSig tracks no set
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_MinHash_Init(CSet_MinHash* const pSig, uint32_t K, uint64_t Seed){
+	memset(pSig, 0, sizeof(CSet_MinHash));
+	if(K == 0){
+		return false;
+	}
+	pSig->A = (uint64_t*) malloc(sizeof(uint64_t) * K);
+	pSig->B = (uint64_t*) malloc(sizeof(uint64_t) * K);
+	pSig->Mins = (uint32_t*) malloc(sizeof(uint32_t) * K);
+	if(!pSig->A || !pSig->B || !pSig->Mins){
+		CSet_MinHash_Free(pSig);
+		return false;
+	}
+	pSig->K = K;
+	uint32_t i = 0;
+	while(i < K){
+		pSig->A[i] = Sketch_Mix(Seed + 2 * i) | 1;
+		pSig->B[i] = Sketch_Mix(Seed + 2 * i + 1);
+		pSig->Mins[i] = UINT32_MAX;
+		i++;
+	}
+	return true;
+};
+
+/**
+ * Recomputes a signature from the elements of a pSet object.
+ *
+ * Pre:
+ *    *pSig was initialized by CSet_MinHash_Init
+ *    *pSet satisfies the CSet contract
+ * Post:
+ *    *pSig is the signature of *pSet
+ *    pSig->Stale == false
+ */
+void CSet_MinHash_Compute(CSet_MinHash* const pSig, const CSet* const pSet){
+	uint32_t K = pSig->K;
+	uint32_t* mins = pSig->Mins;
+	const uint64_t* a = pSig->A;
+	const uint64_t* b = pSig->B;
+	uint32_t i = 0;
+	while(i < K){
+		mins[i] = UINT32_MAX;
+		i++;
+	}
+	uint32_t n = CSet_Size(pSet);
+	uint32_t e = 0;
+	while(e < n){
+		uint64_t x = (uint32_t) pSet->Data[e];
+		for(i = 0; i < K; i++){
+			uint32_t h = (uint32_t)((a[i] * x + b[i]) >> 32);
+			mins[i] = h < mins[i] ? h : mins[i];
+		}
+		e++;
+	}
+	pSig->Stale = false;
+};
+
+/**
+ * Computes the signature of a pSet object and keeps it current as elements
+ * are inserted. Stops tracking any previously tracked set.
+ *
+ * Pre:
+ *    *pSig was initialized by CSet_MinHash_Init
+ *    *pSet satisfies the CSet contract
+ * Post:
+ *    *pSig is the signature of *pSet and is attached to it as an observer
+ */
+void CSet_MinHash_Track(CSet_MinHash* const pSig, CSet* const pSet){
+	CSet_MinHash_Untrack(pSig);
+	CSet_MinHash_Compute(pSig, pSet);
+	pSig->Observer.Inserted = MinHash_On_Insert;
+	pSig->Observer.Removed = MinHash_On_Remove;
+	pSig->Observer.Reset = MinHash_On_Reset;
+	pSig->Observer.Ctx = pSig;
+	CSet_Attach(pSet, &pSig->Observer);
+	pSig->pTracked = pSet;
+};
+
+/**
+ * Stops a signature from following changes to its tracked set, if any.
+ */
+void CSet_MinHash_Untrack(CSet_MinHash* const pSig){
+	if(pSig->pTracked){
+		CSet_Detach(pSig->pTracked, &pSig->Observer);
+		pSig->pTracked = NULL;
+	}
+};
+
+/**
+ * Estimates the Jaccard similarity of the sets behind two signatures.
+ *
+ * Pre:
+ *    *pA and *pB were initialized with the same K and Seed
+ * Returns:
+ *    the fraction of positions at which the signatures agree, in [0, 1],
+ *    or 0 if the signatures are not comparable
+ */
+double CSet_MinHash_Similarity(const CSet_MinHash* const pA, const CSet_MinHash* const pB){
+	if(pA->K != pB->K || pA->K == 0 || pA->A[0] != pB->A[0]){
+		return 0.0;
+	}
+	uint32_t same = 0, i = 0;
+	while(i < pA->K){
+		same += (pA->Mins[i] == pB->Mins[i]);
+		i++;
+	}
+	return (double) same / pA->K;
+};
+
+/**
+ * Releases a signature, untracking its set first.
+ */
+void CSet_MinHash_Free(CSet_MinHash* const pSig){
+	CSet_MinHash_Untrack(pSig);
+	free(pSig->A);
+	free(pSig->B);
+	free(pSig->Mins);
+	memset(pSig, 0, sizeof(CSet_MinHash));
+};
+
+/**
+ * Initializes an empty LSH index over signatures of Bands * Rows values.
+ * More rows per band make candidates more similar; more bands find more
+ * of them.
+ *
+ * Pre:
+ *    Bands > 0, Rows > 0
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_LSH_Init(CSet_LSH* const pIndex, uint32_t Bands, uint32_t Rows){
+	memset(pIndex, 0, sizeof(CSet_LSH));
+	if(Bands == 0 || Rows == 0){
+		return false;
+	}
+	pIndex->Bands = Bands;
+	pIndex->Rows = Rows;
+	return LSH_Rehash(pIndex, LSH_INITIAL_BUCKETS);
+};
+
+/**
+ * Adds the set identified by Id, with signature *pSig, to the index.
+ *
+ * Pre:
+ *    pSig->K >= pIndex->Bands * pIndex->Rows
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_LSH_Insert(CSet_LSH* const pIndex, uint32_t Id, const CSet_MinHash* const pSig){
+	uint32_t bands = pIndex->Bands;
+	if(pSig->K < bands * pIndex->Rows){
+		return false;
+	}
+	if((uint64_t) pIndex->Count + bands >= UINT32_MAX){
+		return false;
+	}
+	if(pIndex->Count + bands > pIndex->Capacity){
+		uint32_t cap = pIndex->Capacity ? pIndex->Capacity * 2 : bands * LSH_INITIAL_BUCKETS;
+		while(cap < pIndex->Count + bands){
+			cap *= 2;
+		}
+		LSH_Entry* newEntries = (LSH_Entry*) realloc(pIndex->Entries, sizeof(LSH_Entry) * cap);
+		if(!newEntries){
+			return false;
+		}
+		pIndex->Entries = newEntries;
+		pIndex->Capacity = cap;
+	}
+	if((pIndex->Count / bands) + 1 > pIndex->Buckets){
+		if(!LSH_Rehash(pIndex, pIndex->Buckets * 2)){
+			return false;
+		}
+	}
+	uint32_t band = 0;
+	while(band < bands){
+		uint32_t index = pIndex->Count++;
+		LSH_Entry* pEntry = &pIndex->Entries[index];
+		pEntry->Key = LSH_Band_Key(pSig, band, pIndex->Rows);
+		pEntry->Id = Id;
+		uint32_t* pHead = &pIndex->Heads[band * pIndex->Buckets + (pEntry->Key & (pIndex->Buckets - 1))];
+		pEntry->Next = *pHead;
+		*pHead = index + 1;
+		band++;
+	}
+	return true;
+};
+
+/**
+ * Finds the sets that share at least one band with *pSig.
+ *
+ * Pre:
+ *    pSig->K >= pIndex->Bands * pIndex->Rows
+ *    Ids points to an array of dimension >= Max
+ * Post:
+ *    Ids[0 : min(Max, n)-1] hold distinct candidate Ids in increasing order,
+ *    where n is the return value
+ * Returns:
+ *    the number of distinct candidates, which may exceed Max
+ */
+uint32_t CSet_LSH_Query(const CSet_LSH* const pIndex, const CSet_MinHash* const pSig,
+                        uint32_t* const Ids, uint32_t Max){
+	if(pSig->K < pIndex->Bands * pIndex->Rows){
+		return 0;
+	}
+	uint32_t found = 0, cap = 0;
+	uint32_t* all = NULL;
+	uint32_t band = 0;
+	while(band < pIndex->Bands){
+		uint64_t key = LSH_Band_Key(pSig, band, pIndex->Rows);
+		uint32_t link = pIndex->Heads[band * pIndex->Buckets + (key & (pIndex->Buckets - 1))];
+		while(link){
+			const LSH_Entry* pEntry = &pIndex->Entries[link - 1];
+			if(pEntry->Key == key){
+				if(found == cap){
+					uint32_t newCap = cap ? cap * 2 : LSH_INITIAL_BUCKETS;
+					uint32_t* grown = (uint32_t*) realloc(all, sizeof(uint32_t) * newCap);
+					if(!grown){
+						free(all);
+						return 0;
+					}
+					all = grown;
+					cap = newCap;
+				}
+				all[found++] = pEntry->Id;
+			}
+			link = pEntry->Next;
+		}
+		band++;
+	}
+	if(found == 0){
+		return 0;
+	}
+	qsort(all, found, sizeof(uint32_t), Compare_Ids);
+	uint32_t distinct = 0, i = 0;
+	while(i < found){
+		if(i == 0 || all[i] != all[i - 1]){
+			if(distinct < Max){
+				Ids[distinct] = all[i];
+			}
+			distinct++;
+		}
+		i++;
+	}
+	free(all);
+	return distinct;
+};
+
+/**
+ * Releases an LSH index.
+ */
+void CSet_LSH_Free(CSet_LSH* const pIndex){
+	free(pIndex->Heads);
+	free(pIndex->Entries);
+	memset(pIndex, 0, sizeof(CSet_LSH));
+};
+
+/**
+ * Computes the exact Jaccard similarity |A n B| / |A u B| of two CSet
+ * objects with one merge pass and no allocation.
+ *
+ * Pre:
+ *    *pA satisfies the CSet contract
+ *    *pB satisfies the CSet contract
+ * Returns:
+ *    the similarity in [0, 1]; 1 if both sets are empty
+ */
+double CSet_Jaccard(const CSet* const pA, const CSet* const pB){
+	uint32_t sizeA = CSet_Size(pA), sizeB = CSet_Size(pB);
+	if(sizeA == 0 && sizeB == 0){
+		return 1.0;
+	}
+	uint32_t a = 0, b = 0, common = 0;
+	while(a < sizeA && b < sizeB){
+		if(pA->Data[a] < pB->Data[b]){
+			a++;
+		}
+		else if(pA->Data[a] > pB->Data[b]){
+			b++;
+		}
+		else{
+			common++;
+			a++;
+			b++;
+		}
+	}
+	return (double) common / ((double) sizeA + sizeB - common);
+};
+
+
+/**
+ * Initializes an empty HyperLogLog sketch with 2^P registers. The standard
+ * error of the estimate is about 1.04 / sqrt(2^P).
+ *
+ * Pre:
+ *    4 <= P <= 18
+ * Post:
+ *    If successful, *pHLL is an empty, sparse sketch tracking no set
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_HLL_Init(CSet_HLL* const pHLL, uint32_t P){
+	memset(pHLL, 0, sizeof(CSet_HLL));
+	if(P < HLL_MIN_P || P > HLL_MAX_P){
+		return false;
+	}
+	pHLL->P = P;
+	return true;
+};
+
+/**
+ * Adds one value to a sketch.
+ *
+ * Returns:
+ *    true if successful, false if memory ran out
+ */
+bool CSet_HLL_Add(CSet_HLL* const pHLL, int32_t Value){
+	uint32_t index;
+	uint8_t rank;
+	HLL_Position(pHLL, Value, &index, &rank);
+	return HLL_Set_Register(pHLL, index, rank);
+};
+
+/**
+ * Adds every element of a pSet object to a sketch in one pass. Large sets
+ * go straight to dense registers, so the pass is a branch-light loop of
+ * hash, shift and max.
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ * Returns:
+ *    true if successful, false if memory ran out
+ */
+bool CSet_HLL_Build(CSet_HLL* const pHLL, const CSet* const pSet){
+	uint32_t n = CSet_Size(pSet);
+	uint32_t m = 1u << pHLL->P;
+	if(!pHLL->Registers && (uint64_t) pHLL->SparseCount + n > m / 4){
+		if(!HLL_Densify(pHLL)){
+			return false;
+		}
+	}
+	uint32_t e = 0;
+	if(pHLL->Registers){
+		uint8_t* regs = pHLL->Registers;
+		while(e < n){
+			uint32_t index;
+			uint8_t rank;
+			HLL_Position(pHLL, pSet->Data[e], &index, &rank);
+			regs[index] = rank > regs[index] ? rank : regs[index];
+			e++;
+		}
+		return true;
+	}
+	while(e < n){
+		if(!CSet_HLL_Add(pHLL, pSet->Data[e])){
+			return false;
+		}
+		e++;
+	}
+	return true;
+};
+
+/**
+ * Builds a sketch from a pSet object and keeps adding its later inserts.
+ * Stops tracking any previously tracked set.
+ *
+ * Pre:
+ *    *pHLL was initialized by CSet_HLL_Init
+ *    *pSet satisfies the CSet contract
+ * Post:
+ *    *pHLL is attached to *pSet as an observer and includes every element
+ *    of *pSet, or pHLL->Stale == true if memory ran out
+ */
+void CSet_HLL_Track(CSet_HLL* const pHLL, CSet* const pSet){
+	CSet_HLL_Untrack(pHLL);
+	HLL_Rebuild(pHLL, pSet);
+	pHLL->Observer.Inserted = HLL_On_Insert;
+	pHLL->Observer.Removed = NULL;
+	pHLL->Observer.Reset = HLL_On_Reset;
+	pHLL->Observer.Ctx = pHLL;
+	CSet_Attach(pSet, &pHLL->Observer);
+	pHLL->pTracked = pSet;
+};
+
+/**
+ * Stops a sketch from following inserts into its tracked set, if any.
+ */
+void CSet_HLL_Untrack(CSet_HLL* const pHLL){
+	if(pHLL->pTracked){
+		CSet_Detach(pHLL->pTracked, &pHLL->Observer);
+		pHLL->pTracked = NULL;
+	}
+};
+
+/**
+ * Folds *pSource into *pTarget, so that *pTarget becomes the sketch of the
+ * union of both inputs. Costs O(2^P), independent of the set sizes.
+ *
+ * Pre:
+ *    pTarget->P == pSource->P
+ * Returns:
+ *    true if successful, false if the precisions differ or memory ran out
+ */
+bool CSet_HLL_Merge(CSet_HLL* const pTarget, const CSet_HLL* const pSource){
+	if(pTarget->P != pSource->P){
+		return false;
+	}
+	uint32_t m = 1u << pTarget->P;
+	if(pSource->Registers){
+		if(!pTarget->Registers && !HLL_Densify(pTarget)){
+			return false;
+		}
+		uint8_t* dst = pTarget->Registers;
+		const uint8_t* src = pSource->Registers;
+		uint32_t j = 0;
+		while(j < m){
+			dst[j] = src[j] > dst[j] ? src[j] : dst[j];
+			j++;
+		}
+		return true;
+	}
+	uint32_t i = 0;
+	while(i < pSource->SparseCount){
+		uint32_t pair = pSource->Sparse[i];
+		if(!HLL_Set_Register(pTarget, pair >> 8, (uint8_t)(pair & 0xFF))){
+			return false;
+		}
+		i++;
+	}
+	return true;
+};
+
+/**
+ * Estimates the number of distinct values added to a sketch (or to any of
+ * the sketches merged into it). A Stale sketch that tracks a set is first
+ * rebuilt from it.
+ *
+ * Post:
+ *    pHLL->Stale == false, unless memory ran out again or no set is tracked
+ * Returns:
+ *    the estimated cardinality
+ */
+double CSet_HLL_Estimate(CSet_HLL* const pHLL){
+	if(pHLL->Stale && pHLL->pTracked){
+		HLL_Rebuild(pHLL, pHLL->pTracked);
+	}
+	uint32_t m = 1u << pHLL->P;
+	double sum = 0.0;
+	uint32_t zeros = 0;
+	if(pHLL->Registers){
+		uint32_t j = 0;
+		while(j < m){
+			sum += ldexp(1.0, -(int) pHLL->Registers[j]);
+			zeros += (pHLL->Registers[j] == 0);
+			j++;
+		}
+	}
+	else{
+		uint32_t i = 0;
+		while(i < pHLL->SparseCount){
+			sum += ldexp(1.0, -(int)(pHLL->Sparse[i] & 0xFF));
+			i++;
+		}
+		zeros = m - pHLL->SparseCount;
+		sum += zeros;
+	}
+	double alpha = (m == 16) ? 0.673 : (m == 32) ? 0.697 : (m == 64) ? 0.709 :
+		0.7213 / (1.0 + 1.079 / m);
+	double estimate = alpha * m * (double) m / sum;
+	if(estimate <= 2.5 * m && zeros > 0){
+		estimate = m * log((double) m / zeros);
+	}
+	return estimate;
+};
+
+/**
+ * Writes a sketch to a stream in host byte order: a magic number, P, the
+ * number of sparse pairs (UINT32_MAX if dense), then the pairs or the 2^P
+ * registers. It may follow the set it describes, written by CSet_Write.
+ *
+ * Returns:
+ *    true if every byte was written, false otherwise
+ */
+bool CSet_HLL_Write(const CSet_HLL* const pHLL, FILE* const Out){
+	uint32_t header[3] = {HLL_FILE_MAGIC, pHLL->P,
+		pHLL->Registers ? UINT32_MAX : pHLL->SparseCount};
+	if(fwrite(header, sizeof(uint32_t), 3, Out) != 3){
+		return false;
+	}
+	if(pHLL->Registers){
+		size_t m = (size_t) 1 << pHLL->P;
+		return fwrite(pHLL->Registers, 1, m, Out) == m;
+	}
+	return pHLL->SparseCount == 0 ||
+		fwrite(pHLL->Sparse, sizeof(uint32_t), pHLL->SparseCount, Out) == pHLL->SparseCount;
+};
+
+/**
+ * Replaces a sketch with one written by CSet_HLL_Write. The sketch must
+ * not be tracking a set.
+ *
+ * Post:
+ *    If successful, *pHLL equals the sketch that was written; otherwise
+ *    *pHLL is an empty sketch
+ * Returns:
+ *    true if a valid sketch was read, false otherwise
+ */
+bool CSet_HLL_Read(CSet_HLL* const pHLL, FILE* const In){
+	uint32_t header[3];
+	CSet_HLL_Free(pHLL);
+	if(fread(header, sizeof(uint32_t), 3, In) != 3 || header[0] != HLL_FILE_MAGIC ||
+		!CSet_HLL_Init(pHLL, header[1])){
+		return false;
+	}
+	uint32_t m = 1u << pHLL->P;
+	if(header[2] == UINT32_MAX){
+		if(!HLL_Densify(pHLL) || fread(pHLL->Registers, 1, m, In) != m){
+			CSet_HLL_Free(pHLL);
+			return false;
+		}
+		return true;
+	}
+	if(header[2] > m){
+		CSet_HLL_Free(pHLL);
+		return false;
+	}
+	if(header[2] > 0){
+		pHLL->Sparse = (uint32_t*) malloc(sizeof(uint32_t) * header[2]);
+		if(!pHLL->Sparse || fread(pHLL->Sparse, sizeof(uint32_t), header[2], In) != header[2] ||
+			!HLL_Check_Sparse(pHLL->Sparse, header[2], pHLL->P)){
+			CSet_HLL_Free(pHLL);
+			return false;
+		}
+		pHLL->SparseCount = pHLL->SparseCap = header[2];
+	}
+	return true;
+};
+
+/**
+ * Releases a sketch, untracking its set first.
+ */
+void CSet_HLL_Free(CSet_HLL* const pHLL){
+	CSet_HLL_Untrack(pHLL);
+	free(pHLL->Registers);
+	free(pHLL->Sparse);
+	uint32_t P = pHLL->P;
+	memset(pHLL, 0, sizeof(CSet_HLL));
+	pHLL->P = P;
+};
+
+//Internal(Private) helpers====================================================
+
+/**
+ * splitmix64 finalizer, used to derive hash parameters and band keys
+ */
+uint64_t Sketch_Mix(uint64_t x){
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+};
+
+/**
+ * Observer callback: lowers each minimum the new element beats
+ */
+void MinHash_On_Insert(void* Ctx, const CSet* pSet, int32_t Value){
+	CSet_MinHash* pSig = (CSet_MinHash*) Ctx;
+	(void) pSet;
+	uint64_t x = (uint32_t) Value;
+	uint32_t i = 0;
+	while(i < pSig->K){
+		uint32_t h = (uint32_t)((pSig->A[i] * x + pSig->B[i]) >> 32);
+		if(h < pSig->Mins[i]){
+			pSig->Mins[i] = h;
+		}
+		i++;
+	}
+};
+
+/**
+ * Observer callback: marks the signature stale if the removed element
+ * held one of the minimums
+ */
+void MinHash_On_Remove(void* Ctx, const CSet* pSet, int32_t Value){
+	CSet_MinHash* pSig = (CSet_MinHash*) Ctx;
+	(void) pSet;
+	uint64_t x = (uint32_t) Value;
+	uint32_t i = 0;
+	while(i < pSig->K && !pSig->Stale){
+		if((uint32_t)((pSig->A[i] * x + pSig->B[i]) >> 32) == pSig->Mins[i]){
+			pSig->Stale = true;
+		}
+		i++;
+	}
+};
+
+/**
+ * Observer callback: recomputes the signature of the replaced contents
+ */
+void MinHash_On_Reset(void* Ctx, const CSet* pSet){
+	CSet_MinHash_Compute((CSet_MinHash*) Ctx, pSet);
+};
+
+/**
+ * Hashes the Rows values of one band of a signature
+ */
+uint64_t LSH_Band_Key(const CSet_MinHash* pSig, uint32_t band, uint32_t rows){
+	uint64_t key = Sketch_Mix(band);
+	uint32_t r = 0;
+	while(r < rows){
+		key = Sketch_Mix(key ^ pSig->Mins[band * rows + r]);
+		r++;
+	}
+	return key;
+};
+
+/**
+ * Rebuilds every band table with the given number of chains per band
+ * @param  pIndex  the index
+ * @param  buckets the new number of chains, a power of two
+ * @return bool whether or not the allocation was successful
+ */
+bool LSH_Rehash(CSet_LSH* pIndex, uint32_t buckets){
+	uint32_t* heads = (uint32_t*) calloc((size_t) buckets * pIndex->Bands, sizeof(uint32_t));
+	if(!heads){
+		return false;
+	}
+	uint32_t index = 0;
+	while(index < pIndex->Count){
+		LSH_Entry* pEntry = &pIndex->Entries[index];
+		uint32_t band = index % pIndex->Bands;
+		uint32_t* pHead = &heads[band * buckets + (pEntry->Key & (buckets - 1))];
+		pEntry->Next = *pHead;
+		*pHead = index + 1;
+		index++;
+	}
+	free(pIndex->Heads);
+	pIndex->Heads = heads;
+	pIndex->Buckets = buckets;
+	return true;
+};
+
+/**
+ * qsort comparator for uint32_t identifiers
+ */
+int Compare_Ids(const void* a, const void* b){
+	uint32_t x = *(const uint32_t*) a;
+	uint32_t y = *(const uint32_t*) b;
+	return (x > y) - (x < y);
+};
+
+/**
+ * Computes the register index (top P bits of the hash) and rank (1 + the
+ * number of leading zeros in the remaining bits) of a value
+ */
+void HLL_Position(const CSet_HLL* pHLL, int32_t val, uint32_t* pIndex, uint8_t* pRank){
+	uint64_t h = Sketch_Mix((uint32_t) val);
+	uint32_t P = pHLL->P;
+	uint64_t rest = (h << P) | (1ULL << (P - 1));
+	*pIndex = (uint32_t)(h >> (64 - P));
+	*pRank = (uint8_t)(__builtin_clzll(rest) + 1);
+};
+
+/**
+ * Raises register index to at least rank, in the sparse list or the dense
+ * array, converting to dense once the list holds 2^P / 4 pairs
+ * @return bool whether or not the allocation was successful
+ */
+bool HLL_Set_Register(CSet_HLL* pHLL, uint32_t index, uint8_t rank){
+	if(pHLL->Registers){
+		if(rank > pHLL->Registers[index]){
+			pHLL->Registers[index] = rank;
+		}
+		return true;
+	}
+	uint32_t bottom = 0, top = pHLL->SparseCount;
+	while(bottom < top){
+		uint32_t mid = bottom + (top - bottom) / 2;
+		if((pHLL->Sparse[mid] >> 8) < index){
+			bottom = mid + 1;
+		}
+		else{
+			top = mid;
+		}
+	}
+	if(bottom < pHLL->SparseCount && (pHLL->Sparse[bottom] >> 8) == index){
+		if(rank > (pHLL->Sparse[bottom] & 0xFF)){
+			pHLL->Sparse[bottom] = (index << 8) | rank;
+		}
+		return true;
+	}
+	if(pHLL->SparseCount >= (1u << pHLL->P) / 4){
+		if(!HLL_Densify(pHLL)){
+			return false;
+		}
+		pHLL->Registers[index] = rank;
+		return true;
+	}
+	if(pHLL->SparseCount == pHLL->SparseCap){
+		uint32_t cap = pHLL->SparseCap ? pHLL->SparseCap * 2 : 16;
+		uint32_t* grown = (uint32_t*) realloc(pHLL->Sparse, sizeof(uint32_t) * cap);
+		if(!grown){
+			return false;
+		}
+		pHLL->Sparse = grown;
+		pHLL->SparseCap = cap;
+	}
+	memmove(pHLL->Sparse + bottom + 1, pHLL->Sparse + bottom,
+		sizeof(uint32_t) * (pHLL->SparseCount - bottom));
+	pHLL->Sparse[bottom] = (index << 8) | rank;
+	pHLL->SparseCount++;
+	return true;
+};
+
+/**
+ * Converts a sparse sketch to dense registers
+ * @return bool whether or not the allocation was successful
+ */
+bool HLL_Densify(CSet_HLL* pHLL){
+	if(pHLL->Registers){
+		return true;
+	}
+	uint8_t* regs = (uint8_t*) calloc((size_t) 1 << pHLL->P, 1);
+	if(!regs){
+		return false;
+	}
+	uint32_t i = 0;
+	while(i < pHLL->SparseCount){
+		regs[pHLL->Sparse[i] >> 8] = (uint8_t)(pHLL->Sparse[i] & 0xFF);
+		i++;
+	}
+	free(pHLL->Sparse);
+	pHLL->Sparse = NULL;
+	pHLL->SparseCount = pHLL->SparseCap = 0;
+	pHLL->Registers = regs;
+	return true;
+};
+
+/**
+ * Checks sparse pairs read from a file: indexes below 2^P and strictly
+ * increasing, and ranks the hash could produce (1 to 64 - P + 1)
+ * @param  sparse the (index << 8 | rank) pairs
+ * @param  count  the number of pairs
+ * @param  P      the register index bits of the sketch
+ * @return bool true if every pair is valid, false otherwise
+ */
+bool HLL_Check_Sparse(const uint32_t* sparse, uint32_t count, uint32_t P){
+	uint32_t i = 0;
+	while(i < count){
+		uint32_t index = sparse[i] >> 8, rank = sparse[i] & 0xFF;
+		if(index >= (1u << P) || rank < 1 || rank > 64 - P + 1 ||
+			(i > 0 && index <= (sparse[i - 1] >> 8))){
+			return false;
+		}
+		i++;
+	}
+	return true;
+};
+
+/**
+ * Observer callback: adds the inserted value to the sketch, or marks it
+ * Stale if memory ran out
+ */
+void HLL_On_Insert(void* Ctx, const CSet* pSet, int32_t Value){
+	CSet_HLL* pHLL = (CSet_HLL*) Ctx;
+	(void) pSet;
+	if(!pHLL->Stale && !CSet_HLL_Add(pHLL, Value)){
+		pHLL->Stale = true;
+	}
+};
+
+/**
+ * Observer callback: rebuilds the sketch from the replaced contents
+ */
+void HLL_On_Reset(void* Ctx, const CSet* pSet){
+	HLL_Rebuild((CSet_HLL*) Ctx, pSet);
+};
+
+/**
+ * Empties a sketch and adds every element of pSet to it, marking the
+ * sketch Stale if memory ran out
+ * @param  pHLL the sketch
+ * @param  pSet the set to rebuild from
+ * @return bool whether or not the rebuild was successful
+ */
+bool HLL_Rebuild(CSet_HLL* pHLL, const CSet* pSet){
+	free(pHLL->Registers);
+	pHLL->Registers = NULL;
+	pHLL->SparseCount = 0;
+	pHLL->Stale = !CSet_HLL_Build(pHLL, pSet);
+	return !pHLL->Stale;
+};
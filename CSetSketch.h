@@ -0,0 +1,90 @@
+#ifndef CSET_SKETCH_H
+#define CSET_SKETCH_H
+#include "CSet.h"
+
+struct _CSet_MinHash {
+
+   uint32_t K;           // number of hash functions (signature length)
+   uint64_t* A;          // odd multipliers of the K hash functions
+   uint64_t* B;          // offsets of the K hash functions
+   uint32_t* Mins;       // minimum of each hash function over the set
+   bool Stale;           // a removal may have invalidated Mins
+   CSet* pTracked;       // set whose changes update Mins, or NULL
+   CSet_Observer Observer;
+};
+
+typedef struct _CSet_MinHash CSet_MinHash;
+
+struct _LSH_Entry;
+
+struct _CSet_HLL {
+
+   uint32_t P;           // precision; the sketch has 2^P registers
+   uint8_t* Registers;   // dense registers, or NULL while sparse
+   uint32_t* Sparse;     // sorted (index << 8 | rank) pairs while sparse
+   uint32_t SparseCount; // number of pairs in Sparse
+   uint32_t SparseCap;   // dimension of Sparse
+   bool Stale;           // an insert was lost; rebuilt from pTracked by Estimate
+   CSet* pTracked;       // set whose inserts update the sketch, or NULL
+   CSet_Observer Observer;
+};
+
+typedef struct _CSet_HLL CSet_HLL;
+
+struct _CSet_LSH {
+
+   uint32_t Bands;       // number of bands
+   uint32_t Rows;        // signature values per band
+   uint32_t Buckets;     // number of chains per band table
+   uint32_t* Heads;      // Bands * Buckets chain heads (index + 1, 0 = empty)
+   struct _LSH_Entry* Entries; // Bands entries per inserted set
+   uint32_t Count;       // number of entries in use
+   uint32_t Capacity;    // dimension of Entries
+};
+
+typedef struct _CSet_LSH CSet_LSH;
+
+bool CSet_MinHash_Init(CSet_MinHash* const pSig, uint32_t K, uint64_t Seed);
+
+void CSet_MinHash_Compute(CSet_MinHash* const pSig, const CSet* const pSet);
+
+void CSet_MinHash_Track(CSet_MinHash* const pSig, CSet* const pSet);
+
+void CSet_MinHash_Untrack(CSet_MinHash* const pSig);
+
+double CSet_MinHash_Similarity(const CSet_MinHash* const pA, const CSet_MinHash* const pB);
+
+void CSet_MinHash_Free(CSet_MinHash* const pSig);
+
+bool CSet_LSH_Init(CSet_LSH* const pIndex, uint32_t Bands, uint32_t Rows);
+
+bool CSet_LSH_Insert(CSet_LSH* const pIndex, uint32_t Id, const CSet_MinHash* const pSig);
+
+uint32_t CSet_LSH_Query(const CSet_LSH* const pIndex, const CSet_MinHash* const pSig,
+                        uint32_t* const Ids, uint32_t Max);
+
+void CSet_LSH_Free(CSet_LSH* const pIndex);
+
+double CSet_Jaccard(const CSet* const pA, const CSet* const pB);
+
+bool CSet_HLL_Init(CSet_HLL* const pHLL, uint32_t P);
+
+bool CSet_HLL_Add(CSet_HLL* const pHLL, int32_t Value);
+
+bool CSet_HLL_Build(CSet_HLL* const pHLL, const CSet* const pSet);
+
+void CSet_HLL_Track(CSet_HLL* const pHLL, CSet* const pSet);
+
+void CSet_HLL_Untrack(CSet_HLL* const pHLL);
+
+bool CSet_HLL_Merge(CSet_HLL* const pTarget, const CSet_HLL* const pSource);
+
+double CSet_HLL_Estimate(CSet_HLL* const pHLL);
+
+bool CSet_HLL_Write(const CSet_HLL* const pHLL, FILE* const Out);
+
+bool CSet_HLL_Read(CSet_HLL* const pHLL, FILE* const In);
+
+void CSet_HLL_Free(CSet_HLL* const pHLL);
+
+#endif
@@ -0,0 +1,311 @@
+#include "CSetStore.h"
+#include "CSetInternal.h"
+#include <stdlib.h>
+#include <string.h>
+
+// CSetStore holds a large collection of read-mostly sets in one array.
+//
+// Each CSet pays for its own header and malloc'd Data array of at least
+// DEFAULT_CAPACITY cells. For millions of small sets most of that memory
+// is allocator overhead and INT32_MAX padding. A store instead packs the
+// sorted elements of every set back to back in a single Pool. Each set is
+// followed by one INT32_MAX cell, so the elements plus that cell form a
+// valid CSet Data array. A set is identified by the id returned when it is
+// appended, and is addressed by (offset, length).
+//
+// CSet_Store_View yields a read-only CSet whose Data points into the Pool.
+// It can be passed to any const operation in CSet.h. Views stay valid
+// until the next Append, Rewrite or Compact on the store.
+//
+// Rewriting a set in place is possible when it does not grow. Otherwise the
+// new elements are appended and the old cells become dead. Once more than
+// half of the Pool is dead, the store is compacted: live sets are copied in
+// id order into a fresh Pool, which also keeps scans over ids sequential.
+
+//Global Declaration
+#define STORE_DEFAULT_CAPACITY 1024
+#define STORE_COMPACT_MIN 4096
+
+struct _Store_Entry {
+
+   uint64_t Offset;      // index of the set's first element in Pool
+   uint32_t Length;      // number of elements in the set
+   uint64_t Hash;        // CSet_Hash of the set
+};
+
+typedef struct _Store_Entry Store_Entry;
+
+//Internal Helper Declarations
+bool Store_Reserve(CSet_Store* pStore, uint64_t cells);
+bool Store_Add_Entry(CSet_Store* pStore, uint32_t* pId);
+void Store_Place(CSet_Store* pStore, Store_Entry* pEntry, const int32_t* Data, uint32_t DSz, uint64_t hash);
+
+/**
+ * Initializes an empty store whose Pool has room for Sz cells.
+ *
+ * Post:
+ *    If successful, *pStore holds no sets
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_Store_Init(CSet_Store* const pStore, uint64_t Sz){
+	memset(pStore, 0, sizeof(CSet_Store));
+	if(Sz == 0){
+		Sz = STORE_DEFAULT_CAPACITY;
+	}
+	pStore->Pool = (int32_t*) malloc(sizeof(int32_t) * Sz);
+	if(!pStore->Pool){
+		return false;
+	}
+	pStore->PoolCapacity = Sz;
+	return true;
+};
+
+/**
+ * Appends a copy of the elements of a pSet object to the store.
+ *
+ * Pre:
+ *    *pSet satisfies the CSet contract
+ * Post:
+ *    If successful, *pId identifies the new set; existing views are invalid
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_Store_Append(CSet_Store* const pStore, const CSet* const pSet, uint32_t* const pId){
+	uint32_t usage = CSet_Size(pSet);
+	if(!Store_Reserve(pStore, (uint64_t) usage + 1) || !Store_Add_Entry(pStore, pId)){
+		return false;
+	}
+	Store_Place(pStore, &pStore->Entries[*pId], pSet->Data, usage, CSet_Hash(pSet));
+	return true;
+};
+
+/**
+ * Appends the elements Data[0:DSz-1] to the store as a new set.
+ *
+ * Pre:
+ *    Data[0:DSz-1] is strictly increasing and does not contain INT32_MAX
+ *    Data does not point into the store
+ * Post:
+ *    If successful, *pId identifies the new set; existing views are invalid
+ * Returns:
+ *    true if successful, false if Data is not a valid set or memory runs out
+ */
+bool CSet_Store_AppendSorted(CSet_Store* const pStore, const int32_t* const Data, uint32_t DSz,
+                             uint32_t* const pId){
+	if(!Is_Sorted_Set(Data, DSz)){
+		return false;
+	}
+	if(!Store_Reserve(pStore, (uint64_t) DSz + 1) || !Store_Add_Entry(pStore, pId)){
+		return false;
+	}
+	Store_Place(pStore, &pStore->Entries[*pId], Data, DSz, CSet_HashElements(Data, DSz));
+	return true;
+};
+
+/**
+ * Replaces the elements of the set Id with Data[0:DSz-1]. A set that does
+ * not grow is rewritten in place; otherwise it moves to the end of the
+ * Pool. The store is compacted once more than half of it is dead.
+ *
+ * Pre:
+ *    Id < CSet_Store_Count(pStore)
+ *    Data[0:DSz-1] is strictly increasing and does not contain INT32_MAX
+ *    Data does not point into the store
+ * Post:
+ *    If successful, the set Id holds exactly Data[0:DSz-1]; existing views
+ *    are invalid
+ *    else, the store is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_Store_Rewrite(CSet_Store* const pStore, uint32_t Id, const int32_t* const Data, uint32_t DSz){
+	if(Id >= pStore->Count || !Is_Sorted_Set(Data, DSz)){
+		return false;
+	}
+	uint64_t hash = CSet_HashElements(Data, DSz);
+	Store_Entry* pEntry = &pStore->Entries[Id];
+	if(DSz <= pEntry->Length){
+		pStore->Dead += pEntry->Length - DSz;
+		memmove(pStore->Pool + pEntry->Offset, Data, sizeof(int32_t) * DSz);
+		pStore->Pool[pEntry->Offset + DSz] = INT32_MAX;
+		pEntry->Length = DSz;
+		pEntry->Hash = hash;
+	}
+	else{
+		if(!Store_Reserve(pStore, (uint64_t) DSz + 1)){
+			return false;
+		}
+		pEntry = &pStore->Entries[Id];
+		pStore->Dead += (uint64_t) pEntry->Length + 1;
+		Store_Place(pStore, pEntry, Data, DSz, hash);
+	}
+	if(pStore->PoolUsage >= STORE_COMPACT_MIN && pStore->Dead * 2 > pStore->PoolUsage){
+		CSet_Store_Compact(pStore);
+	}
+	return true;
+};
+
+/**
+ * Fills *pView with a read-only CSet over the elements of the set Id,
+ * without copying them.
+ *
+ * Pre:
+ *    *pView is not attached to any storage of its own
+ * Post:
+ *    If successful:
+ *       pView->Data points into the store and pView->Flags has
+ *       CSET_FLAG_READONLY set
+ *       pView->Usage is the size of the set, pView->Capacity == pView->Usage + 1
+ *       *pView satisfies the CSet contract until the store is next modified
+ * Returns:
+ *    true if Id names a set in the store, false otherwise
+ */
+bool CSet_Store_View(const CSet_Store* const pStore, uint32_t Id, CSet* const pView){
+	if(Id >= pStore->Count){
+		return false;
+	}
+	const Store_Entry* pEntry = &pStore->Entries[Id];
+	pView->Capacity = pEntry->Length + 1;
+	pView->Usage = pEntry->Length;
+	pView->Data = pStore->Pool + pEntry->Offset;
+	pView->Hash = pEntry->Hash;
+	pView->Summary = NULL;
+	pView->Observers = NULL;
+	pView->Flags = CSET_FLAG_READONLY;
+	return true;
+};
+
+/**
+ * Copies every live set, in id order, into a new Pool with no dead cells.
+ *
+ * Post:
+ *    If successful, pStore->Dead == 0 and existing views are invalid
+ *    else, the store is unchanged
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_Store_Compact(CSet_Store* const pStore){
+	uint64_t live = pStore->PoolUsage - pStore->Dead;
+	uint64_t capacity = live + live / 4;
+	if(capacity < STORE_DEFAULT_CAPACITY){
+		capacity = STORE_DEFAULT_CAPACITY;
+	}
+	int32_t* pool = (int32_t*) malloc(sizeof(int32_t) * capacity);
+	if(!pool){
+		return false;
+	}
+	uint64_t offset = 0;
+	uint32_t id = 0;
+	while(id < pStore->Count){
+		Store_Entry* pEntry = &pStore->Entries[id];
+		memcpy(pool + offset, pStore->Pool + pEntry->Offset, sizeof(int32_t) * ((uint64_t) pEntry->Length + 1));
+		pEntry->Offset = offset;
+		offset += (uint64_t) pEntry->Length + 1;
+		id++;
+	}
+	free(pStore->Pool);
+	pStore->Pool = pool;
+	pStore->PoolUsage = offset;
+	pStore->PoolCapacity = capacity;
+	pStore->Dead = 0;
+	return true;
+};
+
+/**
+ * Reports the number of sets in a store; ids run from 0 to the count - 1.
+ */
+uint32_t CSet_Store_Count(const CSet_Store* const pStore){
+	return pStore->Count;
+};
+
+/**
+ * Releases every set of a store. Existing views become invalid.
+ */
+void CSet_Store_Free(CSet_Store* const pStore){
+	free(pStore->Pool);
+	free(pStore->Entries);
+	memset(pStore, 0, sizeof(CSet_Store));
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Ensures the Pool has room for cells more cells, doubling its capacity
+ * @param  pStore the store
+ * @param  cells  the number of cells about to be appended
+ * @return bool whether or not the allocation was successful
+ */
+bool Store_Reserve(CSet_Store* pStore, uint64_t cells){
+	uint64_t need = pStore->PoolUsage + cells;
+	if(need <= pStore->PoolCapacity){
+		return true;
+	}
+	uint64_t capacity = pStore->PoolCapacity ? pStore->PoolCapacity : STORE_DEFAULT_CAPACITY;
+	while(capacity < need){
+		capacity *= 2;
+	}
+	if(capacity > SIZE_MAX / sizeof(int32_t)){
+		return false;
+	}
+	int32_t* pool = (int32_t*) realloc(pStore->Pool, sizeof(int32_t) * capacity);
+	if(!pool){
+		return false;
+	}
+	pStore->Pool = pool;
+	pStore->PoolCapacity = capacity;
+	return true;
+};
+
+/**
+ * Adds an empty entry for a new set
+ * @param  pStore the store
+ * @param  pId    receives the id of the entry
+ * @return bool whether or not the allocation was successful
+ */
+bool Store_Add_Entry(CSet_Store* pStore, uint32_t* pId){
+	if(pStore->Count == pStore->Capacity){
+		uint32_t capacity = pStore->Capacity ? pStore->Capacity * 2 : STORE_DEFAULT_CAPACITY;
+		if(capacity <= pStore->Count){
+			return false;
+		}
+		Store_Entry* entries = (Store_Entry*) realloc(pStore->Entries, sizeof(Store_Entry) * capacity);
+		if(!entries){
+			return false;
+		}
+		pStore->Entries = entries;
+		pStore->Capacity = capacity;
+	}
+	*pId = pStore->Count++;
+	return true;
+};
+
+/**
+ * Copies a set's elements and its INT32_MAX terminator to the end of the
+ * Pool, which must already have room for them
+ */
+void Store_Place(CSet_Store* pStore, Store_Entry* pEntry, const int32_t* Data, uint32_t DSz, uint64_t hash){
+	pEntry->Offset = pStore->PoolUsage;
+	pEntry->Length = DSz;
+	pEntry->Hash = hash;
+	if(DSz > 0){
+		memcpy(pStore->Pool + pStore->PoolUsage, Data, sizeof(int32_t) * DSz);
+	}
+	pStore->Pool[pStore->PoolUsage + DSz] = INT32_MAX;
+	pStore->PoolUsage += (uint64_t) DSz + 1;
+};
+
+/**
+ * Checks that an array is strictly increasing and free of INT32_MAX
+ */
+bool Is_Sorted_Set(const int32_t* Data, uint32_t DSz){
+	uint32_t i = 1;
+	while(i < DSz){
+		if(Data[i - 1] >= Data[i]){
+			return false;
+		}
+		i++;
+	}
+	return DSz == 0 || Data[DSz - 1] != INT32_MAX;
+};
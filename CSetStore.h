@@ -0,0 +1,37 @@
+#ifndef CSET_STORE_H
+#define CSET_STORE_H
+#include "CSet.h"
+
+struct _Store_Entry;
+
+struct _CSet_Store {
+
+   int32_t* Pool;        // elements of every set, back to back
+   uint64_t PoolUsage;   // number of cells of Pool in use
+   uint64_t PoolCapacity;// dimension of Pool
+   uint64_t Dead;        // cells of Pool no longer referenced by any set
+   struct _Store_Entry* Entries; // location of each set, indexed by id
+   uint32_t Count;       // number of sets
+   uint32_t Capacity;    // dimension of Entries
+};
+
+typedef struct _CSet_Store CSet_Store;
+
+bool CSet_Store_Init(CSet_Store* const pStore, uint64_t Sz);
+
+bool CSet_Store_Append(CSet_Store* const pStore, const CSet* const pSet, uint32_t* const pId);
+
+bool CSet_Store_AppendSorted(CSet_Store* const pStore, const int32_t* const Data, uint32_t DSz,
+                             uint32_t* const pId);
+
+bool CSet_Store_Rewrite(CSet_Store* const pStore, uint32_t Id, const int32_t* const Data, uint32_t DSz);
+
+bool CSet_Store_View(const CSet_Store* const pStore, uint32_t Id, CSet* const pView);
+
+bool CSet_Store_Compact(CSet_Store* const pStore);
+
+uint32_t CSet_Store_Count(const CSet_Store* const pStore);
+
+void CSet_Store_Free(CSet_Store* const pStore);
+
+#endif
@@ -0,0 +1,364 @@
+#include "CSetTrace.h"
+#include "CSetInternal.h"
+#include <stdlib.h>
+#include <string.h>
+
+// CSetTrace records the calls a program makes to the CSet operations, so a
+// production workload can be replayed offline (see CSetReplay.c).
+//
+// While a trace is active (CSet_Active_Trace != NULL), every operation in
+// CSet.c that reads or changes elements appends one CSet_Trace_Record, with
+// the values it was given for Load and RemoveMany. RemoveIf is recorded as a
+// RemoveMany of the elements its predicate dropped, since a predicate cannot
+// be replayed. CSet_Read is recorded as the Load it performs, and
+// CSet_AdoptSorted as a Load of the adopted values. Accessors that
+// only report a field (Size, isEmpty, isFull, Hash) and Write are not
+// recorded, nor are batches run by a CSet_Pool, whose workers merge arrays
+// directly. With no active trace the cost is one load and a branch per call.
+//
+// Sets are identified by their address, mapped to a small id the first time
+// the trace sees it, so a record is 28 bytes plus its values. Records are
+// appended under a mutex, so sets used on several threads are traced in one
+// consistent order.
+//
+// A trace started with a stream copies records into a buffer of BufferBytes
+// and writes the buffer out whenever it fills. A trace started without one
+// keeps its records in a ring of BufferBytes, overwriting the oldest whole
+// records, so it can stay on in production and be saved after a slowdown
+// with CSet_Trace_Save. A saved ring starts mid-stream: sets created before
+// its oldest record start out empty when it is replayed.
+//
+// A trace file is a magic number and the record size as uint32_t, followed
+// by the records and their values, all in host byte order.
+
+//Global Declaration
+#define TRACE_MIN_BUFFER 4096
+#define TRACE_MIN_TABLE 64
+
+CSet_Trace* CSet_Active_Trace = NULL;
+
+//Internal Helper Declarations
+uint32_t Trace_Id(CSet_Trace* pTrace, const CSet* pSet);
+bool Trace_Grow_Table(CSet_Trace* pTrace);
+void Trace_Append(CSet_Trace* pTrace, const void* src, size_t bytes);
+bool Trace_Flush(CSet_Trace* pTrace);
+void Trace_Ring_Put(CSet_Trace* pTrace, uint32_t offset, const void* src, uint32_t bytes);
+void Trace_Ring_Get(const CSet_Trace* pTrace, uint32_t offset, void* dst, uint32_t bytes);
+bool Trace_Write_Header(FILE* out);
+
+/**
+ * Starts recording every CSet operation into a trace, making it the active
+ * trace.
+ *
+ * Pre:
+ *    no trace is active
+ *    no other thread is operating on sets
+ *    Out is open for writing, or NULL to keep the most recent records in a
+ *    ring in memory
+ *    BufferBytes is the size of the write buffer or ring
+ * Post:
+ *    If successful:
+ *       CSet_Active_Trace == pTrace, and if Out != NULL the file header has
+ *       been written to it
+ *    else:
+ *       *pTrace holds no memory and no trace is active
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_Trace_Start(CSet_Trace* const pTrace, FILE* const Out, uint32_t BufferBytes){
+	memset(pTrace, 0, sizeof(CSet_Trace));
+	if(BufferBytes < TRACE_MIN_BUFFER){
+		BufferBytes = TRACE_MIN_BUFFER;
+	}
+	pTrace->Out = Out;
+	pTrace->Capacity = BufferBytes;
+	pTrace->Buffer = (uint8_t*) malloc(BufferBytes);
+	pTrace->TableCap = TRACE_MIN_TABLE;
+	pTrace->Keys = (const CSet**) calloc(TRACE_MIN_TABLE, sizeof(const CSet*));
+	pTrace->Ids = (uint32_t*) malloc(sizeof(uint32_t) * TRACE_MIN_TABLE);
+	if(!pTrace->Buffer || !pTrace->Keys || !pTrace->Ids || (Out && !Trace_Write_Header(Out))){
+		free(pTrace->Buffer);
+		free(pTrace->Keys);
+		free(pTrace->Ids);
+		memset(pTrace, 0, sizeof(CSet_Trace));
+		return false;
+	}
+	pthread_mutex_init(&pTrace->Lock, NULL);
+	CSet_Active_Trace = pTrace;
+	return true;
+};
+
+/**
+ * Writes the records held in the ring of a trace started without a stream,
+ * oldest first, as a trace file. The trace keeps recording.
+ *
+ * Pre:
+ *    *pTrace was started by CSet_Trace_Start with Out == NULL
+ *    Out is open for writing
+ * Post:
+ *    The records in the ring are unchanged
+ * Returns:
+ *    true if every byte was written, false otherwise
+ */
+bool CSet_Trace_Save(CSet_Trace* const pTrace, FILE* const Out){
+	if(pTrace->Out){
+		return false;
+	}
+	pthread_mutex_lock(&pTrace->Lock);
+	uint32_t first = pTrace->Capacity - pTrace->Head;
+	if(first > pTrace->Used){
+		first = pTrace->Used;
+	}
+	bool success = Trace_Write_Header(Out) &&
+	               fwrite(pTrace->Buffer + pTrace->Head, 1, first, Out) == first &&
+	               fwrite(pTrace->Buffer, 1, pTrace->Used - first, Out) == pTrace->Used - first;
+	pthread_mutex_unlock(&pTrace->Lock);
+	return success;
+};
+
+/**
+ * Stops a trace, writing out any buffered records and releasing its memory.
+ * The stream, if any, stays open.
+ *
+ * Pre:
+ *    *pTrace was started by CSet_Trace_Start
+ *    no other thread is operating on sets
+ * Post:
+ *    If *pTrace was the active trace, no trace is active
+ *    *pTrace holds no memory; Records, Dropped and Failed keep their values
+ * Returns:
+ *    true if every record was written (or kept) and every set got an id,
+ *    false otherwise
+ */
+bool CSet_Trace_Stop(CSet_Trace* const pTrace){
+	if(CSet_Active_Trace == pTrace){
+		CSet_Active_Trace = NULL;
+	}
+	if(pTrace->Out && !Trace_Flush(pTrace)){
+		pTrace->Failed = true;
+	}
+	free(pTrace->Buffer);
+	free(pTrace->Keys);
+	free(pTrace->Ids);
+	pTrace->Buffer = NULL;
+	pTrace->Keys = NULL;
+	pTrace->Ids = NULL;
+	pTrace->Capacity = pTrace->Used = pTrace->Head = pTrace->TableCap = 0;
+	pthread_mutex_destroy(&pTrace->Lock);
+	return !pTrace->Failed;
+};
+
+/**
+ * Names a traced operation.
+ *
+ * Returns:
+ *    the name of the CSet function recorded as Op, or "unknown"
+ */
+const char* CSet_Trace_OpName(uint32_t Op){
+	static const char* const names[CSET_TRACE_OPS] = {"unknown", "Init", "Load", "Insert", "Copy",
+		"Contains", "Remove", "RemoveMany", "RemoveRange", "Shrink", "Equals", "isSubsetOf",
+		"Intersects", "Union", "Intersection", "Difference", "makeEmpty", "BuildSummary", "DropSummary",
+		"Move", "Swap", "Release"};
+	return Op < CSET_TRACE_OPS ? names[Op] : names[0];
+};
+
+
+//Internal(Private) helpers====================================================
+
+/**
+ * Appends one call to a trace; called by the operations in CSet.c
+ * @param pTrace the active trace
+ * @param op     the CSET_TRACE_* operation
+ * @param pSet   the set operated on
+ * @param pOther the second set argument, or NULL
+ * @param pThird the third set argument, or NULL
+ * @param arg0   the first scalar argument
+ * @param arg1   the second scalar argument
+ * @param values the values passed to the operation, or NULL
+ * @param count  the number of values
+ */
+void Trace_Record(CSet_Trace* pTrace, uint32_t op, const CSet* pSet, const CSet* pOther, const CSet* pThird,
+                  uint32_t arg0, uint32_t arg1, const int32_t* values, uint32_t count){
+	CSet_Trace_Record record;
+	record.Op = op;
+	record.Args[0] = arg0;
+	record.Args[1] = arg1;
+	record.Count = count;
+	pthread_mutex_lock(&pTrace->Lock);
+	record.Set = Trace_Id(pTrace, pSet);
+	record.Other = Trace_Id(pTrace, pOther);
+	record.Third = Trace_Id(pTrace, pThird);
+	if(pTrace->Out){
+		Trace_Append(pTrace, &record, sizeof(CSet_Trace_Record));
+		if(count > 0){
+			Trace_Append(pTrace, values, sizeof(int32_t) * (size_t) count);
+		}
+		pTrace->Records++;
+		pthread_mutex_unlock(&pTrace->Lock);
+		return;
+	}
+	uint64_t bytes = sizeof(CSet_Trace_Record) + sizeof(int32_t) * (uint64_t) count;
+	if(bytes > pTrace->Capacity){
+		pTrace->Records++;
+		pTrace->Dropped++;
+		pthread_mutex_unlock(&pTrace->Lock);
+		return;
+	}
+	while(pTrace->Used + bytes > pTrace->Capacity){
+		CSet_Trace_Record oldest;
+		Trace_Ring_Get(pTrace, pTrace->Head, &oldest, sizeof(CSet_Trace_Record));
+		uint32_t size = sizeof(CSet_Trace_Record) + sizeof(int32_t) * oldest.Count;
+		pTrace->Head = (uint32_t)(((uint64_t) pTrace->Head + size) % pTrace->Capacity);
+		pTrace->Used -= size;
+		pTrace->Dropped++;
+	}
+	uint32_t tail = (uint32_t)(((uint64_t) pTrace->Head + pTrace->Used) % pTrace->Capacity);
+	Trace_Ring_Put(pTrace, tail, &record, sizeof(CSet_Trace_Record));
+	if(count > 0){
+		Trace_Ring_Put(pTrace, (uint32_t)(((uint64_t) tail + sizeof(CSet_Trace_Record)) % pTrace->Capacity),
+		               values, sizeof(int32_t) * count);
+	}
+	pTrace->Used += (uint32_t) bytes;
+	pTrace->Records++;
+	pthread_mutex_unlock(&pTrace->Lock);
+};
+
+/**
+ * Finds the id of a set, handing out the next one if the trace has not seen
+ * it before
+ * @param  pTrace the trace, locked
+ * @param  pSet   the set, or NULL
+ * @return uint32_t the id, or 0 for NULL or if the table could not grow
+ */
+uint32_t Trace_Id(CSet_Trace* pTrace, const CSet* pSet){
+	if(pSet == NULL){
+		return 0;
+	}
+	uint32_t mask = pTrace->TableCap - 1;
+	uint32_t slot = (uint32_t) Sketch_Mix((uint64_t)(uintptr_t) pSet) & mask;
+	while(pTrace->Keys[slot] != NULL){
+		if(pTrace->Keys[slot] == pSet){
+			return pTrace->Ids[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+	if((pTrace->Sets + 1) * 2 > pTrace->TableCap){
+		if(!Trace_Grow_Table(pTrace)){
+			pTrace->Failed = true;
+			return 0;
+		}
+		return Trace_Id(pTrace, pSet);
+	}
+	pTrace->Keys[slot] = pSet;
+	pTrace->Ids[slot] = ++pTrace->Sets;
+	return pTrace->Sets;
+};
+
+/**
+ * Doubles the set table of a trace, rehashing the sets seen so far
+ * @param  pTrace the trace, locked
+ * @return bool whether the table grew
+ */
+bool Trace_Grow_Table(CSet_Trace* pTrace){
+	uint32_t cap = pTrace->TableCap * 2;
+	const CSet** keys = (const CSet**) calloc(cap, sizeof(const CSet*));
+	uint32_t* ids = (uint32_t*) malloc(sizeof(uint32_t) * cap);
+	if(!keys || !ids || cap == 0){
+		free(keys);
+		free(ids);
+		return false;
+	}
+	uint32_t i = 0;
+	while(i < pTrace->TableCap){
+		if(pTrace->Keys[i] != NULL){
+			uint32_t slot = (uint32_t) Sketch_Mix((uint64_t)(uintptr_t) pTrace->Keys[i]) & (cap - 1);
+			while(keys[slot] != NULL){
+				slot = (slot + 1) & (cap - 1);
+			}
+			keys[slot] = pTrace->Keys[i];
+			ids[slot] = pTrace->Ids[i];
+		}
+		i++;
+	}
+	free(pTrace->Keys);
+	free(pTrace->Ids);
+	pTrace->Keys = keys;
+	pTrace->Ids = ids;
+	pTrace->TableCap = cap;
+	return true;
+};
+
+/**
+ * Copies bytes into the write buffer of a streaming trace, writing the
+ * buffer out first if they do not fit, or writing them directly if they are
+ * larger than the buffer
+ * @param pTrace the trace, locked
+ * @param src    the bytes
+ * @param bytes  the number of bytes
+ */
+void Trace_Append(CSet_Trace* pTrace, const void* src, size_t bytes){
+	if(pTrace->Used + bytes > pTrace->Capacity && !Trace_Flush(pTrace)){
+		pTrace->Failed = true;
+	}
+	if(bytes > pTrace->Capacity){
+		if(fwrite(src, 1, bytes, pTrace->Out) != bytes){
+			pTrace->Failed = true;
+		}
+		return;
+	}
+	memcpy(pTrace->Buffer + pTrace->Used, src, bytes);
+	pTrace->Used += (uint32_t) bytes;
+};
+
+/**
+ * Writes out and empties the write buffer of a streaming trace
+ * @param  pTrace the trace
+ * @return bool whether every byte was written
+ */
+bool Trace_Flush(CSet_Trace* pTrace){
+	bool success = pTrace->Used == 0 || fwrite(pTrace->Buffer, 1, pTrace->Used, pTrace->Out) == pTrace->Used;
+	pTrace->Used = 0;
+	return success;
+};
+
+/**
+ * Copies bytes into the ring at offset, wrapping around its end
+ * @param pTrace the trace, locked
+ * @param offset the ring offset to write at
+ * @param src    the bytes
+ * @param bytes  the number of bytes, at most the ring's capacity
+ */
+void Trace_Ring_Put(CSet_Trace* pTrace, uint32_t offset, const void* src, uint32_t bytes){
+	uint32_t first = pTrace->Capacity - offset;
+	if(first > bytes){
+		first = bytes;
+	}
+	memcpy(pTrace->Buffer + offset, src, first);
+	memcpy(pTrace->Buffer, (const uint8_t*) src + first, bytes - first);
+};
+
+/**
+ * Copies bytes out of the ring at offset, wrapping around its end
+ * @param pTrace the trace, locked
+ * @param offset the ring offset to read at
+ * @param dst    receives the bytes
+ * @param bytes  the number of bytes, at most the ring's capacity
+ */
+void Trace_Ring_Get(const CSet_Trace* pTrace, uint32_t offset, void* dst, uint32_t bytes){
+	uint32_t first = pTrace->Capacity - offset;
+	if(first > bytes){
+		first = bytes;
+	}
+	memcpy(dst, pTrace->Buffer + offset, first);
+	memcpy((uint8_t*) dst + first, pTrace->Buffer, bytes - first);
+};
+
+/**
+ * Writes the header of a trace file
+ * @param  out the stream
+ * @return bool whether the header was written
+ */
+bool Trace_Write_Header(FILE* out){
+	uint32_t header[2] = {CSET_TRACE_FILE_MAGIC, sizeof(CSet_Trace_Record)};
+	return fwrite(header, sizeof(uint32_t), 2, out) == 2;
+};
@@ -0,0 +1,78 @@
+#ifndef CSET_TRACE_H
+#define CSET_TRACE_H
+#include "CSet.h"
+#include <pthread.h>
+
+// Operations recorded in a trace
+#define CSET_TRACE_INIT          1   // Args[0] = Sz
+#define CSET_TRACE_LOAD          2   // Args[0] = Sz, the Count values follow
+#define CSET_TRACE_INSERT        3   // Args[0] = Value
+#define CSET_TRACE_COPY          4   // Set = target, Other = source
+#define CSET_TRACE_CONTAINS      5   // Args[0] = Value
+#define CSET_TRACE_REMOVE        6   // Args[0] = Value
+#define CSET_TRACE_REMOVE_MANY   7   // the Count values follow
+#define CSET_TRACE_REMOVE_RANGE  8   // Args[0] = Lo, Args[1] = Hi
+#define CSET_TRACE_SHRINK        9   // Args[0] = Percent
+#define CSET_TRACE_EQUALS        10  // Set = A, Other = B
+#define CSET_TRACE_SUBSET        11  // Set = A, Other = B
+#define CSET_TRACE_INTERSECTS    12  // Set = A, Other = B
+#define CSET_TRACE_UNION         13  // Set = result, Other = A, Third = B
+#define CSET_TRACE_INTERSECTION  14  // Set = result, Other = A, Third = B
+#define CSET_TRACE_DIFFERENCE    15  // Set = result, Other = A, Third = B
+#define CSET_TRACE_MAKE_EMPTY    16
+#define CSET_TRACE_BUILD_SUMMARY 17
+#define CSET_TRACE_DROP_SUMMARY  18
+#define CSET_TRACE_MOVE          19  // Set = target, Other = source
+#define CSET_TRACE_SWAP          20  // Set = A, Other = B
+#define CSET_TRACE_RELEASE       21
+#define CSET_TRACE_OPS           22  // one more than the largest operation
+
+#define CSET_TRACE_FILE_MAGIC 0x31525443u   // "CTR1" in little-endian byte order
+
+// One traced call. Sets are identified by small ids handed out in the order
+// the trace first sees them; 0 means no set. Values (int32_t) are stored as
+// their bit patterns.
+struct _CSet_Trace_Record {
+
+   uint32_t Op;          // CSET_TRACE_* operation
+   uint32_t Set;         // id of the set operated on (the result of set operations)
+   uint32_t Other;       // id of the second set argument, or 0
+   uint32_t Third;       // id of the third set argument, or 0
+   uint32_t Args[2];     // scalar arguments
+   uint32_t Count;       // number of int32_t values following the record
+};
+
+typedef struct _CSet_Trace_Record CSet_Trace_Record;
+
+// A trace either streams its records to a file through a write buffer, or
+// keeps the most recent ones in a ring of the same size.
+struct _CSet_Trace {
+
+   FILE* Out;            // stream the records are written to, or NULL for a ring
+   uint8_t* Buffer;      // write buffer, or the ring
+   uint32_t Capacity;    // dimension of Buffer in bytes
+   uint32_t Head;        // offset of the oldest record in the ring
+   uint32_t Used;        // number of bytes held in Buffer
+   uint64_t Records;     // number of calls recorded
+   uint64_t Dropped;     // records overwritten in, or too large for, the ring
+   bool Failed;          // a write to Out or an id allocation failed
+   const CSet** Keys;    // open-addressing table of the sets seen, NULL if free
+   uint32_t* Ids;        // id of each set in Keys
+   uint32_t TableCap;    // dimension of Keys and Ids, a power of two
+   uint32_t Sets;        // number of ids handed out
+   pthread_mutex_t Lock; // guards everything above
+};
+
+typedef struct _CSet_Trace CSet_Trace;
+
+extern CSet_Trace* CSet_Active_Trace;
+
+bool CSet_Trace_Start(CSet_Trace* const pTrace, FILE* const Out, uint32_t BufferBytes);
+
+bool CSet_Trace_Save(CSet_Trace* const pTrace, FILE* const Out);
+
+bool CSet_Trace_Stop(CSet_Trace* const pTrace);
+
+const char* CSet_Trace_OpName(uint32_t Op);
+
+#endif
@@ -0,0 +1,702 @@
+#include "CSetView.h"
+#include "CSetKernels.h"
+#include "CSetInternal.h"
+#include <stdlib.h>
+#include <string.h>
+
+// CSetView maintains materialized set views: the union, intersection or
+// difference of a list of input sets, stored as an ordinary CSet and kept
+// current as the inputs change instead of being recomputed.
+//
+// The view attaches an observer to each input and applies every insert or
+// remove it reports as a delta:
+//  - a union keeps, alongside Result.Data, the number of inputs holding each
+//    element. A delta adjusts that count after one binary search, and the
+//    element leaves Result only when its count drops to zero, so a removal
+//    from one input keeps elements still present in another
+//  - an intersection or difference decides membership of the one changed
+//    value by searching the other inputs, O(k log N) for k inputs
+//  - either way Result changes by at most one element per delta, which is
+//    O(log N) to locate plus the shift of Data that any CSet insert or
+//    remove pays; refresh cost follows the size of the change, not of the
+//    inputs
+//
+// Between CSet_View_Begin and CSet_View_Commit deltas are only recorded.
+// Commit sorts and deduplicates them, recomputes each changed value against
+// the inputs once, and applies the result either value by value or, for
+// VIEW_MERGE_THRESHOLD or more values, in a single merge pass over Result.
+// A merge replaces Result wholesale, so views observing it refresh fully.
+//
+// Views compose: Result is a CSet with its own observer list, so it can be
+// the input of another view. A Reset of an input (Load, Copy, makeEmpty)
+// rebuilds the view from scratch. If memory runs out while applying a
+// delta the view marks itself Stale and stops following deltas until
+// CSet_View_Refresh rebuilds it.
+//
+// Inputs must not be the result of CSet_Union, CSet_Intersection or
+// CSet_Difference while viewed, since those detach observers. Callbacks
+// never read the input that is being modified: for that input the value's
+// membership is known from the delta itself.
+
+//Global Declaration
+#define VIEW_MERGE_THRESHOLD 32
+#define VIEW_MIN_CAPACITY 16
+#define VIEW_MIN_PENDING 64
+
+//Internal Helper Declarations
+void View_On_Insert(void* Ctx, const CSet* pSet, int32_t Value);
+void View_On_Remove(void* Ctx, const CSet* pSet, int32_t Value);
+void View_On_Reset(void* Ctx, const CSet* pSet);
+void View_Delta(CSet_View* pView, const CSet* pChanged, int32_t val, bool inserted);
+bool View_Has(const CSet_View* pView, uint32_t i, int32_t val, const CSet* pChanged, bool changedHas);
+bool View_Member(const CSet_View* pView, int32_t val, const CSet* pChanged, bool changedHas);
+uint32_t View_Holders(const CSet_View* pView, int32_t val);
+uint32_t View_Index(const CSet* pResult, int32_t val);
+uint32_t View_Count_Of(const CSet_View* pView, int32_t val);
+void View_Set_Count(CSet_View* pView, int32_t val, uint32_t count);
+void View_Set_Member(CSet_View* pView, int32_t val, bool member);
+bool View_Reserve_Counts(CSet_View* pView, uint32_t n);
+bool View_Push_Pending(CSet_View* pView, int32_t val);
+uint32_t View_Merge(uint32_t kind, const int32_t* a, const uint32_t* aCounts, uint32_t na,
+                    const int32_t* b, uint32_t nb, int32_t* out, uint32_t* outCounts);
+bool View_Merge_Pending(CSet_View* pView);
+bool View_Load_Result(CSet_View* pView, const int32_t* data, const uint32_t* counts, uint32_t n);
+uint32_t View_Capacity(uint32_t n);
+
+/**
+ * Initializes a view of the given kind over Inputs[0:InputCount-1] and
+ * computes its initial contents. The same set may appear more than once.
+ *
+ * Pre:
+ *    Kind is one of CSET_VIEW_UNION, CSET_VIEW_INTERSECTION or
+ *       CSET_VIEW_DIFFERENCE
+ *    Inputs[0:InputCount-1] point to sets satisfying the CSet contract,
+ *       which outlive the view
+ *    *pView stays at the same address until CSet_View_Free
+ * Post:
+ *    If successful:
+ *       pView->Result holds the union, intersection, or difference of the
+ *       first input and all others, and follows changes to the inputs
+ *    else:
+ *       *pView holds no memory and observes no set
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_View_Init(CSet_View* const pView, uint32_t Kind, CSet* const* const Inputs, uint32_t InputCount){
+	memset(pView, 0, sizeof(CSet_View));
+	CSet_Init(&pView->Result, 0);
+	if(Kind > CSET_VIEW_DIFFERENCE || InputCount == 0){
+		return false;
+	}
+	pView->Inputs = (CSet_View_Input*) calloc(InputCount, sizeof(CSet_View_Input));
+	if(!pView->Inputs){
+		return false;
+	}
+	pView->Kind = Kind;
+	pView->InputCount = InputCount;
+	uint32_t i = 0;
+	while(i < InputCount){
+		CSet_View_Input* pIn = &pView->Inputs[i];
+		pIn->pView = pView;
+		pIn->pSet = Inputs[i];
+		pIn->Observer.Inserted = View_On_Insert;
+		pIn->Observer.Removed = View_On_Remove;
+		pIn->Observer.Reset = View_On_Reset;
+		pIn->Observer.Ctx = pIn;
+		i++;
+	}
+	if(!CSet_View_Refresh(pView)){
+		free(pView->Inputs);
+		free(pView->Counts);
+		CSet_makeEmpty(&pView->Result);
+		pView->Inputs = NULL;
+		pView->Counts = NULL;
+		pView->InputCount = 0;
+		pView->CountCap = 0;
+		return false;
+	}
+	i = 0;
+	while(i < InputCount){
+		CSet_Attach(pView->Inputs[i].pSet, &pView->Inputs[i].Observer);
+		i++;
+	}
+	return true;
+};
+
+/**
+ * Starts a batch: until CSet_View_Commit, changes to the inputs are only
+ * recorded and Result is left as it was.
+ *
+ * Pre:
+ *    *pView was initialized by CSet_View_Init
+ * Post:
+ *    pView->Batching == true
+ */
+void CSet_View_Begin(CSet_View* const pView){
+	pView->Batching = true;
+};
+
+/**
+ * Ends a batch and brings Result up to date with every input change made
+ * since CSet_View_Begin. The cost is O(d (k log N)) to recompute the d
+ * changed values, plus either d single-element updates of Result or one
+ * O(N + d) merge.
+ *
+ * Pre:
+ *    *pView was initialized by CSet_View_Init
+ * Post:
+ *    pView->Batching == false
+ *    If successful:
+ *       pView->Result reflects the current contents of the inputs
+ *       pView->Stale == false
+ *    else:
+ *       pView->Stale == true
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_View_Commit(CSet_View* const pView){
+	pView->Batching = false;
+	if(pView->Stale){
+		return CSet_View_Refresh(pView);
+	}
+	if(pView->PendingCount == 0){
+		return true;
+	}
+	qsort(pView->Pending, pView->PendingCount, sizeof(int32_t), Compare_Int32);
+	uint32_t d = 1;
+	uint32_t i = 1;
+	while(i < pView->PendingCount){
+		if(pView->Pending[i] != pView->Pending[d - 1]){
+			pView->Pending[d++] = pView->Pending[i];
+		}
+		i++;
+	}
+	pView->PendingCount = d;
+	if(d >= VIEW_MERGE_THRESHOLD){
+		if(!View_Merge_Pending(pView)){
+			pView->Stale = true;
+		}
+	}
+	else{
+		i = 0;
+		while(i < d && !pView->Stale){
+			int32_t val = pView->Pending[i];
+			if(pView->Kind == CSET_VIEW_UNION){
+				View_Set_Count(pView, val, View_Holders(pView, val));
+			}
+			else{
+				View_Set_Member(pView, val, View_Member(pView, val, NULL, false));
+			}
+			i++;
+		}
+	}
+	pView->PendingCount = 0;
+	if(pView->Stale){
+		return CSet_View_Refresh(pView);
+	}
+	return true;
+};
+
+/**
+ * Recomputes Result from the inputs, replacing it wholesale. This is the
+ * way back from a Stale view; it costs O(k N) for k inputs.
+ *
+ * Pre:
+ *    *pView was initialized by CSet_View_Init
+ * Post:
+ *    If successful:
+ *       pView->Result reflects the current contents of the inputs
+ *       pView->Stale == false
+ *       no recorded batch values remain
+ *    else:
+ *       pView->Stale == true
+ * Returns:
+ *    true if successful, false otherwise
+ */
+bool CSet_View_Refresh(CSet_View* const pView){
+	const CSet* pFirst = pView->Inputs[0].pSet;
+	uint64_t bound = pFirst->Usage;
+	uint32_t i = 1;
+	while(pView->Kind == CSET_VIEW_UNION && i < pView->InputCount){
+		bound += pView->Inputs[i].pSet->Usage;
+		i++;
+	}
+	if(bound > UINT32_MAX - 1){
+		bound = UINT32_MAX - 1;
+	}
+	bool counted = pView->Kind == CSET_VIEW_UNION;
+	int32_t* acc = (int32_t*) malloc(sizeof(int32_t) * (size_t)(bound + 1));
+	int32_t* next = (int32_t*) malloc(sizeof(int32_t) * (size_t)(bound + 1));
+	uint32_t* accCounts = counted ? (uint32_t*) malloc(sizeof(uint32_t) * (size_t)(bound + 1)) : NULL;
+	uint32_t* nextCounts = counted ? (uint32_t*) malloc(sizeof(uint32_t) * (size_t)(bound + 1)) : NULL;
+	bool success = acc && next && (!counted || (accCounts && nextCounts));
+	if(success){
+		uint32_t n = pFirst->Usage;
+		if(n > 0){
+			memcpy(acc, pFirst->Data, sizeof(int32_t) * (size_t) n);
+		}
+		uint32_t k = 0;
+		while(counted && k < n){
+			accCounts[k++] = 1;
+		}
+		i = 1;
+		while(i < pView->InputCount){
+			const CSet* pIn = pView->Inputs[i].pSet;
+			n = View_Merge(pView->Kind, acc, accCounts, n, pIn->Data, pIn->Usage, next, nextCounts);
+			int32_t* swap = acc;
+			acc = next;
+			next = swap;
+			uint32_t* swapCounts = accCounts;
+			accCounts = nextCounts;
+			nextCounts = swapCounts;
+			i++;
+		}
+		success = View_Load_Result(pView, acc, accCounts, n);
+	}
+	free(acc);
+	free(next);
+	free(accCounts);
+	free(nextCounts);
+	pView->Stale = !success;
+	if(success){
+		pView->PendingCount = 0;
+	}
+	return success;
+};
+
+/**
+ * Detaches a view from its inputs and releases its memory. Observers of
+ * Result see it reset to the empty set.
+ *
+ * Pre:
+ *    *pView was initialized by CSet_View_Init, or zeroed
+ * Post:
+ *    *pView observes no set and holds no memory
+ */
+void CSet_View_Free(CSet_View* const pView){
+	uint32_t i = 0;
+	while(i < pView->InputCount){
+		CSet_Detach(pView->Inputs[i].pSet, &pView->Inputs[i].Observer);
+		i++;
+	}
+	CSet_makeEmpty(&pView->Result);
+	free(pView->Inputs);
+	free(pView->Counts);
+	free(pView->Pending);
+	pView->Inputs = NULL;
+	pView->Counts = NULL;
+	pView->Pending = NULL;
+	pView->InputCount = 0;
+	pView->CountCap = 0;
+	pView->PendingCount = 0;
+	pView->PendingCap = 0;
+	pView->Batching = false;
+	pView->Stale = false;
+};
+
+//Internal(Private) helpers=======================================================================
+
+/**
+ * Observer callback: Value was inserted into an input
+ */
+void View_On_Insert(void* Ctx, const CSet* pSet, int32_t Value){
+	View_Delta(((CSet_View_Input*) Ctx)->pView, pSet, Value, true);
+};
+
+/**
+ * Observer callback: Value was removed from an input
+ */
+void View_On_Remove(void* Ctx, const CSet* pSet, int32_t Value){
+	View_Delta(((CSet_View_Input*) Ctx)->pView, pSet, Value, false);
+};
+
+/**
+ * Observer callback: an input was replaced wholesale, so the view is
+ * rebuilt, or rebuilt at commit time while a batch is open
+ */
+void View_On_Reset(void* Ctx, const CSet* pSet){
+	CSet_View* pView = ((CSet_View_Input*) Ctx)->pView;
+	(void) pSet;
+	pView->Stale = true;
+	if(!pView->Batching){
+		CSet_View_Refresh(pView);
+	}
+};
+
+/**
+ * Applies one change of an input to the view, or records it while a batch
+ * is open. Each observer of the changed set reports the change once, so a
+ * set that is several inputs of the view delivers it once per input.
+ * @param pView    the view
+ * @param pChanged the input that changed; it is mid-mutation and not read
+ * @param val      the value inserted or removed
+ * @param inserted whether val was inserted rather than removed
+ */
+void View_Delta(CSet_View* pView, const CSet* pChanged, int32_t val, bool inserted){
+	if(pView->Stale){
+		return;
+	}
+	if(pView->Batching){
+		if(!View_Push_Pending(pView, val)){
+			pView->Stale = true;
+		}
+		return;
+	}
+	if(pView->Kind == CSET_VIEW_UNION){
+		uint32_t count = View_Count_Of(pView, val);
+		if(inserted){
+			count++;
+		}
+		else if(count > 0){
+			count--;
+		}
+		View_Set_Count(pView, val, count);
+	}
+	else{
+		View_Set_Member(pView, val, View_Member(pView, val, pChanged, inserted));
+	}
+};
+
+/**
+ * Tells whether input i holds val, taking the membership in pChanged from
+ * the delta rather than reading it
+ * @param  pView      the view
+ * @param  i          index of the input
+ * @param  val        the value to look up
+ * @param  pChanged   the input being modified, or NULL
+ * @param  changedHas whether pChanged holds val after the change
+ * @return bool whether input i holds val
+ */
+bool View_Has(const CSet_View* pView, uint32_t i, int32_t val, const CSet* pChanged, bool changedHas){
+	const CSet* pSet = pView->Inputs[i].pSet;
+	return pSet == pChanged ? changedHas : CSet_Contains(pSet, val);
+};
+
+/**
+ * Decides whether val belongs to the view, searching the inputs
+ * @param  pView      the view
+ * @param  val        the value to decide
+ * @param  pChanged   the input being modified, or NULL
+ * @param  changedHas whether pChanged holds val after the change
+ * @return bool whether val belongs in Result
+ */
+bool View_Member(const CSet_View* pView, int32_t val, const CSet* pChanged, bool changedHas){
+	uint32_t i;
+	switch(pView->Kind){
+	case CSET_VIEW_UNION:
+		i = 0;
+		while(i < pView->InputCount){
+			if(View_Has(pView, i, val, pChanged, changedHas)){
+				return true;
+			}
+			i++;
+		}
+		return false;
+	case CSET_VIEW_INTERSECTION:
+		i = 0;
+		while(i < pView->InputCount){
+			if(!View_Has(pView, i, val, pChanged, changedHas)){
+				return false;
+			}
+			i++;
+		}
+		return true;
+	default:
+		if(!View_Has(pView, 0, val, pChanged, changedHas)){
+			return false;
+		}
+		i = 1;
+		while(i < pView->InputCount){
+			if(View_Has(pView, i, val, pChanged, changedHas)){
+				return false;
+			}
+			i++;
+		}
+		return true;
+	}
+};
+
+/**
+ * Counts the inputs holding val; all inputs must be readable
+ * @param  pView the view
+ * @param  val   the value to count
+ * @return uint32_t the number of inputs holding val
+ */
+uint32_t View_Holders(const CSet_View* pView, int32_t val){
+	uint32_t holders = 0;
+	uint32_t i = 0;
+	while(i < pView->InputCount){
+		holders += CSet_Contains(pView->Inputs[i].pSet, val);
+		i++;
+	}
+	return holders;
+};
+
+/**
+ * Finds the first index of pResult->Data holding a value >= val
+ * @param  pResult the view's result set
+ * @param  val     the value to search for
+ * @return uint32_t the lower bound of val, pResult->Usage if there is none
+ */
+uint32_t View_Index(const CSet* pResult, int32_t val){
+	if(pResult->Usage == 0){
+		return 0;
+	}
+	return CSet_Active_Kernels->LowerBound(pResult->Data, pResult->Usage, val);
+};
+
+/**
+ * Reports how many inputs of a union view hold val, according to Counts
+ * @param  pView a union view
+ * @param  val   the value to look up
+ * @return uint32_t the count of val, 0 if it is not in Result
+ */
+uint32_t View_Count_Of(const CSet_View* pView, int32_t val){
+	uint32_t index = View_Index(&pView->Result, val);
+	if(index < pView->Result.Usage && pView->Result.Data[index] == val){
+		return pView->Counts[index];
+	}
+	return 0;
+};
+
+/**
+ * Sets the count of val in a union view, inserting it into Result or
+ * removing it as the count becomes non-zero or zero
+ * @param pView a union view
+ * @param val   the value to update
+ * @param count the number of inputs holding val
+ */
+void View_Set_Count(CSet_View* pView, int32_t val, uint32_t count){
+	CSet* pRes = &pView->Result;
+	uint32_t index = View_Index(pRes, val);
+	bool present = index < pRes->Usage && pRes->Data[index] == val;
+	if(present && count > 0){
+		pView->Counts[index] = count;
+	}
+	else if(present){
+		memmove(pView->Counts + index, pView->Counts + index + 1,
+			sizeof(uint32_t) * (size_t)(pRes->Usage - 1 - index));
+		CSet_Remove(pRes, val);
+	}
+	else if(count > 0){
+		if(!View_Reserve_Counts(pView, pRes->Usage + 1) || !CSet_Insert(pRes, val)){
+			pView->Stale = true;
+			return;
+		}
+		memmove(pView->Counts + index + 1, pView->Counts + index,
+			sizeof(uint32_t) * (size_t)(pRes->Usage - 1 - index));
+		pView->Counts[index] = count;
+	}
+};
+
+/**
+ * Makes val a member of Result, or not, for intersection and difference views
+ * @param pView  the view
+ * @param val    the value to update
+ * @param member whether val belongs in Result
+ */
+void View_Set_Member(CSet_View* pView, int32_t val, bool member){
+	CSet* pRes = &pView->Result;
+	if(!member){
+		CSet_Remove(pRes, val);
+	}
+	else if(!CSet_Contains(pRes, val) && !CSet_Insert(pRes, val)){
+		pView->Stale = true;
+	}
+};
+
+/**
+ * Grows Counts to hold at least n entries
+ * @param  pView a union view
+ * @param  n     the number of entries needed
+ * @return bool whether the allocation was successful
+ */
+bool View_Reserve_Counts(CSet_View* pView, uint32_t n){
+	if(pView->CountCap >= n){
+		return true;
+	}
+	uint64_t cap = (uint64_t) pView->CountCap * 2;
+	if(cap < n){
+		cap = n;
+	}
+	if(cap > UINT32_MAX){
+		cap = UINT32_MAX;
+	}
+	uint32_t* temp = (uint32_t*) realloc(pView->Counts, sizeof(uint32_t) * (size_t) cap);
+	if(!temp){
+		return false;
+	}
+	pView->Counts = temp;
+	pView->CountCap = (uint32_t) cap;
+	return true;
+};
+
+/**
+ * Records a changed value while a batch is open
+ * @param  pView the view
+ * @param  val   the value that changed in some input
+ * @return bool whether the allocation was successful
+ */
+bool View_Push_Pending(CSet_View* pView, int32_t val){
+	if(pView->PendingCount == pView->PendingCap){
+		if(pView->PendingCap == UINT32_MAX){
+			return false;
+		}
+		uint64_t cap = pView->PendingCap ? (uint64_t) pView->PendingCap * 2 : VIEW_MIN_PENDING;
+		if(cap > UINT32_MAX){
+			cap = UINT32_MAX;
+		}
+		int32_t* temp = (int32_t*) realloc(pView->Pending, sizeof(int32_t) * (size_t) cap);
+		if(!temp){
+			return false;
+		}
+		pView->Pending = temp;
+		pView->PendingCap = (uint32_t) cap;
+	}
+	pView->Pending[pView->PendingCount++] = val;
+	return true;
+};
+
+/**
+ * Combines the sorted arrays a and b into out according to the view kind.
+ * For a union, outCounts receives the counts of a plus one for b.
+ * @param  kind      the CSET_VIEW_* kind
+ * @param  a         the accumulated elements
+ * @param  aCounts   counts of a, or NULL unless kind is a union
+ * @param  na        number of elements in a
+ * @param  b         the elements of the next input
+ * @param  nb        number of elements in b
+ * @param  out       array of dimension >= na + nb receiving the result
+ * @param  outCounts counts of out, or NULL unless kind is a union
+ * @return uint32_t the number of elements written to out
+ */
+uint32_t View_Merge(uint32_t kind, const int32_t* a, const uint32_t* aCounts, uint32_t na,
+                    const int32_t* b, uint32_t nb, int32_t* out, uint32_t* outCounts){
+	uint32_t i = 0;
+	uint32_t j = 0;
+	uint32_t n = 0;
+	while(i < na && j < nb){
+		if(a[i] < b[j]){
+			if(kind != CSET_VIEW_INTERSECTION){
+				if(outCounts){
+					outCounts[n] = aCounts[i];
+				}
+				out[n++] = a[i];
+			}
+			i++;
+		}
+		else if(a[i] > b[j]){
+			if(kind == CSET_VIEW_UNION){
+				outCounts[n] = 1;
+				out[n++] = b[j];
+			}
+			j++;
+		}
+		else{
+			if(kind != CSET_VIEW_DIFFERENCE){
+				if(outCounts){
+					outCounts[n] = aCounts[i] + 1;
+				}
+				out[n++] = a[i];
+			}
+			i++;
+			j++;
+		}
+	}
+	while(i < na && kind != CSET_VIEW_INTERSECTION){
+		if(outCounts){
+			outCounts[n] = aCounts[i];
+		}
+		out[n++] = a[i++];
+	}
+	while(j < nb && kind == CSET_VIEW_UNION){
+		outCounts[n] = 1;
+		out[n++] = b[j++];
+	}
+	return n;
+};
+
+/**
+ * Applies the sorted, distinct pending values to Result in one merge pass
+ * and replaces Result with the outcome
+ * @param  pView the view, with no lost deltas
+ * @return bool whether the allocation was successful
+ */
+bool View_Merge_Pending(CSet_View* pView){
+	const CSet* pRes = &pView->Result;
+	bool counted = pView->Kind == CSET_VIEW_UNION;
+	size_t bound = (size_t) pRes->Usage + pView->PendingCount;
+	int32_t* data = (int32_t*) malloc(sizeof(int32_t) * bound);
+	uint32_t* counts = counted ? (uint32_t*) malloc(sizeof(uint32_t) * bound) : NULL;
+	if(!data || (counted && !counts)){
+		free(data);
+		free(counts);
+		return false;
+	}
+	uint32_t i = 0;
+	uint32_t j = 0;
+	uint32_t n = 0;
+	while(i < pRes->Usage || j < pView->PendingCount){
+		if(j == pView->PendingCount || (i < pRes->Usage && pRes->Data[i] < pView->Pending[j])){
+			if(counted){
+				counts[n] = pView->Counts[i];
+			}
+			data[n++] = pRes->Data[i++];
+			continue;
+		}
+		int32_t val = pView->Pending[j++];
+		if(i < pRes->Usage && pRes->Data[i] == val){
+			i++;
+		}
+		if(counted){
+			uint32_t holders = View_Holders(pView, val);
+			if(holders > 0){
+				counts[n] = holders;
+				data[n++] = val;
+			}
+		}
+		else if(View_Member(pView, val, NULL, false)){
+			data[n++] = val;
+		}
+	}
+	bool success = View_Load_Result(pView, data, counts, n);
+	free(data);
+	free(counts);
+	return success;
+};
+
+/**
+ * Replaces Result with data[0:n-1], and Counts with counts[0:n-1] for a union
+ * @param  pView  the view
+ * @param  data   the sorted elements of the view
+ * @param  counts their counts, or NULL unless the view is a union
+ * @param  n      the number of elements
+ * @return bool whether the allocation was successful; on failure Result and
+ *         Counts are unchanged
+ */
+bool View_Load_Result(CSet_View* pView, const int32_t* data, const uint32_t* counts, uint32_t n){
+	if(counts && !View_Reserve_Counts(pView, n)){
+		return false;
+	}
+	if(!CSet_Load(&pView->Result, View_Capacity(n), data, n)){
+		return false;
+	}
+	if(counts && n > 0){
+		memcpy(pView->Counts, counts, sizeof(uint32_t) * (size_t) n);
+	}
+	return true;
+};
+
+/**
+ * Chooses the capacity of a rebuilt Result, leaving room to absorb deltas
+ * @param  n the number of elements
+ * @return uint32_t the capacity, at least n + 1
+ */
+uint32_t View_Capacity(uint32_t n){
+	uint64_t cap = (uint64_t) n + n / 2 + 1;
+	if(cap < VIEW_MIN_CAPACITY){
+		cap = VIEW_MIN_CAPACITY;
+	}
+	return cap > UINT32_MAX ? UINT32_MAX : (uint32_t) cap;
+};
+
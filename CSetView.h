@@ -0,0 +1,52 @@
+#ifndef CSET_VIEW_H
+#define CSET_VIEW_H
+#include "CSet.h"
+
+// Kinds of materialized view
+#define CSET_VIEW_UNION        0   // elements of any input
+#define CSET_VIEW_INTERSECTION 1   // elements of every input
+#define CSET_VIEW_DIFFERENCE   2   // elements of the first input and of no other
+
+struct _CSet_View;
+
+// One input of a view: the observer attached to the input set
+struct _CSet_View_Input {
+
+   struct _CSet_View* pView; // view the input belongs to
+   CSet* pSet;           // the input set
+   CSet_Observer Observer;
+};
+
+typedef struct _CSet_View_Input CSet_View_Input;
+
+// A set derived from its inputs and kept current as they change. Result may
+// be read, searched, or observed (including by other views), but must only
+// be modified by the view.
+struct _CSet_View {
+
+   uint32_t Kind;        // CSET_VIEW_* kind
+   CSet Result;          // the maintained contents
+   uint32_t* Counts;     // UNION: number of inputs holding Result.Data[i]
+   uint32_t CountCap;    // dimension of Counts
+   CSet_View_Input* Inputs; // the InputCount inputs, in order
+   uint32_t InputCount;  // number of inputs
+   int32_t* Pending;     // values changed in an input since CSet_View_Begin
+   uint32_t PendingCount; // number of values in Pending
+   uint32_t PendingCap;  // dimension of Pending
+   bool Batching;        // deltas are collected in Pending until CSet_View_Commit
+   bool Stale;           // a delta was lost; Result is rebuilt by Commit or Refresh
+};
+
+typedef struct _CSet_View CSet_View;
+
+bool CSet_View_Init(CSet_View* const pView, uint32_t Kind, CSet* const* const Inputs, uint32_t InputCount);
+
+void CSet_View_Begin(CSet_View* const pView);
+
+bool CSet_View_Commit(CSet_View* const pView);
+
+bool CSet_View_Refresh(CSet_View* const pView);
+
+void CSet_View_Free(CSet_View* const pView);
+
+#endif
@@ -1,5 +1,25 @@
 #include "CSet.h"
+#include "CSetIngest.h"
+#include "CSetServer.h"
+#include "CSetSketch.h"
+#include "CSetStore.h"
+#include "CSetKernels.h"
+#include "CSetExternal.h"
+#include "CSetView.h"
+#include "CSetBatch.h"
+#include "CSetPMA.h"
+#include "CSetFrozen.h"
+#include "CSetTrace.h"
+#include "CSetReplay.h"
+#include "CSetShared.h"
+#include "CSetJoin.h"
+#include "CSetFixed.h"
 #include <assert.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
 
 
 void Test_Init(){
@@ -19,6 +39,7 @@ void Test_Init(){
 void Test_Load(){
 	printf("Test_Load()----------------------------------------------\n");
 	CSet set;
+	CSet_Init(&set, 0);
 	int32_t* Data = (int32_t*) malloc(sizeof(int32_t) * 10);
 	Data[0] = 0;
 	Data[9] = 9;
@@ -154,6 +175,60 @@ void Test_Remove(){
 	printf("%s\n", "Passed Remove Tests...\n");	
 }
 
+bool Is_Multiple_Of_Three(int32_t Value, void* Ctx){
+	(void) Ctx;
+	return Value % 3 == 0;
+}
+
+void Test_Bulk_Remove(){
+	printf("Test_Bulk_Remove()----------------------------------------------\n");
+	CSet set;
+	CSet expected;
+	CSet_Init(&set, 0);
+	CSet_Init(&expected, 0);
+	int32_t i = 0;
+	while(i < 100){
+		CSet_Insert(&set, i);
+		i++;
+	}
+
+	int32_t batch[6] = {50, 7, 3, 200, 7, 99};
+	assert(CSet_RemoveMany(&set, batch, 6) == 4);
+	assert(set.Usage == 96);
+	assert(!CSet_Contains(&set, 3));
+	assert(!CSet_Contains(&set, 50));
+	assert(!CSet_Contains(&set, 99));
+	assert(CSet_Contains(&set, 98));
+	assert(set.Data[set.Usage] == INT32_MAX);
+
+	assert(CSet_RemoveRange(&set, 10, 40) == 30);
+	assert(CSet_RemoveRange(&set, 10, 40) == 0);
+	assert(!CSet_Contains(&set, 10));
+	assert(!CSet_Contains(&set, 39));
+	assert(CSet_Contains(&set, 9));
+	assert(CSet_Contains(&set, 40));
+
+	assert(CSet_RemoveIf(&set, Is_Multiple_Of_Three, NULL) == 22);
+	i = 0;
+	while(i < 100){
+		if(i != 3 && i != 7 && i != 50 && i != 99 && (i < 10 || i >= 40) && i % 3 != 0){
+			CSet_Insert(&expected, i);
+		}
+		i++;
+	}
+	assert(CSet_Equals(&set, &expected));
+	assert(CSet_Hash(&set) == CSet_Hash(&expected));
+
+	assert(set.Capacity == 160);
+	assert(CSet_Shrink(&set, 30) == true);
+	assert(set.Capacity == 2 * set.Usage);
+	assert(CSet_Shrink(&set, 30) == false);
+	assert(CSet_Equals(&set, &expected));
+	CSet_Insert(&set, 3);
+	assert(CSet_Contains(&set, 3));
+	printf("%s\n", "Passed Bulk Remove Tests...\n");	
+}
+
 void Test_Equals(){
 	printf("Test_Equals()----------------------------------------------\n");
 	CSet setA;
@@ -186,6 +261,44 @@ void Test_Equals(){
 	printf("%s\n", "Passed Equals Tests...\n");	
 }
 
+void Test_Hash(){
+	printf("Test_Hash()----------------------------------------------\n");
+	CSet setA;
+	CSet setB;
+	CSet copy;
+	CSet_Init(&setA, 0);
+	CSet_Init(&setB, 0);
+	CSet_Init(&copy, 0);
+
+	assert(CSet_Hash(&setA) == 0);
+
+	CSet_Insert(&setA, 2);
+	CSet_Insert(&setA, 3);
+	CSet_Insert(&setA, 4);
+
+	CSet_Insert(&setB, 4);
+	CSet_Insert(&setB, 9);
+	CSet_Insert(&setB, 2);
+	assert(CSet_Hash(&setA) != CSet_Hash(&setB));
+
+	CSet_Remove(&setB, 9);
+	CSet_Insert(&setB, 3);
+	assert(CSet_Hash(&setA) == CSet_Hash(&setB));
+	assert(CSet_Equals(&setA, &setB) == true);
+
+	int32_t Data[3] = {2, 3, 4};
+	CSet_Load(&copy, 10, Data, 3);
+	assert(CSet_Hash(&copy) == CSet_Hash(&setA));
+	CSet_Copy(&copy, &setB);
+	assert(CSet_Hash(&copy) == CSet_Hash(&setA));
+
+	CSet_makeEmpty(&setA);
+	assert(CSet_Hash(&setA) == 0);
+	assert(CSet_Equals(&setA, &setB) == false);
+
+	printf("%s\n", "Passed Hash Tests...\n");	
+}
+
 void Test_Is_Subset_Of(){
 	printf("Test_Is_Subset_Of()----------------------------------------------\n");
 	CSet setA;
@@ -219,6 +332,102 @@ void Test_Is_Subset_Of(){
 	printf("%s\n", "Passed isSubsetOf Tests...\n");	
 }
 
+void Test_Intersects(){
+	printf("Test_Intersects()----------------------------------------------\n");
+	CSet setA;
+	CSet setB;
+	CSet setC;
+	CSet nullSet;
+	CSet_Init(&nullSet, 0);
+	CSet_Init(&setA, 0);
+	CSet_Init(&setB, 0);
+	CSet_Init(&setC, 0);
+
+	CSet_Insert(&setA, 2);
+	CSet_Insert(&setA, 4);
+	CSet_Insert(&setA, 6);
+
+	CSet_Insert(&setB, 1);
+	CSet_Insert(&setB, 3);
+	CSet_Insert(&setB, 6);
+
+	CSet_Insert(&setC, 1);
+	CSet_Insert(&setC, 5);
+
+	assert(CSet_Intersects(&setA, &setB) == true);
+	assert(CSet_Intersects(&setA, &setC) == false);
+	assert(CSet_Intersects(&setA, &nullSet) == false);
+	printf("%s\n", "Passed Intersects Tests...\n");	
+}
+
+void Test_Summary(){
+	printf("Test_Summary()----------------------------------------------\n");
+	CSet set;
+	CSet plain;
+	CSet sub;
+	CSet far;
+	CSet_Init(&set, 0);
+	CSet_Init(&plain, 0);
+	CSet_Init(&sub, 0);
+	CSet_Init(&far, 0);
+	int32_t i = 0;
+	while(i < 1000){
+		CSet_Insert(&set, i);
+		CSet_Insert(&plain, i);
+		i += 2;
+	}
+	assert(CSet_BuildSummary(&set));
+	assert(set.Summary != NULL);
+	i = -10;
+	while(i < 1010){
+		assert(CSet_Contains(&set, i) == CSet_Contains(&plain, i));
+		i++;
+	}
+
+	i = 1;
+	while(i < 3000){
+		CSet_Insert(&set, i);
+		CSet_Insert(&plain, i);
+		i += 6;
+	}
+	i = 0;
+	while(i < 1000){
+		CSet_Remove(&set, i);
+		CSet_Remove(&plain, i);
+		i += 8;
+	}
+	assert(set.Summary != NULL);
+	i = -10;
+	while(i < 3010){
+		assert(CSet_Contains(&set, i) == CSet_Contains(&plain, i));
+		i++;
+	}
+
+	CSet_Insert(&sub, 2);
+	CSet_Insert(&sub, 998);
+	CSet_Insert(&sub, 2995);
+	assert(CSet_isSubsetOf(&sub, &set) == true);
+	CSet_Insert(&sub, 3);
+	assert(CSet_isSubsetOf(&sub, &set) == false);
+
+	i = 5000;
+	while(i < 5100){
+		CSet_Insert(&far, i);
+		i++;
+	}
+	assert(CSet_BuildSummary(&far));
+	assert(CSet_Intersects(&set, &far) == false);
+	CSet_Insert(&far, 998);
+	assert(CSet_Intersects(&set, &far) == true);
+
+	CSet_DropSummary(&set);
+	assert(set.Summary == NULL);
+	assert(CSet_Contains(&set, 998));
+	CSet_makeEmpty(&far);
+	assert(far.Summary == NULL);
+	printf("%s\n", "Passed Summary Tests...\n");	
+}
+
 void Test_Union(){
 	printf("Test_Union()----------------------------------------------\n");
 	CSet setA;
@@ -321,6 +530,1743 @@ void Test_Difference(){
 	printf("%s\n", "Passed Difference Tests...\n");
 }
 
+void Test_Ingest(){
+	printf("Test_Ingest()----------------------------------------------\n");
+	const char* textPath = "/tmp/cset_ingest_test.txt";
+	const char* binPath = "/tmp/cset_ingest_test.bin";
+	CSet expected;
+	CSet set;
+	CSet_Init(&expected, 0);
+	CSet_Init(&set, 0);
+
+	FILE* text = fopen(textPath, "w");
+	FILE* bin = fopen(binPath, "wb");
+	assert(text && bin);
+	int32_t i = 0;
+	while(i < 200000){
+		int32_t val = (int32_t)(((uint32_t)i * 2654435761u) % 150000u) - 75000;
+		if(i % 7 == 0){
+			val = val * 20000 + 123456789;
+		}
+		fprintf(text, "%d\n", val);
+		unsigned char bytes[4] = {(unsigned char)val, (unsigned char)(val >> 8),
+			(unsigned char)(val >> 16), (unsigned char)((uint32_t)val >> 24)};
+		fwrite(bytes, 1, 4, bin);
+		CSet_Insert(&expected, val);
+		i++;
+	}
+	fclose(text);
+	fclose(bin);
+
+	assert(CSet_IngestText(&set, textPath, 4));
+	assert(CSet_Equals(&set, &expected));
+	assert(set.Data[set.Usage] == INT32_MAX);
+	CSet_makeEmpty(&set);
+	assert(CSet_IngestText(&set, textPath, 1));
+	assert(CSet_Equals(&set, &expected));
+	CSet_makeEmpty(&set);
+	assert(CSet_IngestBinary(&set, binPath, 0));
+	assert(CSet_Equals(&set, &expected));
+
+	text = fopen(textPath, "w");
+	fprintf(text, "1\n2\nfoo\n");
+	fclose(text);
+	assert(CSet_IngestText(&set, textPath, 2) == false);
+	assert(CSet_Equals(&set, &expected));
+	text = fopen(textPath, "w");
+	fprintf(text, "2147483648\n");
+	fclose(text);
+	assert(CSet_IngestText(&set, textPath, 2) == false);
+	text = fopen(textPath, "w");
+	fprintf(text, "-2147483648\n2147483646\n 00000000000000000042 \n");
+	fclose(text);
+	assert(CSet_IngestText(&set, textPath, 2));
+	assert(set.Usage == 3);
+	assert(set.Data[0] == INT32_MIN);
+	assert(set.Data[1] == 42);
+	remove(textPath);
+	remove(binPath);
+	printf("%s\n", "Passed Ingest Tests...\n");
+}
+
+void Count_Ownership_Reset(void* Ctx, const CSet* pSet){
+	(void) pSet;
+	(*(uint32_t*) Ctx)++;
+}
+
+void* Run_Server_Thread(void* pServer){
+	CSet_Server_Run((CSet_Server*) pServer);
+	return NULL;
+}
+
+struct _Server_Client_Job {
+
+   const char* Path;     // socket of the server
+   uint32_t Seed;        // seed of the probes
+   uint32_t Wrong;       // answers that disagreed with the published sets
+};
+
+typedef struct _Server_Client_Job Server_Client_Job;
+
+void* Run_Server_Client(void* pArg){
+	Server_Client_Job* pJob = (Server_Client_Job*) pArg;
+	int fd = CSet_Client_Connect(pJob->Path);
+	if(fd < 0){
+		pJob->Wrong++;
+		return NULL;
+	}
+	int32_t probes[64];
+	bool results[64];
+	uint32_t pass = 0;
+	while(pass < 200){
+		uint32_t i = 0;
+		while(i < 64){
+			pJob->Seed = pJob->Seed * 1103515245u + 12345u;
+			probes[i] = (int32_t)((pJob->Seed >> 8) % 1200) - 100;
+			i++;
+		}
+		const char* name = (pass & 1) ? "odds" : "evens";
+		if(CSet_Client_ContainsMany(fd, name, probes, 64, results) != CSET_STATUS_OK){
+			pJob->Wrong++;
+		}
+		i = 0;
+		while(i < 64){
+			bool member = probes[i] >= 0 && probes[i] < 1000 && (uint32_t)(probes[i] % 2) == (pass & 1);
+			pJob->Wrong += results[i] != member;
+			i++;
+		}
+		bool found = true;
+		if(CSet_Client_Contains(fd, name, 1000 + (int32_t) pass, &found) != CSET_STATUS_OK || found){
+			pJob->Wrong++;
+		}
+		pass++;
+	}
+	close(fd);
+	return NULL;
+}
+
+void Test_Server(){
+	printf("Test_Server()----------------------------------------------\n");
+	const char* sockPath = "/tmp/cset_server_test.sock";
+	char root[] = "/tmp/cset_server_rootXXXXXX";
+	assert(mkdtemp(root) != NULL);
+	char textPath[64], linkPath[64];
+	const char* outsidePath = "/tmp/cset_server_outside.txt";
+	snprintf(textPath, sizeof(textPath), "%s/small.txt", root);
+	snprintf(linkPath, sizeof(linkPath), "%s/escape.txt", root);
+	CSet_Server* pServer = CSet_Server_Create(sockPath);
+	assert(pServer);
+	CSet evens;
+	CSet odds;
+	CSet_Init(&evens, 0);
+	CSet_Init(&odds, 0);
+	int32_t i = 0;
+	while(i < 1000){
+		CSet_Insert(i % 2 ? &odds : &evens, i);
+		i++;
+	}
+	uint32_t resets = 0;
+	CSet_Observer observer = {NULL, NULL, Count_Ownership_Reset, &resets, NULL};
+	CSet_Attach(&odds, &observer);
+	assert(CSet_Server_Publish(pServer, "evens", &evens));
+	assert(CSet_Server_Publish(pServer, "odds", &odds));
+	assert(CSet_isEmpty(&evens) && CSet_isEmpty(&odds) && resets == 1);
+
+	// The observer stays with the caller's set, not the published copy
+	CSet_Insert(&odds, 1);
+	assert(CSet_Server_Publish(pServer, "spare", &odds) && resets == 2);
+	CSet_Init(&evens, 0);
+	assert(CSet_Server_Publish(pServer, "spare", &evens) && resets == 2);
+	assert(CSet_Detach(&odds, &observer));
+	pthread_t tid;
+	assert(pthread_create(&tid, NULL, Run_Server_Thread, pServer) == 0);
+
+	int fd = CSet_Client_Connect(sockPath);
+	assert(fd >= 0);
+	bool found = false;
+	assert(CSet_Client_Contains(fd, "evens", 42, &found) == CSET_STATUS_OK && found);
+	assert(CSet_Client_Contains(fd, "evens", 43, &found) == CSET_STATUS_OK && !found);
+	assert(CSet_Client_Contains(fd, "nope", 43, &found) == CSET_STATUS_NO_SUCH_SET);
+
+	int32_t probes[2000];
+	bool results[2000];
+	i = 0;
+	while(i < 2000){
+		probes[i] = 1999 - i;
+		i++;
+	}
+	assert(CSet_Client_ContainsMany(fd, "odds", probes, 2000, results) == CSET_STATUS_OK);
+	i = 0;
+	while(i < 2000){
+		assert(results[i] == (probes[i] < 1000 && probes[i] % 2 == 1));
+		i++;
+	}
+
+	uint32_t size = 0;
+	assert(CSet_Client_Size(fd, "odds", &size) == CSET_STATUS_OK && size == 500);
+	CSet result;
+	CSet_Init(&result, 0);
+	assert(CSet_Client_SetOp(fd, CSET_OP_UNION, "evens", "odds", &result) == CSET_STATUS_OK);
+	assert(result.Usage == 1000);
+	assert(CSet_Client_SetOp(fd, CSET_OP_INTERSECTION, "evens", "odds", &result) == CSET_STATUS_OK);
+	assert(result.Usage == 0);
+
+	FILE* text = fopen(textPath, "w");
+	fprintf(text, "4\n5\n6\n");
+	fclose(text);
+	text = fopen(outsidePath, "w");
+	fprintf(text, "7\n");
+	fclose(text);
+	assert(symlink(outsidePath, linkPath) == 0);
+	void* reply = NULL;
+	uint32_t len = 0;
+
+	// Loads are refused until a root is set, then confined to it
+	assert(CSet_Client_Request(fd, CSET_OP_LOAD, "small", NULL, "small.txt", 9, &reply, &len) == CSET_STATUS_DENIED);
+	CSet_Server_Stop(pServer);
+	pthread_join(tid, NULL);
+
+	// Stopping closes every open connection
+	char eof;
+	assert(read(fd, &eof, 1) == 0);
+	close(fd);
+	assert(!CSet_Server_AllowLoads(pServer, textPath) && CSet_Server_AllowLoads(pServer, root));
+	assert(pthread_create(&tid, NULL, Run_Server_Thread, pServer) == 0);
+	fd = CSet_Client_Connect(sockPath);
+	assert(fd >= 0);
+	const char* denied[5] = {textPath, "../small.txt", "x/../small.txt", "escape.txt", "missing.txt"};
+	i = 0;
+	while(i < 5){
+		assert(CSet_Client_Request(fd, CSET_OP_LOAD, "small", NULL, denied[i], strlen(denied[i]),
+			&reply, &len) == CSET_STATUS_DENIED);
+		i++;
+	}
+	assert(CSet_Client_Request(fd, CSET_OP_LOAD, "small", NULL, "./small.txt", 11, &reply, &len) == CSET_STATUS_OK);
+	free(reply);
+	assert(CSet_Client_SetOp(fd, CSET_OP_DIFFERENCE, "small", "evens", &result) == CSET_STATUS_OK);
+	assert(result.Usage == 1 && result.Data[0] == 5);
+	remove(linkPath);
+	remove(textPath);
+	remove(outsidePath);
+	rmdir(root);
+
+	int fd2 = CSet_Client_Connect(sockPath);
+	assert(fd2 >= 0);
+	assert(CSet_Client_Contains(fd2, "small", 6, &found) == CSET_STATUS_OK && found);
+	close(fd2);
+
+	// Concurrent clients, whose pending probes the server answers in shared batches
+	Server_Client_Job jobs[4];
+	pthread_t clients[4];
+	i = 0;
+	while(i < 4){
+		jobs[i].Path = sockPath;
+		jobs[i].Seed = (uint32_t) i * 7919u + 1;
+		jobs[i].Wrong = 0;
+		assert(pthread_create(&clients[i], NULL, Run_Server_Client, &jobs[i]) == 0);
+		i++;
+	}
+	i = 0;
+	while(i < 4){
+		pthread_join(clients[i], NULL);
+		assert(jobs[i].Wrong == 0);
+		i++;
+	}
+	assert(CSet_Client_Contains(fd, "evens", 998, &found) == CSET_STATUS_OK && found);
+	close(fd);
+
+	CSet_Server_Stop(pServer);
+	pthread_join(tid, NULL);
+	CSet_Server_Destroy(pServer);
+	CSet_makeEmpty(&result);
+	printf("%s\n", "Passed Server Tests...\n");
+}
+
+void Test_MinHash(){
+	printf("Test_MinHash()----------------------------------------------\n");
+	CSet sets[40];
+	CSet_MinHash sigs[40];
+	CSet_LSH index;
+	assert(CSet_LSH_Init(&index, 16, 4));
+	uint32_t s = 0;
+	while(s < 40){
+		CSet_Init(&sets[s], 0);
+		assert(CSet_MinHash_Init(&sigs[s], 64, 7));
+		CSet_MinHash_Track(&sigs[s], &sets[s]);
+		int32_t i = 0;
+		while(i < 200){
+			// sets 0..19 are near-copies of each other, 20..39 are disjoint
+			CSet_Insert(&sets[s], s < 20 ? i + (int32_t) s : 100000 * (int32_t) s + i);
+			i++;
+		}
+		assert(CSet_LSH_Insert(&index, s, &sigs[s]));
+		s++;
+	}
+
+	CSet_MinHash fresh;
+	assert(CSet_MinHash_Init(&fresh, 64, 7));
+	CSet_MinHash_Compute(&fresh, &sets[3]);
+	assert(memcmp(fresh.Mins, sigs[3].Mins, sizeof(uint32_t) * 64) == 0);
+	assert(CSet_MinHash_Similarity(&sigs[3], &sigs[3]) == 1.0);
+	assert(CSet_MinHash_Similarity(&sigs[3], &sigs[4]) > 0.8);
+	assert(CSet_MinHash_Similarity(&sigs[3], &sigs[30]) == 0.0);
+	assert(CSet_Jaccard(&sets[3], &sets[4]) == 199.0 / 201.0);
+	assert(CSet_Jaccard(&sets[3], &sets[30]) == 0.0);
+
+	uint32_t ids[40];
+	uint32_t n = CSet_LSH_Query(&index, &sigs[5], ids, 40);
+	assert(n >= 10 && n <= 20);
+	uint32_t i = 0;
+	bool self = false;
+	while(i < n){
+		assert(ids[i] < 20);
+		self = self || ids[i] == 5;
+		i++;
+	}
+	assert(self);
+	assert(CSet_LSH_Query(&index, &sigs[25], ids, 40) == 1 && ids[0] == 25);
+
+	CSet_Remove(&sets[3], 3);
+	CSet_MinHash_Compute(&fresh, &sets[3]);
+	assert(sigs[3].Stale || memcmp(fresh.Mins, sigs[3].Mins, sizeof(uint32_t) * 64) == 0);
+	CSet_MinHash_Compute(&sigs[3], &sets[3]);
+	assert(!sigs[3].Stale);
+
+	CSet_MinHash_Free(&fresh);
+	CSet_LSH_Free(&index);
+	s = 0;
+	while(s < 40){
+		CSet_MinHash_Free(&sigs[s]);
+		assert(sets[s].Observers == NULL);
+		CSet_makeEmpty(&sets[s]);
+		s++;
+	}
+	printf("%s\n", "Passed MinHash Tests...\n");
+}
+
+void Test_Store(){
+	printf("Test_Store()----------------------------------------------\n");
+	CSet_Store store;
+	assert(CSet_Store_Init(&store, 0));
+	CSet small;
+	CSet view;
+	CSet_Init(&small, 0);
+	CSet_Init(&view, 0);
+	CSet_Insert(&small, 5);
+	CSet_Insert(&small, 1);
+	CSet_Insert(&small, 9);
+	uint32_t id = 0;
+	assert(CSet_Store_Append(&store, &small, &id) && id == 0);
+
+	int32_t values[100];
+	uint32_t i = 0;
+	while(i < 1000){
+		uint32_t n = i % 7, k = 0;
+		while(k < n){
+			values[k] = (int32_t)(i * 10 + k);
+			k++;
+		}
+		assert(CSet_Store_AppendSorted(&store, values, n, &id) && id == i + 1);
+		i++;
+	}
+	int32_t unsorted[2] = {3, 2};
+	assert(CSet_Store_AppendSorted(&store, unsorted, 2, &id) == false);
+	assert(CSet_Store_Count(&store) == 1001);
+
+	assert(CSet_Store_View(&store, 0, &view));
+	assert(CSet_Equals(&view, &small));
+	assert(CSet_Hash(&view) == CSet_Hash(&small));
+	assert(CSet_Contains(&view, 9) && !CSet_Contains(&view, 4));
+	assert(CSet_Insert(&view, 4) == false);
+	assert(CSet_Remove(&view, 5) == false);
+
+	assert(CSet_Store_View(&store, 13, &view));
+	assert(view.Usage == 5 && view.Data[0] == 120 && view.Data[5] == INT32_MAX);
+	assert(CSet_Store_View(&store, 15, &view));
+	assert(CSet_isEmpty(&view) && !CSet_Contains(&view, 0));
+
+	values[0] = -4;
+	assert(CSet_Store_Rewrite(&store, 0, values, 1));
+	i = 0;
+	while(i < 100){
+		values[i] = (int32_t) i;
+		i++;
+	}
+	uint32_t round = 0;
+	while(round < 50){
+		assert(CSet_Store_Rewrite(&store, 1 + round, values, 100));
+		round++;
+	}
+	assert(CSet_Store_View(&store, 0, &view));
+	assert(view.Usage == 1 && view.Data[0] == -4);
+	assert(CSet_Store_View(&store, 20, &view));
+	assert(view.Usage == 100 && CSet_Contains(&view, 99));
+	assert(CSet_Store_Compact(&store));
+	assert(store.Dead == 0);
+	assert(CSet_Store_View(&store, 20, &view));
+	assert(view.Usage == 100 && CSet_Contains(&view, 99));
+	assert(CSet_Store_View(&store, 60, &view));
+	assert(view.Usage == 59 % 7 && view.Data[0] == 590);
+
+	CSet_makeEmpty(&view);
+	assert(view.Data == NULL && view.Flags == 0);
+	CSet_Store_Free(&store);
+	CSet_makeEmpty(&small);
+	printf("%s\n", "Passed Store Tests...\n");
+}
+
+void Test_HLL(){
+	printf("Test_HLL()------------------------------------------------\n");
+	CSet a, b, c;
+	CSet_Init(&a, 0);
+	CSet_Init(&b, 0);
+	CSet_Init(&c, 0);
+	CSet_HLL ha, hb, hc;
+	assert(CSet_HLL_Init(&ha, 3) == false);
+	assert(CSet_HLL_Init(&ha, 12));
+	assert(CSet_HLL_Init(&hb, 12));
+	assert(CSet_HLL_Init(&hc, 10));
+	assert(CSet_HLL_Estimate(&ha) == 0.0);
+
+	CSet_HLL_Track(&ha, &a);
+	int32_t i = 0;
+	while(i < 200){
+		CSet_Insert(&a, i * 3);
+		i++;
+	}
+	assert(ha.Registers == NULL && ha.SparseCount > 0);
+	double e = CSet_HLL_Estimate(&ha);
+	assert(e > 180 && e < 220);
+	while(i < 20000){
+		CSet_Insert(&a, i * 3);
+		i++;
+	}
+	assert(ha.Registers != NULL && ha.Sparse == NULL);
+	e = CSet_HLL_Estimate(&ha);
+	assert(e > 20000 * 0.94 && e < 20000 * 1.06);
+
+	// A sketch that lost inserts is rebuilt from its set by the next estimate
+	memset(ha.Registers, 0, (size_t) 1 << ha.P);
+	ha.Stale = true;
+	assert(CSet_HLL_Estimate(&ha) == e && !ha.Stale);
+
+	i = 10000;
+	while(i < 40000){
+		CSet_Insert(&b, i * 3);
+		i++;
+	}
+	assert(CSet_HLL_Build(&hb, &b));
+	assert(CSet_HLL_Merge(&hb, &ha));
+	e = CSet_HLL_Estimate(&hb);
+	assert(e > 40000 * 0.94 && e < 40000 * 1.06);
+	assert(CSet_HLL_Merge(&hc, &ha) == false);
+
+	CSet_Insert(&c, 7);
+	CSet_Insert(&c, -7);
+	FILE* f = tmpfile();
+	assert(f);
+	assert(CSet_Write(&a, f) && CSet_HLL_Write(&ha, f));
+	assert(CSet_Write(&c, f));
+	assert(CSet_HLL_Init(&hc, 10) && CSet_HLL_Build(&hc, &c) && CSet_HLL_Write(&hc, f));
+	rewind(f);
+	CSet r;
+	CSet_HLL hr;
+	CSet_Init(&r, 0);
+	CSet_HLL_Init(&hr, 4);
+	assert(CSet_Read(&r, f) && CSet_Equals(&r, &a));
+	assert(CSet_HLL_Read(&hr, f) && CSet_HLL_Estimate(&hr) == CSet_HLL_Estimate(&ha));
+	assert(CSet_Read(&r, f) && CSet_Equals(&r, &c));
+	assert(CSet_HLL_Read(&hr, f) && hr.Registers == NULL && hr.SparseCount == 2);
+	assert(CSet_Read(&r, f) == false);
+	fclose(f);
+
+	// Corrupt sparse pairs are rejected: index out of range, out of order, bad rank
+	uint32_t corrupt[3][5] = {
+		{0x314C4C48u, 4, 2, (3u << 8) | 1, (16u << 8) | 1},
+		{0x314C4C48u, 4, 2, (5u << 8) | 1, (5u << 8) | 2},
+		{0x314C4C48u, 4, 2, (3u << 8) | 1, (5u << 8) | 62}};
+	uint32_t k = 0;
+	while(k < 3){
+		f = tmpfile();
+		assert(f && fwrite(corrupt[k], sizeof(uint32_t), 5, f) == 5);
+		rewind(f);
+		assert(!CSet_HLL_Read(&hr, f) && hr.Sparse == NULL && hr.Registers == NULL);
+		fclose(f);
+		k++;
+	}
+
+	CSet_HLL_Free(&ha);
+	CSet_Insert(&a, -1);
+	CSet_HLL_Free(&hb);
+	CSet_HLL_Free(&hc);
+	CSet_HLL_Free(&hr);
+	CSet_makeEmpty(&a);
+	CSet_makeEmpty(&b);
+	CSet_makeEmpty(&c);
+	CSet_makeEmpty(&r);
+	printf("%s\n", "Passed HLL Tests...\n");
+}
+
+void Test_Kernels(){
+	printf("Test_Kernels()--------------------------------------------\n");
+	const char* names[4] = {"scalar", "sse4.2", "avx2", "avx512"};
+	const CSet_Kernels* best = CSet_Kernels_Get();
+	assert(CSet_Kernels_Select("scalar"));
+	assert(CSet_Kernels_Select("mmx") == false);
+	assert(strcmp(CSet_Kernels_Get()->Name, "scalar") == 0);
+	uint32_t big = (1u << 20) + 37;
+	int32_t* src = (int32_t*) malloc(sizeof(int32_t) * big);
+	int32_t* dst = (int32_t*) malloc(sizeof(int32_t) * (big + 1));
+	uint32_t i = 0;
+	while(i < big){
+		src[i] = (int32_t)(i * 2) - 1000;
+		i++;
+	}
+	uint32_t k = 0;
+	while(k < 4){
+		if(!CSet_Kernels_Select(names[k])){
+			k++;
+			continue;
+		}
+		const CSet_Kernels* kern = CSet_Kernels_Get();
+		uint32_t n = 0;
+		while(n < 100){
+			kern->Fill(dst, 7, n + 1);
+			dst[n + 1] = -1;
+			kern->Fill(dst, INT32_MAX, n);
+			assert(n == 0 || dst[n - 1] == INT32_MAX);
+			assert(dst[n] == 7 && dst[n + 1] == -1);
+			kern->Copy(dst + 1, src, n);
+			assert(kern->Equal(dst + 1, src, n));
+			if(n > 0){
+				dst[n] = 12345;
+				assert(kern->Equal(dst + 1, src, n) == false);
+			}
+			int32_t key = -1003;
+			while(key < (int32_t)(n * 2) - 995){
+				uint32_t expect = 0;
+				while(expect < n && src[expect] < key){
+					expect++;
+				}
+				assert(kern->LowerBound(src, n, key) == expect);
+				key++;
+			}
+			assert(kern->LowerBound(src, n, INT32_MIN) == 0);
+			assert(kern->LowerBound(src, n, INT32_MAX) == n);
+			n++;
+		}
+		kern->Copy(dst + 1, src, big);
+		assert(kern->Equal(dst + 1, src, big));
+		assert(kern->LowerBound(src, big, src[big / 3]) == big / 3);
+		assert(kern->LowerBound(src, big, src[big - 1] + 1) == big);
+
+		CSet a, b;
+		CSet_Init(&a, 0);
+		CSet_Init(&b, 0);
+		i = 0;
+		while(i < 500){
+			assert(CSet_Insert(&a, (int32_t)((i * 7919) % 1000)));
+			i++;
+		}
+		assert(CSet_Insert(&a, 7919 % 1000) == false);
+		assert(CSet_Contains(&a, 919) && !CSet_Contains(&a, 1000));
+		assert(CSet_Copy(&b, &a) && CSet_Equals(&a, &b));
+		assert(CSet_Remove(&b, 919) && !CSet_Equals(&a, &b));
+		assert(CSet_RemoveRange(&a, 100, 900) > 0 && a.Data[a.Usage] == INT32_MAX);
+		CSet_makeEmpty(&a);
+		CSet_makeEmpty(&b);
+		k++;
+	}
+	assert(CSet_Kernels_Select(NULL));
+	assert(CSet_Kernels_Select(best->Name) && CSet_Kernels_Get() == best);
+	free(src);
+	free(dst);
+	printf("%s\n", "Passed Kernels Tests...\n");
+}
+
+int Compare_Test_Values(const void* a, const void* b){
+	int32_t x = *(const int32_t*)a;
+	int32_t y = *(const int32_t*)b;
+	return (x > y) - (x < y);
+}
+
+uint32_t Sorted_Distinct(int32_t* values, uint32_t n){
+	qsort(values, n, sizeof(int32_t), Compare_Test_Values);
+	uint32_t write = 0, read = 0;
+	while(read < n){
+		if(write == 0 || values[write - 1] != values[read]){
+			values[write++] = values[read];
+		}
+		read++;
+	}
+	return write;
+}
+
+void Test_External(){
+	printf("Test_External()-------------------------------------------\n");
+	char dir[] = "/tmp/cset_external_XXXXXX";
+	assert(mkdtemp(dir));
+	char rawPath[64], aPath[64], bPath[64], outPath[64];
+	snprintf(rawPath, sizeof(rawPath), "%s/raw", dir);
+	snprintf(aPath, sizeof(aPath), "%s/a", dir);
+	snprintf(bPath, sizeof(bPath), "%s/b", dir);
+	snprintf(outPath, sizeof(outPath), "%s/out", dir);
+	CSet_External_Config config = {256u << 10, dir, true};
+
+	uint32_t n = 300000;
+	int32_t* values = (int32_t*) malloc(sizeof(int32_t) * n);
+	uint32_t i = 0;
+	while(i < n){
+		values[i] = (int32_t)(((uint32_t) i * 2654435761u) % 400000u) - 200000;
+		i++;
+	}
+	FILE* raw = fopen(rawPath, "wb");
+	assert(raw && fwrite(values, sizeof(int32_t), n, raw) == n);
+	fclose(raw);
+	uint32_t distinct = Sorted_Distinct(values, n);
+	CSet a, b, result, expected;
+	CSet_Init(&a, 0);
+	CSet_Init(&b, 0);
+	CSet_Init(&result, 0);
+	CSet_Init(&expected, 0);
+	assert(CSet_Load(&a, distinct + 1, values, distinct));
+
+	assert(CSet_External_Sort(rawPath, aPath, &config));
+	assert(CSet_External_Load(&result, aPath, &config));
+	assert(CSet_Equals(&result, &a) && result.Data[result.Usage] == INT32_MAX);
+
+	i = 0;
+	while(i < 100000){
+		values[i] = (int32_t)(i * 5) - 100000;
+		i++;
+	}
+	assert(CSet_Load(&b, 100001, values, 100000));
+	assert(CSet_External_Write(&b, bPath));
+
+	assert(CSet_Union(&expected, &a, &b));
+	assert(CSet_External_Union(aPath, bPath, NULL, &result, NULL));
+	assert(CSet_Equals(&result, &expected));
+	assert(CSet_External_Union(aPath, bPath, outPath, NULL, &config));
+	assert(CSet_External_Load(&result, outPath, NULL) && CSet_Equals(&result, &expected));
+
+	assert(CSet_Intersection(&expected, &a, &b));
+	assert(CSet_External_Intersection(aPath, bPath, outPath, NULL, &config));
+	assert(CSet_External_Load(&result, outPath, &config) && CSet_Equals(&result, &expected));
+
+	assert(CSet_Difference(&expected, &a, &b));
+	assert(CSet_External_Difference(aPath, bPath, NULL, &result, &config));
+	assert(CSet_Equals(&result, &expected));
+	assert(CSet_External_Difference(bPath, bPath, NULL, &result, &config));
+	assert(CSet_isEmpty(&result));
+
+	assert(CSet_External_Union(aPath, bPath, outPath, &result, &config) == false);
+	assert(CSet_External_Union(aPath, "/nonexistent/cset", NULL, &result, &config) == false);
+	assert(CSet_isEmpty(&result));
+	raw = fopen(rawPath, "wb");
+	int32_t bad[3] = {5, INT32_MAX, 1};
+	assert(raw && fwrite(bad, sizeof(int32_t), 3, raw) == 3);
+	fclose(raw);
+	remove(outPath);
+	assert(CSet_External_Sort(rawPath, outPath, &config) == false);
+	assert(access(outPath, F_OK) != 0);
+	assert(CSet_External_Load(&result, rawPath, &config) == false);
+
+	remove(rawPath);
+	remove(aPath);
+	remove(bPath);
+	assert(rmdir(dir) == 0);
+	free(values);
+	CSet_makeEmpty(&a);
+	CSet_makeEmpty(&b);
+	CSet_makeEmpty(&result);
+	CSet_makeEmpty(&expected);
+	printf("%s\n", "Passed External Tests...\n");
+}
+
+double Seconds_Since(const struct timespec* start){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void Test_Huge(){
+	printf("Test_Huge()-----------------------------------------------\n");
+	// 64 MiB and larger arrays are mapped; growth past that moves to a mapping
+	uint32_t n = 12000000;
+	int32_t* values = (int32_t*) malloc(sizeof(int32_t) * 20000000);
+	uint32_t i = 0;
+	while(i < 20000000){
+		values[i] = (int32_t) i * 3 - 30000000;
+		i++;
+	}
+	CSet set, copy, small;
+	CSet_Init(&set, 0);
+	CSet_Init(&copy, 0);
+	CSet_Init(&small, 0);
+	assert(CSet_Load(&set, n + 1, values, n));
+	assert(!(set.Flags & CSET_FLAG_MAPPED));
+	assert(CSet_Insert(&set, INT32_MAX - 1));
+	assert(set.Flags & CSET_FLAG_MAPPED);
+	assert(set.Capacity == 2 * (n + 1) && set.Usage == n + 1);
+	assert(CSet_Contains(&set, values[n - 1]) && CSet_Contains(&set, INT32_MAX - 1));
+	assert(set.Data[set.Usage] == INT32_MAX && set.Data[set.Capacity - 1] == INT32_MAX);
+
+	// Mapped arrays grow with mremap
+	n = 20000000;
+	assert(CSet_Load(&set, n + 1, values, n));
+	assert(set.Flags & CSET_FLAG_MAPPED);
+	assert(CSet_Insert(&set, -30000001));
+	assert(set.Capacity == 2 * (n + 1) && set.Data[0] == -30000001 && set.Data[n] == values[n - 1]);
+	assert(set.Data[set.Capacity - 1] == INT32_MAX);
+	assert(CSet_Remove(&set, values[n / 2]) && !CSet_Contains(&set, values[n / 2]));
+	assert(CSet_Copy(&copy, &set) && (copy.Flags & CSET_FLAG_MAPPED));
+	assert(CSet_Equals(&copy, &set));
+	assert(CSet_RemoveRange(&copy, -30000000, INT32_MAX) == n - 1);
+	assert(CSet_Shrink(&copy, 50) && copy.Capacity == 10 && copy.Usage == 1);
+	assert(CSet_Insert(&copy, 5) && CSet_Contains(&copy, -30000001));
+	CSet_Insert(&small, 1);
+	assert(CSet_Copy(&set, &small) && !(set.Flags & CSET_FLAG_MAPPED));
+	assert(CSet_Equals(&set, &small) && set.Data[1] == INT32_MAX);
+	free(values);
+	CSet_makeEmpty(&set);
+	CSet_makeEmpty(&copy);
+	assert(copy.Flags == 0);
+
+	// Sets of billions of elements need tens of GB, so they only run when
+	// CSET_HUGE_ELEMENTS is set (up to 4294967294); timings are printed
+	const char* env = getenv("CSET_HUGE_ELEMENTS");
+	uint64_t total = env ? strtoull(env, NULL, 10) : 0;
+	if(total > 0 && total < UINT32_MAX){
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		uint64_t k = 0;
+		while(k < total){
+			assert(CSet_Insert(&set, (int32_t)((int64_t) k + INT32_MIN)));
+			k++;
+		}
+		printf("inserted %llu elements in %.1f s\n", (unsigned long long) total, Seconds_Since(&start));
+		assert(CSet_Size(&set) == total && set.Data[total] == INT32_MAX);
+		assert(set.Data[total - 1] == (int32_t)((int64_t) total - 1 + INT32_MIN));
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		uint64_t hits = 0;
+		k = 0;
+		while(k < 10000000){
+			int64_t probe = (int64_t)((k * 2654435761u) % (total + total / 4)) + INT32_MIN;
+			hits += CSet_Contains(&set, (int32_t) probe);
+			k++;
+		}
+		printf("10M lookups in %.2f s (%llu hits)\n", Seconds_Since(&start), (unsigned long long) hits);
+		assert(hits > 0);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		assert(CSet_Copy(&copy, &set));
+		printf("copied in %.2f s\n", Seconds_Since(&start));
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		assert(CSet_Equals(&copy, &set));
+		printf("compared in %.2f s\n", Seconds_Since(&start));
+		if(total == UINT32_MAX - 1){
+			assert(set.Capacity == UINT32_MAX && CSet_Insert(&set, INT32_MAX - 1) == false);
+		}
+		CSet_makeEmpty(&set);
+		CSet_makeEmpty(&copy);
+	}
+	CSet_makeEmpty(&small);
+	printf("%s\n", "Passed Huge Tests...\n");
+}
+
+void Test_View(){
+	printf("Test_View()-----------------------------------------------\n");
+	CSet a, b, c, expect, part;
+	CSet_Init(&a, 0);
+	CSet_Init(&b, 0);
+	CSet_Init(&c, 0);
+	CSet_Init(&expect, 0);
+	CSet_Init(&part, 0);
+	int32_t i = 0;
+	while(i < 200){
+		CSet_Insert(&a, i * 2);
+		CSet_Insert(&b, i * 3);
+		CSet_Insert(&c, i * 5);
+		i++;
+	}
+	CSet_View u, n, d, w, twice;
+	CSet* abc[3] = {&a, &b, &c};
+	CSet* ac[2] = {&a, &c};
+	CSet* aab[3] = {&a, &a, &b};
+	assert(!CSet_View_Init(&u, 7, abc, 2));
+	assert(CSet_View_Init(&u, CSET_VIEW_UNION, abc, 2));
+	assert(CSet_View_Init(&n, CSET_VIEW_INTERSECTION, ac, 2));
+	assert(CSet_View_Init(&d, CSET_VIEW_DIFFERENCE, abc, 2));
+	assert(CSet_View_Init(&twice, CSET_VIEW_UNION, aab, 3));
+	CSet* uc[2] = {&u.Result, &c};
+	assert(CSet_View_Init(&w, CSET_VIEW_INTERSECTION, uc, 2));
+	CSet_Union(&expect, &a, &b);
+	assert(CSet_Equals(&u.Result, &expect) && CSet_Equals(&twice.Result, &expect));
+	CSet_Intersection(&expect, &a, &c);
+	assert(CSet_Equals(&n.Result, &expect));
+	CSet_Difference(&expect, &a, &b);
+	assert(CSet_Equals(&d.Result, &expect));
+
+	// Single deltas: a value shared by a and b stays in the union when it
+	// leaves a, and changes propagate through u into w
+	assert(CSet_Remove(&a, 6) && CSet_Contains(&u.Result, 6));
+	assert(CSet_Remove(&b, 6) && !CSet_Contains(&u.Result, 6) && !CSet_Contains(&twice.Result, 6));
+	assert(CSet_Remove(&a, 30) && CSet_Contains(&w.Result, 30));
+	assert(CSet_Remove(&b, 30) && !CSet_Contains(&w.Result, 30));
+	assert(CSet_Insert(&b, 7) && CSet_Insert(&c, 7) && CSet_Contains(&w.Result, 7));
+	uint32_t seed = 12345;
+	i = 0;
+	while(i < 3000){
+		seed = seed * 1103515245u + 12345u;
+		CSet* pSet = abc[(seed >> 16) % 3];
+		int32_t val = (int32_t)((seed >> 4) % 700);
+		if(seed & 0x100){
+			CSet_Insert(pSet, val);
+		}
+		else{
+			CSet_Remove(pSet, val);
+		}
+		i++;
+	}
+	CSet_RemoveRange(&a, 100, 200);
+	CSet_RemoveMany(&b, (const int32_t[]){3, 9, 27, 81, 243}, 5);
+	CSet_Union(&expect, &a, &b);
+	assert(CSet_Equals(&u.Result, &expect) && CSet_Equals(&twice.Result, &expect));
+	CSet_Intersection(&part, &expect, &c);
+	assert(CSet_Equals(&w.Result, &part));
+	CSet_Intersection(&expect, &a, &c);
+	assert(CSet_Equals(&n.Result, &expect));
+	CSet_Difference(&expect, &a, &b);
+	assert(CSet_Equals(&d.Result, &expect));
+	assert(!u.Stale && !n.Stale && !d.Stale && !w.Stale);
+
+	// Batches: small ones are applied value by value, large ones by a merge
+	uint32_t size = 2;
+	while(size <= 512){
+		CSet_View_Begin(&u);
+		CSet_View_Begin(&n);
+		CSet_View_Begin(&d);
+		CSet_Copy(&expect, &u.Result);
+		i = 0;
+		while(i < (int32_t) size){
+			seed = seed * 1103515245u + 12345u;
+			CSet* pSet = abc[(seed >> 16) % 3];
+			int32_t val = (int32_t)((seed >> 4) % 1000);
+			if(seed & 0x100){
+				CSet_Insert(pSet, val);
+			}
+			else{
+				CSet_Remove(pSet, val);
+			}
+			i++;
+		}
+		assert(CSet_Equals(&u.Result, &expect));
+		assert(CSet_View_Commit(&u) && CSet_View_Commit(&n) && CSet_View_Commit(&d));
+		CSet_Union(&expect, &a, &b);
+		assert(CSet_Equals(&u.Result, &expect) && CSet_Equals(&twice.Result, &expect));
+		CSet_Intersection(&part, &expect, &c);
+		assert(CSet_Equals(&w.Result, &part));
+		CSet_Intersection(&expect, &a, &c);
+		assert(CSet_Equals(&n.Result, &expect));
+		CSet_Difference(&expect, &a, &b);
+		assert(CSet_Equals(&d.Result, &expect));
+		size *= 4;
+	}
+
+	// Union counts survive a merge: removing from one input keeps the
+	// elements still present in the other
+	CSet_View_Begin(&u);
+	CSet_RemoveRange(&a, 0, 500);
+	assert(CSet_View_Commit(&u));
+	CSet_Remove(&b, 0);
+	CSet_Union(&expect, &a, &b);
+	assert(CSet_Equals(&u.Result, &expect));
+
+	// Wholesale replacement of an input rebuilds the view
+	int32_t values[4] = {1, 2, 3, 4};
+	CSet_Load(&c, 10, values, 4);
+	CSet_Intersection(&expect, &a, &c);
+	assert(CSet_Equals(&n.Result, &expect));
+	CSet_makeEmpty(&a);
+	assert(CSet_isEmpty(&n.Result) && CSet_isEmpty(&d.Result) && CSet_Equals(&u.Result, &b));
+
+	CSet_View_Free(&w);
+	CSet_View_Free(&u);
+	CSet_View_Free(&n);
+	CSet_View_Free(&d);
+	CSet_View_Free(&twice);
+	assert(a.Observers == NULL && b.Observers == NULL && c.Observers == NULL);
+	CSet_makeEmpty(&a);
+	CSet_makeEmpty(&b);
+	CSet_makeEmpty(&c);
+	CSet_makeEmpty(&expect);
+	CSet_makeEmpty(&part);
+	printf("%s\n", "Passed View Tests...\n");
+}
+
+void Test_Batch(){
+	printf("Test_Batch()----------------------------------------------\n");
+	const uint32_t sets = 400;
+	const uint32_t count = 20000;
+	CSet* inputs = (CSet*) malloc(sizeof(CSet) * sets);
+	CSet_Batch_Op* ops = (CSet_Batch_Op*) malloc(sizeof(CSet_Batch_Op) * count);
+	CSet* results = (CSet*) malloc(sizeof(CSet) * count);
+	uint32_t seed = 99;
+	uint32_t i = 0;
+	while(i < sets){
+		CSet_Init(&inputs[i], 0);
+		// mostly tiny sets, with a few large ones to unbalance the tasks
+		uint32_t size = (i % 50 == 0) ? 60000 : 1 + i % 40;
+		uint32_t k = 0;
+		while(k < size){
+			seed = seed * 1103515245u + 12345u;
+			CSet_Insert(&inputs[i], (int32_t)((seed >> 8) % (size * 4)));
+			k++;
+		}
+		i++;
+	}
+	i = 0;
+	while(i < count){
+		seed = seed * 1103515245u + 12345u;
+		ops[i].Op = CSET_BATCH_UNION + (seed >> 28) % 3;
+		ops[i].pA = &inputs[(seed >> 4) % sets];
+		ops[i].pB = &inputs[(seed >> 14) % sets];
+		CSet_Init(&results[i], 0);
+		ops[i].pResult = &results[i];
+		i++;
+	}
+	CSet expect;
+	CSet_Init(&expect, 0);
+	uint32_t threads[3] = {1, 4, 0};
+	uint32_t t = 0;
+	while(t < 3){
+		CSet_Pool* pPool = CSet_Pool_Create(threads[t]);
+		assert(pPool && CSet_Pool_Threads(pPool) >= 1);
+		uint32_t round = 0;
+		while(round < 2){
+			assert(CSet_Pool_Run(pPool, ops, count));
+			i = 0;
+			while(i < count){
+				assert(!ops[i].Failed && (results[i].Flags & CSET_FLAG_READONLY));
+				if(ops[i].Op == CSET_BATCH_UNION){
+					CSet_Union(&expect, ops[i].pA, ops[i].pB);
+				}
+				else if(ops[i].Op == CSET_BATCH_INTERSECTION){
+					CSet_Intersection(&expect, ops[i].pA, ops[i].pB);
+				}
+				else{
+					CSet_Difference(&expect, ops[i].pA, ops[i].pB);
+				}
+				assert(CSet_Equals(&results[i], &expect) && CSet_Hash(&results[i]) == CSet_Hash(&expect));
+				assert(results[i].Data[results[i].Usage] == INT32_MAX);
+				CSet_makeEmpty(&expect);
+				i++;
+			}
+			CSet_Pool_Reset(pPool);
+			round++;
+		}
+		// Results borrow arena storage: they cannot be modified, but a copy can
+		assert(CSet_Pool_Run(pPool, ops, 1));
+		assert(!CSet_Insert(&results[0], INT32_MAX - 1));
+		assert(CSet_Copy(&expect, &results[0]) && CSet_Insert(&expect, INT32_MAX - 1));
+		CSet_makeEmpty(&expect);
+		CSet_Batch_Op bad = {99, &inputs[0], &inputs[1], &expect, false};
+		assert(!CSet_Pool_Run(pPool, &bad, 1) && bad.Failed && expect.Data == NULL);
+		assert(CSet_Pool_Run(pPool, ops, 0));
+		CSet_Pool_Destroy(pPool);
+		t++;
+	}
+
+	// Throughput of many tiny operations, sequential versus the pool
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	i = 0;
+	while(i < count){
+		CSet_Intersection(&expect, ops[i].pA, ops[i].pB);
+		CSet_makeEmpty(&expect);
+		i++;
+	}
+	double sequential = Seconds_Since(&start);
+	CSet_Pool* pPool = CSet_Pool_Create(0);
+	i = 0;
+	while(i < count){
+		ops[i].Op = CSET_BATCH_INTERSECTION;
+		i++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	assert(CSet_Pool_Run(pPool, ops, count));
+	printf("%u intersections: %.3f s sequential, %.3f s on %u threads\n", count, sequential,
+	       Seconds_Since(&start), CSet_Pool_Threads(pPool));
+	CSet_Pool_Destroy(pPool);
+	i = 0;
+	while(i < count){
+		CSet_makeEmpty(&results[i]);
+		i++;
+	}
+	i = 0;
+	while(i < sets){
+		CSet_makeEmpty(&inputs[i]);
+		i++;
+	}
+	free(inputs);
+	free(ops);
+	free(results);
+	printf("%s\n", "Passed Batch Tests...\n");
+}
+
+bool PMA_Matches(const CSet_PMA* pPMA, const CSet* pSet){
+	uint32_t segments = pPMA->Capacity / pPMA->Segment;
+	uint32_t s = 0;
+	uint64_t total = 0;
+	while(s < segments){
+		// every segment is non-empty unless there is only one
+		if(pPMA->Counts[s] > pPMA->Segment || (segments > 1 && pPMA->Counts[s] == 0)){
+			return false;
+		}
+		total += pPMA->Counts[s];
+		s++;
+	}
+	uint32_t cursor = 0;
+	uint32_t i = 0;
+	int32_t value;
+	while(CSet_PMA_Next(pPMA, &cursor, &value)){
+		if(i >= CSet_Size(pSet) || pSet->Data[i] != value){
+			return false;
+		}
+		i++;
+	}
+	return i == CSet_Size(pSet) && total == i && CSet_PMA_Size(pPMA) == i;
+}
+
+void Test_PMA(){
+	printf("Test_PMA()------------------------------------------------\n");
+	CSet_PMA pma;
+	CSet set, dense;
+	CSet_Init(&set, 0);
+	CSet_Init(&dense, 0);
+	assert(CSet_PMA_Init(&pma) && CSet_PMA_Size(&pma) == 0 && PMA_Matches(&pma, &set));
+	assert(!CSet_PMA_Contains(&pma, 5) && !CSet_PMA_Remove(&pma, 5));
+	assert(!CSet_PMA_Insert(&pma, INT32_MAX));
+
+	// Random updates, growing and then shrinking the array
+	uint32_t seed = 7;
+	uint32_t step = 0;
+	while(step < 60000){
+		seed = seed * 1103515245u + 12345u;
+		int32_t val = (int32_t)((seed >> 8) % 20000) - 10000;
+		bool insert = step < 40000 ? (seed & 0x10) || (seed & 0x20) : (seed & 0x10) && (seed & 0x20);
+		if(insert){
+			assert(CSet_PMA_Insert(&pma, val) == CSet_Insert(&set, val));
+		}
+		else{
+			assert(CSet_PMA_Remove(&pma, val) == CSet_Remove(&set, val));
+		}
+		if(step % 5000 == 0){
+			assert(PMA_Matches(&pma, &set));
+		}
+		step++;
+	}
+	assert(PMA_Matches(&pma, &set));
+	assert(CSet_PMA_Contains(&pma, set.Data[0]) && !CSet_PMA_Contains(&pma, 10001));
+	assert(CSet_PMA_Compact(&pma, &dense) && CSet_Equals(&dense, &set));
+	assert(dense.Capacity == dense.Usage + 1 && dense.Hash == set.Hash);
+	uint32_t before = pma.Capacity;
+	while(CSet_Size(&set) > 3){
+		int32_t val = set.Data[CSet_Size(&set) / 2];
+		assert(CSet_Remove(&set, val) && CSet_PMA_Remove(&pma, val));
+	}
+	assert(PMA_Matches(&pma, &set) && pma.Capacity < before);
+
+	// Ascending and descending runs fill the ends of the array
+	CSet_makeEmpty(&set);
+	assert(CSet_PMA_Build(&pma, &set) && PMA_Matches(&pma, &set));
+	int32_t i = 0;
+	while(i < 30000){
+		CSet_PMA_Insert(&pma, i);
+		CSet_PMA_Insert(&pma, -1 - i);
+		i++;
+	}
+	assert(CSet_PMA_Size(&pma) == 60000);
+	assert(CSet_PMA_Compact(&pma, &dense) && CSet_Size(&dense) == 60000);
+	assert(dense.Data[0] == -30000 && dense.Data[59999] == 29999);
+	assert(CSet_PMA_Build(&pma, &dense) && PMA_Matches(&pma, &dense));
+	assert(pma.Usage * 4 <= pma.Capacity * 2 && pma.Usage * 4 > pma.Capacity);
+
+	// Random inserts into a large set: the PMA against the dense array
+	uint32_t n = 200000;
+	struct timespec start;
+	CSet_PMA_Free(&pma);
+	CSet_PMA_Init(&pma);
+	CSet_makeEmpty(&set);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	seed = 1;
+	uint32_t k = 0;
+	while(k < n){
+		seed = seed * 1103515245u + 12345u;
+		CSet_Insert(&set, (int32_t)(seed >> 1));
+		k++;
+	}
+	double dense_time = Seconds_Since(&start);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	seed = 1;
+	k = 0;
+	while(k < n){
+		seed = seed * 1103515245u + 12345u;
+		CSet_PMA_Insert(&pma, (int32_t)(seed >> 1));
+		k++;
+	}
+	printf("%u random inserts: %.3f s dense, %.3f s packed memory array\n", n, dense_time, Seconds_Since(&start));
+	assert(PMA_Matches(&pma, &set));
+	CSet_PMA_Free(&pma);
+	assert(pma.Cells == NULL);
+	CSet_makeEmpty(&set);
+	CSet_makeEmpty(&dense);
+	printf("%s\n", "Passed PMA Tests...\n");
+}
+
+void Test_Frozen(){
+	printf("Test_Frozen()---------------------------------------------\n");
+	CSet_Frozen frozen, other;
+	memset(&frozen, 0, sizeof(CSet_Frozen));
+	memset(&other, 0, sizeof(CSet_Frozen));
+	CSet set, read;
+	CSet_Init(&set, 0);
+	CSet_Init(&read, 0);
+	assert(CSet_Frozen_Build(&frozen, &set, 1) && frozen.Count == 0);
+	assert(!CSet_Frozen_Contains(&frozen, 0) && !CSet_Frozen_Contains(&frozen, INT32_MIN));
+
+	// Built on one and on four threads, the index answers like the set
+	uint32_t n = 300000;
+	uint32_t seed = 3;
+	while(CSet_Size(&set) < n){
+		seed = seed * 1103515245u + 12345u;
+		CSet_Insert(&set, (int32_t)(seed ^ (seed << 16)));
+	}
+	uint32_t threads = 1;
+	while(threads <= 4){
+		assert(CSet_Frozen_Build(&frozen, &set, threads));
+		assert(frozen.Count == n && frozen.SetHash == CSet_Hash(&set));
+		assert(frozen.Levels > 1 && frozen.SpillCount < 16);
+		assert((uint64_t) frozen.BlockCount * 512 < (uint64_t) n * 5);
+		uint32_t i = 0;
+		while(i < n){
+			assert(CSet_Frozen_Contains(&frozen, set.Data[i]));
+			i++;
+		}
+		uint32_t misses = 0;
+		i = 0;
+		while(i < n){
+			seed = seed * 1103515245u + 12345u;
+			int32_t val = (int32_t) seed;
+			assert(CSet_Frozen_Contains(&frozen, val) == CSet_Contains(&set, val));
+			misses += !CSet_Contains(&set, val);
+			i++;
+		}
+		assert(misses > n / 2);
+		threads += 3;
+	}
+
+	// Written after its set, the index is read back and checked against it
+	FILE* file = tmpfile();
+	assert(file != NULL);
+	assert(CSet_Write(&set, file) && CSet_Frozen_Write(&frozen, file));
+	rewind(file);
+	assert(CSet_Read(&read, file) && CSet_Frozen_Read(&other, file, &read));
+	assert(other.Count == n && other.Levels == frozen.Levels && other.BlockCount == frozen.BlockCount);
+	uint32_t i = 0;
+	while(i < n){
+		assert(CSet_Frozen_Contains(&other, read.Data[i]));
+		assert(CSet_Frozen_Contains(&other, read.Data[i] + 1) == CSet_Contains(&read, read.Data[i] + 1));
+		i++;
+	}
+	assert(CSet_Remove(&read, read.Data[0]));
+	rewind(file);
+	assert(CSet_Read(&set, file) && !CSet_Frozen_Read(&other, file, &read));
+	assert(other.Count == n);
+	fclose(file);
+
+	// Lookups of members: the index against binary search
+	struct timespec start;
+	uint32_t found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	i = 0;
+	while(i < 4 * n){
+		found += CSet_Contains(&set, set.Data[(i * 2654435761u) % n]);
+		i++;
+	}
+	double search_time = Seconds_Since(&start);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	i = 0;
+	while(i < 4 * n){
+		found += CSet_Frozen_Contains(&frozen, set.Data[(i * 2654435761u) % n]);
+		i++;
+	}
+	assert(found == 8 * n);
+	printf("%u lookups: %.3f s binary search, %.3f s frozen index\n", 4 * n, search_time, Seconds_Since(&start));
+	CSet_Frozen_Free(&frozen);
+	CSet_Frozen_Free(&other);
+	assert(frozen.Blocks == NULL && !CSet_Frozen_Contains(&frozen, set.Data[0]));
+	CSet_makeEmpty(&set);
+	CSet_makeEmpty(&read);
+	printf("%s\n", "Passed Frozen Tests...\n");
+}
+
+void Test_Trace(){
+	printf("Test_Trace()----------------------------------------------\n");
+	CSet_Trace trace;
+	CSet_Replay_Report report;
+	CSet a, b, c;
+	FILE* file = tmpfile();
+	assert(file != NULL);
+
+	// Record a mixed workload to a file
+	assert(CSet_Trace_Start(&trace, file, 1 << 16) && CSet_Active_Trace == &trace);
+	CSet_Init(&a, 0);
+	CSet_Init(&b, 100);
+	CSet_Init(&c, 0);
+	int32_t loaded[5] = {-7, 2, 9, 40, 41};
+	assert(CSet_Load(&b, 10, loaded, 5));
+	uint32_t seed = 5;
+	uint32_t contains = 0;
+	uint32_t i = 0;
+	while(i < 20000){
+		seed = seed * 1103515245u + 12345u;
+		int32_t val = (int32_t)((seed >> 8) % 5000);
+		if(seed & 0x10){
+			CSet_Insert(&a, val);
+		}
+		else if(seed & 0x20){
+			CSet_Remove(&a, val);
+		}
+		else{
+			CSet_Contains(&a, val);
+			contains++;
+		}
+		i++;
+	}
+	int32_t victims[4] = {30, 10, 20, 5000};
+	CSet_RemoveMany(&a, victims, 4);
+	assert(CSet_RemoveIf(&a, Is_Multiple_Of_Three, NULL) > 0);
+	CSet_RemoveRange(&a, 100, 200);
+	assert(CSet_Union(&c, &a, &b));
+	assert(CSet_Intersects(&c, &b) && CSet_isSubsetOf(&b, &c));
+	CSet_Copy(&b, &c);
+	assert(CSet_Difference(&c, &a, &b) && CSet_isEmpty(&c));
+	CSet_Size(&a);
+	assert(CSet_Trace_Stop(&trace) && CSet_Active_Trace == NULL);
+	assert(trace.Sets == 3 && trace.Dropped == 0);
+	uint64_t records = trace.Records;
+	uint64_t state = CSet_Hash(&a) + CSet_Hash(&b) + CSet_Hash(&c);
+	CSet_Insert(&a, -1);
+	assert(trace.Records == records);
+
+	// Replaying on dense sets reproduces every set
+	rewind(file);
+	assert(CSet_Replay_Run(file, &CSet_Replay_Dense, &report));
+	assert(report.Records == records && report.Sets == 3 && report.StateHash == state);
+	assert(report.Ops[CSET_TRACE_CONTAINS].Count == contains && report.Ops[CSET_TRACE_UNION].Count == 1);
+	assert(report.Ops[CSET_TRACE_REMOVE_MANY].Count == 2 && report.Ops[CSET_TRACE_INIT].Count == 3);
+	i = 1;
+	while(i < CSET_TRACE_OPS){
+		assert(report.Ops[i].Skipped == 0);
+		assert(report.Ops[i].Count == 0 || report.Ops[i].Ns[0] <= report.Ops[i].Ns[4]);
+		i++;
+	}
+	CSet_Replay_Print(&report, stdout);
+
+	// Packed memory arrays run the point operations and skip the rest
+	rewind(file);
+	assert(CSet_Replay_Run(file, &CSet_Replay_Packed, &report));
+	assert(report.Records == records && report.Ops[CSET_TRACE_CONTAINS].Count == contains);
+	assert(report.Ops[CSET_TRACE_UNION].Skipped == 1 && report.Ops[CSET_TRACE_REMOVE_RANGE].Skipped == 1);
+	CSet_Replay_Print(&report, stdout);
+	fclose(file);
+
+	// A ring keeps only the most recent records
+	assert(CSet_Trace_Start(&trace, NULL, 4096));
+	i = 0;
+	while(i < 1000){
+		CSet_Contains(&a, (int32_t) i);
+		i++;
+	}
+	assert(CSet_Load(&b, 2000, loaded, 5));
+	assert(trace.Records == 1001 && trace.Dropped > 800);
+	file = tmpfile();
+	assert(file != NULL && CSet_Trace_Save(&trace, file));
+	assert(CSet_Trace_Stop(&trace));
+	rewind(file);
+	assert(CSet_Replay_Run(file, &CSet_Replay_Dense, &report));
+	assert(report.Records == trace.Records - trace.Dropped && report.Ops[CSET_TRACE_LOAD].Count == 1);
+	assert(report.StateHash == CSet_Hash(&b));
+	fclose(file);
+
+	// A file that is not a trace is rejected
+	file = tmpfile();
+	assert(file != NULL && CSet_Write(&a, file));
+	rewind(file);
+	assert(!CSet_Replay_Run(file, &CSet_Replay_Dense, &report));
+	fclose(file);
+	CSet_makeEmpty(&a);
+	CSet_makeEmpty(&b);
+	CSet_makeEmpty(&c);
+	printf("%s\n", "Passed Trace Tests...\n");
+}
+
+void Test_Shared(){
+	printf("Test_Shared()---------------------------------------------\n");
+	CSet_Shared writer, reader;
+	CSet a, b, c, view, result;
+	CSet_Init(&a, 0);
+	CSet_Init(&b, 0);
+	CSet_Init(&c, 0);
+	CSet_Init(&result, 0);
+	int32_t i = 0;
+	while(i < 1000){
+		CSet_Insert(&a, 2 * i);
+		i++;
+	}
+	uint32_t seed = 11;
+	while(CSet_Size(&c) < 8000){
+		seed = seed * 1103515245u + 12345u;
+		CSet_Insert(&c, (int32_t) seed);
+	}
+	const CSet* sets[3] = {&a, &b, &c};
+	char name[64];
+	snprintf(name, sizeof(name), "/cset_test_%d", (int) getpid());
+	CSet_Shared_Remove(name);
+	assert(CSet_Shared_Create(&writer, name, 1 << 18));
+	assert(CSet_Shared_Latest(&writer) == 0 && CSet_Shared_Pin(&writer) == 0);
+	assert(CSet_Shared_Publish(&writer, sets, 3) && CSet_Shared_Latest(&writer) == 1);
+
+	// Another process attaches by name and reads the sets in place
+	pid_t child = fork();
+	if(child == 0){
+		CSet_Shared other;
+		bool ok = CSet_Shared_Attach(&other, name, -1) && CSet_Shared_Pin(&other) == 1 &&
+		          CSet_Shared_Count(&other) == 3 && CSet_Shared_View(&other, 0, &view) &&
+		          CSet_Equals(&view, &a) && CSet_Contains(&view, 1998) && !CSet_Contains(&view, 1999) &&
+		          CSet_Shared_View(&other, 2, &view) && CSet_Equals(&view, &c);
+		CSet_Shared_Close(&other);
+		_exit(ok ? 0 : 1);
+	}
+	int status;
+	assert(child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	// A second mapping in this process sees the same sets at another address
+	assert(CSet_Shared_Attach(&reader, name, -1) && reader.Base != writer.Base);
+	assert(CSet_Shared_Pin(&reader) == 1 && CSet_Shared_Count(&reader) == 3);
+	assert(CSet_Shared_View(&reader, 0, &view) && (view.Flags & CSET_FLAG_READONLY));
+	assert(CSet_Equals(&view, &a) && CSet_Hash(&view) == CSet_Hash(&a) && !CSet_Insert(&view, 1));
+	assert(CSet_Difference(&result, &view, &b) && CSet_Equals(&result, &a) && CSet_isSubsetOf(&view, &result));
+	assert(CSet_Shared_View(&reader, 1, &view) && CSet_isEmpty(&view));
+	assert(!CSet_Shared_View(&reader, 3, &view));
+	assert(!CSet_Shared_Publish(&reader, sets, 3));
+
+	// While generation 1 is pinned the ring fills up; unpinning frees it
+	uint32_t published = 1;
+	while(CSet_Shared_Publish(&writer, sets, 3)){
+		published++;
+		assert(published < 100);
+	}
+	assert(published > 2 && CSet_Shared_Latest(&reader) == published);
+	assert(CSet_Shared_View(&reader, 2, &view) && CSet_Equals(&view, &c));
+	CSet_Shared_Unpin(&reader);
+	assert(CSet_Shared_Count(&reader) == 0 && CSet_Shared_Publish(&writer, sets, 3));
+	published++;
+	assert(CSet_Shared_Pin(&reader) == published);
+	CSet_Insert(&b, 42);
+	assert(CSet_Shared_Publish(&writer, sets, 3));
+	published++;
+	assert(CSet_Shared_View(&reader, 1, &view) && CSet_isEmpty(&view));
+	assert(CSet_Shared_Pin(&reader) == published && CSet_Shared_View(&reader, 1, &view) && CSet_Contains(&view, 42));
+
+	// A process that exits while pinning does not hold versions forever
+	CSet_Shared_Unpin(&reader);
+	child = fork();
+	if(child == 0){
+		CSet_Shared other;
+		_exit(CSet_Shared_Attach(&other, name, -1) && CSet_Shared_Pin(&other) > 0 ? 0 : 1);
+	}
+	assert(child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	uint32_t more = 0;
+	while(more < 2 * published){
+		assert(CSet_Shared_Publish(&writer, sets, 3));
+		more++;
+	}
+	CSet_Shared_Close(&reader);
+	CSet_Shared_Close(&writer);
+	assert(CSet_Shared_Remove(name) && !CSet_Shared_Attach(&reader, name, -1));
+
+	// An anonymous segment is attached through its descriptor
+	assert(CSet_Shared_Create(&writer, NULL, 0) && CSet_Shared_Publish(&writer, sets + 2, 1));
+	assert(CSet_Shared_Attach(&reader, NULL, writer.Fd) && CSet_Shared_Pin(&reader) == 1);
+	assert(CSet_Shared_View(&reader, 0, &view) && CSet_Equals(&view, &c));
+	CSet_Shared_Close(&reader);
+	CSet_Shared_Close(&writer);
+	CSet_makeEmpty(&a);
+	CSet_makeEmpty(&b);
+	CSet_makeEmpty(&c);
+	CSet_makeEmpty(&result);
+	printf("%s\n", "Passed Shared Tests...\n");
+}
+
+void Test_Ownership(){
+	printf("Test_Ownership()------------------------------------------\n");
+	CSet a, b, view;
+	CSet_Init(&a, 0);
+	CSet_Init(&b, 0);
+	uint32_t resets = 0;
+	CSet_Observer observer = {NULL, NULL, Count_Ownership_Reset, &resets, NULL};
+	CSet_Attach(&a, &observer);
+
+	// Adopting takes the buffer as is; a rejected buffer stays the caller's
+	int32_t* buffer = (int32_t*) malloc(sizeof(int32_t) * 8);
+	int32_t values[5] = {-4, 0, 3, 7, 9};
+	memcpy(buffer, values, sizeof(values));
+	buffer[2] = 10;
+	assert(!CSet_AdoptSorted(&a, buffer, 5, 8, 0, true) && CSet_isEmpty(&a) && resets == 0);
+	assert(!CSet_AdoptSorted(&a, buffer, 8, 8, 0, false));
+	buffer[2] = 3;
+	assert(CSet_AdoptSorted(&a, buffer, 5, 8, 0, true) && a.Data == buffer && resets == 1);
+	assert(a.Capacity == 8 && a.Data[5] == INT32_MAX && a.Data[7] == INT32_MAX);
+	assert(CSet_Hash(&a) == CSet_HashElements(values, 5) && CSet_Contains(&a, 7));
+	assert(CSet_Insert(&a, 5) && CSet_Insert(&a, 100) && CSet_Insert(&a, 101) && CSet_Size(&a) == 8);
+
+	// Move hands the array over, Swap exchanges arrays, observers stay put
+	int32_t* data = a.Data;
+	assert(CSet_BuildSummary(&a));
+	CSet_Move(&b, &a);
+	assert(b.Data == data && b.Summary != NULL && CSet_Size(&b) == 8 && CSet_Contains(&b, 101));
+	assert(a.Data == NULL && a.Summary == NULL && CSet_isEmpty(&a) && a.Observers == &observer && resets == 2);
+	assert(b.Observers == NULL);
+	CSet_Insert(&a, 1);
+	int32_t* small = a.Data;
+	CSet_Swap(&a, &b);
+	assert(a.Data == data && b.Data == small && CSet_Size(&a) == 8 && CSet_Size(&b) == 1);
+	assert(a.Observers == &observer && b.Observers == NULL && resets == 3 && a.Summary && !b.Summary);
+	CSet_Move(&a, &a);
+	assert(CSet_Size(&a) == 8);
+
+	// Release gives the array back without copying, ready to be adopted again
+	uint32_t usage, capacity, flags;
+	int32_t* released = CSet_Release(&a, &usage, &capacity, &flags);
+	assert(released == data && usage == 8 && capacity >= 9 && flags == 0);
+	assert(CSet_isEmpty(&a) && a.Summary == NULL && resets == 4);
+	assert(released[0] == -4 && released[7] == 101 && released[8] == INT32_MAX);
+	uint32_t kept = capacity;
+	assert(CSet_Release(&a, &usage, &capacity, &flags) == NULL && usage == 0 && capacity == 0);
+	assert(CSet_AdoptSorted(&b, released, 8, kept, 0, false) && b.Data == data);
+	assert(CSet_Size(&b) == 8 && CSet_Contains(&b, -4));
+
+	// Borrowed storage cannot be released
+	view = b;
+	view.Flags |= CSET_FLAG_READONLY;
+	view.Observers = NULL;
+	assert(CSet_Release(&view, &usage, &capacity, &flags) == NULL && view.Data == data);
+	released = CSet_Release(&b, &usage, &capacity, &flags);
+	CSet_FreeArray(released, capacity, flags);
+	CSet_FreeArray(NULL, 0, 0);
+
+	// Transfers are traced and replayed
+	CSet_Trace trace;
+	CSet_Replay_Report report;
+	FILE* file = tmpfile();
+	assert(file != NULL && CSet_Trace_Start(&trace, file, 0));
+	CSet_Insert(&a, 3);
+	CSet_Insert(&b, 4);
+	CSet_Swap(&a, &b);
+	CSet_Move(&b, &a);
+	CSet_Insert(&a, 5);
+	released = CSet_Release(&a, &usage, &capacity, &flags);
+	assert(CSet_Trace_Stop(&trace));
+	rewind(file);
+	assert(CSet_Replay_Run(file, &CSet_Replay_Dense, &report));
+	assert(report.StateHash == CSet_Hash(&a) + CSet_Hash(&b) && report.Ops[CSET_TRACE_MOVE].Count == 1);
+	assert(report.Ops[CSET_TRACE_SWAP].Count == 1 && report.Ops[CSET_TRACE_RELEASE].Count == 1);
+	rewind(file);
+	assert(CSet_Replay_Run(file, &CSet_Replay_Packed, &report) && report.StateHash == CSet_Hash(&b));
+	fclose(file);
+	CSet_FreeArray(released, capacity, flags);
+	assert(CSet_Detach(&a, &observer));
+	CSet_makeEmpty(&a);
+	CSet_makeEmpty(&b);
+	printf("%s\n", "Passed Ownership Tests...\n");
+}
+
+void Test_Join(){
+	printf("Test_Join()-----------------------------------------------\n");
+	uint32_t n = 150;
+	CSet sets[150];
+	const CSet* pSets[150];
+	uint32_t seed = 11;
+	uint32_t i = 0;
+	while(i < n){
+		CSet_Init(&sets[i], 0);
+		pSets[i] = &sets[i];
+		if(i >= 100 && i != 120){
+
+			// Near-duplicates of earlier sets: drop about a tenth, add a few
+			const CSet* pBase = &sets[i - 100 + (i % 3)];
+			uint32_t j = 0;
+			while(j < CSet_Size(pBase)){
+				seed = seed * 1103515245u + 12345u;
+				if((seed >> 16) % 10 != 0){
+					CSet_Insert(&sets[i], pBase->Data[j]);
+				}
+				j++;
+			}
+			CSet_Insert(&sets[i], 5000 + (int32_t) i);
+		}
+		else if(i != 7 && i != 120){
+			seed = seed * 1103515245u + 12345u;
+			uint32_t size = (seed >> 16) % 300;
+			while(CSet_Size(&sets[i]) < size){
+				seed = seed * 1103515245u + 12345u;
+				int32_t val = (int32_t)((seed >> 8) % 4000) - 2000;
+				CSet_Insert(&sets[i], (seed & 7) == 0 ? val : val / 8);
+			}
+		}
+		i++;
+	}
+	CSet_Copy(&sets[8], &sets[9]);
+	CSet_Insert(&sets[120], INT32_MIN);
+	CSet_Insert(&sets[120], INT32_MAX - 1);
+
+	// Brute-force overlaps of every pair
+	uint32_t* expected = (uint32_t*) malloc(sizeof(uint32_t) * n * n);
+	uint32_t* matrix = (uint32_t*) malloc(sizeof(uint32_t) * n * n);
+	assert(expected != NULL && matrix != NULL);
+	i = 0;
+	while(i < n){
+		uint32_t j = 0;
+		while(j < n){
+			uint32_t k = 0, common = 0;
+			while(k < CSet_Size(&sets[i])){
+				common += CSet_Contains(&sets[j], sets[i].Data[k]);
+				k++;
+			}
+			expected[i * n + j] = common;
+			j++;
+		}
+		i++;
+	}
+	assert(expected[7 * n + 7] == 0 && expected[8 * n + 9] == CSet_Size(&sets[9]));
+
+	// The count matrix, on one and on four threads
+	uint32_t threads = 1;
+	while(threads <= 4){
+		memset(matrix, 0xFF, sizeof(uint32_t) * n * n);
+		assert(CSet_Join_Counts(pSets, n, matrix, threads));
+		assert(memcmp(matrix, expected, sizeof(uint32_t) * n * n) == 0);
+		threads += 3;
+	}
+	assert(CSet_Join_Counts(pSets, 0, NULL, 1));
+
+	// Thresholded joins against the pairs found from the brute-force matrix
+	double thresholds[4] = {1.0, 0.75, 0.3, 0.05};
+	uint32_t t = 0;
+	while(t < 4){
+		CSet_Join_Pair* pairs = NULL;
+		uint64_t count = 0, k = 0;
+		assert(CSet_Join_Similar(pSets, n, thresholds[t], 1 + 2 * t, &pairs, &count));
+		i = 0;
+		while(i < n){
+			uint32_t j = i + 1;
+			while(j < n){
+				uint32_t o = expected[i * n + j];
+				uint32_t sizes = CSet_Size(&sets[i]) + CSet_Size(&sets[j]);
+				if(sizes > 0 && (double) o / ((double) sizes - o) >= thresholds[t]){
+					assert(k < count && pairs[k].A == i && pairs[k].B == j && pairs[k].Overlap == o);
+					assert(pairs[k].Jaccard == CSet_Jaccard(&sets[i], &sets[j]));
+					k++;
+				}
+				j++;
+			}
+			i++;
+		}
+		assert(k == count && count > 0);
+		if(t == 0){
+			assert(count == 1 && pairs[0].A == 8 && pairs[0].B == 9);
+		}
+		free(pairs);
+		t++;
+	}
+	CSet_Join_Pair* pairs = NULL;
+	uint64_t count = 7;
+	assert(!CSet_Join_Similar(pSets, n, 0.0, 1, &pairs, &count) && !CSet_Join_Similar(pSets, n, 1.5, 1, &pairs, &count));
+	assert(pairs == NULL && count == 7);
+
+	// Overlaps of 1000 sets: pairwise merges against the count join
+	uint32_t many = 1000;
+	CSet* bulk = (CSet*) malloc(sizeof(CSet) * many);
+	const CSet** pBulk = (const CSet**) malloc(sizeof(CSet*) * many);
+	uint32_t* big = (uint32_t*) malloc(sizeof(uint32_t) * many * many);
+	assert(bulk != NULL && pBulk != NULL && big != NULL);
+	i = 0;
+	while(i < many){
+		CSet_Init(&bulk[i], 0);
+		pBulk[i] = &bulk[i];
+		while(CSet_Size(&bulk[i]) < 200){
+			seed = seed * 1103515245u + 12345u;
+			CSet_Insert(&bulk[i], (int32_t)((seed >> 8) % 100000));
+		}
+		i++;
+	}
+	struct timespec start;
+	double similarity = 0.0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	i = 0;
+	while(i < many){
+		uint32_t j = i + 1;
+		while(j < many){
+			similarity += CSet_Jaccard(&bulk[i], &bulk[j]);
+			j++;
+		}
+		i++;
+	}
+	double merge_time = Seconds_Since(&start);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	assert(CSet_Join_Counts(pBulk, many, big, 0));
+	printf("%u pairs: %.3f s pairwise merges, %.3f s count join\n", many * (many - 1) / 2, merge_time, Seconds_Since(&start));
+	assert(big[0] == 200 && big[1] == big[many] && similarity > 0.0);
+	i = 0;
+	while(i < many){
+		CSet_makeEmpty(&bulk[i]);
+		i++;
+	}
+	i = 0;
+	while(i < n){
+		CSet_makeEmpty(&sets[i]);
+		i++;
+	}
+	free(bulk);
+	free(pBulk);
+	free(big);
+	free(expected);
+	free(matrix);
+	printf("%s\n", "Passed Join Tests...\n");
+}
+
+CSET_FIXED_DEFINE(Feature_Set, 4096)
+CSET_FIXED_DEFINE(Small_Set, 100)
+
+static const Feature_Set Fixed_Primes = { .Words = {
+	[0] = CSET_FIXED_MASK(2) | CSET_FIXED_MASK(3) | CSET_FIXED_MASK(5) | CSET_FIXED_MASK(7),
+	[CSET_FIXED_WORD(4093)] = CSET_FIXED_MASK(4093) } };
+
+void Test_Fixed(){
+	printf("Test_Fixed()----------------------------------------------\n");
+	Feature_Set a = CSET_FIXED_EMPTY, b = CSET_FIXED_EMPTY, result = CSET_FIXED_EMPTY;
+	assert(sizeof(Feature_Set) == 512 && sizeof(Small_Set) == 16);
+	assert(Feature_Set_Size(&Fixed_Primes) == 5 && Feature_Set_Contains(&Fixed_Primes, 4093));
+	assert(Feature_Set_isEmpty(&a) && Feature_Set_Size(&a) == 0);
+
+	// Values outside the universe are rejected
+	Small_Set small = CSET_FIXED_EMPTY;
+	assert(!Small_Set_Insert(&small, 100) && !Small_Set_Insert(&small, -1) && !Small_Set_Insert(&small, INT32_MIN));
+	assert(Small_Set_Insert(&small, 99) && !Small_Set_Insert(&small, 99) && Small_Set_Insert(&small, 0));
+	assert(!Small_Set_Contains(&small, 100) && !Small_Set_Contains(&small, -1) && Small_Set_Contains(&small, 99));
+	assert(Small_Set_Size(&small) == 2 && Small_Set_Remove(&small, 99) && !Small_Set_Remove(&small, 99));
+	assert(!Small_Set_Remove(&small, 4000) && Small_Set_Size(&small) == 1);
+
+	// Random sets against the same operations on CSet objects
+	CSet setA, setB, converted, expected;
+	CSet_Init(&setA, 0);
+	CSet_Init(&setB, 0);
+	CSet_Init(&converted, 0);
+	CSet_Init(&expected, 0);
+	uint32_t seed = 5;
+	uint32_t trial = 1;
+	while(trial <= 20){
+		Feature_Set_makeEmpty(&a);
+		Feature_Set_makeEmpty(&b);
+		CSet_makeEmpty(&setA);
+		CSet_makeEmpty(&setB);
+		uint32_t i = 0;
+		while(i < 40 * trial){
+			seed = seed * 1103515245u + 12345u;
+			int32_t val = (int32_t)((seed >> 8) % 4096);
+			assert(Feature_Set_Insert(&a, val) == CSet_Insert(&setA, val));
+			seed = seed * 1103515245u + 12345u;
+			val = (int32_t)((seed >> 8) % (512 + 200 * trial));
+			if(val < 4096){
+				assert(Feature_Set_Insert(&b, val) == CSet_Insert(&setB, val));
+			}
+			i++;
+		}
+		assert(Feature_Set_Size(&a) == CSet_Size(&setA) && Feature_Set_Size(&b) == CSet_Size(&setB));
+		assert(Feature_Set_ToCSet(&a, &converted) && CSet_Equals(&converted, &setA));
+		assert(CSet_Hash(&converted) == CSet_Hash(&setA));
+		assert(Feature_Set_FromCSet(&result, &setB) && Feature_Set_Equals(&result, &b));
+		assert(Feature_Set_isSubsetOf(&a, &b) == CSet_isSubsetOf(&setA, &setB));
+		assert(Feature_Set_Intersects(&a, &b) == CSet_Intersects(&setA, &setB));
+		assert(Feature_Set_Equals(&a, &b) == CSet_Equals(&setA, &setB));
+
+		Feature_Set_Union(&result, &a, &b);
+		assert(CSet_Union(&expected, &setA, &setB) && Feature_Set_ToCSet(&result, &converted));
+		assert(CSet_Equals(&converted, &expected));
+		CSet_makeEmpty(&expected);
+		Feature_Set_Difference(&result, &a, &b);
+		assert(CSet_Difference(&expected, &setA, &setB) && Feature_Set_ToCSet(&result, &converted));
+		assert(CSet_Equals(&converted, &expected));
+		CSet_makeEmpty(&expected);
+		Feature_Set_Intersection(&result, &a, &b);
+		i = 0;
+		while(i < 4096){
+			assert(Feature_Set_Contains(&result, (int32_t) i) == (CSet_Contains(&setA, (int32_t) i) && CSet_Contains(&setB, (int32_t) i)));
+			i++;
+		}
+		trial++;
+	}
+
+	// Results may alias an operand; out-of-universe CSets are refused
+	Feature_Set copy = a;
+	Feature_Set_Intersection(&a, &a, &b);
+	Feature_Set_Union(&a, &a, &copy);
+	assert(Feature_Set_Equals(&a, &copy));
+	CSet_Insert(&setA, 4096);
+	assert(!Feature_Set_FromCSet(&a, &setA) && Feature_Set_Equals(&a, &copy));
+	CSet_makeEmpty(&setA);
+	CSet_Insert(&setA, -3);
+	assert(!Small_Set_FromCSet(&small, &setA) && Small_Set_Size(&small) == 1);
+	CSet_makeEmpty(&setA);
+	assert(Feature_Set_FromCSet(&a, &setA) && Feature_Set_isEmpty(&a));
+	assert(Feature_Set_ToCSet(&a, &converted) && CSet_isEmpty(&converted));
+
+	// Lookups and intersections of hot sets: fixed sets against CSet objects
+	struct timespec start;
+	uint32_t found = 0;
+	Feature_Set_FromCSet(&a, &setB);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	uint32_t i = 0;
+	while(i < 4000000){
+		found += CSet_Contains(&setB, (int32_t)((i * 2654435761u) >> 20));
+		i++;
+	}
+	double search_time = Seconds_Since(&start);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	i = 0;
+	while(i < 4000000){
+		found -= Feature_Set_Contains(&a, (int32_t)((i * 2654435761u) >> 20));
+		i++;
+	}
+	assert(found == 0);
+	printf("4000000 lookups: %.3f s CSet, %.3f s fixed set\n", search_time, Seconds_Since(&start));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	i = 0;
+	while(i < 1000000){
+		Feature_Set_Intersection(&result, &copy, &b);
+		copy.Words[i & 63] ^= result.Words[(i + 1) & 63] | 1;
+		found += Feature_Set_Size(&result);
+		i++;
+	}
+	printf("1000000 intersections with sizes: %.3f s (%u)\n", Seconds_Since(&start), found & 1);
+	CSet_makeEmpty(&setA);
+	CSet_makeEmpty(&setB);
+	CSet_makeEmpty(&converted);
+	CSet_makeEmpty(&expected);
+	printf("%s\n", "Passed Fixed Tests...\n");
+}
+
 int main(int argc, char* argv[]){
 	printf("Started to do set calculations...\n");
 	Test_Init();
@@ -329,9 +2275,30 @@ int main(int argc, char* argv[]){
 	Test_Copy();
 	Test_Contains();
 	Test_Remove();
+	Test_Bulk_Remove();
 	Test_Equals();
+	Test_Hash();
 	Test_Is_Subset_Of();
+	Test_Intersects();
+	Test_Summary();
 	Test_Union();
 	Test_Intersection();
 	Test_Difference();
+	Test_Ingest();
+	Test_Server();
+	Test_MinHash();
+	Test_Store();
+	Test_HLL();
+	Test_Kernels();
+	Test_External();
+	Test_Huge();
+	Test_View();
+	Test_Batch();
+	Test_PMA();
+	Test_Frozen();
+	Test_Trace();
+	Test_Shared();
+	Test_Ownership();
+	Test_Join();
+	Test_Fixed();
 }	
\ No newline at end of file